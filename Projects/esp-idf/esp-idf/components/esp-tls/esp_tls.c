@@ -457,6 +457,26 @@ static esp_err_t set_client_config(const char *hostname, size_t hostlen, esp_tls
     return ESP_OK;
 }
 
+#ifdef CONFIG_ESP_TLS_CLIENT_SESSION_TICKETS
+static void save_client_session(esp_tls_t *tls, esp_tls_client_session_t *session)
+{
+    int ret = mbedtls_ssl_get_session(&tls->ssl, &session->saved_session);
+    if (ret != 0) {
+        ESP_LOGW(TAG, "mbedtls_ssl_get_session returned -0x%x", -ret);
+        esp_tls_client_session_free(session);
+        return;
+    }
+    /* The server certificate was verified by the full handshake and it is not
+       needed to resume the session, do not keep it in memory */
+    if (session->saved_session.peer_cert != NULL) {
+        mbedtls_x509_crt_free(session->saved_session.peer_cert);
+        mbedtls_free(session->saved_session.peer_cert);
+        session->saved_session.peer_cert = NULL;
+    }
+    session->valid = true;
+}
+#endif /* CONFIG_ESP_TLS_CLIENT_SESSION_TICKETS */
+
 static esp_err_t create_ssl_handle(const char *hostname, size_t hostlen, const void *cfg, esp_tls_t *tls)
 {
     assert(cfg != NULL);
@@ -505,6 +525,18 @@ static esp_err_t create_ssl_handle(const char *hostname, size_t hostlen, const v
         esp_ret = ESP_ERR_MBEDTLS_SSL_SETUP_FAILED;
         goto exit;
     }
+#ifdef CONFIG_ESP_TLS_CLIENT_SESSION_TICKETS
+    if (tls->role == ESP_TLS_CLIENT) {
+        esp_tls_client_session_t *session = ((esp_tls_cfg_t *)cfg)->client_session;
+        if (session != NULL && session->valid) {
+            ESP_LOGD(TAG, "Resuming the saved client session");
+            /* Not fatal, the server runs a full handshake */
+            if ((ret = mbedtls_ssl_set_session(&tls->ssl, &session->saved_session)) != 0) {
+                ESP_LOGW(TAG, "mbedtls_ssl_set_session returned -0x%x", -ret);
+            }
+        }
+    }
+#endif
     mbedtls_ssl_set_bio(&tls->ssl, &tls->server_fd, mbedtls_net_send, mbedtls_net_recv, NULL);
 
     return ESP_OK;
@@ -625,6 +657,11 @@ static int esp_tls_low_level_conn(const char *hostname, int hostlen, int port, c
             ESP_LOGD(TAG, "handshake in progress...");
             ret = mbedtls_ssl_handshake(&tls->ssl);
             if (ret == 0) {
+#ifdef CONFIG_ESP_TLS_CLIENT_SESSION_TICKETS
+                if (cfg->client_session != NULL) {
+                    save_client_session(tls, cfg->client_session);
+                }
+#endif
                 tls->conn_state = ESP_TLS_DONE;
                 return 1;
             } else {
@@ -636,6 +673,12 @@ static int esp_tls_low_level_conn(const char *hostname, int hostlen, int port, c
                         /* This is to check whether handshake failed due to invalid certificate*/
                         verify_certificate(tls);
                     }
+#ifdef CONFIG_ESP_TLS_CLIENT_SESSION_TICKETS
+                    if (cfg->client_session != NULL) {
+                        /* A stale session must not break the next attempt too */
+                        esp_tls_client_session_free(cfg->client_session);
+                    }
+#endif
                     tls->conn_state = ESP_TLS_FAIL;
                     return -1;
                 }
@@ -831,3 +874,17 @@ esp_err_t esp_tls_get_and_clear_last_error(esp_tls_error_handle_t h, int *mbedtl
     memset(h, 0, sizeof(esp_tls_last_error_t));
     return last_err;
 }
+
+#ifdef CONFIG_ESP_TLS_CLIENT_SESSION_TICKETS
+void esp_tls_client_session_init(esp_tls_client_session_t *session)
+{
+    mbedtls_ssl_session_init(&session->saved_session);
+    session->valid = false;
+}
+
+void esp_tls_client_session_free(esp_tls_client_session_t *session)
+{
+    mbedtls_ssl_session_free(&session->saved_session);
+    session->valid = false;
+}
+#endif /* CONFIG_ESP_TLS_CLIENT_SESSION_TICKETS */
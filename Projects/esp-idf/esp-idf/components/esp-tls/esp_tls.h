@@ -77,6 +77,17 @@ typedef enum esp_tls_role {
     ESP_TLS_SERVER,
 } esp_tls_role_t;
 
+#ifdef CONFIG_ESP_TLS_CLIENT_SESSION_TICKETS
+/**
+ * @brief Client session of a previous connection, offered to the server to resume
+ *        it (RFC 5077 ticket or session id) instead of running a full handshake
+ */
+typedef struct esp_tls_client_session {
+    mbedtls_ssl_session saved_session;      /*!< Negotiated session, the peer certificate is not kept */
+    bool valid;                             /*!< saved_session holds a session to resume */
+} esp_tls_client_session_t;
+#endif /* CONFIG_ESP_TLS_CLIENT_SESSION_TICKETS */
+
 /**
  * @brief      ESP-TLS configuration parameters 
  */ 
@@ -126,6 +137,12 @@ typedef struct esp_tls_cfg {
                                                  If NULL, server certificate CN must match hostname. */
 
     bool skip_common_name;                  /*!< Skip any validation of server certificate CN field */
+
+#ifdef CONFIG_ESP_TLS_CLIENT_SESSION_TICKETS
+    esp_tls_client_session_t *client_session; /*!< If non-NULL, the session is resumed when valid and
+                                                 updated after every successful handshake.
+                                                 It must remain valid until the connection is closed */
+#endif /* CONFIG_ESP_TLS_CLIENT_SESSION_TICKETS */
 } esp_tls_cfg_t;
 
 #ifdef CONFIG_ESP_TLS_SERVER
@@ -463,6 +480,22 @@ void esp_tls_free_global_ca_store();
  */
 esp_err_t esp_tls_get_and_clear_last_error(esp_tls_error_handle_t h, int *mbedtls_code, int *mbedtls_flags);
 
+#ifdef CONFIG_ESP_TLS_CLIENT_SESSION_TICKETS
+/**
+ * @brief      Initialize a client session, the next connection runs a full handshake
+ *
+ * @param[in]  session  client session
+ */
+void esp_tls_client_session_init(esp_tls_client_session_t *session);
+
+/**
+ * @brief      Free the resources of a client session and invalidate it
+ *
+ * @param[in]  session  client session
+ */
+void esp_tls_client_session_free(esp_tls_client_session_t *session);
+#endif /* CONFIG_ESP_TLS_CLIENT_SESSION_TICKETS */
+
 #ifdef CONFIG_ESP_TLS_SERVER
 /**
  * @brief      Create TLS/SSL server session
@@ -417,6 +417,10 @@ eMBMasterReqReadDiscreteInputs( UCHAR ucSndAddr, USHORT usDiscreteAddr, USHORT u
 eMBMasterReqErrCode
 eMBMAsterReqReportSlaveId(UCHAR ucSndAddr,  LONG lTimeOut);
 
+eMBMasterReqErrCode
+eMBMasterReqRaw( UCHAR ucSndAddr, const UCHAR *pucPDU, USHORT usPDULen,
+        UCHAR *pucRcvPDU, USHORT *pusRcvLen, LONG lTimeOut );
+
 eMBException
 eMBMasterFuncReportSlaveID( UCHAR * pucFrame, USHORT * usLen );
 eMBException
@@ -65,6 +65,13 @@
 
 static UCHAR    ucMBMasterDestAddress;
 static BOOL     xMBRunInMasterMode = FALSE;
+
+/* Raw request (ADU tunnel), the response PDU is copied as it is,
+ * exceptions included, instead of being executed by a function handler.
+ */
+static UCHAR   * volatile pucMBMasterRawRcvBuf = NULL;
+static USHORT   usMBMasterRawRcvMax = 0;
+static USHORT   usMBMasterRawRcvLen = 0;
 static volatile eMBMasterErrorEventType eMBMasterCurErrorType;
 
 static enum
@@ -322,8 +329,18 @@ eMBMasterPoll( void )
             ESP_LOGD(MB_PORT_TAG, "%s:EV_MASTER_EXECUTE", __func__);
             ucFunctionCode = ucMBFrame[MB_PDU_FUNC_OFF];
             eException = MB_EX_ILLEGAL_FUNCTION;
+            if (pucMBMasterRawRcvBuf != NULL) {
+                /* a broadcast has no response */
+                if ( xMBMasterRequestIsBroadcast() ) {
+                    usMBMasterRawRcvLen = 0;
+                } else {
+                    usMBMasterRawRcvLen = (usLength > usMBMasterRawRcvMax) ? usMBMasterRawRcvMax : usLength;
+                    memcpy(pucMBMasterRawRcvBuf, ucMBFrame, usMBMasterRawRcvLen);
+                }
+                eException = MB_EX_NONE;
+            }
             /* If receive frame has exception. The receive function code highest bit is 1.*/
-            if(ucFunctionCode >> 7) {
+            else if(ucFunctionCode >> 7) {
                 eException = (eMBException)ucMBFrame[MB_PDU_DATA_OFF];
             }
             else
@@ -410,6 +427,48 @@ eMBMasterPoll( void )
     return MB_ENOERR;
 }
 
+/**
+ * Send a PDU as it is and return the PDU of the response, an exception
+ * response is returned as well with MB_MRE_NO_ERR.
+ *
+ * @param ucSndAddr slave address
+ * @param pucPDU PDU to send (function code and data)
+ * @param usPDULen length of the PDU
+ * @param pucRcvPDU buffer of the response PDU
+ * @param pusRcvLen in size of pucRcvPDU, out length of the response PDU
+ * @param lTimeOut wait time of the master resource
+ *
+ * @return error code
+ */
+eMBMasterReqErrCode
+eMBMasterReqRaw( UCHAR ucSndAddr, const UCHAR *pucPDU, USHORT usPDULen,
+        UCHAR *pucRcvPDU, USHORT *pusRcvLen, LONG lTimeOut )
+{
+    UCHAR                 *ucMBFrame;
+    eMBMasterReqErrCode    eErrStatus = MB_MRE_NO_ERR;
+
+    if ( ( ucSndAddr > MB_MASTER_TOTAL_SLAVE_NUM ) ||
+         ( usPDULen < MB_PDU_SIZE_MIN ) || ( usPDULen > MB_PDU_SIZE_MAX ) ) eErrStatus = MB_MRE_ILL_ARG;
+    else if ( xMBMasterRunResTake( lTimeOut ) == FALSE ) eErrStatus = MB_MRE_MASTER_BUSY;
+    else
+    {
+        usMBMasterRawRcvMax = *pusRcvLen;
+        usMBMasterRawRcvLen = 0;
+        pucMBMasterRawRcvBuf = pucRcvPDU;
+
+        vMBMasterGetPDUSndBuf(&ucMBFrame);
+        vMBMasterSetDestAddress(ucSndAddr);
+        memcpy(ucMBFrame, pucPDU, usPDULen);
+        vMBMasterSetPDUSndLength(usPDULen);
+        ( void ) xMBMasterPortEventPost( EV_MASTER_FRAME_SENT );
+        eErrStatus = eMBMasterWaitRequestFinish( );
+
+        pucMBMasterRawRcvBuf = NULL;
+        *pusRcvLen = usMBMasterRawRcvLen;
+    }
+    return eErrStatus;
+}
+
 // Get whether the Modbus Master is run in master mode.
 BOOL xMBMasterGetCBRunInMasterMode( void )
 {
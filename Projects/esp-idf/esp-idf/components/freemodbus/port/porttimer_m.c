@@ -57,6 +57,7 @@
 
 /* ----------------------- Variables ----------------------------------------*/
 static USHORT usT35TimeOut50us;
+static USHORT usRespondTimeOutMs = MB_MASTER_TIMEOUT_MS_RESPOND;   // CAREL runtime respond timeout
 
 static const USHORT usTimerIndex = MB_TIMER_INDEX;      // Initialize Modbus Timer index used by stack,
 static const USHORT usTimerGroupIndex = MB_TIMER_GROUP; // Timer group index used by stack
@@ -178,13 +179,28 @@ void vMBMasterPortTimersConvertDelayEnable()
 
 void vMBMasterPortTimersRespondTimeoutEnable()
 {
-    USHORT usTimerTicks = (MB_MASTER_TIMEOUT_MS_RESPOND * 1000 / MB_TICK_TIME_US);
+    USHORT usTimerTicks = (usRespondTimeOutMs * 1000 / MB_TICK_TIME_US);
 
     vMBMasterSetCurTimerMode(MB_TMODE_RESPOND_TIMEOUT);
     ESP_LOGD(MB_PORT_TAG,"%s Respond enable timeout.", __func__);
     (void)xMBMasterPortTimersEnable(usTimerTicks);
 }
 
+// CAREL set the respond timeout of the next requests, 0 restore the default
+void vMBMasterPortTimersSetRespondTimeout(USHORT usTimeOutMs)
+{
+    if ((usTimeOutMs == 0) || (usTimeOutMs > (0xFFFF / (1000 / MB_TICK_TIME_US)))) {
+        usTimeOutMs = MB_MASTER_TIMEOUT_MS_RESPOND;
+    }
+    usRespondTimeOutMs = usTimeOutMs;
+}
+
+// CAREL change the T3.5 time after a runtime change of the baudrate
+void vMBMasterPortTimersSetT35(USHORT usTimeOut50us)
+{
+    usT35TimeOut50us = usTimeOut50us;
+}
+
 void vMBMasterPortTimersDisable()
 {
     // Stop timer and then reload timer counter value
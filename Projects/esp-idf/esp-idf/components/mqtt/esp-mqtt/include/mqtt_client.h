@@ -166,6 +166,7 @@ typedef struct {
     int refresh_connection_after_ms;        /*!< Refresh connection after this value (in milliseconds) */
     const struct psk_key_hint* psk_hint_key;     /*!< Pointer to PSK struct defined in esp_tls.h to enable PSK authentication (as alternative to certificate verification). If not NULL and server/client certificates are NULL, PSK is enabled */
     bool          use_global_ca_store;      /*!< Use a global ca_store for all the connections in which this bool is set. */
+    struct esp_tls_client_session *tls_client_session; /*!< Pointer to a client session defined in esp_tls.h, resumed on every (re)connection and updated after each handshake. Requires CONFIG_ESP_TLS_CLIENT_SESSION_TICKETS */
 } esp_mqtt_client_config_t;
 
 /**
@@ -437,6 +437,14 @@ esp_mqtt_client_handle_t esp_mqtt_client_init(const esp_mqtt_client_config_t *co
 #else
         ESP_LOGE(TAG, "PSK authentication is not available in IDF version %s", IDF_VER);
         goto _mqtt_init_failed;
+#endif
+    }
+    if (config->tls_client_session) {
+#ifdef CONFIG_ESP_TLS_CLIENT_SESSION_TICKETS
+        esp_transport_ssl_set_client_session(ssl, config->tls_client_session);
+#else
+        ESP_LOGE(TAG, "TLS session resumption requires CONFIG_ESP_TLS_CLIENT_SESSION_TICKETS");
+        goto _mqtt_init_failed;
 #endif
     }
     esp_transport_list_add(client->transport_list, ssl, "mqtts");
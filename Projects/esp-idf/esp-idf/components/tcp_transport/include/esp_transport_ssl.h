@@ -79,6 +79,18 @@ void esp_transport_ssl_set_client_key_data(esp_transport_handle_t t, const char
  */
 void esp_transport_ssl_skip_common_name_check(esp_transport_handle_t t);
 
+#ifdef CONFIG_ESP_TLS_CLIENT_SESSION_TICKETS
+/**
+ * @brief      Set the client session used to resume the TLS session on every connection.
+ *             Note that, this function stores the pointer to the session, rather than making a copy.
+ *             So the session must remain valid until after the transport is destroyed
+ *
+ * @param      t        ssl transport
+ * @param[in]  session  client session, updated after each successful handshake
+ */
+void esp_transport_ssl_set_client_session(esp_transport_handle_t t, esp_tls_client_session_t *session);
+#endif
+
 #ifdef __cplusplus
 }
 #endif
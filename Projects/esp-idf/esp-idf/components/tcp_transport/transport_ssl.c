@@ -204,6 +204,16 @@ void esp_transport_ssl_skip_common_name_check(esp_transport_handle_t t)
     }
 }
 
+#ifdef CONFIG_ESP_TLS_CLIENT_SESSION_TICKETS
+void esp_transport_ssl_set_client_session(esp_transport_handle_t t, esp_tls_client_session_t *session)
+{
+    transport_ssl_t *ssl = esp_transport_get_context_data(t);
+    if (t && ssl) {
+        ssl->cfg.client_session = session;
+    }
+}
+#endif
+
 esp_transport_handle_t esp_transport_ssl_init()
 {
     esp_transport_handle_t t = esp_transport_init();
@@ -179,6 +179,19 @@ static void register_tasks()
 
 #endif // WITH_TASKS_INFO
 
+/** 'telemetry' command prints cpu load, stack and heap usage */
+
+void register_telemetry(esp_console_cmd_func_t func)
+{
+    const esp_console_cmd_t cmd = {
+        .command = "telemetry",
+        .help = "Get cpu load and stack high water mark of the tasks, heap minimum and largest free block",
+        .hint = NULL,
+        .func = func,
+    };
+    ESP_ERROR_CHECK( esp_console_cmd_register(&cmd) );
+}
+
 /** 'deep_sleep' command puts the chip into deep sleep mode */
 
 static struct {
@@ -8,6 +8,8 @@
 */
 #pragma once
 
+#include "esp_console.h"
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -15,6 +17,9 @@ extern "C" {
 // Register system functions
 void register_system();
 
+// Register the 'telemetry' command, the handler is given by the application
+void register_telemetry(esp_console_cmd_func_t func);
+
 #ifdef __cplusplus
 }
 #endif
@@ -85,6 +85,27 @@ typedef struct esp_uart esp_uart_t;
  */
 modem_dte_t *esp_modem_dte_init(const esp_modem_dte_config_t *config, esp_uart_t uart_pins);
 
+/**
+ * @brief Start the CMUX multiplexing (GSM 07.10 basic option) on the modem UART
+ *        PPP runs on one virtual channel, the AT commands on another one,
+ *        so the commands don't need to leave the data mode.
+ *        If the channels cannot be opened the DCE is brought back to the AT mode
+ *
+ * @param dte Modem DTE object, DCE must be in command mode
+ * @return esp_err_t
+ *      - ESP_OK on success
+ *      - ESP_FAIL on error, the UART is left in the plain AT mode
+ */
+esp_err_t esp_modem_start_cmux(modem_dte_t *dte);
+
+/**
+ * @brief Check if the CMUX multiplexing is running
+ *
+ * @param dte Modem DTE object
+ * @return bool true if CMUX is running
+ */
+bool esp_modem_cmux_active(modem_dte_t *dte);
+
 /**
  * @brief Register event handler for ESP Modem event loop
  *
@@ -0,0 +1,104 @@
+// Copyright 2015-2018 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+/**
+ * @brief Virtual channels (DLCI) used on the modem UART
+ *
+ */
+#define CMUX_DLCI_CONTROL (0) /*!< Multiplexer control channel */
+#define CMUX_DLCI_PPP (1)     /*!< Dial up and PPP data */
+#define CMUX_DLCI_AT (2)      /*!< AT commands while PPP is running */
+#define CMUX_DLCI_NUM (3)
+
+/**
+ * @brief GSM 07.10 basic option framing
+ *
+ */
+#define CMUX_MAX_INFO_LEN (127)   /*!< N1, max information field length set with AT+CMUX */
+#define CMUX_FRAME_OVERHEAD (6)   /*!< Flag, address, control, length, FCS, flag */
+
+#define CMUX_FLAG (0xF9)
+#define CMUX_SABM (0x2F) /*!< Set asynchronous balanced mode (open channel) */
+#define CMUX_UA (0x63)   /*!< Unnumbered acknowledgement */
+#define CMUX_DM (0x0F)   /*!< Disconnected mode */
+#define CMUX_DISC (0x43) /*!< Disconnect (close channel) */
+#define CMUX_UIH (0xEF)  /*!< Unnumbered information with header check */
+#define CMUX_PF (0x10)   /*!< Poll/final bit of the control field */
+
+#define CMUX_MSG_CR (0x02)  /*!< Command/response bit of a control channel message */
+#define CMUX_MSG_CLD (0xC1) /*!< Multiplexer close down message */
+
+/**
+ * @brief Callback for every valid frame, the control field is given without P/F bit
+ *
+ */
+typedef void (*cmux_frame_cb_t)(void *ctx, uint8_t dlci, uint8_t control, const uint8_t *info, size_t len);
+
+/**
+ * @brief Frame decoder, fed with the raw bytes read from the UART
+ *
+ */
+typedef struct {
+    uint8_t state;                    /*!< Parser state */
+    uint8_t address;                  /*!< Address field of the current frame */
+    uint8_t control;                  /*!< Control field of the current frame */
+    uint8_t fcs;                      /*!< Running frame check sequence */
+    uint16_t len;                     /*!< Length of the information field */
+    uint16_t pos;                     /*!< Received bytes of the information field */
+    uint32_t errors;                  /*!< Discarded frames (bad FCS or too long) */
+    uint8_t info[CMUX_MAX_INFO_LEN];  /*!< Information field */
+} cmux_decoder_t;
+
+/**
+ * @brief Build a frame
+ *
+ * @param dlci virtual channel
+ * @param control control field (with P/F bit if required)
+ * @param info information field, can be NULL if len is 0
+ * @param len length of info, up to CMUX_MAX_INFO_LEN
+ * @param frame output buffer of at least len + CMUX_FRAME_OVERHEAD bytes
+ * @return size_t length of the frame
+ */
+size_t cmux_encode(uint8_t dlci, uint8_t control, const uint8_t *info, size_t len, uint8_t *frame);
+
+/**
+ * @brief Reset a frame decoder
+ *
+ * @param dec decoder
+ */
+void cmux_decoder_init(cmux_decoder_t *dec);
+
+/**
+ * @brief Decode raw bytes, cb is called for every complete and valid frame
+ *
+ * @param dec decoder
+ * @param data raw bytes
+ * @param len number of bytes
+ * @param cb frame callback
+ * @param ctx context of the callback
+ */
+void cmux_decode(cmux_decoder_t *dec, const uint8_t *data, size_t len, cmux_frame_cb_t cb, void *ctx);
+
+#ifdef __cplusplus
+}
+#endif
@@ -126,6 +126,8 @@ esp_err_t esp_modem_dce_define_pdp_context(modem_dce_t *dce, uint32_t cid, const
  */
 esp_err_t esp_modem_dce_hang_up(modem_dce_t *dce);
 
+esp_err_t esp_modem_dce_cmux(modem_dce_t *dce, uint32_t max_frame);
+
 #ifdef __cplusplus
 }
 #endif
@@ -22,6 +22,8 @@
 #include "lwip/dns.h"
 #include "tcpip_adapter.h"
 #include "esp_modem.h"
+#include "esp_modem_cmux.h"
+#include "esp_modem_dce_service.h"
 #include "esp_log.h"
 #include "sdkconfig.h"
 
@@ -32,6 +34,10 @@
 #define MIN_POST_IDLE (10)
 #define MIN_PRE_IDLE (10)
 
+#define ESP_MODEM_CMUX_RX_SIZE (256)
+#define ESP_MODEM_CMUX_OPEN_TIMEOUT (3000) /*!< Max wait for the UA of a SABM, ms */
+#define ESP_MODEM_CMUX_NO_DLCI (0xFF)
+
 /**
  * @brief Macro defined for error checking
  *
@@ -49,6 +55,21 @@ static const char *MODEM_TAG = "esp-modem";
 
 ESP_EVENT_DEFINE_BASE(ESP_MODEM_EVENT);
 
+/**
+ * @brief CMUX state of the DTE
+ *
+ */
+typedef struct {
+    cmux_decoder_t dec;                     /*!< Frame decoder */
+    uint8_t rx[ESP_MODEM_CMUX_RX_SIZE];     /*!< Raw bytes read from UART */
+    uint32_t line_len;                      /*!< Length of the line being assembled in the DTE buffer */
+    uint8_t line_dlci;                      /*!< Channel of the line being assembled */
+    uint8_t cmd_dlci;                       /*!< Channel used by send_cmd */
+    bool ppp_data;                          /*!< PPP channel switched to data (CONNECT received) */
+    uint8_t wait_dlci;                      /*!< Channel waiting for UA/DM */
+    uint8_t wait_control;                   /*!< Answer to the SABM */
+} esp_modem_cmux_t;
+
 /**
  * @brief ESP32 Modem DTE
  *
@@ -63,6 +84,8 @@ typedef struct {
     struct netif pppif;                     /*!< PPP network interface */
     ppp_pcb *ppp;                           /*!< PPP control block */
     modem_dte_t parent;                     /*!< DTE interface that should extend */
+    bool cmux;                              /*!< UART multiplexed with CMUX (GSM 07.10) */
+    esp_modem_cmux_t *mux;                  /*!< CMUX state, allocated when started */
 } esp_modem_dte_t;
 
 /**
@@ -92,6 +115,150 @@ err:
     return ESP_FAIL;
 }
 
+/**
+ * @brief Write data on a CMUX channel, split in UIH frames
+ *        every frame is written with a single call so frames of different tasks never mix
+ *
+ * @param esp_dte ESP32 Modem DTE object
+ * @param dlci virtual channel
+ * @param data data buffer
+ * @param length length of data
+ * @return int length of data sent, -1 on error
+ */
+static int esp_cmux_write(esp_modem_dte_t *esp_dte, uint8_t dlci, const uint8_t *data, uint32_t length)
+{
+    uint8_t frame[CMUX_MAX_INFO_LEN + CMUX_FRAME_OVERHEAD];
+    uint32_t sent = 0;
+    while (sent < length) {
+        size_t chunk = MIN(length - sent, CMUX_MAX_INFO_LEN);
+        size_t len = cmux_encode(dlci, CMUX_UIH, data + sent, chunk, frame);
+        if (uart_write_bytes(esp_dte->uart_port, (const char *)frame, len) < 0) {
+            return -1;
+        }
+        sent += chunk;
+    }
+    return sent;
+}
+
+/**
+ * @brief Assemble the text received on a CMUX channel in lines
+ *        on the PPP channel the text ends with CONNECT, what follows is PPP data
+ *
+ * @param esp_dte ESP32 Modem DTE object
+ * @param dlci virtual channel
+ * @param data received text
+ * @param len length of text
+ */
+static void esp_cmux_handle_text(esp_modem_dte_t *esp_dte, uint8_t dlci, const uint8_t *data, size_t len)
+{
+    esp_modem_cmux_t *mux = esp_dte->mux;
+    if (mux->line_dlci != dlci) {
+        mux->line_len = 0;
+        mux->line_dlci = dlci;
+    }
+    for (size_t i = 0; i < len; i++) {
+        if (mux->line_len < ESP_MODEM_LINE_BUFFER_SIZE - 1) {
+            esp_dte->buffer[mux->line_len++] = data[i];
+        }
+        if (data[i] != '\n') {
+            continue;
+        }
+        esp_dte->buffer[mux->line_len] = '\0';
+        mux->line_len = 0;
+        if ((dlci == CMUX_DLCI_PPP) && strstr((const char *)esp_dte->buffer, MODEM_RESULT_CODE_CONNECT)) {
+            mux->ppp_data = true;
+            esp_dte_handle_line(esp_dte);
+            if ((i + 1 < len) && esp_dte->ppp) {
+                pppos_input_tcpip(esp_dte->ppp, (u8_t *)&data[i + 1], len - i - 1);
+            }
+            return;
+        }
+        esp_dte_handle_line(esp_dte);
+    }
+}
+
+/**
+ * @brief Answer the commands of the DCE on the control channel (e.g. MSC)
+ *        with the same message and the C/R bit cleared
+ *
+ * @param esp_dte ESP32 Modem DTE object
+ * @param info message
+ * @param len length of message
+ */
+static void esp_cmux_handle_control(esp_modem_dte_t *esp_dte, const uint8_t *info, size_t len)
+{
+    uint8_t msg[CMUX_MAX_INFO_LEN];
+    if ((len < 2) || !(info[0] & CMUX_MSG_CR)) {
+        return;
+    }
+    memcpy(msg, info, len);
+    msg[0] &= ~CMUX_MSG_CR;
+    esp_cmux_write(esp_dte, CMUX_DLCI_CONTROL, msg, len);
+}
+
+/**
+ * @brief Dispatch a frame received from DCE
+ *
+ */
+static void esp_cmux_on_frame(void *ctx, uint8_t dlci, uint8_t control, const uint8_t *info, size_t len)
+{
+    esp_modem_dte_t *esp_dte = (esp_modem_dte_t *)ctx;
+    esp_modem_cmux_t *mux = esp_dte->mux;
+    switch (control) {
+    case CMUX_UA:
+    case CMUX_DM:
+        if (dlci == mux->wait_dlci) {
+            mux->wait_control = control;
+            xSemaphoreGive(esp_dte->process_sem);
+        }
+        break;
+    case CMUX_UIH:
+        if (dlci == CMUX_DLCI_CONTROL) {
+            esp_cmux_handle_control(esp_dte, info, len);
+        } else if ((dlci == CMUX_DLCI_PPP) && mux->ppp_data) {
+            if (esp_dte->ppp) {
+                pppos_input_tcpip(esp_dte->ppp, (u8_t *)info, len);
+            }
+        } else if (dlci < CMUX_DLCI_NUM) {
+            esp_cmux_handle_text(esp_dte, dlci, info, len);
+        }
+        break;
+    case CMUX_DISC:
+        ESP_LOGW(MODEM_TAG, "CMUX channel %d closed by DCE", dlci);
+        break;
+    default:
+        break;
+    }
+}
+
+/**
+ * @brief Open a CMUX channel (SABM) and wait for the acknowledge of DCE
+ *
+ * @param esp_dte ESP32 Modem DTE object
+ * @param dlci virtual channel
+ * @return esp_err_t
+ *      - ESP_OK on success
+ *      - ESP_FAIL on error
+ */
+static esp_err_t esp_cmux_open_dlci(esp_modem_dte_t *esp_dte, uint8_t dlci)
+{
+    esp_modem_cmux_t *mux = esp_dte->mux;
+    uint8_t frame[CMUX_FRAME_OVERHEAD];
+    size_t len = cmux_encode(dlci, CMUX_SABM | CMUX_PF, NULL, 0, frame);
+    mux->wait_control = 0;
+    mux->wait_dlci = dlci;
+    xSemaphoreTake(esp_dte->process_sem, 0);
+    uart_write_bytes(esp_dte->uart_port, (const char *)frame, len);
+    MODEM_CHECK(xSemaphoreTake(esp_dte->process_sem, pdMS_TO_TICKS(ESP_MODEM_CMUX_OPEN_TIMEOUT)) == pdTRUE,
+                "open channel %d timeout", err, dlci);
+    MODEM_CHECK(mux->wait_control == CMUX_UA, "channel %d refused", err, dlci);
+    mux->wait_dlci = ESP_MODEM_CMUX_NO_DLCI;
+    return ESP_OK;
+err:
+    mux->wait_dlci = ESP_MODEM_CMUX_NO_DLCI;
+    return ESP_FAIL;
+}
+
 /**
  * @brief Handle when a pattern has been detected by UART
  *
@@ -133,6 +300,13 @@ static void esp_handle_uart_data(esp_modem_dte_t *esp_dte)
 {
     size_t length = 0;
     uart_get_buffered_data_len(esp_dte->uart_port, &length);
+    if (esp_dte->cmux) {
+        /* every byte is part of a frame, PPP and AT lines are split by channel */
+        length = MIN(ESP_MODEM_CMUX_RX_SIZE, length);
+        length = uart_read_bytes(esp_dte->uart_port, esp_dte->mux->rx, length, portMAX_DELAY);
+        cmux_decode(&esp_dte->mux->dec, esp_dte->mux->rx, length, esp_cmux_on_frame, esp_dte);
+        return;
+    }
     length = MIN(ESP_MODEM_LINE_BUFFER_SIZE, length);
     length = uart_read_bytes(esp_dte->uart_port, esp_dte->buffer, length, portMAX_DELAY);
     /* pass input data to the lwIP core thread */
@@ -176,7 +350,13 @@ static void uart_event_task_entry(void *param)
                 ESP_LOGE(MODEM_TAG, "Frame Error");
                 break;
             case UART_PATTERN_DET:
-                esp_handle_uart_pattern(esp_dte);
+                if (esp_dte->cmux) {
+                    /* queued before CMUX was started, the bytes are frames */
+                    uart_pattern_queue_reset(esp_dte->uart_port, CONFIG_UART_PATTERN_QUEUE_SIZE);
+                    esp_handle_uart_data(esp_dte);
+                } else {
+                    esp_handle_uart_pattern(esp_dte);
+                }
                 break;
             default:
                 ESP_LOGW(MODEM_TAG, "unknown uart event type: %d", event.type);
@@ -209,8 +389,12 @@ static esp_err_t esp_modem_dte_send_cmd(modem_dte_t *dte, const char *command, u
     /* Calculate timeout clock tick */
     /* Reset runtime information */
     dce->state = MODEM_STATE_PROCESSING;
-    /* Send command via UART */
-    uart_write_bytes(esp_dte->uart_port, command, strlen(command));
+    /* Send command via UART, with CMUX on its own channel */
+    if (esp_dte->cmux) {
+        esp_cmux_write(esp_dte, esp_dte->mux->cmd_dlci, (const uint8_t *)command, strlen(command));
+    } else {
+        uart_write_bytes(esp_dte->uart_port, command, strlen(command));
+    }
     /* Check timeout */
     MODEM_CHECK(xSemaphoreTake(esp_dte->process_sem, pdMS_TO_TICKS(timeout)) == pdTRUE, "process command timeout", err);
     ret = ESP_OK;
@@ -231,6 +415,9 @@ static int esp_modem_dte_send_data(modem_dte_t *dte, const char *data, uint32_t
 {
     MODEM_CHECK(data, "data is NULL", err);
     esp_modem_dte_t *esp_dte = __containerof(dte, esp_modem_dte_t, parent);
+    if (esp_dte->cmux) {
+        return esp_cmux_write(esp_dte, CMUX_DLCI_PPP, (const uint8_t *)data, length);
+    }
     return uart_write_bytes(esp_dte->uart_port, data, length);
 err:
     return -1;
@@ -254,6 +441,7 @@ static esp_err_t esp_modem_dte_send_wait(modem_dte_t *dte, const char *data, uin
     MODEM_CHECK(data, "data is NULL", err_param);
     MODEM_CHECK(prompt, "prompt is NULL", err_param);
     esp_modem_dte_t *esp_dte = __containerof(dte, esp_modem_dte_t, parent);
+    MODEM_CHECK(!esp_dte->cmux, "not supported with CMUX", err_param);
     // We'd better disable pattern detection here for a moment in case prompt string contains the pattern character
     uart_disable_pattern_det_intr(esp_dte->uart_port);
     // uart_disable_rx_intr(esp_dte->uart_port);
@@ -289,6 +477,17 @@ static esp_err_t esp_modem_dte_change_mode(modem_dte_t *dte, modem_mode_t new_mo
     MODEM_CHECK(dce, "DTE has not yet bind with DCE", err);
     esp_modem_dte_t *esp_dte = __containerof(dte, esp_modem_dte_t, parent);
     MODEM_CHECK(dce->mode != new_mode, "already in mode: %d", err, new_mode);
+    if (esp_dte->cmux) {
+        /* AT commands have their own channel, only the dial up is done on the PPP one */
+        if (new_mode == MODEM_PPP_MODE) {
+            esp_dte->mux->ppp_data = false;
+            esp_dte->mux->cmd_dlci = CMUX_DLCI_PPP;
+            esp_err_t res = dce->set_working_mode(dce, new_mode);
+            esp_dte->mux->cmd_dlci = CMUX_DLCI_AT;
+            MODEM_CHECK(res == ESP_OK, "set new working mode:%d failed", err, new_mode);
+        }
+        return ESP_OK;
+    }
     switch (new_mode) {
     case MODEM_PPP_MODE:
         MODEM_CHECK(dce->set_working_mode(dce, new_mode) == ESP_OK, "set new working mode:%d failed", err, new_mode);
@@ -341,6 +540,7 @@ static esp_err_t esp_modem_dte_deinit(modem_dte_t *dte)
     /* Uninstall UART Driver */
     uart_driver_delete(esp_dte->uart_port);
     /* Free memory */
+    free(esp_dte->mux);
     free(esp_dte->buffer);
     if (dte->dce) {
         dte->dce->dte = NULL;
@@ -418,12 +618,13 @@ modem_dte_t *esp_modem_dte_init(const esp_modem_dte_config_t *config, esp_uart_t
     esp_dte->process_sem = xSemaphoreCreateBinary();
     MODEM_CHECK(esp_dte->process_sem, "create process semaphore failed", err_sem);
     /* Create UART Event task */
-    BaseType_t ret = xTaskCreate(uart_event_task_entry,             //Task Entry
+    BaseType_t ret = xTaskCreatePinnedToCore(uart_event_task_entry, //Task Entry
                                  "uart_event",                      //Task Name
                                  CONFIG_UART_EVENT_TASK_STACK_SIZE, //Task Stack Size(Bytes)
                                  esp_dte,                           //Task Parameter
                                  CONFIG_UART_EVENT_TASK_PRIORITY,   //Task Priority
-                                 & (esp_dte->uart_event_task_hdl)   //Task Handler
+                                 & (esp_dte->uart_event_task_hdl),  //Task Handler
+                                 CONFIG_GME_NET_CORE                //Core, with PPP and lwIP
                                 );
     MODEM_CHECK(ret == pdTRUE, "create uart event task failed", err_tsk_create);
     return &(esp_dte->parent);
@@ -444,6 +645,57 @@ err_dte_mem:
     return NULL;
 }
 
+esp_err_t esp_modem_start_cmux(modem_dte_t *dte)
+{
+    modem_dce_t *dce = dte->dce;
+    MODEM_CHECK(dce, "DTE has not yet bind with DCE", err);
+    esp_modem_dte_t *esp_dte = __containerof(dte, esp_modem_dte_t, parent);
+    MODEM_CHECK(!esp_dte->cmux, "CMUX already started", err);
+    MODEM_CHECK(dce->mode == MODEM_COMMAND_MODE, "CMUX can be started only in command mode", err);
+    if (esp_dte->mux == NULL) {
+        esp_dte->mux = calloc(1, sizeof(esp_modem_cmux_t));
+        MODEM_CHECK(esp_dte->mux, "calloc cmux failed", err);
+    }
+    esp_modem_cmux_t *mux = esp_dte->mux;
+    cmux_decoder_init(&mux->dec);
+    mux->line_len = 0;
+    mux->line_dlci = CMUX_DLCI_AT;
+    mux->cmd_dlci = CMUX_DLCI_AT;
+    mux->ppp_data = false;
+    mux->wait_dlci = ESP_MODEM_CMUX_NO_DLCI;
+    /* Ask DCE to enter the multiplexer mode */
+    MODEM_CHECK(esp_modem_dce_cmux(dce, CMUX_MAX_INFO_LEN) == ESP_OK, "enter cmux mode failed", err);
+    /* From now on the UART carries only frames */
+    uart_disable_pattern_det_intr(esp_dte->uart_port);
+    esp_dte->cmux = true;
+    uart_enable_rx_intr(esp_dte->uart_port);
+    for (uint8_t dlci = CMUX_DLCI_CONTROL; dlci < CMUX_DLCI_NUM; dlci++) {
+        MODEM_CHECK(esp_cmux_open_dlci(esp_dte, dlci) == ESP_OK, "open channel %d failed", err_open, dlci);
+    }
+    ESP_LOGI(MODEM_TAG, "CMUX started");
+    return ESP_OK;
+err_open:
+    {
+        /* Close down the multiplexer so that DCE gets back to the plain AT mode */
+        const uint8_t cld[] = { CMUX_MSG_CLD | CMUX_MSG_CR, 0x01 };
+        esp_cmux_write(esp_dte, CMUX_DLCI_CONTROL, cld, sizeof(cld));
+        vTaskDelay(pdMS_TO_TICKS(100));
+    }
+    esp_dte->cmux = false;
+    uart_disable_rx_intr(esp_dte->uart_port);
+    uart_flush(esp_dte->uart_port);
+    uart_enable_pattern_det_intr(esp_dte->uart_port, '\n', 1, MIN_PATTERN_INTERVAL, MIN_POST_IDLE, MIN_PRE_IDLE);
+    uart_pattern_queue_reset(esp_dte->uart_port, CONFIG_UART_PATTERN_QUEUE_SIZE);
+err:
+    return ESP_FAIL;
+}
+
+bool esp_modem_cmux_active(modem_dte_t *dte)
+{
+    esp_modem_dte_t *esp_dte = __containerof(dte, esp_modem_dte_t, parent);
+    return esp_dte->cmux;
+}
+
 esp_err_t esp_modem_add_event_handler(modem_dte_t *dte, esp_event_handler_t handler, void *handler_args)
 {
     esp_modem_dte_t *esp_dte = __containerof(dte, esp_modem_dte_t, parent);
@@ -0,0 +1,165 @@
+// Copyright 2015-2018 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#include <string.h>
+#include "esp_modem_cmux.h"
+
+/**
+ * @brief Decoder states
+ *
+ */
+enum {
+    CMUX_ST_HUNT = 0, /*!< Wait for the opening flag */
+    CMUX_ST_ADDRESS,
+    CMUX_ST_CONTROL,
+    CMUX_ST_LENGTH,
+    CMUX_ST_LENGTH2,
+    CMUX_ST_INFO,
+    CMUX_ST_FCS,
+    CMUX_ST_CLOSE      /*!< Wait for the closing flag */
+};
+
+#define CMUX_FCS_INIT (0xFF)
+#define CMUX_FCS_GOOD (0xCF) /*!< Remainder of a frame received without errors */
+
+/**
+ * @brief CRC-8 (reflected, polynomial x^8+x^2+x+1) of the 07.10 FCS,
+ *        computed bit by bit since it only covers the 3-4 header bytes of UIH frames
+ *
+ */
+static uint8_t cmux_fcs(uint8_t fcs, uint8_t byte)
+{
+    fcs ^= byte;
+    for (int i = 0; i < 8; i++) {
+        fcs = (fcs & 0x01) ? ((fcs >> 1) ^ 0xE0) : (fcs >> 1);
+    }
+    return fcs;
+}
+
+size_t cmux_encode(uint8_t dlci, uint8_t control, const uint8_t *info, size_t len, uint8_t *frame)
+{
+    size_t pos = 0;
+    uint8_t fcs = CMUX_FCS_INIT;
+
+    if (len > CMUX_MAX_INFO_LEN) {
+        len = CMUX_MAX_INFO_LEN;
+    }
+    frame[pos++] = CMUX_FLAG;
+    /* EA = 1, C/R = 1 (sent by the initiator) */
+    frame[pos++] = (uint8_t)((dlci << 2) | 0x03);
+    frame[pos++] = control;
+    frame[pos++] = (uint8_t)((len << 1) | 0x01);
+    for (size_t i = 1; i < pos; i++) {
+        fcs = cmux_fcs(fcs, frame[i]);
+    }
+    if (len) {
+        memcpy(&frame[pos], info, len);
+        pos += len;
+    }
+    frame[pos++] = (uint8_t)(0xFF - fcs);
+    frame[pos++] = CMUX_FLAG;
+    return pos;
+}
+
+void cmux_decoder_init(cmux_decoder_t *dec)
+{
+    memset(dec, 0, sizeof(cmux_decoder_t));
+    dec->state = CMUX_ST_HUNT;
+}
+
+void cmux_decode(cmux_decoder_t *dec, const uint8_t *data, size_t len, cmux_frame_cb_t cb, void *ctx)
+{
+    for (size_t i = 0; i < len; i++) {
+        uint8_t byte = data[i];
+        switch (dec->state) {
+        case CMUX_ST_HUNT:
+            if (byte == CMUX_FLAG) {
+                dec->state = CMUX_ST_ADDRESS;
+            }
+            break;
+        case CMUX_ST_ADDRESS:
+            /* a closing flag can be followed by the opening one */
+            if (byte == CMUX_FLAG) {
+                break;
+            }
+            /* single byte address, EA bit set */
+            if (!(byte & 0x01)) {
+                dec->errors++;
+                dec->state = CMUX_ST_HUNT;
+                break;
+            }
+            dec->address = byte;
+            dec->fcs = cmux_fcs(CMUX_FCS_INIT, byte);
+            dec->state = CMUX_ST_CONTROL;
+            break;
+        case CMUX_ST_CONTROL:
+            /* the flag never appears in the header, resync on it */
+            if (byte == CMUX_FLAG) {
+                dec->errors++;
+                dec->state = CMUX_ST_ADDRESS;
+                break;
+            }
+            dec->control = byte;
+            dec->fcs = cmux_fcs(dec->fcs, byte);
+            dec->state = CMUX_ST_LENGTH;
+            break;
+        case CMUX_ST_LENGTH:
+        case CMUX_ST_LENGTH2:
+            dec->fcs = cmux_fcs(dec->fcs, byte);
+            if (dec->state == CMUX_ST_LENGTH) {
+                dec->len = byte >> 1;
+            } else {
+                dec->len |= (uint16_t)byte << 7;
+            }
+            if ((dec->state == CMUX_ST_LENGTH) && !(byte & 0x01)) {
+                dec->state = CMUX_ST_LENGTH2;
+                break;
+            }
+            if (dec->len > CMUX_MAX_INFO_LEN) {
+                dec->errors++;
+                dec->state = CMUX_ST_HUNT;
+                break;
+            }
+            dec->pos = 0;
+            dec->state = dec->len ? CMUX_ST_INFO : CMUX_ST_FCS;
+            break;
+        case CMUX_ST_INFO:
+            dec->info[dec->pos++] = byte;
+            if (dec->pos == dec->len) {
+                dec->state = CMUX_ST_FCS;
+            }
+            break;
+        case CMUX_ST_FCS:
+            dec->fcs = cmux_fcs(dec->fcs, byte);
+            dec->state = CMUX_ST_CLOSE;
+            break;
+        case CMUX_ST_CLOSE:
+            if (byte != CMUX_FLAG) {
+                dec->errors++;
+                dec->state = CMUX_ST_HUNT;
+                break;
+            }
+            if (dec->fcs == CMUX_FCS_GOOD) {
+                cb(ctx, dec->address >> 2, dec->control & ~CMUX_PF, dec->info, dec->len);
+            } else {
+                dec->errors++;
+            }
+            /* the closing flag may also open the next frame */
+            dec->state = CMUX_ST_ADDRESS;
+            break;
+        default:
+            dec->state = CMUX_ST_HUNT;
+            break;
+        }
+    }
+}
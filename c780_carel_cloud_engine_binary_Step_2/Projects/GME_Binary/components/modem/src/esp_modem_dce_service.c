@@ -113,6 +113,22 @@ err:
     return ESP_FAIL;
 }
 
+esp_err_t esp_modem_dce_cmux(modem_dce_t *dce, uint32_t max_frame)
+{
+    modem_dte_t *dte = dce->dte;
+    char command[32];
+    /* basic option, UIH frames, 115200 bps */
+    int len = snprintf(command, sizeof(command), "AT+CMUX=0,0,5,%d\r", max_frame);
+    DCE_CHECK(len < sizeof(command), "command too long: %s", err, command);
+    dce->handle_line = esp_modem_dce_handle_response_default;
+    DCE_CHECK(dte->send_cmd(dte, command, MODEM_COMMAND_TIMEOUT_DEFAULT) == ESP_OK, "send command failed", err);
+    DCE_CHECK(dce->state == MODEM_STATE_SUCCESS, "enter cmux mode failed", err);
+    ESP_LOGD(DCE_TAG, "enter cmux mode ok");
+    return ESP_OK;
+err:
+    return ESP_FAIL;
+}
+
 esp_err_t esp_modem_dce_hang_up(modem_dce_t *dce)
 {
     modem_dte_t *dte = dce->dte;
@@ -102,8 +102,18 @@
  * */
 //#define __CCL_COVERAGE_MODE
 
+/* with __CCL_COVERAGE_BIN every site only sets a bit in RAM, the reached
+ * sites are exported in the same format on the console, on the /cov topic
+ * and on http://<gme>/cov.txt (see coverage_CAREL.h), the DEBUG_MODE can
+ * stay enabled. __CCL_TRACE_RING also keeps the last hits with a timestamp */
+//#define __CCL_COVERAGE_BIN
+//#define __CCL_TRACE_RING
+
 #define COV_MARK "!#!"
-#ifdef __CCL_COVERAGE_MODE
+#if defined(__CCL_COVERAGE_MODE) && defined(__CCL_COVERAGE_BIN)
+    #include "coverage_CAREL.h"
+    #define	P_COV_LN  COV_HIT(__COUNTER__, __LINE__)
+#elif defined(__CCL_COVERAGE_MODE)
     #define	P_COV_LN  printf("%s|%s|%d|\r\n",COV_MARK,__FILE__, __LINE__)
 #else
     #define P_COV_LN ;
@@ -167,6 +177,16 @@
 
 #define MQTT_KEEP_ALIVE_DEFAULT_SEC   (60)
 
+// persistent MQTT session (clean session = 0, the client id is the gateway id),
+// after a reconnect the broker still has the subscription of /req.
+// The TLS session is resumed if CONFIG_ESP_TLS_CLIENT_SESSION_TICKETS is set
+#define MQTT_PERSISTENT_SESSION
+
+// uncomment below to add the milliseconds of the sampling time to
+// /values ("tms") and of the start/end time to /alarms ("sms"/"ems"),
+// for fast changing signals
+//#define SAMPLE_MS_TIMESTAMP
+
 #define NTP_DEFAULT_PORT  	123
 
 // period for mobile payload transmission
@@ -178,5 +198,8 @@
 // comment below if no periodic power query is required
 //
 //#define GW_QUERY_RSSI
+// uncomment below to add the telemetry of tasks and heap (see telemetry_IS.h)
+// to the status payload
+//#define GW_STATUS_TELEMETRY
 #endif
 
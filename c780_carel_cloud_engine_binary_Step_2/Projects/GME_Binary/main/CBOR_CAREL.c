@@ -11,8 +11,11 @@
 #include "data_types_CAREL.h"
 
 #include "modbus_IS.h"
+#include "modbus_aux_IS.h"
 
 #include "CBOR_CAREL.h"
+#include "CBOR_ReqKeys_CAREL.h"
+#include "CBOR_Templates_CAREL.h"
 #include "File_System_CAREL.h"
 #include "tinycbor/cbor.h"
 #include "Miscellaneous_IS.h"
@@ -31,6 +34,7 @@
 #include "main_CAREL.h"
 #include "mobile.h"
 #include "utilities_CAREL.h"
+#include "telemetry_IS.h"
 #ifdef INCLUDE_PLATFORM_DEPENDENT
 #include "mb_m.h"
 #endif
@@ -52,7 +56,6 @@ C_UINT16 did;
 c_cborhreq async_req[NUM_OF_ASYNC] = {{0},{0},{0},{0},{0}};
 C_UINT16 async_cid[NUM_OF_ASYNC] = {0, 0, 0, 0, 0};
 
-
 /**
  * @brief CBOR_SendAlarms
  *
@@ -103,38 +106,45 @@ size_t CBOR_Alarms(C_CHAR* cbor_stream, c_cboralarms cbor_alarms)
 	// map1
 	err = cbor_encoder_create_map(&encoder, &mapEncoder, CborIndefiniteLength);
 	DEBUG_ENC(err, "alarms create main map");
-	// encode ver - elem1
-	err |= cbor_encode_text_stringz(&mapEncoder, "ver");
-	err |= cbor_encode_uint(&mapEncoder, CAREL_TYPES_VERSION);
+	// encode ver - elem1, key of aty
+	err |= CBOR_TMPL(&mapEncoder, tmpl_ver_aty, 3);
 	DEBUG_ADD(err, "version");
 
 	// encode aty - elem2
-	err |= cbor_encode_text_stringz(&mapEncoder, "aty");
 	err |= cbor_encode_uint(&mapEncoder, cbor_alarms.aty);
 	DEBUG_ADD(err, "aty");
 
 	// encode ali - elem3
-	err |= cbor_encode_text_stringz(&mapEncoder, "ali");
+	err |= CBOR_TMPL(&mapEncoder, tmpl_key_ali, 1);
 	err |= cbor_encode_text_stringz(&mapEncoder, (char*)cbor_alarms.ali);
 	DEBUG_ADD(err, "ali");
 
 	// encode aco - elem4
-	err |= cbor_encode_text_stringz(&mapEncoder, "aco");
+	err |= CBOR_TMPL(&mapEncoder, tmpl_key_aco, 1);
 	err |= cbor_encode_uint(&mapEncoder, cbor_alarms.aco);
 	DEBUG_ADD(err, "aco");
 
 	// encode st - elem5
-	err |= cbor_encode_text_stringz(&mapEncoder, "st");
+	err |= CBOR_TMPL(&mapEncoder, tmpl_key_st, 1);
 	err |= cbor_encode_uint(&mapEncoder, cbor_alarms.st);
 	DEBUG_ADD(err, "st");
 
 	// encode et - elem6
-	err |= cbor_encode_text_stringz(&mapEncoder, "et");
+	err |= CBOR_TMPL(&mapEncoder, tmpl_key_et, 1);
 	err |= cbor_encode_uint(&mapEncoder, cbor_alarms.et);
 	DEBUG_ADD(err, "et");
 
+#ifdef SAMPLE_MS_TIMESTAMP
+	// encode sms, ems - optional
+	err |= CBOR_TMPL(&mapEncoder, tmpl_key_sms, 1);
+	err |= cbor_encode_uint(&mapEncoder, cbor_alarms.st_ms);
+	err |= CBOR_TMPL(&mapEncoder, tmpl_key_ems, 1);
+	err |= cbor_encode_uint(&mapEncoder, cbor_alarms.et_ms);
+	DEBUG_ADD(err, "sms ems");
+#endif
+
 	// encode did - elem7
-	err |= cbor_encode_text_stringz(&mapEncoder, "did");
+	err |= CBOR_TMPL(&mapEncoder, tmpl_key_did, 1);
 	err |= cbor_encode_int(&mapEncoder, CBOR_GetDid());
 	DEBUG_ADD(err, "did");
 
@@ -293,6 +303,116 @@ size_t CBOR_Hello(C_CHAR* cbor_stream)
 	return len;
 }
 
+#ifdef GW_STATUS_TELEMETRY
+/**
+ * @brief CBOR_Telemetry
+ *
+ * Encodes the telemetry section of the status as
+ * {"hmn":min free heap, "hlb":largest free block, "tsk":[[name, cpu per mille, stack hwm], ...],
+ *  "bfs":ms from boot to the first sample, 0 if not yet polled,
+ *  "mbl":[[line, requests, errors, avg latency us, max latency us, bytes/s, busy per mille,
+ *          turnaround jitter us], ...] line 0 main, 1 aux,
+ *  "rcn":[ms from the last link down to MQTT up, max ms, directed connects, full scan fallbacks],
+ *  "pla":[bytes of the poll tables arena, max bytes, heap fragmentation per mille,
+ *         last poll cycle ms, max ms, last tables compare/update pass us, max us]}
+ *
+ * @param encoder, the encoder of the status map
+ * @return CborNoError or the encoding error
+ */
+static CborError CBOR_Telemetry(CborEncoder* encoder)
+{
+	CborEncoder mapEncoder, arrayEncoder, taskEncoder;
+	const telemetry_task_t* tasks;
+	telemetry_heap_t heap;
+	mb_line_stats_t line[MB_LINE_NUM];
+	wifi_reconnect_stats_t rcn;
+	poll_stats_t pla;
+	C_UINT64 span_us;
+	C_BYTE num, i, lines = 0;
+	CborError err;
+
+	Telemetry__GetHeap(&heap);
+	num = Telemetry__GetTasks(&tasks);
+
+	for (i = 0; i < MB_LINE_NUM; i++)
+	{
+		if ((C_SUCCESS == Modbus__GetLineStats((mb_line_t)i, &line[i])) && (line[i].requests > 0))
+			lines++;
+	}
+
+	WiFi__GetReconnectStats(&rcn);
+	PollEngine__GetStats(&pla);
+
+	err = cbor_encoder_create_map(encoder, &mapEncoder, 7);
+	err |= CBOR_TMPL(&mapEncoder, tmpl_key_hmn, 1);
+	err |= cbor_encode_uint(&mapEncoder, heap.min_free);
+	err |= CBOR_TMPL(&mapEncoder, tmpl_key_hlb, 1);
+	err |= cbor_encode_uint(&mapEncoder, heap.largest);
+
+	err |= CBOR_TMPL(&mapEncoder, tmpl_key_tsk, 1);
+	err |= cbor_encoder_create_array(&mapEncoder, &arrayEncoder, num);
+	for (i = 0; i < num; i++)
+	{
+		err |= cbor_encoder_create_array(&arrayEncoder, &taskEncoder, 3);
+		err |= cbor_encode_text_stringz(&taskEncoder, tasks[i].name);
+		err |= cbor_encode_uint(&taskEncoder, tasks[i].cpu);
+		err |= cbor_encode_uint(&taskEncoder, tasks[i].hwm);
+		err |= cbor_encoder_close_container(&arrayEncoder, &taskEncoder);
+	}
+	err |= cbor_encoder_close_container(&mapEncoder, &arrayEncoder);
+
+	err |= CBOR_TMPL(&mapEncoder, tmpl_key_bfs, 1);
+	err |= cbor_encode_uint(&mapEncoder, PollEngine__GetFirstSampleTime());
+
+	err |= CBOR_TMPL(&mapEncoder, tmpl_key_mbl, 1);
+	err |= cbor_encoder_create_array(&mapEncoder, &arrayEncoder, lines);
+	for (i = 0; i < MB_LINE_NUM; i++)
+	{
+		if (line[i].requests == 0)
+			continue;
+
+		span_us = RTC_Get_Mono_us() - line[i].since_us;
+		if (span_us == 0)
+			span_us = 1;
+
+		err |= cbor_encoder_create_array(&arrayEncoder, &taskEncoder, 8);
+		err |= cbor_encode_uint(&taskEncoder, i);
+		err |= cbor_encode_uint(&taskEncoder, line[i].requests);
+		err |= cbor_encode_uint(&taskEncoder, line[i].errors);
+		err |= cbor_encode_uint(&taskEncoder, line[i].busy_us / line[i].requests);
+		err |= cbor_encode_uint(&taskEncoder, line[i].lat_max_us);
+		err |= cbor_encode_uint(&taskEncoder, ((C_UINT64)line[i].bytes * 1000000) / span_us);
+		err |= cbor_encode_uint(&taskEncoder, (line[i].busy_us * 1000) / span_us);
+		err |= cbor_encode_uint(&taskEncoder, line[i].ta_max_us - line[i].ta_min_us);
+		err |= cbor_encoder_close_container(&arrayEncoder, &taskEncoder);
+	}
+	err |= cbor_encoder_close_container(&mapEncoder, &arrayEncoder);
+
+	err |= CBOR_TMPL(&mapEncoder, tmpl_key_rcn, 1);
+	err |= cbor_encoder_create_array(&mapEncoder, &arrayEncoder, 4);
+	err |= cbor_encode_uint(&arrayEncoder, rcn.last_ms);
+	err |= cbor_encode_uint(&arrayEncoder, rcn.max_ms);
+	err |= cbor_encode_uint(&arrayEncoder, rcn.directed);
+	err |= cbor_encode_uint(&arrayEncoder, rcn.fallback);
+	err |= cbor_encoder_close_container(&mapEncoder, &arrayEncoder);
+
+	// fragmentation: part of the free heap not in the largest free block
+	err |= CBOR_TMPL(&mapEncoder, tmpl_key_pla, 1);
+	err |= cbor_encoder_create_array(&mapEncoder, &arrayEncoder, 7);
+	err |= cbor_encode_uint(&arrayEncoder, pla.arena);
+	err |= cbor_encode_uint(&arrayEncoder, pla.arena_hwm);
+	err |= cbor_encode_uint(&arrayEncoder, (heap.free > heap.largest) ? 1000 - ((C_UINT64)heap.largest * 1000) / heap.free : 0);
+	err |= cbor_encode_uint(&arrayEncoder, pla.cycle_last_us / 1000);
+	err |= cbor_encode_uint(&arrayEncoder, pla.cycle_max_us / 1000);
+	err |= cbor_encode_uint(&arrayEncoder, pla.diff_last_us);
+	err |= cbor_encode_uint(&arrayEncoder, pla.diff_max_us);
+	err |= cbor_encoder_close_container(&mapEncoder, &arrayEncoder);
+	err |= cbor_encoder_close_container(encoder, &mapEncoder);
+
+	return err;
+}
+#endif
+
 /**
  * @brief CBOR_SendStatus
  *
@@ -326,40 +446,45 @@ size_t CBOR_Status(C_CHAR* cbor_stream)
 	// map1
 	err = cbor_encoder_create_map(&encoder, &mapEncoder, CborIndefiniteLength);
 	DEBUG_ENC(err, "status create main map");
-	// encode ver - elem1
-	err |= cbor_encode_text_stringz(&mapEncoder, "ver");
-	err |= cbor_encode_uint(&mapEncoder, CAREL_TYPES_VERSION);
+	// encode ver - elem1, key of t
+	err |= CBOR_TMPL(&mapEncoder, tmpl_ver_t, 3);
 	DEBUG_ADD(err, "version");
 
 	// encode t - elem2
-	err |= cbor_encode_text_stringz(&mapEncoder, "t");
 	C_TIME t = RTC_Get_UTC_Current_Time();
 	err |= cbor_encode_uint(&mapEncoder, t);
 	DEBUG_ADD(err, "t");
 
 	// encode upt - elem3
-	err |= cbor_encode_text_stringz(&mapEncoder, "upt");
+	err |= CBOR_TMPL(&mapEncoder, tmpl_key_upt, 1);
 	err |= cbor_encode_uint(&mapEncoder, t - RTC_Get_UTC_Boot_Time());
 	DEBUG_ADD(err, "upt");
 
 	// encode fme -elem4
-	err |= cbor_encode_text_stringz(&mapEncoder, "fme");
+	err |= CBOR_TMPL(&mapEncoder, tmpl_key_fme, 1);
 	C_UINT32 freemem = Sys__GetFreeHeapSize();
 	err |= cbor_encode_uint(&mapEncoder, freemem);
 	DEBUG_ADD(err,"fme");
 
 	// encode est -elem5
-	err |= cbor_encode_text_stringz(&mapEncoder, "est");
+	err |= CBOR_TMPL(&mapEncoder, tmpl_key_est, 1);
 	err |= cbor_encode_uint(&mapEncoder, PollEngine_GetStatusForSending_CAREL());
 	DEBUG_ADD(err,"est");
 
 	// encode sgn -elem6
-	err |= cbor_encode_text_stringz(&mapEncoder, "sgn");
+	err |= CBOR_TMPL(&mapEncoder, tmpl_key_sgn, 1);
 	int8_t rssi = 0;
 	rssi = Radio__GetRSSI();
 	err |= cbor_encode_int(&mapEncoder, rssi);
 	DEBUG_ADD(err,"sgn");
 
+#ifdef GW_STATUS_TELEMETRY
+	// encode tlm -elem7, optional
+	err |= CBOR_TMPL(&mapEncoder, tmpl_key_tlm, 1);
+	err |= CBOR_Telemetry(&mapEncoder);
+	DEBUG_ADD(err,"tlm");
+#endif
+
 	err |= cbor_encoder_close_container(&encoder, &mapEncoder);
 	if(err == CborNoError)
 		len = cbor_encoder_get_buffer_size(&encoder, (unsigned char*)cbor_stream);
@@ -446,36 +571,44 @@ size_t CBOR_Values(C_CHAR* cbor_stream, C_UINT16 index, C_UINT16 number, C_INT16
 	// map1
 	err = cbor_encoder_create_map(&encoder, &mapEncoder, CborIndefiniteLength);
 	DEBUG_ENC(err, "values create main map");
-	// encode ver - elem1
-	err |= cbor_encode_text_stringz(&mapEncoder, "ver");
-	err |= cbor_encode_uint(&mapEncoder, CAREL_TYPES_VERSION);
+	// encode ver - elem1, key of cnt
+	err |= CBOR_TMPL(&mapEncoder, tmpl_ver_cnt, 3);
 	DEBUG_ADD(err, "version");
 
 	// encode cnt - elem2
-	err |= cbor_encode_text_stringz(&mapEncoder, "cnt");
 	err |= cbor_encode_uint(&mapEncoder, pkt_cnt);
 	if (frame < 0)
 		pkt_cnt++; 	// do not increment "cnt" field if message is fragmented (unless it is the last)
 	DEBUG_ADD(err, "cnt");
 
 	// encode btm - elem3
-	err |= cbor_encode_text_stringz(&mapEncoder, "btm");
+	err |= CBOR_TMPL(&mapEncoder, tmpl_key_btm, 1);
 	C_TIME t = RTC_Get_UTC_Boot_Time();
 	err |= cbor_encode_uint(&mapEncoder, t);
 	DEBUG_ADD(err, "btm");
 
 	// encode t - elem4
-	err |= cbor_encode_text_stringz(&mapEncoder, "t");
+	err |= CBOR_TMPL(&mapEncoder, tmpl_key_t, 1);
 	// if there's no change to notify, update t at current time
+	C_UINT16 t_ms;
 	if (number == 0)
-		t = RTC_Get_UTC_Current_Time();
-	else
+		t = RTC_Get_UTC_Current_Time_ms(&t_ms);
+	else {
 		t = Get_SamplingTime(index);
+		t_ms = Get_SamplingTime_ms(index);
+	}
 	err |= cbor_encode_uint(&mapEncoder, t);
 	DEBUG_ADD(err, "t");
 
+#ifdef SAMPLE_MS_TIMESTAMP
+	// encode tms - optional
+	err |= CBOR_TMPL(&mapEncoder, tmpl_key_tms, 1);
+	err |= cbor_encode_uint(&mapEncoder, t_ms);
+	DEBUG_ADD(err, "tms");
+#endif
+
 	// encode vls - elem5
-	err |= cbor_encode_text_stringz(&mapEncoder, "vls");
+	err |= CBOR_TMPL(&mapEncoder, tmpl_key_vls, 1);
 	// map vals
 	err = cbor_encoder_create_map(&mapEncoder, &mapEncoder1, CborIndefiniteLength);
 	DEBUG_ENC(err, "vals create map");
@@ -494,13 +627,43 @@ size_t CBOR_Values(C_CHAR* cbor_stream, C_UINT16 index, C_UINT16 number, C_INT16
 	}
 	err |= cbor_encoder_close_container(&mapEncoder, &mapEncoder1);
 
+	// encode agg - optional, min/max/mean/count of the aggregate records
+	if (PollEngine__GetAggWindow() != 0) {
+		C_CHAR min_tmp[VAL_SIZE], max_tmp[VAL_SIZE];
+		C_UINT16 agg_cnt, agg_num = 0;
+		CborEncoder arrayEncoder;
+
+		for (C_UINT16 i = index; i < index + number; i++) {
+			if (Get_Aggregate(i, min_tmp, max_tmp, value_tmp, &agg_cnt))
+				agg_num++;
+		}
+		if (agg_num != 0) {
+			err |= CBOR_TMPL(&mapEncoder, tmpl_key_agg, 1);
+			err |= cbor_encoder_create_map(&mapEncoder, &mapEncoder1, agg_num);
+			for (C_UINT16 i = index; i < index + number; i++) {
+				if (!Get_Aggregate(i, min_tmp, max_tmp, value_tmp, &agg_cnt))
+					continue;
+				// alias: [min, max, mean, count]
+				err |= cbor_encode_text_stringz(&mapEncoder1, Get_Alias(i, alias_tmp));
+				err |= cbor_encoder_create_array(&mapEncoder1, &arrayEncoder, 4);
+				err |= cbor_encode_text_stringz(&arrayEncoder, min_tmp);
+				err |= cbor_encode_text_stringz(&arrayEncoder, max_tmp);
+				err |= cbor_encode_text_stringz(&arrayEncoder, value_tmp);
+				err |= cbor_encode_uint(&arrayEncoder, agg_cnt);
+				err |= cbor_encoder_close_container(&mapEncoder1, &arrayEncoder);
+			}
+			err |= cbor_encoder_close_container(&mapEncoder, &mapEncoder1);
+			DEBUG_ADD(err, "agg");
+		}
+	}
+
 	// encode frm - elem6
-	err |= cbor_encode_text_stringz(&mapEncoder, "frm");
+	err |= CBOR_TMPL(&mapEncoder, tmpl_key_frm, 1);
 	err |= cbor_encode_int(&mapEncoder, frame);
 	DEBUG_ADD(err, "frm");
 
 	// encode did - elem7
-	err |= cbor_encode_text_stringz(&mapEncoder, "did");
+	err |= CBOR_TMPL(&mapEncoder, tmpl_key_did, 1);
 	err |= cbor_encode_int(&mapEncoder, CBOR_GetDid());
 	DEBUG_ADD(err, "did");
 
@@ -535,14 +698,23 @@ void CBOR_SendFragmentedValues(C_UINT16 index, C_UINT16 number)
 	C_INT16 framecnt = 1;
 	// cbor values packet overhead is calculated based on the packet format... if it changes this number must be recalculated!!!
 	C_UINT16 cborval_overhead = 50;
+#ifdef SAMPLE_MS_TIMESTAMP
+	cborval_overhead += 7;	// "tms" key and value
+#endif
+	// maximum size of alias and values fields, with aggregation any entry can carry also its "agg"
+	C_UINT16 entry_size = ALIAS_SIZE + VAL_SIZE + 2;
+	if (PollEngine__GetAggWindow() != 0) {
+		cborval_overhead += 6;		// "agg" key and map
+		entry_size += ALIAS_SIZE + 3 * VAL_SIZE + 8;
+	}
 	// calculate values packet size based on maximum size of alias and values fields
-	C_UINT16 values_size = number * (ALIAS_SIZE + VAL_SIZE + 2) + cborval_overhead;
+	C_UINT16 values_size = number * entry_size + cborval_overhead;
 	C_UINT16 entry_per_packet;
 
 	// if a single packet cannot contain all data...
 	if ( values_size > txbuff_len ) {
 		// calculate the number of values that can be put in a single packet (according to tx buff size)...
-		entry_per_packet = ( txbuff_len - cborval_overhead ) / (ALIAS_SIZE + VAL_SIZE + 2);
+		entry_per_packet = ( txbuff_len - cborval_overhead ) / entry_size;
 
 		while(number > entry_per_packet)
 		{
@@ -741,23 +913,21 @@ void CBOR_ResHeader(C_CHAR* cbor_stream, c_cborhreq* cbor_req, CborEncoder* enco
 	err = cbor_encoder_create_map(encoder, mapEncoder, CborIndefiniteLength);
 	DEBUG_ENC(err, "header response");
 
-	// encode ver - elem1
-	err |= cbor_encode_text_stringz(mapEncoder, "ver");
-	err |= cbor_encode_uint(mapEncoder, CAREL_TYPES_VERSION);
+	// encode ver - elem1, key of rto
+	err |= CBOR_TMPL(mapEncoder, tmpl_ver_rto, 3);
 	DEBUG_ADD(err, "ver");
 
 	// encode rto - elem2
-	err |= cbor_encode_text_stringz(mapEncoder, "rto");
 	err |= cbor_encode_text_stringz(mapEncoder, (char*)cbor_req->rto);
 	DEBUG_ADD(err, "rto");
 
 	// encode cmd - elem3
-	err |= cbor_encode_text_stringz(mapEncoder, "cmd");
+	err |= CBOR_TMPL(mapEncoder, tmpl_key_cmd, 1);
 	err |= cbor_encode_uint(mapEncoder, cbor_req->cmd);
 	DEBUG_ADD(err, "cmd");
 
    	// encode res - elem4
-	err = cbor_encode_text_stringz(mapEncoder, "res");
+	err = CBOR_TMPL(mapEncoder, tmpl_key_res, 1);
 	err |= cbor_encode_int(mapEncoder, cbor_req->res);
 	DEBUG_ADD(err, "res");
 
@@ -844,12 +1014,13 @@ size_t CBOR_ResSetDevsConfig(C_CHAR* cbor_response, c_cborhreq* cbor_req, C_UINT
  * @param Address of first responding device
  * @param Answer of the first responding device to Modbus command ReportSlaveId (command 17)
  * @param Length of answer
+ * @param Pointer to the result of a fast scan (NULL for the standard scan)
  * @return void
  */
-size_t CBOR_ResScanLine(C_CHAR* cbor_response, c_cborhreq* cbor_req, C_UINT16 device, C_BYTE* answer, C_UINT16 answer_len)
+size_t CBOR_ResScanLine(C_CHAR* cbor_response, c_cborhreq* cbor_req, C_UINT16 device, C_BYTE* answer, C_UINT16 answer_len, c_cborresscanline* scan)
 {
 	size_t len;
-	CborEncoder encoder, mapEncoder;
+	CborEncoder encoder, mapEncoder, arrayEncoder;
 	CborError err;
 
 	CBOR_ResHeader(cbor_response, cbor_req, &encoder, &mapEncoder);
@@ -867,6 +1038,27 @@ size_t CBOR_ResScanLine(C_CHAR* cbor_response, c_cborhreq* cbor_req, C_UINT16 de
 	err |= cbor_encode_byte_string(&mapEncoder, answer, answer_len);
 	DEBUG_ADD(err, "ans");
 
+	if(scan != NULL)
+	{
+		// encode all the responding devices - elem7
+		err |= cbor_encode_text_stringz(&mapEncoder, "lst");
+		err |= cbor_encoder_create_array(&mapEncoder, &arrayEncoder, scan->num);
+		for(C_UINT16 i = 0; i < scan->num; i++)
+			err |= cbor_encode_uint(&arrayEncoder, scan->dev[i]);
+		err |= cbor_encoder_close_container(&mapEncoder, &arrayEncoder);
+		DEBUG_ADD(err, "lst");
+
+		// encode the auto-detected line config - elem8, elem9
+		if(scan->baud != 0)
+		{
+			err |= cbor_encode_text_stringz(&mapEncoder, "bdr");
+			err |= cbor_encode_uint(&mapEncoder, scan->baud);
+			err |= cbor_encode_text_stringz(&mapEncoder, "par");
+			err |= cbor_encode_uint(&mapEncoder, Modbus__ParityToEMB(scan->parity));
+			DEBUG_ADD(err, "bdr/par");
+		}
+	}
+
 	err |= cbor_encoder_close_container(&encoder, &mapEncoder);
 
 	if(err == CborNoError)
@@ -885,20 +1077,21 @@ size_t CBOR_ResScanLine(C_CHAR* cbor_response, c_cborhreq* cbor_req, C_UINT16 de
 /**
  * @brief CBOR_ResSendMbAdu
  *
- * Prepares CBOR encoded message containing result of send mb adu
+ * Prepares CBOR encoded message containing result of send mb adu,
+ * "adu" holds a [response, err, us] array for every executed frame
  *
- * @param Pointer to the CBOR-encoded payload
+ * @param Pointer to the CBOR-encoded payload, ADU_RESPONSE_SIZE
  * @param Pointer to the structure containing received request
  * @param Adu identifier (same as request)
- * @param Modbus response
- * @param Length of Modbus response
+ * @param Modbus responses of the batch
  * @return void
  */
-size_t CBOR_ResSendMbAdu(C_CHAR* cbor_response, c_cborhreq* cbor_req, C_UINT16 seq, C_BYTE* val, C_UINT16 val_len)
+size_t CBOR_ResSendMbAdu(C_CHAR* cbor_response, c_cborhreq* cbor_req, C_UINT16 seq, c_cbor_res_mb_adu* res)
 {
 	size_t len;
-	CborEncoder encoder, mapEncoder;
+	CborEncoder encoder, mapEncoder, arrayEncoder, frameEncoder;
 	CborError err;
+	C_BYTE i;
 
 	CBOR_ResHeader(cbor_response, cbor_req, &encoder, &mapEncoder);
 
@@ -907,10 +1100,19 @@ size_t CBOR_ResSendMbAdu(C_CHAR* cbor_response, c_cborhreq* cbor_req, C_UINT16 s
 	err |= cbor_encode_int(&mapEncoder, seq);
 	DEBUG_ADD(err, "seq");
 
-	// encode val - elem6
-	err |= cbor_encode_text_stringz(&mapEncoder, "val");
-	err |= cbor_encode_byte_string(&mapEncoder, val, val_len);
-	DEBUG_ADD(err, "val");
+	// encode adu - elem6
+	err |= cbor_encode_text_stringz(&mapEncoder, "adu");
+	err |= cbor_encoder_create_array(&mapEncoder, &arrayEncoder, res->num);
+	for (i = 0; i < res->num; i++)
+	{
+		err |= cbor_encoder_create_array(&arrayEncoder, &frameEncoder, 3);
+		err |= cbor_encode_byte_string(&frameEncoder, &res->rsp[res->off[i]], res->len[i]);
+		err |= cbor_encode_int(&frameEncoder, res->err[i]);
+		err |= cbor_encode_uint(&frameEncoder, res->us[i]);
+		err |= cbor_encoder_close_container(&arrayEncoder, &frameEncoder);
+	}
+	err |= cbor_encoder_close_container(&mapEncoder, &arrayEncoder);
+	DEBUG_ADD(err, "adu");
 
 	err |= cbor_encoder_close_container(&encoder, &mapEncoder);
 
@@ -983,374 +1185,377 @@ size_t CBOR_ResRdWrValues(C_CHAR* cbor_response, c_cborhreq* cbor_req, C_CHAR* a
 	return len;
 }
 
+/* Request decoder -----------------------------------------------------------*/
+/* the keys and their perfect hash are in CBOR_ReqKeys_CAREL.h */
+
+typedef struct req_field_s{
+	C_UINT32 key;
+	C_UINT16 offset;		// in c_cborreq
+	C_BYTE size;			// 0 empty slot
+	C_BYTE type;
+	C_BYTE hdr;				// 1 if part of the request header
+}req_field_t;
+
+#define REQ_FIELD(a,b,c, member, type, hdr)		[REQ_KEY_SLOT(REQ_KEY(a,b,c))] = \
+	{ REQ_KEY(a,b,c), offsetof(c_cborreq, member), sizeof(((c_cborreq*)0)->member), (type), (hdr) },
+
+static const req_field_t req_fields[REQ_KEY_SLOTS] = {
+	REQ_FIELDS(REQ_FIELD)
+};
+
+_Static_assert(REQ_KEY_SIZE == TAG_SIZE, "the keys are read in a tag of TAG_SIZE chars");
+
+
 /**
- * @brief CBOR_ReqHeader
+ * @brief CBOR_ReqWalk
  *
- * Interprets CBOR request header
+ * Walks once the map of a request, every known key is stored in place,
+ * the unknown ones are skipped without being decoded
  *
  * @param Pointer to the CBOR-encoded stream
  * @param Length of CBOR stream
- * @param Pointer to the request struct
+ * @param Pointer to the destination, a c_cborreq or (hdr_only) a c_cborhreq
+ * @param hdr_only, decode only the header keys
  * @return CborError
  */
-CborError CBOR_ReqHeader(C_CHAR* cbor_stream, C_UINT16 cbor_len, c_cborhreq* cbor_req)
+static CborError CBOR_ReqWalk(C_CHAR* cbor_stream, C_UINT16 cbor_len, void* dest, C_BOOL hdr_only)
 {
-	// parse request header and get replyTo and cmd fields
-	// write them to cbor_req
 	CborParser parser;
-	size_t stlen;
-    char tag[TAG_SIZE];
-	char rto[RTO_SIZE];
-	CborError err;
 	CborValue it, recursed;
+	CborError err;
+	const req_field_t *field;
+	char tag[TAG_SIZE + 1];
+	size_t stlen;
+	C_UINT32 key;
+	int64_t tmp = 0;
 
 	err = cbor_parser_init((unsigned char*)cbor_stream, cbor_len, 0, &parser, &it);
-	err |= cbor_value_enter_container(&it, &recursed);
-	DEBUG_DEC(err, "header request map");
+	if ((err == CborNoError) && !cbor_value_is_map(&it))
+		err = CborErrorIllegalType;
+	if (err)
+		return err;
 
-	int64_t tmp = 0;
+	err = cbor_value_enter_container(&it, &recursed);
+	DEBUG_DEC(err, "request map");
+
+	while ((err == CborNoError) && !cbor_value_at_end(&recursed)) {
+
+		if (!cbor_value_is_text_string(&recursed))
+			return CborErrorIllegalType;
 
-	while (!cbor_value_at_end(&recursed)) {
-		stlen = TAG_SIZE;
-		memset(tag,'0',sizeof(tag));
+		// a key longer than TAG_SIZE is unknown, the iterator is anyway moved to its value
+		stlen = sizeof(tag);
 		err = cbor_value_copy_text_string(&recursed, tag, &stlen, &recursed);
+		if (err == CborErrorOutOfMemory)
+		{
+			err = CborNoError;
+			stlen = 0;
+		}
+		if (err)
+			return err;
 
-		if (strncmp(tag, "ver", 3) == 0)
+		field = NULL;
+		key = ReqKey__Pack(tag, stlen);
+		if (key != 0)
 		{
-			err |= CBOR_ExtractInt(&recursed, &tmp);
-			cbor_req->ver = (C_INT16)tmp;
-			DEBUG_DEC(err, "header: ver");
+			field = &req_fields[REQ_KEY_SLOT(key)];
+			if ((field->size == 0) || (field->key != key) || (hdr_only && !field->hdr))
+				field = NULL;
 		}
-		else if (strncmp(tag, "rto", 3) == 0)
+
+		if (field == NULL)
 		{
-			stlen = RTO_SIZE;
-			err |= cbor_value_copy_text_string(&recursed, rto, &stlen, &recursed);
-			strcpy((char*)cbor_req->rto, rto);
-			DEBUG_DEC(err, "header: rto");
+			err = cbor_value_advance(&recursed);
+			DEBUG_DEC(err, "discard element");
 		}
-		else if (strncmp(tag, "cmd", 3) == 0)
+		else if (field->type == REQ_FIELD_TEXT)
 		{
-			err |= CBOR_ExtractInt(&recursed, &tmp);
-			cbor_req->cmd = (C_INT16)tmp;
-			DEBUG_DEC(err, "header: cmd");
+			if (!cbor_value_is_text_string(&recursed))
+				return CborErrorIllegalType;
+			stlen = field->size;
+			err = cbor_value_copy_text_string(&recursed, (char*)dest + field->offset, &stlen, &recursed);
+			DEBUG_DEC(err, tag);
 		}
 		else
 		{
-			err |= CBOR_DiscardElement(&recursed);
-			DEBUG_DEC(err, "header: discard element");
+			if (!cbor_value_is_integer(&recursed))
+				return CborErrorIllegalType;
+			err = CBOR_ExtractInt(&recursed, &tmp);
+			switch (field->size)
+			{
+				case 1:  { C_BYTE   v = (C_BYTE)tmp;   memcpy((C_BYTE*)dest + field->offset, &v, sizeof(v)); } break;
+				case 2:  { C_UINT16 v = (C_UINT16)tmp; memcpy((C_BYTE*)dest + field->offset, &v, sizeof(v)); } break;
+				default: { C_UINT32 v = (C_UINT32)tmp; memcpy((C_BYTE*)dest + field->offset, &v, sizeof(v)); } break;
+			}
+			DEBUG_DEC(err, tag);
 		}
-		if (err)
-			return err;
 	}
 
+	if (err)
+		return err;
+
 	err = cbor_value_leave_container(&it, &recursed);
 	return err;
 }
 
 /**
- * @brief CBOR_ReqSetLinesConfig
+ * @brief CBOR_ReqHeader
  *
- * Interprets CBOR set lines config request
+ * Interprets CBOR request header, the other keys are skipped
  *
- * @param Pointer to the CBOR current element
- * @param Pointer to new baud rate
- * @param Pointer to new serial connector type
+ * @param Pointer to the CBOR-encoded stream
+ * @param Length of CBOR stream
+ * @param Pointer to the request header
  * @return CborError
  */
-CborError CBOR_ReqSetLinesConfig(C_CHAR* cbor_stream, C_UINT16 cbor_len, c_cborreqlinesconfig *set_line_cfg)
+CborError CBOR_ReqHeader(C_CHAR* cbor_stream, C_UINT16 cbor_len, c_cborhreq* cbor_req)
 {
-	CborError err = CborNoError;
-	size_t stlen;
-	char tag[TAG_SIZE];
-	CborValue it, recursed;
-	CborParser parser;
-
-	err = cbor_parser_init((unsigned char*)cbor_stream, cbor_len, 0, &parser, &it);
-	err |= cbor_value_enter_container(&it, &recursed);
-	DEBUG_DEC(err, "set lines config request map");
-
-	int64_t tmp = 0;
-
-	while (!cbor_value_at_end(&recursed)) {
-		stlen = TAG_SIZE;
-		memset(tag,'0',sizeof(tag));
-		err = cbor_value_copy_text_string(&recursed, tag, &stlen, &recursed);
-
-		if (strncmp(tag, "bau", 3) == 0)
-		{
-			err |= CBOR_ExtractInt(&recursed, &tmp);
-			set_line_cfg->baud = (C_UINT32)tmp;
-			DEBUG_DEC(err, "req_set_lines_config: bau");
-		}
-		else if (strncmp(tag, "con", 3) == 0)
-		{
-			err |= CBOR_ExtractInt(&recursed, &tmp);
-			set_line_cfg->conn = (C_BYTE)tmp;
-			DEBUG_DEC(err, "req_set_lines_config: con");
-		}
-		else if (strncmp(tag, "del", 3) == 0)
-		{
-			err |= CBOR_ExtractInt(&recursed, &tmp);
-			set_line_cfg->del = (C_UINT16)tmp;
-			DEBUG_DEC(err, "req_set_lines_config: del");
-		}
-		else
-		{
-			err |= CBOR_DiscardElement(&recursed);
-			DEBUG_DEC(err, "req_set_lines_config: discard element");
-		}
-		if (err)
-			return err;
-	}
-
-	err = cbor_value_leave_container(&it, &recursed);
-	return err;
+	// the header is the first member of c_cborreq, its offsets are the same
+	return CBOR_ReqWalk(cbor_stream, cbor_len, (void*)cbor_req, C_TRUE);
 }
 
 /**
- * @brief CBOR_ReqSetDevsConfig
+ * @brief CBOR_ReqDecode
  *
- * Interprets CBOR set devs config
+ * Interprets a whole CBOR request (header and fields of the command)
+ * in a single pass
  *
- * @param Pointer to the CBOR current element
- * @param Pointer to new username
- * @param Pointer to new password
- * @param Pointer to new uri
- * @param Pointer to new cid (for update)
+ * @param Pointer to the CBOR-encoded stream
+ * @param Length of CBOR stream
+ * @param Pointer to the decoded request, must be zeroed by the caller
  * @return CborError
  */
-CborError CBOR_ReqSetDevsConfig(C_CHAR* cbor_stream, C_UINT16 cbor_len, c_cborreqdwldevsconfig* download_devs_config)
+CborError CBOR_ReqDecode(C_CHAR* cbor_stream, C_UINT16 cbor_len, c_cborreq* req)
 {
-	CborError err = CborNoError;
-	size_t stlen;
-	char tag[TAG_SIZE];
-	CborValue it, recursed;
-	CborParser parser;
-
-	err = cbor_parser_init((unsigned char*)cbor_stream, cbor_len, 0, &parser, &it);
-	err |= cbor_value_enter_container(&it, &recursed);
-	DEBUG_DEC(err, "set devs config request map");
-
-	int64_t tmp = 0;
-
-	while (!cbor_value_at_end(&recursed)) {
-		stlen = TAG_SIZE;
-		memset(tag,'0',sizeof(tag));
-		err = cbor_value_copy_text_string(&recursed, tag, &stlen, &recursed);
-
-		if (strncmp(tag, "usr", 3) == 0)
-		{
-			stlen = USERNAME_SIZE;
-			err |= cbor_value_copy_text_string(&recursed, download_devs_config->usr, &stlen, &recursed);
-			DEBUG_DEC(err, "req_set_devs_config: usr");
-		}
-		else if (strncmp(tag, "pwd", 3) == 0)
-		{
-			stlen = PASSWORD_SIZE;
-			err |= cbor_value_copy_text_string(&recursed, download_devs_config->pwd, &stlen, &recursed);
-			DEBUG_DEC(err, "req_set_devs_config: pwd");
-		}
-		else if (strncmp(tag, "uri", 3) == 0)
-		{
-			stlen = URI_SIZE;
-			err |= cbor_value_copy_text_string(&recursed, download_devs_config->uri, &stlen, &recursed);
-			DEBUG_DEC(err, "req_set_devs_config: uri");
-		}
-		else if (strncmp(tag, "cid", 3) == 0)
-		{
-			err |= CBOR_ExtractInt(&recursed, &tmp);
-			download_devs_config->cid = (C_UINT16)tmp;
-			DEBUG_DEC(err, "req_set_devs_config: cid");
-		}
-		else if (strncmp(tag, "crc", 3) == 0)
-		{
-			err |= CBOR_ExtractInt(&recursed, &tmp);
-			download_devs_config->crc = (C_UINT16)tmp;
-			DEBUG_DEC(err, "req_set_devs_config: crc");
-		}
-		else if (strncmp(tag, "dev", 3) == 0)
-		{
-			err |= CBOR_ExtractInt(&recursed, &tmp);
-			download_devs_config->dev = (C_UINT16)tmp;
-			DEBUG_DEC(err, "req_set_devs_config: dev");
-		}
-		else if (strncmp(tag, "did", 3) == 0)
-		{
-			err |= CBOR_ExtractInt(&recursed, &tmp);
-			download_devs_config->did = (C_UINT16)tmp;
-			DEBUG_DEC(err, "req_set_devs_config: did");
-		}
-		else if (strncmp(tag, "fil", 3) == 0)
-		{
-			stlen = FIL_SIZE;
-			err |= cbor_value_copy_text_string(&recursed, download_devs_config->fil, &stlen, &recursed);
-			DEBUG_DEC(err, "req_set_devs_config: fil");
-		}
-		else
-		{
-			err |= CBOR_DiscardElement(&recursed);
-			DEBUG_DEC(err, "req_set_devs_config: discard element");
-		}
-		if (err)
-			return err;
-	}
-
-	err = cbor_value_leave_container(&it, &recursed);
-	return err;
+	return CBOR_ReqWalk(cbor_stream, cbor_len, (void*)req, C_FALSE);
 }
 
-
 /**
- * @brief CBOR_ReqScanLine
+ * @brief CBOR_ReqSendMbAdu
  *
- * Interprets CBOR scan line request
+ * Interprets the fields of a send_mb_adu request, the batch of frames
+ * "adu" is an array of byte strings (whole RTU ADU, CRC included)
+ * copied back to back in adu->adu, "lin" selects the line
  *
- * @param Pointer to the CBOR stream
- * @param Length of the CBOR stream
- * @param Pointer to the address to be queried (if 0, query all addresses)
+ * @param Pointer to the CBOR-encoded stream
+ * @param Length of CBOR stream
+ * @param Pointer to the decoded batch
  * @return CborError
  */
-CborError CBOR_ReqScanLine(C_CHAR* cbor_stream, C_UINT16 cbor_len, C_UINT16 *device)
+CborError CBOR_ReqSendMbAdu(C_CHAR* cbor_stream, C_UINT16 cbor_len, c_cbor_send_mb_adu* adu)
 {
-	CborError err = CborNoError;
-	size_t stlen;
-	char tag[TAG_SIZE];
-	CborValue it, recursed;
 	CborParser parser;
+	CborValue it, recursed, frames;
+	CborError err;
+	char tag[TAG_SIZE + 1];
+	size_t stlen;
+	int64_t tmp = 0;
+	C_UINT16 used = 0;
+
+	memset((void*)adu, 0, sizeof(c_cbor_send_mb_adu));
 
 	err = cbor_parser_init((unsigned char*)cbor_stream, cbor_len, 0, &parser, &it);
-	err |= cbor_value_enter_container(&it, &recursed);
-	DEBUG_DEC(err, "scan line request map");
+	if ((err == CborNoError) && !cbor_value_is_map(&it))
+		err = CborErrorIllegalType;
+	if (err)
+		return err;
+
+	err = cbor_value_enter_container(&it, &recursed);
+	DEBUG_DEC(err, "adu map");
 
-	int64_t tmp;
+	while ((err == CborNoError) && !cbor_value_at_end(&recursed)) {
 
-	while (!cbor_value_at_end(&recursed)) {
-		stlen = TAG_SIZE;
-		memset(tag,'0',sizeof(tag));
+		if (!cbor_value_is_text_string(&recursed))
+			return CborErrorIllegalType;
+
+		stlen = sizeof(tag);
 		err = cbor_value_copy_text_string(&recursed, tag, &stlen, &recursed);
+		if (err == CborErrorOutOfMemory)
+		{
+			err = CborNoError;
+			tag[0] = '\0';
+		}
+		if (err)
+			return err;
 
-		if (strncmp(tag, "dev", 3) == 0)
+		if (!strcmp(tag, "adu"))
 		{
-			err |= CBOR_ExtractInt(&recursed, &tmp);
-			*device = (C_UINT16)tmp;
-			DEBUG_DEC(err, "req_scan_line: dev");
+			if (!cbor_value_is_array(&recursed))
+				return CborErrorIllegalType;
+			err = cbor_value_enter_container(&recursed, &frames);
+			while ((err == CborNoError) && !cbor_value_at_end(&frames))
+			{
+				if (!cbor_value_is_byte_string(&frames))
+					return CborErrorIllegalType;
+				if (adu->num >= ADU_MAX_FRAMES)
+					return CborErrorOutOfMemory;
+
+				stlen = sizeof(adu->adu) - used;
+				if (stlen > ADU_FRAME_SIZE)
+					stlen = ADU_FRAME_SIZE;
+				err = cbor_value_copy_byte_string(&frames, &adu->adu[used], &stlen, &frames);
+				if (err)
+					return err;
+
+				adu->off[adu->num] = used;
+				adu->len[adu->num] = (uint16_t)stlen;
+				adu->num++;
+				used += (C_UINT16)stlen;
+			}
+			if (err == CborNoError)
+				err = cbor_value_leave_container(&recursed, &frames);
+			DEBUG_DEC(err, tag);
+		}
+		else if (!strcmp(tag, "seq") || !strcmp(tag, "tmo") || !strcmp(tag, "hld") ||
+				 !strcmp(tag, "cls") || !strcmp(tag, "lin"))
+		{
+			if (!cbor_value_is_integer(&recursed))
+				return CborErrorIllegalType;
+			err = CBOR_ExtractInt(&recursed, &tmp);
+			if (tag[0] == 's')
+				adu->sequence = (uint16_t)tmp;
+			else if (tag[0] == 't')
+				adu->tmo = (uint16_t)tmp;
+			else if (tag[0] == 'h')
+				adu->hld = (uint16_t)tmp;
+			else if (tag[0] == 'l')
+				adu->lin = (tmp != 0) ? 1 : 0;
+			else
+				adu->cls = (tmp != 0) ? 1 : 0;
+			DEBUG_DEC(err, tag);
 		}
 		else
 		{
-			err |= CBOR_DiscardElement(&recursed);
-			DEBUG_DEC(err, "req_scan_line: discard element");
+			// header keys are decoded by CBOR_ReqHeader
+			err = cbor_value_advance(&recursed);
+			DEBUG_DEC(err, "discard element");
 		}
-		if (err)
-			return err;
 	}
 
+	if (err)
+		return err;
+
+	if (adu->num == 0)
+		return CborErrorIllegalType;
+
 	err = cbor_value_leave_container(&it, &recursed);
 	return err;
 }
 
 /**
- * @brief CBOR_ReqRdWrValues
+ * @brief CBOR_ReqAuxPoll
  *
- * Interprets CBOR read/write values request
+ * Interprets the poll table of the aux line of a set_lines_config
+ * request, "apl" is an array of [ali, dev, fc, reg, typ] (see
+ * mb_aux_poll_entry_t) and "apt" the poll period in s. Without "apl"
+ * the aux line is not polled
  *
- * @param Pointer to the CBOR current element
- * @param Pointer to structure for read/write values command
+ * @param Pointer to the CBOR-encoded stream
+ * @param Length of CBOR stream
+ * @param Pointer to the decoded poll table
  * @return CborError
  */
-CborError CBOR_ReqRdWrValues(C_CHAR* cbor_stream, C_UINT16 cbor_len, c_cborreqrdwrvalues* cbor_rwv)
+CborError CBOR_ReqAuxPoll(C_CHAR* cbor_stream, C_UINT16 cbor_len, mb_aux_poll_cfg_t* cfg)
 {
-	CborError err = CborNoError;
-	size_t stlen;
-	char tag[TAG_SIZE]={'\0'};
-	char text[30];
-	CborValue it, recursed;
 	CborParser parser;
+	CborValue it, recursed, list, item;
+	CborError err;
+	char tag[TAG_SIZE + 1];
+	size_t stlen;
+	int64_t field[5];
+	mb_aux_poll_entry_t *ent;
+	C_BYTE n;
+
+	memset((void*)cfg, 0, sizeof(mb_aux_poll_cfg_t));
 
 	err = cbor_parser_init((unsigned char*)cbor_stream, cbor_len, 0, &parser, &it);
-	err |= cbor_value_enter_container(&it, &recursed);
-	DEBUG_DEC(err, "write values request map");
+	if ((err == CborNoError) && !cbor_value_is_map(&it))
+		err = CborErrorIllegalType;
+	if (err)
+		return err;
 
-	int64_t tmp = 0;
+	err = cbor_value_enter_container(&it, &recursed);
+	DEBUG_DEC(err, "apl map");
 
-	while (!cbor_value_at_end(&recursed)) {
-		stlen = TAG_SIZE;
-		memset(tag,'0',sizeof(tag));
-		err = cbor_value_copy_text_string(&recursed, tag, &stlen, &recursed);
+	while ((err == CborNoError) && !cbor_value_at_end(&recursed)) {
 
-		if (strncmp(tag, "ali", 3) == 0)
-		{
-			stlen = ALIAS_SIZE;
-			err |= cbor_value_copy_text_string(&recursed, text, &stlen, &recursed);
-			memcpy(cbor_rwv->alias, text, stlen);
-			DEBUG_DEC(err, "req_rdwr_values: ali");
-		}
-		else if (strncmp(tag, "val", 3) == 0)
-		{
-			stlen = VAL_SIZE;
-			err |= cbor_value_copy_text_string(&recursed, text, &stlen, &recursed);
-			memcpy(cbor_rwv->val, text, stlen);
-			DEBUG_DEC(err, "req_rdwr_values: val");
-		}
-		else if (strncmp(tag, "fun", 3) == 0)
-		{
-			err |= CBOR_ExtractInt(&recursed, &tmp);
-			cbor_rwv->func = (C_UINT16)tmp;
-			DEBUG_DEC(err, "req_rdwr_values: fun");
-		}
-		else if (strncmp(tag, "adr", 3) == 0)
-		{
-			err |= CBOR_ExtractInt(&recursed, &tmp);
-			cbor_rwv->addr = (C_UINT16)tmp;
-			DEBUG_DEC(err, "req_rdwr_values: adr");
-		}
-		else if (strncmp(tag, "dim", 3) == 0)
-		{
-			err |= CBOR_ExtractInt(&recursed, &tmp);
-			cbor_rwv->dim = (C_UINT16)tmp;
-			DEBUG_DEC(err, "req_rdwr_values: dim");
-		}
-		else if (strncmp(tag, "pos", 3) == 0)
-		{
-			err |= CBOR_ExtractInt(&recursed, &tmp);
-			cbor_rwv->pos = (C_UINT16)tmp;
-			DEBUG_DEC(err, "req_rdwr_values: pos");
-		}
-		else if (strncmp(tag, "len", 3) == 0)
-		{
-			err |= CBOR_ExtractInt(&recursed, &tmp);
-			cbor_rwv->len = (C_UINT16)tmp;
-			DEBUG_DEC(err, "req_rdwr_values: len");
-		}
-		else if (strncmp(tag, "a", 3) == 0)
+		if (!cbor_value_is_text_string(&recursed))
+			return CborErrorIllegalType;
+
+		stlen = sizeof(tag);
+		err = cbor_value_copy_text_string(&recursed, tag, &stlen, &recursed);
+		if (err == CborErrorOutOfMemory)
 		{
-			stlen = A_SIZE;
-			err |= cbor_value_copy_text_string(&recursed, text, &stlen, &recursed);
-			memcpy(cbor_rwv->a, text, stlen);
-			DEBUG_DEC(err, "req_rdwr_values: a");
+			err = CborNoError;
+			tag[0] = '\0';
 		}
-		else if (strncmp(tag, "b", 3) == 0)
+		if (err)
+			return err;
+
+		if (!strcmp(tag, "apl"))
 		{
-			stlen = B_SIZE;
-			err |= cbor_value_copy_text_string(&recursed, text, &stlen, &recursed);
-			memcpy(cbor_rwv->b, text, stlen);
-			DEBUG_DEC(err, "req_rdwr_values: b");
+			if (!cbor_value_is_array(&recursed))
+				return CborErrorIllegalType;
+			err = cbor_value_enter_container(&recursed, &list);
+			while ((err == CborNoError) && !cbor_value_at_end(&list))
+			{
+				if (!cbor_value_is_array(&list))
+					return CborErrorIllegalType;
+				if (cfg->num >= MB_AUX_POLL_MAX)
+					return CborErrorOutOfMemory;
+
+				err = cbor_value_enter_container(&list, &item);
+				for (n = 0; (err == CborNoError) && (n < 5); n++)
+				{
+					if (cbor_value_at_end(&item) || !cbor_value_is_integer(&item))
+						return CborErrorIllegalType;
+					err = CBOR_ExtractInt(&item, &field[n]);
+				}
+				if (err)
+					return err;
+				if (!cbor_value_at_end(&item))
+					return CborErrorIllegalType;
+				err = cbor_value_leave_container(&list, &item);
+
+				// [ali, dev, fc, reg, typ], 32 bit values only in registers
+				if ((field[1] < 1) || (field[1] > 247) || (field[2] < 1) || (field[2] > 4) ||
+					(field[3] < 0) || (field[3] > 0xFFFF) || (field[4] < MB_AUX_TYP_U16) || (field[4] > MB_AUX_TYP_S32) ||
+					((field[2] <= 2) && (field[4] != MB_AUX_TYP_U16)))
+					return CborErrorIllegalType;
+
+				ent = &cfg->ent[cfg->num++];
+				ent->ali = (C_UINT16)field[0];
+				ent->dev = (C_BYTE)field[1];
+				ent->fc = (C_BYTE)field[2];
+				ent->reg = (C_UINT16)field[3];
+				ent->typ = (C_BYTE)field[4];
+			}
+			if (err == CborNoError)
+				err = cbor_value_leave_container(&recursed, &list);
+			DEBUG_DEC(err, tag);
 		}
-		else if (strncmp(tag, "flg", 3) == 0)
+		else if (!strcmp(tag, "apt"))
 		{
-			flag_t ftmp = {0};
-			err |= CBOR_ExtractInt(&recursed, &ftmp);
-			cbor_rwv->flags = ftmp;
-			DEBUG_DEC(err, "req_rdwr_values: flg");
+			if (!cbor_value_is_integer(&recursed))
+				return CborErrorIllegalType;
+			err = CBOR_ExtractInt(&recursed, &field[0]);
+			cfg->period = ((field[0] < MB_AUX_POLL_PERIOD_MIN_S) || (field[0] > 0xFFFF)) ? MB_AUX_POLL_PERIOD_DEF_S : (C_UINT16)field[0];
+			DEBUG_DEC(err, tag);
 		}
 		else
 		{
-			err |= CBOR_DiscardElement(&recursed);
-			DEBUG_DEC(err, "req_rdwr_values: discard element");
+			// the other keys are decoded by CBOR_ReqDecode
+			err = cbor_value_advance(&recursed);
+			DEBUG_DEC(err, "discard element");
 		}
-		if (err)
-			return err;
 	}
 
+	if (err)
+		return err;
+
+	if (cfg->period == 0)
+		cfg->period = MB_AUX_POLL_PERIOD_DEF_S;
+
 	err = cbor_value_leave_container(&it, &recursed);
 	return err;
 }
@@ -1372,364 +1577,57 @@ CborError CBOR_ExtractInt(CborValue* recursed, int64_t* read)
 }
 
 /**
- * @brief CBOR_ReqSetGwConfig
+ * @brief CBOR_DiscardElement
  *
- * Interprets CBOR set gw config
+ * Interprets CBOR and discard unneedee fields
  *
- * @param Pointer to the CBOR stream
- * @param Length of the CBOR stream
- * @param Pointer to structure for set gw config command
+ * @param Pointer to the CBOR struct
  * @return CborError
  */
-CborError CBOR_ReqSetGwConfig(C_CHAR* cbor_stream, C_UINT16 cbor_len, c_cborreqsetgwconfig* cbor_setgwconfig)
+CborError CBOR_DiscardElement(CborValue* it)
 {
-	CborError err = CborNoError;
-	size_t stlen;
-	char tag[TAG_SIZE];
-	CborValue it, recursed;
-	CborParser parser;
-
-	err = cbor_parser_init((unsigned char*)cbor_stream, cbor_len, 0, &parser, &it);
-	err |= cbor_value_enter_container(&it, &recursed);
-	DEBUG_DEC(err, "set gw config request map");
-
-	int64_t tmp = 0;
+	// skip the element whatever is its type, without copying it
+	return cbor_value_advance(it);
+}
 
-	while (!cbor_value_at_end(&recursed)) {
-		stlen = TAG_SIZE;
-		memset(tag,'0',sizeof(tag));
-		err = cbor_value_copy_text_string(&recursed, tag, &stlen, &recursed);
-
-		if (strncmp(tag, "pva", 3) == 0)
-		{
-			err |= CBOR_ExtractInt(&recursed, &tmp);
-			cbor_setgwconfig->pva = (C_UINT16)tmp;
-			DEBUG_DEC(err, "req_set_gw_config: pva");
-		}
-		else if (strncmp(tag, "pst", 3) == 0)
-		{
-			err |= CBOR_ExtractInt(&recursed, &tmp);
-			cbor_setgwconfig->pst = (C_UINT16)tmp;
-			DEBUG_DEC(err, "req_set_gw_config: pst");
-		}
-		else if (strncmp(tag, "mka", 3) == 0)
-		{
-			err |= CBOR_ExtractInt(&recursed, &tmp);
-			cbor_setgwconfig->mka = (C_UINT16)tmp;
-			DEBUG_DEC(err, "req_set_gw_config: mka");
-		}
-		else if (strncmp(tag, "lss", 3) == 0)
-		{
-			err |= CBOR_ExtractInt(&recursed, &tmp);
-			cbor_setgwconfig->lss = (C_UINT16)tmp;
-			DEBUG_DEC(err, "req_set_gw_config: lss");
-		}
-		else if (strncmp(tag, "hss", 3) == 0)
-		{
-			err |= CBOR_ExtractInt(&recursed, &tmp);
-			cbor_setgwconfig->hss = (C_UINT16)tmp;
-			DEBUG_DEC(err, "req_set_gw_config: hss");
-		}
-		else
-		{
-			err |= CBOR_DiscardElement(&recursed);
-			DEBUG_DEC(err, "req_set_gw_config: discard element");
-		}
-		if (err)
-			return err;
-	}
-
-	err = cbor_value_leave_container(&it, &recursed);
-	return err;
-}
+/**
+ * @brief CBOR_ReqGetUpdFw
+ *
+ * Extracts the fields of an update firmware request
+ *
+ * @param Pointer to the decoded request
+ * @param Pointer to the update firmware data
+ * @return void
+ */
+static void CBOR_ReqGetUpdFw(const c_cborreq* req, c_cborrequpddevfw* upd_fw)
+{
+	memcpy(upd_fw->usr, req->cfg.usr, sizeof(upd_fw->usr));
+	memcpy(upd_fw->pwd, req->cfg.pwd, sizeof(upd_fw->pwd));
+	memcpy(upd_fw->uri, req->cfg.uri, sizeof(upd_fw->uri));
+	upd_fw->fid = req->file.fid;
+	upd_fw->wet = req->wet;
+	upd_fw->cid = req->cfg.cid;
+}
 
 /**
- * @brief CBOR_ReqReboot
+ * @brief CBOR_ReqGetUpdGmeFw
  *
- * Interprets CBOR reboot request
+ * Extracts the fields of an update GME firmware request
  *
- * @param Pointer to the CBOR stream
- * @param Length of the CBOR stream
- * @param Pointer to cid identifier
- * @return CborError
- */
-CborError CBOR_ReqReboot(C_CHAR* cbor_stream, C_UINT16 cbor_len, C_UINT16* cid)
-{
-	CborError err = CborNoError;
-	size_t stlen;
-	char tag[TAG_SIZE];
-	CborValue it, recursed;
-	CborParser parser;
-
-	err = cbor_parser_init((unsigned char*)cbor_stream, cbor_len, 0, &parser, &it);
-	err |= cbor_value_enter_container(&it, &recursed);
-	DEBUG_DEC(err, "reboot request map");
-
-	int64_t tmp=0;
-
-	while (!cbor_value_at_end(&recursed)) {
-		stlen = TAG_SIZE;
-		memset(tag,'0',sizeof(tag));
-		err = cbor_value_copy_text_string(&recursed, tag, &stlen, &recursed);
-
-		if (strncmp(tag, "cid", 3) == 0)
-		{
-			err |= CBOR_ExtractInt(&recursed, &tmp);
-			*cid = (C_UINT16)tmp;
-			DEBUG_DEC(err, "reboot: cid");
-		}
-		else
-		{
-			err |= CBOR_DiscardElement(&recursed);
-			DEBUG_DEC(err, "reboot: discard element");
-		}
-		if (err)
-			return err;
-	}
-	err = cbor_value_leave_container(&it, &recursed);
-	return err;
-}
-
-
-/**
- * @brief CBOR_DiscardElement
- *
- * Interprets CBOR and discard unneedee fields
- *
- * @param Pointer to the CBOR struct
- * @return CborError
- */
-CborError CBOR_DiscardElement(CborValue* it)
-{
-	CborError err = CborNoError;
-
-	CborType type = cbor_value_get_type(it);
-	switch (type) {
-		case CborIntegerType: {
-			int64_t val;
-			err = CBOR_ExtractInt(it, &val);     // can't fail
-			break;
-		}
-		case CborByteStringType: {
-			size_t n=512;
-			uint8_t stringa[512];
-			err = cbor_value_copy_byte_string(it, stringa, &n, it);
-			break;
-		}
-		case CborTextStringType: {
-			size_t n=512;
-			char text[512];
-			err = cbor_value_copy_text_string(it, text, &n, it);
-			break;
-		}
-		default:
-			break;
-	}
-	return err;
-}
-
-
-
-/**
- * @brief CBOR_ReqUpdateDevFW
- *
- * Interprets CBOR update dev FW
- *
- * @param Pointer to the CBOR current element
- * @param Pointer to username
- * @param Pointer to password
- * @param Pointer to uri
- * @param Pointer to fid          0..9999 file index, valid only for modbus file transf.
- * @param Pointer to wet          number of second needed by the target to perform a reboot after an upgrade
- *
- * @return CborError
- */
-CborError CBOR_ReqUpdateDevFW(C_CHAR* cbor_stream, C_UINT16 cbor_len, c_cborrequpddevfw* update_dev_fw)
-{
-	CborError err = CborNoError;
-	size_t stlen;
-	char tag[TAG_SIZE];
-	CborValue it, recursed;
-	CborParser parser;
-
-	err = cbor_parser_init((unsigned char*)cbor_stream, cbor_len, 0, &parser, &it);
-	err |= cbor_value_enter_container(&it, &recursed);
-	DEBUG_DEC(err, "set devs config request map");
-
-	int64_t tmp=0;
-
-	while (!cbor_value_at_end(&recursed)) {
-		stlen = TAG_SIZE;
-		memset(tag,'0',sizeof(tag));
-		err = cbor_value_copy_text_string(&recursed, tag, &stlen, &recursed);
-
-		if (strncmp(tag, "usr", 3) == 0)
-		{
-			stlen = USERNAME_SIZE;
-			err |= cbor_value_copy_text_string(&recursed, update_dev_fw->usr, &stlen, &recursed);
-			DEBUG_DEC(err, "req_set_devs_config: usr");
-		}
-		else if (strncmp(tag, "pwd", 3) == 0)
-		{
-			stlen = PASSWORD_SIZE;
-			err |= cbor_value_copy_text_string(&recursed, update_dev_fw->pwd, &stlen, &recursed);
-			DEBUG_DEC(err, "req_set_devs_config: pwd");
-		}
-		else if (strncmp(tag, "uri", 3) == 0)
-		{
-			stlen = URI_SIZE;
-			err |= cbor_value_copy_text_string(&recursed, update_dev_fw->uri, &stlen, &recursed);
-			DEBUG_DEC(err, "req_set_devs_config: uri");
-		}
-		else if (strncmp(tag, "fid", 3) == 0)
-		{
-			err |= CBOR_ExtractInt(&recursed, &tmp);
-			update_dev_fw->fid = (C_UINT16)tmp;
-			DEBUG_DEC(err, "req_set_devs_config: fid");
-		}
-		else if (strncmp(tag, "wet", 3) == 0)
-		{
-			err |= CBOR_ExtractInt(&recursed, &tmp);
-			update_dev_fw->wet = (C_UINT16)tmp;
-			DEBUG_DEC(err, "req_set_devs_config: wet");
-		}
-		else if (strncmp(tag, "cid", 3) == 0)
-		{
-			err |= CBOR_ExtractInt(&recursed, &tmp);
-			update_dev_fw->cid = (C_UINT16)tmp;
-			DEBUG_DEC(err, "req_set_devs_config: cid");
-		}
-		else
-		{
-			err |= CBOR_DiscardElement(&recursed);
-			DEBUG_DEC(err, "req_: discard element");
-		}
-		if (err)
-			return err;
-	}
-
-	err = cbor_value_leave_container(&it, &recursed);
-	return err;
-}
-
-
-
-// step 2
-
-/**
- * @brief CBOR_ReqFileLog
- *
- * Interprets CBOR request full or range file/log
- *
- * @param Pointer to fid          0..9999 file index, valid only for modbus file
- * @param Pointer to fst          0..4294967295 file start offset
- * @param Pointer to fle          0..4294967295 lenght of file
- *
- * @return CborError
- */
-
-CborError CBOR_ReqFileLog(C_CHAR* cbor_stream, C_UINT16 cbor_len, c_cborreqrangefile* RangeFileData)
-{
-	CborError err = CborNoError;
-	size_t stlen;
-	char tag[TAG_SIZE];
-	CborValue it, recursed;
-	CborParser parser;
-
-	err = cbor_parser_init((unsigned char*)cbor_stream, cbor_len, 0, &parser, &it);
-	err |= cbor_value_enter_container(&it, &recursed);
-	DEBUG_DEC(err, "range file request");
-
-	int64_t tmp=0;
-
-	while (!cbor_value_at_end(&recursed)) {
-		stlen = TAG_SIZE;
-		memset(tag,'0',sizeof(tag));
-		err = cbor_value_copy_text_string(&recursed, tag, &stlen, &recursed);
-
-		if (strncmp(tag, "fid", 3) == 0)
-		{
-			err |= CBOR_ExtractInt(&recursed, &tmp);
-			RangeFileData->fid = (C_UINT16)tmp;
-			DEBUG_DEC(err, "req_range_file_log: fid");
-		}
-		else if(strncmp(tag, "fst", 3) == 0)
-		{
-			err |= CBOR_ExtractInt(&recursed, &tmp);
-			RangeFileData->fst = (C_UINT32)tmp;
-			DEBUG_DEC(err, "req_range_file_log: fst");
-		}
-		else if(strncmp(tag, "fle", 3) == 0)
-		{
-			err |= CBOR_ExtractInt(&recursed, &tmp);
-			RangeFileData->fle = (C_UINT32)tmp;
-			DEBUG_DEC(err, "req_range_file_log: fle");
-		}
-		else
-		{
-			err |= CBOR_DiscardElement(&recursed);
-			DEBUG_DEC(err, "req_: discard element");
-		}
-
-		if (err)
-		return err;
-	}
-
-	err = cbor_value_leave_container(&it, &recursed);
-	return err;
-}
-
-/**
- * @brief CBOR_ReqFileLog
- *
- * Interprets CBOR request abort log (full/range)
- *
- * @param Pointer to rid          This is a string of max. 64 char 48 char max.  string zero terminated
- *								  this is the same RTO value the cloud sent for the request.
- * @return CborError
+ * @param Pointer to the decoded request
+ * @param Pointer to the update firmware data
+ * @return void
  */
-
-CborError CBOR_ReqAbort(C_CHAR* cbor_stream, C_UINT16 cbor_len, c_cborreqabort* AbortData)
+static void CBOR_ReqGetUpdGmeFw(const c_cborreq* req, c_cborrequpdgmefw* upd_fw)
 {
-	CborError err = CborNoError;
-		size_t stlen;
-		char tag[TAG_SIZE];
-		char rid[RTO_SIZE];
-		CborValue it, recursed;
-		CborParser parser;
-
-		err = cbor_parser_init((unsigned char*)cbor_stream, cbor_len, 0, &parser, &it);
-		err |= cbor_value_enter_container(&it, &recursed);
-		DEBUG_DEC(err, "range file request");
-
-		int64_t tmp=0;
-
-		while (!cbor_value_at_end(&recursed)) {
-				stlen = TAG_SIZE;
-				memset(tag,'0',sizeof(tag));
-				err = cbor_value_copy_text_string(&recursed, tag, &stlen, &recursed);
-
-				if (strncmp(tag, "rid", 3) == 0)
-				{
-					stlen = RTO_SIZE;
-					err |= cbor_value_copy_text_string(&recursed, rid, &stlen, &recursed);
-					strcpy((char*)AbortData->rid, rid);
-					DEBUG_DEC(err, "req_id: rid");
-				}
-				else
-				{
-					err |= CBOR_DiscardElement(&recursed);
-					DEBUG_DEC(err, "req_: discard element");
-				}
-
-				if (err)
-				return err;
-			}
-
-			err = cbor_value_leave_container(&it, &recursed);
-			return err;
-
-
+	memcpy(upd_fw->usr, req->cfg.usr, sizeof(upd_fw->usr));
+	memcpy(upd_fw->pwd, req->cfg.pwd, sizeof(upd_fw->pwd));
+	memcpy(upd_fw->uri, req->cfg.uri, sizeof(upd_fw->uri));
+	memcpy(upd_fw->dpu, req->dpu, sizeof(upd_fw->dpu));
+	memcpy(upd_fw->sha, req->cfg.sha, sizeof(upd_fw->sha));
+	upd_fw->fid = req->file.fid;
+	upd_fw->wet = req->wet;
+	upd_fw->cid = req->cfg.cid;
 }
 
 
@@ -1847,7 +1745,7 @@ int CBOR_SendAsync_FileLog(filelog_info_t data, C_UINT16 numof)
  */
 int CBOR_ReqTopicParser(C_CHAR* cbor_stream, C_UINT16 cbor_len){
 
-	c_cborhreq cbor_req = {0};
+	c_cborreq req = {0};
 	CborError err;
 	C_CHAR cbor_response[RESPONSE_SIZE];
 	size_t len = 0;
@@ -1860,30 +1758,42 @@ int CBOR_ReqTopicParser(C_CHAR* cbor_stream, C_UINT16 cbor_len){
 
 	strcpy((char*)topic,(char*)dev_id);
 
-	err = CBOR_ReqHeader(cbor_stream, cbor_len, &cbor_req);
+	err = CBOR_ReqDecode(cbor_stream, cbor_len, &req);
 	if (err)
-		cbor_req.cmd = NO_COMMAND;		// request is not recognized
+	{
+		// a malformed field of a known request is answered with ERROR_CMD
+		memset((void*)&req.hdr, 0, sizeof(req.hdr));
+		if (CBOR_ReqHeader(cbor_stream, cbor_len, &req.hdr) == CborNoError)
+		{
+			req.hdr.res = ERROR_CMD;
+			len = CBOR_ResSimple(cbor_response, &req.hdr);
+			sprintf(topic,"%s%s", "/res/", req.hdr.rto);
+			mqtt_client_publish((C_SCHAR*)MQTT_GetUuidTopic(topic), (C_SBYTE*)cbor_response, len, QOS_0, NO_RETAIN);
+			P_COV_LN;
+			return ret;
+		}
+		req.hdr.cmd = NO_COMMAND;		// request is not recognized
+	}
 
-	switch(cbor_req.cmd){
+	switch(req.hdr.cmd){
 
 		case REBOOT:
 		{
-			C_UINT16 cbor_cid;
-			err = CBOR_ReqReboot(cbor_stream, cbor_len, &cbor_cid);
+			C_UINT16 cbor_cid = req.cfg.cid;
             #ifdef __DEBUG_CBOR_CAREL_LEV_1
 			PRINTF_DEBUG("reboot > cid %d\n", cbor_cid);
             #endif
 
 
 			// mqtt response
-			cbor_req.res = (err == C_SUCCESS) ? SUCCESS_CMD : ERROR_CMD;
-			len = CBOR_ResSimple(cbor_response, &cbor_req);
-			sprintf(topic,"%s%s", "/res/", cbor_req.rto);
+			req.hdr.res = SUCCESS_CMD;
+			len = CBOR_ResSimple(cbor_response, &req.hdr);
+			sprintf(topic,"%s%s", "/res/", req.hdr.rto);
 
 			mqtt_client_publish((C_SCHAR*)MQTT_GetUuidTopic(topic), (C_SBYTE*)cbor_response, len, QOS_0, NO_RETAIN);
 			//TODO CPPCHECK valore di ritorno non testato
 
-			if(SUCCESS_CMD == cbor_req.res){
+			if(SUCCESS_CMD == req.hdr.res){
 				PollEngine_StopEngine_CAREL();
 				// save cid for successive hello
 				NVM__WriteU32Value(MB_CID_NVM, cbor_cid);
@@ -1899,9 +1809,9 @@ int CBOR_ReqTopicParser(C_CHAR* cbor_stream, C_UINT16 cbor_len){
 			PRINTF_DEBUG("flush_values\n");
             #endif
 			ForceSending();		// TODO move this call after publish? ...that way response to flush is surely sent before forced values
-			cbor_req.res = SUCCESS_CMD;
-			len = CBOR_ResSimple(cbor_response, &cbor_req);
-			sprintf(topic,"%s%s", "/res/", cbor_req.rto);
+			req.hdr.res = SUCCESS_CMD;
+			len = CBOR_ResSimple(cbor_response, &req.hdr);
+			sprintf(topic,"%s%s", "/res/", req.hdr.rto);
 			mqtt_client_publish((C_SCHAR*)MQTT_GetUuidTopic(topic), (C_SBYTE*)cbor_response, len, QOS_0, NO_RETAIN);
 			//TODO CPPCHECK valore di ritorno non testato
 		}
@@ -1910,18 +1820,11 @@ int CBOR_ReqTopicParser(C_CHAR* cbor_stream, C_UINT16 cbor_len){
 
 		case SET_GW_CONFIG:
 		{
-			c_cborreqsetgwconfig cbor_setgwconfig = {0};
-			cbor_req.res = ERROR_CMD;
-
-			err = CBOR_ReqSetGwConfig(cbor_stream, cbor_len, &cbor_setgwconfig);
-			if (err == C_SUCCESS) {
-				// write new data to configuration file and put in res the result of operation
-				// to be implemented
-				cbor_req.res = (execute_set_gw_config(cbor_setgwconfig) == C_SUCCESS) ? SUCCESS_CMD : ERROR_CMD;
-			}
+			// write new data to configuration file and put in res the result of operation
+			req.hdr.res = (execute_set_gw_config(req.gw) == C_SUCCESS) ? SUCCESS_CMD : ERROR_CMD;
 			// mqtt response
-			len = CBOR_ResSimple(cbor_response, &cbor_req);
-			sprintf(topic,"%s%s", "/res/", cbor_req.rto);
+			len = CBOR_ResSimple(cbor_response, &req.hdr);
+			sprintf(topic,"%s%s", "/res/", req.hdr.rto);
 			mqtt_client_publish((C_SCHAR*)MQTT_GetUuidTopic(topic), (C_SBYTE*)cbor_response, len, QOS_0, NO_RETAIN);
 			//TODO CPPCHECK valore di ritorno non testato
 		}
@@ -1929,49 +1832,44 @@ int CBOR_ReqTopicParser(C_CHAR* cbor_stream, C_UINT16 cbor_len){
 
 		case SET_DEVS_CONFIG:
 		{
-			c_cborreqdwldevsconfig download_devs_config = {0};
-			cbor_req.res = ERROR_CMD;
-
-			err = CBOR_ReqSetDevsConfig(cbor_stream, cbor_len, &download_devs_config);
-			if (err == C_SUCCESS) {
-				CBOR_SaveAsyncRequest(cbor_req, download_devs_config.cid, ASYNC_DEVCONF);
-
-				// empty uri means device has to be disactivated
-				// no model must be downloaded
-				// configuration flag in nvm must be cleared
-				// save cid for successive reboot
-				if (!strcmp(download_devs_config.uri,"")) {
-					unlink(MODEL_FILE);
-					if((C_SUCCESS == NVM__WriteU8Value(SET_DEVS_CONFIG_NVM, DEFAULT)) &&
-						(C_SUCCESS == NVM__WriteU32Value(MB_CID_NVM, download_devs_config.cid)) &&
-						(C_SUCCESS == NVM__WriteU32Value(MB_DID_NVM, 0)) )
-						err = C_SUCCESS;
-					else
-						err = C_FAIL;
-					err == C_SUCCESS ? CBOR_SendAsyncResponseDid(0, download_devs_config.did, ASYNC_DEVCONF) : CBOR_SendAsyncResponseDid(1, download_devs_config.did, ASYNC_DEVCONF);
-					if(err == C_SUCCESS)
-						GME__Reboot();
-
-					break;
-				}
-				OTA__ModelInit(download_devs_config);
+			req.hdr.res = ERROR_CMD;
+
+			CBOR_SaveAsyncRequest(req.hdr, req.cfg.cid, ASYNC_DEVCONF);
+
+			// empty uri means device has to be disactivated
+			// no model must be downloaded
+			// configuration flag in nvm must be cleared
+			// save cid for successive reboot
+			if (!strcmp(req.cfg.uri,"")) {
+				unlink(MODEL_FILE);
+				if((C_SUCCESS == NVM__WriteU8Value(SET_DEVS_CONFIG_NVM, DEFAULT)) &&
+					(C_SUCCESS == NVM__WriteU32Value(MB_CID_NVM, req.cfg.cid)) &&
+					(C_SUCCESS == NVM__WriteU32Value(MB_DID_NVM, 0)) )
+					err = C_SUCCESS;
+				else
+					err = C_FAIL;
+				err == C_SUCCESS ? CBOR_SendAsyncResponseDid(0, req.cfg.did, ASYNC_DEVCONF) : CBOR_SendAsyncResponseDid(1, req.cfg.did, ASYNC_DEVCONF);
+				if(err == C_SUCCESS)
+					GME__Reboot();
+
+				break;
 			}
+			OTA__ModelInit(req.cfg);
 			// response will be sent when ota task will come to its end
 		}
 		break;
 
 		case SET_LINES_CONFIG:
 		{
-			c_cborreqlinesconfig set_line_cfg = {0};
-			cbor_req.res = ERROR_CMD;
+			static mb_aux_poll_cfg_t aux_poll;
 
-			err = CBOR_ReqSetLinesConfig(cbor_stream, cbor_len, &set_line_cfg);
-			if (err == C_SUCCESS) {
-				// write new baud rate and connector to configuration file and put in res the result of operation
-				cbor_req.res = (execute_set_line_config(set_line_cfg) == C_SUCCESS) ? SUCCESS_CMD : ERROR_CMD;
-			}
-			len = CBOR_ResSimple(cbor_response, &cbor_req);
-			sprintf(topic,"%s%s", "/res/", cbor_req.rto);
+			// write new baud rate, connector and aux poll table to configuration file and put in res the result of operation
+			if (CborNoError != CBOR_ReqAuxPoll(cbor_stream, cbor_len, &aux_poll))
+				req.hdr.res = ERROR_CMD;
+			else
+				req.hdr.res = (execute_set_line_config(req.line, &aux_poll) == C_SUCCESS) ? SUCCESS_CMD : ERROR_CMD;
+			len = CBOR_ResSimple(cbor_response, &req.hdr);
+			sprintf(topic,"%s%s", "/res/", req.hdr.rto);
 			mqtt_client_publish((C_SCHAR*)MQTT_GetUuidTopic(topic), (C_SBYTE*)cbor_response, len, QOS_0, NO_RETAIN);
 			//TODO CPPCHECK valore di ritorno non testato
 		}
@@ -1980,25 +1878,61 @@ int CBOR_ReqTopicParser(C_CHAR* cbor_stream, C_UINT16 cbor_len){
 		case SCAN_DEVICES:
 		{
 			// scan Modbus line
-			C_UINT16 device = 0;
+			C_UINT16 device = req.cfg.dev;
 			C_BYTE answer[REPORT_SLAVE_ID_SIZE];
 			C_INT16 length = 0;
-			cbor_req.res = ERROR_CMD;
+			C_BYTE mode = 0;
+			c_cborresscanline scan = {0};
 
-			err = CBOR_ReqScanLine(cbor_stream, cbor_len, &device);
-			if (err == C_SUCCESS) {
-				cbor_req.res = (execute_scan_devices((C_BYTE *)(&answer), &device, &length) == C_SUCCESS) ? SUCCESS_CMD : ERROR_CMD;
-			}
-			if (cbor_req.res == ERROR_CMD)
+			if (req.file.fst != 0)
+				mode |= SCAN_MODE_FAST;
+			if (req.abd != 0)
+				mode |= (SCAN_MODE_FAST | SCAN_MODE_AUTOBAUD);
+
+			if (mode & SCAN_MODE_FAST)
+				req.hdr.res = (execute_scan_devices_fast((C_BYTE *)(&answer), &device, &length, mode, &scan) == C_SUCCESS) ? SUCCESS_CMD : ERROR_CMD;
+			else
+				req.hdr.res = (execute_scan_devices((C_BYTE *)(&answer), &device, &length) == C_SUCCESS) ? SUCCESS_CMD : ERROR_CMD;
+			if (req.hdr.res == ERROR_CMD)
 				device = 0;
 
-			len = CBOR_ResScanLine(cbor_response, &cbor_req, device, answer, length);
-            sprintf(topic,"%s%s", "/res/", cbor_req.rto);
+			len = CBOR_ResScanLine(cbor_response, &req.hdr, device, answer, length, (mode & SCAN_MODE_FAST) ? &scan : NULL);
+            sprintf(topic,"%s%s", "/res/", req.hdr.rto);
             mqtt_client_publish((C_SCHAR*)MQTT_GetUuidTopic(topic), (C_SBYTE*)cbor_response, len, QOS_0, NO_RETAIN);
             //TODO CPPCHECK valore di ritorno non testato
 		}
 		break;
 
+		case SEND_MB_ADU:
+		{
+			// raw RTU frames tunneled from the cloud, on the main line the
+			// polling stays suspended until the session ends (passing mode),
+			// the aux line queues a batch with its poll task, the main line keeps polling
+			static c_cbor_send_mb_adu adu_req;
+			static c_cbor_res_mb_adu adu_res;
+			static C_CHAR adu_response[ADU_RESPONSE_SIZE];
+
+			memset((void*)&adu_res, 0, sizeof(adu_res));
+			req.hdr.res = ERROR_CMD;
+
+			if (CborNoError == CBOR_ReqSendMbAdu(cbor_stream, cbor_len, &adu_req))
+			{
+				if (adu_req.lin != 0)
+					req.hdr.res = (execute_send_mb_adu(&adu_req, &adu_res) == C_SUCCESS) ? SUCCESS_CMD : ERROR_CMD;
+				else if (C_SUCCESS == PollEngine__PassModeEnter())
+				{
+					req.hdr.res = (execute_send_mb_adu(&adu_req, &adu_res) == C_SUCCESS) ? SUCCESS_CMD : ERROR_CMD;
+					PollEngine__PassModeLeave(adu_req.hld, (adu_req.cls != 0) ? C_TRUE : C_FALSE);
+				}
+			}
+
+			len = CBOR_ResSendMbAdu(adu_response, &req.hdr, adu_req.sequence, &adu_res);
+			sprintf(topic,"%s%s", "/res/", req.hdr.rto);
+			mqtt_client_publish((C_SCHAR*)MQTT_GetUuidTopic(topic), (C_SBYTE*)adu_response, len, QOS_0, NO_RETAIN);
+			P_COV_LN;
+		}
+		break;
+
 		case READ_VALUES:
 		case WRITE_VALUES:
 		{
@@ -2006,22 +1940,16 @@ int CBOR_ReqTopicParser(C_CHAR* cbor_stream, C_UINT16 cbor_len){
 			{
 				set_msg_trigger(1);
 
-				c_cborreqrdwrvalues cbor_rwv = {0};
-				cbor_req.res = ERROR_CMD;
+				req.hdr.res = ERROR_CMD;
 				// following check to be sure we are not asking something on non-configured serial
 				if (GetsmStatus() == GME_IDLE_INTERNET_CONNECTED) {
+					// send modbus command to read/write values
+					// wait modbus response to get result
 
-					err = CBOR_ReqRdWrValues(cbor_stream, cbor_len, &cbor_rwv);
-
-				    if (err == C_SUCCESS) {
-					   // send modbus command to read/write values
-					   // wait modbus response to get result
-
-					  // new function 2021 A.CHIEBAO (to avoid the corruption of the buffer during polling + request from Cloud)
-				      // here we receive the data and we execute the real command (read or write) with the
-				      // following function inside the polling => mb_rw_call_execute()
-					  mb_rw_set_data(cbor_rwv, cbor_req);    // c_cborhreq
-				   }
+					// new function 2021 A.CHIEBAO (to avoid the corruption of the buffer during polling + request from Cloud)
+					// here we receive the data and we execute the real command (read or write) with the
+					// following function inside the polling => mb_rw_call_execute()
+					mb_rw_set_data(req.rdwr, req.hdr);    // c_cborhreq
 			    }
 			}
 		}
@@ -2031,14 +1959,15 @@ int CBOR_ReqTopicParser(C_CHAR* cbor_stream, C_UINT16 cbor_len){
 		case UPDATE_GME_FIRMWARE:
 		{
 			c_cborrequpdgmefw update_gw_fw = {0};
-			cbor_req.res = ERROR_CMD;
-
-			err = CBOR_ReqUpdateGMEFW(cbor_stream, cbor_len, &update_gw_fw);
-			if (err == C_SUCCESS) {
-				Modbus_Disable();
-				CBOR_SaveAsyncRequest(cbor_req, update_gw_fw.cid, ASYNC_GMEFW);
-				OTA__GMEInit(update_gw_fw);
-			}
+			req.hdr.res = ERROR_CMD;
+
+			CBOR_ReqGetUpdGmeFw(&req, &update_gw_fw);
+			// the polling is stopped (REQ_CLASS_BUS), with the modbus task
+			// disabled its requests would wait forever
+			Modbus_Disable();
+			CBOR_SaveAsyncRequest(req.hdr, update_gw_fw.cid, ASYNC_GMEFW);
+			OTA__GMEInit(update_gw_fw);
+			ret = 1;	// OTAGroup restarts the polling if the update fails
 			// response will be sent when ota task will come to its end
 		}
 		break;
@@ -2047,14 +1976,12 @@ int CBOR_ReqTopicParser(C_CHAR* cbor_stream, C_UINT16 cbor_len){
 		case UPDATE_DEV_FIRMWARE:
 		{
 			c_cborrequpddevfw update_dev_fw = {0};
-			cbor_req.res = ERROR_CMD;
+			req.hdr.res = ERROR_CMD;
 
-			err = CBOR_ReqUpdateDevFW(cbor_stream, cbor_len, &update_dev_fw);
-			if (err == C_SUCCESS) {
-				CBOR_SaveAsyncRequest(cbor_req, 0, ASYNC_DEVFW);
-				OTA__DEVInit(update_dev_fw);
-				ret = 1;	// this let polling restart after update
-			}
+			CBOR_ReqGetUpdFw(&req, &update_dev_fw);
+			CBOR_SaveAsyncRequest(req.hdr, 0, ASYNC_DEVFW);
+			OTA__DEVInit(update_dev_fw);
+			ret = 1;	// this let polling restart after update
 			// response will be sent when update_dev task will come to its end
 		}
 		break;
@@ -2062,18 +1989,14 @@ int CBOR_ReqTopicParser(C_CHAR* cbor_stream, C_UINT16 cbor_len){
 
 		case UPDATE_CA_CERTIFICATES:
 		{
-			c_cborrequpdatecacert update_ca_config = {0};
-			cbor_req.res = ERROR_CMD;
-
-			err = CBOR_ReqUpdateCaCertificate(cbor_stream, cbor_len, &update_ca_config);
-			if (err == C_SUCCESS) {
-				//Modbus is disabled to let resource available for other tasks (not for functional reasons)
-			//	Modbus_Disable();
-				CBOR_SaveAsyncRequest(cbor_req, 0, ASYNC_CA);
-				// start a task that performs a https read file from uri, using usr and pwd authentication data
-				OTA__CAInit(update_ca_config);
-				ret = 1;
-			}
+			req.hdr.res = ERROR_CMD;
+
+			//Modbus is disabled to let resource available for other tasks (not for functional reasons)
+		//	Modbus_Disable();
+			CBOR_SaveAsyncRequest(req.hdr, 0, ASYNC_CA);
+			// start a task that performs a https read file from uri, using usr and pwd authentication data
+			OTA__CAInit(req.cfg);
+			ret = 1;
 			// response will be sent when update_dev task will come to its end
 		}
 		break;
@@ -2081,18 +2004,12 @@ int CBOR_ReqTopicParser(C_CHAR* cbor_stream, C_UINT16 cbor_len){
 
 		case CHANGE_CREDENTIALS:
 		{
-			c_cborreqchangecred change_cred_config = {0};
-			cbor_req.res = ERROR_CMD;
-
-			err = CBOR_ReqChangeCredentials(cbor_stream, cbor_len, &change_cred_config);
-			if (err == C_SUCCESS) {
-				// write new credentials to configuration file and put in res the result of operation
-				cbor_req.res = (execute_change_cred(change_cred_config) == C_SUCCESS) ? SUCCESS_CMD : ERROR_CMD;
-			}
+			// write new credentials to configuration file and put in res the result of operation
+			req.hdr.res = (execute_change_cred(req.cfg) == C_SUCCESS) ? SUCCESS_CMD : ERROR_CMD;
 			// mqtt response
 			// to be implemented
-			len = CBOR_ResSimple(cbor_response, &cbor_req);
-			sprintf(topic,"%s%s", "/res/", cbor_req.rto);
+			len = CBOR_ResSimple(cbor_response, &req.hdr);
+			sprintf(topic,"%s%s", "/res/", req.hdr.rto);
 			mqtt_client_publish((C_SCHAR*)MQTT_GetUuidTopic(topic), (C_SBYTE*)cbor_response, len, QOS_0, NO_RETAIN);
 			//TODO CPPCHECK valore di ritorno non testato
 		}
@@ -2103,13 +2020,13 @@ int CBOR_ReqTopicParser(C_CHAR* cbor_stream, C_UINT16 cbor_len){
 		{
 			if ( C_SUCCESS == NVM__WriteU8Value(PE_STATUS_NVM, RUNNING) ) {
 				PollEngine_StartEngine_CAREL();
-				cbor_req.res = SUCCESS_CMD;
+				req.hdr.res = SUCCESS_CMD;
 			}
 			else {
-				cbor_req.res = ERROR_CMD;
+				req.hdr.res = ERROR_CMD;
 			}
-			len = CBOR_ResSimple(cbor_response, &cbor_req);
-			sprintf(topic,"%s%s", "/res/", cbor_req.rto);
+			len = CBOR_ResSimple(cbor_response, &req.hdr);
+			sprintf(topic,"%s%s", "/res/", req.hdr.rto);
 			mqtt_client_publish((C_SCHAR*)MQTT_GetUuidTopic(topic), (C_SBYTE*)cbor_response, len, QOS_0, NO_RETAIN);
 			//TODO CPPCHECK valore di ritorno non testato
 		}
@@ -2120,14 +2037,14 @@ int CBOR_ReqTopicParser(C_CHAR* cbor_stream, C_UINT16 cbor_len){
 		{
 			if ( C_SUCCESS == NVM__WriteU8Value(PE_STATUS_NVM, STOPPED) ) {
 				PollEngine_StopEngine_CAREL();
-				cbor_req.res = SUCCESS_CMD;
+				req.hdr.res = SUCCESS_CMD;
 				ret = 1;
 			}
 			else {
-				cbor_req.res = ERROR_CMD;
+				req.hdr.res = ERROR_CMD;
 			}
-			len = CBOR_ResSimple(cbor_response, &cbor_req);
-			sprintf(topic,"%s%s", "/res/", cbor_req.rto);
+			len = CBOR_ResSimple(cbor_response, &req.hdr);
+			sprintf(topic,"%s%s", "/res/", req.hdr.rto);
 			mqtt_client_publish((C_SCHAR*)MQTT_GetUuidTopic(topic), (C_SBYTE*)cbor_response, len, QOS_0, NO_RETAIN);
 			//TODO CPPCHECK valore di ritorno non testato
 		}
@@ -2137,30 +2054,22 @@ int CBOR_ReqTopicParser(C_CHAR* cbor_stream, C_UINT16 cbor_len){
 		{
 			// full download of the device log
 
-			c_cborreqfullfile fullfile_info = {0};
-			cbor_req.res = ERROR_CMD;
-
-			err = CBOR_ReqFileLog(cbor_stream, cbor_len, &fullfile_info);
-
-			cbor_req.res = (err == C_SUCCESS) ? SUCCESS_CMD : ERROR_CMD;
+			req.hdr.res = SUCCESS_CMD;
 
-			if(cbor_req.res == SUCCESS_CMD)
+			if(Dev_LogFile_GetSM() == LOGFILE_IDLE)
 			{
-				if(Dev_LogFile_GetSM() == LOGFILE_IDLE)
-				{
-					//save Request for the future response
-					CBOR_SaveAsyncRequest(cbor_req, 0, ASYNC_LOG);
-					// save info for read file state machine
-					RetrieveFileLog_Info(fullfile_info);
-					Dev_LogFile_SetSM(LOGFILE_FULL);
-				}
-				else
-					cbor_req.res = ERROR_ALREADY_RUN; //send error 5
+				//save Request for the future response
+				CBOR_SaveAsyncRequest(req.hdr, 0, ASYNC_LOG);
+				// save info for read file state machine
+				RetrieveFileLog_Info(req.file);
+				Dev_LogFile_SetSM(LOGFILE_FULL);
 			}
+			else
+				req.hdr.res = ERROR_ALREADY_RUN; //send error 5
 
 			// mqtt response
-			len = CBOR_ResSimple(cbor_response, &cbor_req);
-			sprintf(topic,"%s%s", "/res/", cbor_req.rto);
+			len = CBOR_ResSimple(cbor_response, &req.hdr);
+			sprintf(topic,"%s%s", "/res/", req.hdr.rto);
 
 			mqtt_client_publish((C_SCHAR*)MQTT_GetUuidTopic(topic), (C_SBYTE*)cbor_response, len, QOS_0, NO_RETAIN);
 
@@ -2172,30 +2081,21 @@ int CBOR_ReqTopicParser(C_CHAR* cbor_stream, C_UINT16 cbor_len){
 		{
 			// range download of the device log
 
-			c_cborreqrangefile rangefile_info = {0};
-			cbor_req.res = ERROR_CMD;
-
-			err = CBOR_ReqFileLog(cbor_stream, cbor_len, &rangefile_info);
-
-			cbor_req.res = (err == C_SUCCESS) ? SUCCESS_CMD : ERROR_CMD;
+			req.hdr.res = SUCCESS_CMD;
 
-			if(cbor_req.res == SUCCESS_CMD)
+			if(Dev_LogFile_GetSM() == LOGFILE_IDLE)
 			{
-				if(Dev_LogFile_GetSM() == LOGFILE_IDLE)
-				{
-					//save Request for the future response
-					CBOR_SaveAsyncRequest(cbor_req, 0, ASYNC_LOG);
-					// save info for read file state machine
-					RetrieveFileLog_Info(rangefile_info);
-					Dev_LogFile_SetSM(LOGFILE_RANGE);
-				}
-				else
-					cbor_req.res = ERROR_ALREADY_RUN;  //send error 5
-
+				//save Request for the future response
+				CBOR_SaveAsyncRequest(req.hdr, 0, ASYNC_LOG);
+				// save info for read file state machine
+				RetrieveFileLog_Info(req.file);
+				Dev_LogFile_SetSM(LOGFILE_RANGE);
 			}
+			else
+				req.hdr.res = ERROR_ALREADY_RUN; //send error 5
 			// mqtt response
-			len = CBOR_ResSimple(cbor_response, &cbor_req);
-			sprintf(topic,"%s%s", "/res/", cbor_req.rto);
+			len = CBOR_ResSimple(cbor_response, &req.hdr);
+			sprintf(topic,"%s%s", "/res/", req.hdr.rto);
 
 			mqtt_client_publish((C_SCHAR*)MQTT_GetUuidTopic(topic), (C_SBYTE*)cbor_response, len, QOS_0, NO_RETAIN);
 
@@ -2206,36 +2106,28 @@ int CBOR_ReqTopicParser(C_CHAR* cbor_stream, C_UINT16 cbor_len){
 		{
 			// abort download of the device log
 
-			c_cborreqabort abort_info = {0};
-			cbor_req.res = ERROR_CMD;
-
-			err = CBOR_ReqAbort(cbor_stream, cbor_len, &abort_info);
+			req.hdr.res = SUCCESS_CMD;
 
-			cbor_req.res = (err == C_SUCCESS) ? SUCCESS_CMD : ERROR_CMD;
-
-			if(cbor_req.res == SUCCESS_CMD)
+			if((Dev_LogFile_GetSM() == LOGFILE_FULL) || (Dev_LogFile_GetSM() == LOGFILE_RANGE))
 			{
-				if((Dev_LogFile_GetSM() == LOGFILE_FULL) || (Dev_LogFile_GetSM() == LOGFILE_RANGE))
+				// compare rid and rto
+				if(!strcmp((char*)req.abort.rid, (char*)async_req[ASYNC_LOG].rto))
 				{
-					// compare rid and rto
-					if(!strcmp(&abort_info.rid, &async_req[ASYNC_LOG].rto))
-					{
-						// download  probably still running...we set a flag and wait.
-						SetAbort();
-					}
-					else
-					{
-						cbor_req.res = ERROR_RID_NOMATCH;
-					}
+					// download  probably still running...we set a flag and wait.
+					SetAbort();
 				}
 				else
 				{
-					cbor_req.res = ERROR_NO_ONGOING;  //send error 7, there isn't any ongoing transfer
+					req.hdr.res = ERROR_RID_NOMATCH;
 				}
 			}
+			else
+			{
+				req.hdr.res = ERROR_NO_ONGOING;  //send error 7, there isn't any ongoing transfer
+			}
 			// mqtt response
-			len = CBOR_ResSimple(cbor_response, &cbor_req);
-			sprintf(topic,"%s%s", "/res/", cbor_req.rto);
+			len = CBOR_ResSimple(cbor_response, &req.hdr);
+			sprintf(topic,"%s%s", "/res/", req.hdr.rto);
 
 			mqtt_client_publish((C_SCHAR*)MQTT_GetUuidTopic(topic), (C_SBYTE*)cbor_response, len, QOS_0, NO_RETAIN);
 
@@ -2247,18 +2139,11 @@ int CBOR_ReqTopicParser(C_CHAR* cbor_stream, C_UINT16 cbor_len){
 
 		case UPDATE_FILE:
 		{
-			c_cborrequpdatefile update_file = {0};
-			cbor_req.res = ERROR_CMD;
-
-			err = CBOR_ReqUpdateFile(cbor_stream, cbor_len, &update_file);
-			if(err == C_SUCCESS) {
-				// write new data to configuration file and put in res the result of operation
-				// to be implemented
-				cbor_req.res = (execute_update_file(&update_file) == C_SUCCESS) ? SUCCESS_CMD : ERROR_CMD;
-			}
+			// write new data to configuration file and put in res the result of operation
+			req.hdr.res = (execute_update_file(&req.cfg) == C_SUCCESS) ? SUCCESS_CMD : ERROR_CMD;
 			// mqtt response
-			len = CBOR_ResSimple(cbor_response, &cbor_req);
-			sprintf(topic,"%s%s", "/res/", cbor_req.rto);
+			len = CBOR_ResSimple(cbor_response, &req.hdr);
+			sprintf(topic,"%s%s", "/res/", req.hdr.rto);
 			mqtt_client_publish((C_SCHAR*)MQTT_GetUuidTopic(topic), (C_SBYTE*)cbor_response, len, QOS_0, NO_RETAIN);
 			//TODO CPPCHECK valore di ritorno non testato
 		}
@@ -2266,9 +2151,9 @@ int CBOR_ReqTopicParser(C_CHAR* cbor_stream, C_UINT16 cbor_len){
 
 		case NO_COMMAND:
 		default:
-			cbor_req.res = INVALID_CMD;
-			len = CBOR_ResSimple(cbor_response, &cbor_req);
-			sprintf(topic,"%s%s", "/res/", cbor_req.rto);
+			req.hdr.res = INVALID_CMD;
+			len = CBOR_ResSimple(cbor_response, &req.hdr);
+			sprintf(topic,"%s%s", "/res/", req.hdr.rto);
 			mqtt_client_publish((C_SCHAR*)MQTT_GetUuidTopic(topic), (C_SBYTE*)cbor_response, len, QOS_0, NO_RETAIN);
 			//TODO CPPCHECK valore di ritorno non testato
 		break;
@@ -2278,6 +2163,66 @@ int CBOR_ReqTopicParser(C_CHAR* cbor_stream, C_UINT16 cbor_len){
 	return ret;
 }
 
+/**
+ * @brief CBOR_GetReqClass
+ *        peek the command of a request to know if the polling
+ *        must be stopped before executing it
+ *
+ * @param C_CHAR* cbor_stream
+ * @param C_UINT16 cbor_len
+ * @return cloud_req_class_t
+ */
+cloud_req_class_t CBOR_GetReqClass(C_CHAR* cbor_stream, C_UINT16 cbor_len){
+
+	c_cborhreq cbor_req = {0};
+
+	if (CBOR_ReqHeader(cbor_stream, cbor_len, &cbor_req) != CborNoError)
+		return REQ_CLASS_NO_BUS;		// will be answered with INVALID_CMD
+
+	switch(cbor_req.cmd){
+		case SET_LINES_CONFIG:
+		case SET_DEVS_CONFIG:
+		case UPDATE_GME_FIRMWARE:		// the modbus task is disabled, OTAGroup restarts the polling
+		case UPDATE_DEV_FIRMWARE:		// the ota task restarts the polling at its end
+		case UPDATE_CA_CERTIFICATES:
+		case SEND_MB_PASS_THROUGH:
+			P_COV_LN;
+			return REQ_CLASS_BUS;
+
+		default:
+			// READ/WRITE_VALUES are executed inside the polling task,
+			// SEND_MB_ADU suspends the polling for its whole session,
+			// SCAN_DEVICES takes the bus for each probe only, the polling
+			// (alarms included) goes on between the probes
+			return REQ_CLASS_NO_BUS;
+	}
+}
+
+/**
+ * @brief CBOR_SendReqBusy
+ *        answer ERROR_CMD to a request that cannot be queued
+ *
+ * @param C_CHAR* cbor_stream
+ * @param C_UINT16 cbor_len
+ * @return none
+ */
+void CBOR_SendReqBusy(C_CHAR* cbor_stream, C_UINT16 cbor_len){
+
+	c_cborhreq cbor_req = {0};
+	C_CHAR cbor_response[RESPONSE_SIZE];
+	C_MQTT_TOPIC topic;
+	size_t len;
+
+	if (CBOR_ReqHeader(cbor_stream, cbor_len, &cbor_req) != CborNoError)
+		return;
+
+	cbor_req.res = ERROR_CMD;
+	len = CBOR_ResSimple(cbor_response, &cbor_req);
+	sprintf(topic,"%s%s", "/res/", cbor_req.rto);
+	mqtt_client_publish((C_SCHAR*)MQTT_GetUuidTopic(topic), (C_SBYTE*)cbor_response, len, QOS_0, NO_RETAIN);
+	P_COV_LN;
+}
+
 void CBOR_SaveAsyncRequest(c_cborhreq cbor_req, C_UINT16 my_cid, C_UINT16 numof){
 	async_req[numof] = cbor_req;
 	async_cid[numof] = my_cid;
@@ -2319,12 +2264,16 @@ void CBOR_SendAsyncResponseDid(C_INT16 res, C_UINT16 did, C_UINT16 numof){
 }
 
 
-C_RES execute_set_line_config(c_cborreqlinesconfig set_line_cfg){
+C_RES execute_set_line_config(c_cborreqlinesconfig set_line_cfg, const mb_aux_poll_cfg_t *aux_poll){
 
-	C_RES err = NVM__WriteU32Value(MB_BAUDRATE_NVM, set_line_cfg.baud);
+	C_RES err = NVM__BeginTransaction();
+	err |= NVM__WriteU32Value(MB_BAUDRATE_NVM, set_line_cfg.baud);
 	err |= NVM__WriteU8Value(MB_CONNECTOR_NVM, set_line_cfg.conn);
 	err |= NVM__WriteU8Value(SET_LINE_CONFIG_NVM, CONFIGURED);
 	err |= NVM__WriteU32Value(MB_DELAY_NVM, set_line_cfg.del);
+	err |= NVM__WriteU8Value(MB_AUX_NVM, set_line_cfg.aux);
+	err |= NVM__WriteBlob(MB_AUX_POLL_NVM, (void*)aux_poll, sizeof(mb_aux_poll_cfg_t));
+	err |= NVM__EndTransaction();
 
 	return err;
 }
@@ -2338,6 +2287,8 @@ C_RES execute_set_gw_config(c_cborreqsetgwconfig set_gw_config)
 	size_t len = 0;
 	C_BYTE gw_config_status;
 
+	NVM__BeginTransaction();		// one commit for blob and flag
+
 	if(C_SUCCESS == NVM__ReadU8Value(SET_GW_CONFIG_NVM, &gw_config_status) && CONFIGURED == gw_config_status){
 		NVM__ReadBlob(SET_GW_PARAM_NVM, (void*)&gw_config_nvm, &len);
 	}
@@ -2352,6 +2303,14 @@ C_RES execute_set_gw_config(c_cborreqsetgwconfig set_gw_config)
 	if(C_SUCCESS == err){
 		err = NVM__WriteU8Value(SET_GW_CONFIG_NVM, CONFIGURED);
 	}
+	// kept out of the blob, whose size is the one of the old releases
+	if(C_SUCCESS == err){
+		err = NVM__WriteU32Value(AGG_WINDOW_NVM, set_gw_config.agt);
+		err |= NVM__WriteU8Value(AGG_POLICY_NVM, set_gw_config.agf);
+	}
+
+	if (C_SUCCESS != NVM__EndTransaction())
+		err = C_FAIL;
 
 	return err;
 }
@@ -2365,8 +2324,10 @@ C_RES execute_change_cred(c_cborreqdwldevsconfig change_cred){
     #endif
 
 	// save new credentials, user/password
+	res |= NVM__BeginTransaction();
 	res |= NVM__WriteString(MQTT_USER, change_cred.usr);
 	res |= NVM__WriteString(MQTT_PASSWORD, change_cred.pwd);
+	res |= NVM__EndTransaction();
 
 	return res;
 }
@@ -2426,6 +2387,152 @@ C_RES execute_scan_devices(C_BYTE *data_rx, C_UINT16 *add, C_INT16 * lnt)
 	return C_SUCCESS;
 }
 
+#ifdef INCLUDE_PLATFORM_DEPENDENT
+/* line configs tried by the auto-detection, the most common first */
+static const C_UINT32 scan_baud[] = { 19200, 9600, 38400, 57600, 115200 };
+static const C_BYTE scan_parity[] = { MB_PARITY_NONE, MB_PARITY_EVEN, MB_PARITY_ODD };
+
+/**
+ * @brief scan_line_probe
+ *
+ * probe the addresses first..last with a respond timeout derived from the
+ * baudrate, the bus is released between two probes so the polling (alarms
+ * included) goes on during the scan
+ *
+ * @param first address to probe
+ * @param last address to probe
+ * @param C_TRUE stop at the first responding device
+ * @param Pointer to the answer of the first responding device
+ * @param Pointer to the length of the answer
+ * @param Pointer to the scan result
+ * @return C_UINT16 number of responding devices
+ */
+static C_UINT16 scan_line_probe(C_UINT16 first, C_UINT16 last, C_BOOL stop_first, C_BYTE *data_rx, C_INT16 *lnt, c_cborresscanline* scan)
+{
+	C_UINT16 timeout = Modbus__GetProbeTimeout(Modbus__GetBaudrate());
+	C_INT16 len;
+	C_RES err;
+
+	for (C_UINT16 addr = first; (addr <= last) && (scan->num < SCAN_MAX_DEVICES); addr++)
+	{
+		// the answer must be saved before another client use the bus
+		Modbus__BusAcquire(MB_CLIENT_SCAN);
+
+		err = app_report_slave_id_probe(addr, timeout);
+		if (err == C_SUCCESS)
+		{
+			if (scan->num == 0)
+			{
+				// same format of execute_scan_devices
+				len = usMBSlaveIDLen;
+				*(data_rx) = addr;
+				for(C_INT16 i = 0; i < len + 2; i++)
+				  *(data_rx + i + 1) = 	ucMBSlaveID[i];
+				*lnt = len + 1 + 2;
+			}
+			scan->dev[scan->num++] = addr;
+		}
+
+		Modbus__BusRelease();
+
+		if ((err == C_SUCCESS) && stop_first)
+			break;
+
+		// the polling task runs on the other core, a yield is not enough
+		// to let it take the bus before the next probe
+		Sys__Delay(SCAN_PROBE_YIELD_MS);
+	}
+
+	return scan->num;
+}
+
+/**
+ * @brief scan_line_autobaud
+ *
+ * nobody answers with the line config in use, try the others until
+ * a device answers then complete the scan with that config.
+ * The polling can't work with a wrong config, so the bus is kept for the whole search.
+ * The original config is restored at the end, the detected one must be set
+ * by a set lines config request
+ *
+ * @param first address to probe
+ * @param last address to probe
+ * @param Pointer to the answer of the first responding device
+ * @param Pointer to the length of the answer
+ * @param Pointer to the scan result
+ * @return none
+ */
+static void scan_line_autobaud(C_UINT16 first, C_UINT16 last, C_BYTE *data_rx, C_INT16 *lnt, c_cborresscanline* scan)
+{
+	C_UINT32 baud = Modbus__GetBaudrate();
+	C_BYTE parity = Modbus__GetParity();
+
+	Modbus__BusAcquire(MB_CLIENT_SCAN);
+
+	for (C_BYTE b = 0; (b < sizeof(scan_baud)/sizeof(scan_baud[0])) && (scan->num == 0); b++)
+	{
+		for (C_BYTE p = 0; (p < sizeof(scan_parity)) && (scan->num == 0); p++)
+		{
+			if ((scan_baud[b] == baud) && (scan_parity[p] == parity))
+				continue;
+
+			if (Modbus__SetLineConfig(scan_baud[b], scan_parity[p]) != C_SUCCESS)
+				continue;
+
+			if (scan_line_probe(first, last, C_TRUE, data_rx, lnt, scan) == 0)
+				continue;
+
+			scan->baud = scan_baud[b];
+			scan->parity = scan_parity[p];
+
+			if (scan->dev[0] < last)
+				scan_line_probe(scan->dev[0] + 1, last, C_FALSE, data_rx, lnt, scan);
+		}
+	}
+
+	Modbus__SetLineConfig(baud, parity);
+
+	Modbus__BusRelease();
+	P_COV_LN;
+}
+#endif
+
+/**
+ * @brief execute_scan_devices_fast
+ *
+ * scan the line without fixed sleeps and with a short respond timeout,
+ * all the responding devices are reported
+ *
+ * @param Pointer to the answer of the first responding device
+ * @param Pointer to the address to query (if 0, query all addresses), return the first responding
+ * @param Pointer to the length of the answer
+ * @param scan mode (SCAN_MODE_xxx)
+ * @param Pointer to the scan result
+ * @return C_RES
+ */
+C_RES execute_scan_devices_fast(C_BYTE *data_rx, C_UINT16 *add, C_INT16 * lnt, C_BYTE mode, c_cborresscanline* scan)
+{
+	memset((void*)scan, 0, sizeof(c_cborresscanline));
+	*lnt = 0;
+
+#ifdef INCLUDE_PLATFORM_DEPENDENT
+	C_UINT16 first = 1;
+	C_UINT16 last = MB_ADDRESS_MAX;
+
+	if (*add != 0)
+		first = last = *add;
+
+	if ((scan_line_probe(first, last, C_FALSE, data_rx, lnt, scan) == 0) && (mode & SCAN_MODE_AUTOBAUD))
+		scan_line_autobaud(first, last, data_rx, lnt, scan);
+#endif
+
+	if (scan->num == 0)
+		return C_FAIL;
+
+	*add = scan->dev[0];
+	return C_SUCCESS;
+}
+
 /**
  * @brief read_values_conversion
  *
@@ -2786,6 +2893,69 @@ C_RES execute_update_file(c_cborrequpdatefile *update_file){
 	return C_SUCCESS;
 }
 
+/**
+ * @brief execute_send_mb_adu
+ *        execute the frames of a batch back to back, a frame without
+ *        answer doesn't stop the batch, its err tells what happened.
+ *        An answer that doesn't fit in what is left of the response is
+ *        dropped and its err is ADU_ERR_RSP_OVERFLOW.
+ *        Unlike READ/WRITE_VALUES the frames are not queued to the polling
+ *        task (mb_rw_set_data): on the main line the caller suspends the
+ *        polling for the session (PollEngine__PassModeEnter) and every frame
+ *        takes the bus arbiter as MB_CLIENT_TUNNEL, so the frames are never
+ *        interleaved with a polling transaction and their timing is the
+ *        one asked by the cloud
+ *
+ * @param c_cbor_send_mb_adu *req
+ * @param c_cbor_res_mb_adu *res  responses, err and time of every frame
+ * @return C_RES C_FAIL if the line of the batch is not started
+ */
+C_RES execute_send_mb_adu(c_cbor_send_mb_adu *req, c_cbor_res_mb_adu *res){
+
+	static C_BYTE rsp[ADU_FRAME_SIZE];
+	C_UINT16 used = 0;
+	C_UINT16 rsp_len;
+	C_UINT64 start_us;
+	C_BYTE i;
+
+	if (C_FALSE == ((req->lin != 0) ? ModbusAux__IsStarted() : PollEngine_MBStarted_IS()))
+		return C_FAIL;
+
+	for (i = 0; i < req->num; i++)
+	{
+		rsp_len = sizeof(rsp);
+
+		start_us = RTC_Get_Mono_us();
+		if (req->lin != 0)
+			res->err[i] = (int16_t)ModbusAux__RawAdu(&req->adu[req->off[i]], req->len[i], rsp, &rsp_len, req->tmo);
+		else
+			res->err[i] = (int16_t)app_raw_adu(&req->adu[req->off[i]], req->len[i], rsp, &rsp_len, req->tmo);
+		res->us[i] = (uint32_t)(RTC_Get_Mono_us() - start_us);
+
+		if (res->err[i] != MB_MRE_NO_ERR)
+			rsp_len = 0;
+		else if (rsp_len > sizeof(res->rsp) - used)
+		{
+			res->err[i] = ADU_ERR_RSP_OVERFLOW;
+			rsp_len = 0;
+			P_COV_LN;
+		}
+		else
+			memcpy(&res->rsp[used], rsp, rsp_len);
+
+		res->off[i] = used;
+		res->len[i] = rsp_len;
+		used += rsp_len;
+		res->num = i + 1;
+	}
+
+    #ifdef __DEBUG_CBOR_CAREL_LEV_2
+	PRINTF_DEBUG("execute_send_mb_adu seq %d frames %d\n", req->sequence, res->num);
+    #endif
+
+	return C_SUCCESS;
+}
+
 void CBOR_ReadDidFromNVM (void)
 {
 	C_UINT32 val;
@@ -2820,6 +2990,10 @@ static c_cborhreq act_req;
 static C_BYTE msg_trigger = 0;
 static C_BOOL relax_pollalarm = 0;
 
+static mb_rw_local_t act_local;
+static C_RES act_local_res;
+static volatile C_BYTE act_local_state = MB_RW_LOCAL_IDLE;
+
 
 C_BYTE mb_rw_get_idle(void)     { return mb_is_idle;  }
 void   mb_rw_set_idle(C_BYTE x) { mb_is_idle = x;     }
@@ -2841,11 +3015,16 @@ void mb_rw_execute(c_cborreqrdwrvalues cbor_rwv, c_cborhreq c_req)
 
 	C_MQTT_TOPIC topic;
 
+	// keep the bus for the whole request, a write could be a read-modify-write
+	Modbus__BusAcquire(MB_CLIENT_CLOUD_RW);
+
 	if (c_req.cmd == READ_VALUES)
 		c_req.res = (parse_read_values(&cbor_rwv) == C_SUCCESS) ? SUCCESS_CMD : ERROR_CMD;
 	else
 		c_req.res = (parse_write_values(cbor_rwv) == C_SUCCESS) ? SUCCESS_CMD : ERROR_CMD;
 
+	Modbus__BusRelease();
+
 
 	if (c_req.res == SUCCESS_CMD)	{
 		len = CBOR_ResRdWrValues(cbor_response, &c_req, cbor_rwv.alias, cbor_rwv.val);
@@ -2863,6 +3042,57 @@ void mb_rw_execute(c_cborreqrdwrvalues cbor_rwv, c_cborhreq c_req)
 C_BOOL get_relax(void) 		{ return relax_pollalarm; }
 void   set_relax(C_BOOL r)  { relax_pollalarm = r;    }
 
+/**
+ * @brief mb_rw_set_local
+ *        queue a write of a local client, the polling task executes it
+ *        at its next mb_rw_call_execute. One write at a time, the caller
+ *        waits the result with mb_rw_get_local
+ *
+ * @param  const mb_rw_local_t *w
+ * @return C_RES C_FAIL if the previous write is not executed yet
+ */
+C_RES mb_rw_set_local(const mb_rw_local_t *w)
+{
+	if ((MB_RW_LOCAL_QUEUED == act_local_state) || (MB_RW_LOCAL_RUNNING == act_local_state))
+		return C_FAIL;
+
+	act_local = *w;
+	act_local_state = MB_RW_LOCAL_QUEUED;
+	return C_SUCCESS;
+}
+
+/**
+ * @brief mb_rw_get_local
+ *        state of the write queued with mb_rw_set_local, once read
+ *        MB_RW_LOCAL_DONE goes back to MB_RW_LOCAL_IDLE
+ *
+ * @param  C_RES *res  result of the write, valid if MB_RW_LOCAL_DONE
+ * @return C_BYTE MB_RW_LOCAL_xxx
+ */
+C_BYTE mb_rw_get_local(C_RES *res)
+{
+	C_BYTE state = act_local_state;
+
+	if (MB_RW_LOCAL_DONE == state)
+	{
+		*res = act_local_res;
+		act_local_state = MB_RW_LOCAL_IDLE;
+	}
+	return state;
+}
+
+static void mb_rw_local_execute(const mb_rw_local_t *w)
+{
+	Modbus__BusAcquire(MB_CLIENT_CLOUD_RW);
+
+	if (mbW_COIL == w->func)
+		act_local_res = PollEngine__Write_COIL_Req((C_UINT16)w->value, w->addr, w->func);
+	else
+		act_local_res = PollEngine__Write_HR_Req_Int(w->value, w->addr, w->num, 0, w->func);
+
+	Modbus__BusRelease();
+}
+
 void mb_rw_call_execute(void)
 {
 	if(get_msg_trigger())
@@ -2876,6 +3106,13 @@ void mb_rw_call_execute(void)
 
 		mb_rw_set_idle(true);
 	}
+
+	if (MB_RW_LOCAL_QUEUED == act_local_state)
+	{
+		act_local_state = MB_RW_LOCAL_RUNNING;
+		mb_rw_local_execute(&act_local);
+		act_local_state = MB_RW_LOCAL_DONE;
+	}
 }
 
 
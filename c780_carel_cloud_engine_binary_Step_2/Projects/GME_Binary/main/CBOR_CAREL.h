@@ -22,6 +22,7 @@
 #include "tinycbor/cbor.h"
 #include "binary_model.h"
 #include "polling_CAREL.h"
+#include "modbus_aux_IS.h"
 
 #include "filelog_CAREL.h"
 
@@ -58,7 +59,14 @@
 #define B_SIZE					30
 
 #define REPORT_SLAVE_ID_SIZE	256
-#define ADU_SIZE				512
+#define ADU_SIZE				512			// all the frames of a send_mb_adu batch
+#define ADU_MAX_FRAMES			16
+#define ADU_FRAME_SIZE			256			// max Modbus RTU ADU
+#define ADU_RESPONSE_SIZE		CBORSTREAM_SIZE		// the responses plus ~11 bytes per frame
+
+/* err of a send_mb_adu frame executed whose answer doesn't fit in the
+   response of the batch, the others are eMBMasterReqErrCode */
+#define ADU_ERR_RSP_OVERFLOW	(-1)
 
 #define HEADERREQ_LEN			55			// header of request has fixed size
 
@@ -110,6 +118,17 @@ typedef enum CloudtoGME_Commands_l{
 	UPDATE_FILE = 50,
 }cloud_req_commands_t;
 
+/**
+ * @brief cloud_req_class_t
+ *        REQ_CLASS_NO_BUS requests run while the polling goes on,
+ *        REQ_CLASS_BUS requests (or the task they start) need the serial
+ *        line for themselves, the polling is stopped around them
+ */
+typedef enum{
+	REQ_CLASS_NO_BUS = 0,
+	REQ_CLASS_BUS
+}cloud_req_class_t;
+
 
 #ifdef __DEBUG_CBOR_CAREL_LEV_4
 
@@ -176,6 +195,8 @@ typedef struct C_CBORREQSETGWCONFIG{
 	C_UINT16 mka;		// mqtt keep alive interval
 	C_UINT16 lss;		// low speed sampling period
 	C_UINT16 hss;		// high speed sampling period
+	C_UINT16 agt;		// aggregation window (s), 0 no aggregation
+	C_BYTE agf;			// aggregation policy, POLL_AGG_xxx
 }c_cborreqsetgwconfig;
 #pragma pack()
 
@@ -194,6 +215,7 @@ typedef struct C_CBORDWLDEVSCFG{
 	C_UINT16 dev;
 	C_UINT16 did;
 	C_CHAR fil[FIL_SIZE];
+	C_CHAR sha[SHA_SIZE];		// sha-256 of the file in hex, optional
 }c_cborreqdwldevsconfig;
 #pragma pack()
 
@@ -215,6 +237,25 @@ typedef struct C_CBORREQUPDDEVFW{
 }c_cborrequpddevfw;
 #pragma pack()
 
+/**
+ * @brief C_CBORREQUPDGMEFW
+ *
+ * Request update of the GME firmware, dpu is the optional patch
+ * against the running image, uri the full image used as fallback
+ */
+#pragma pack(1)
+typedef struct C_CBORREQUPDGMEFW{
+	C_USERNAME usr;
+	C_PASSWORD pwd;
+	C_URI uri;
+	C_UINT16 fid;
+	C_UINT16 wet;
+	C_UINT16 cid;
+	C_URI dpu;
+	C_CHAR sha[SHA_SIZE];		// sha-256 of the new image in hex, optional
+}c_cborrequpdgmefw;
+#pragma pack()
+
 /**
  * @brief C_CBORREQLINESCONFIG
  *
@@ -225,17 +266,69 @@ typedef struct C_CBORLINESCFG{
 	C_UINT32 baud;
 	C_BYTE conn;
 	C_UINT16 del;
+	C_BYTE aux;				// 1 the other connector is the aux line, its poll table is decoded by CBOR_ReqAuxPoll
 }c_cborreqlinesconfig;
 #pragma pack()
 
+/**
+ * @brief C_CBORRESSCANLINE
+ *
+ * Result of a fast scan line, the responding devices
+ * (at most SCAN_MAX_DEVICES are reported)
+ */
+#define SCAN_MAX_DEVICES		32
+
+#define SCAN_MODE_FAST			0x01
+#define SCAN_MODE_AUTOBAUD		0x02
+
+/* pause between two probes, at least a tick so the polling can take the bus */
+#define SCAN_PROBE_YIELD_MS		10
+
+#pragma pack(1)
+typedef struct C_CBORRESSCANLINE{
+	C_UINT16 num;
+	C_BYTE dev[SCAN_MAX_DEVICES];
+	C_UINT32 baud;			// auto-detected line config, 0 if not detected
+	C_BYTE parity;			// MB_PARITY_xxx, sent as eMBParity
+}c_cborresscanline;
+#pragma pack()
+
+/**
+ * @brief C_CBORSENDMBADU
+ *
+ * send_mb_adu batch, frame i is adu[off[i]] of len[i] bytes
+ */
 #pragma pack(1)
 typedef struct C_CBORSENDMBADU{
 	uint16_t sequence;
-	uint8_t *adu;
-	uint8_t adu_len;
+	uint16_t tmo;					// respond timeout of every frame (ms), 0 the line one
+	uint16_t hld;					// polling suspended hld s after the batch, 0 PASS_MODE_TIMER
+	uint8_t cls;					// 1 ends the session after the batch
+	uint8_t lin;					// 0 main line (polling suspended), 1 aux line
+	uint8_t num;
+	uint16_t off[ADU_MAX_FRAMES];
+	uint16_t len[ADU_MAX_FRAMES];
+	uint8_t adu[ADU_SIZE];
 }c_cbor_send_mb_adu;
 #pragma pack()
 
+/**
+ * @brief C_CBORRESMBADU
+ *
+ * responses of a send_mb_adu batch, same layout of the request,
+ * err is the modbus error of the frame and us its time on the bus
+ */
+#pragma pack(1)
+typedef struct C_CBORRESMBADU{
+	uint8_t num;
+	int16_t err[ADU_MAX_FRAMES];
+	uint32_t us[ADU_MAX_FRAMES];
+	uint16_t off[ADU_MAX_FRAMES];
+	uint16_t len[ADU_MAX_FRAMES];
+	uint8_t rsp[ADU_SIZE];
+}c_cbor_res_mb_adu;
+#pragma pack()
+
 /**
  * @brief C_CBORALARMS
  *
@@ -248,6 +341,8 @@ typedef struct C_CBORALARMS{
 	C_BYTE aco;
 	C_TIME st;
 	C_TIME et;
+	C_UINT16 st_ms;
+	C_UINT16 et_ms;
 }c_cboralarms;
 #pragma pack()
 
@@ -278,6 +373,26 @@ typedef struct C_CBORREQFILEABORT{
 }c_cborreqabort;
 #pragma pack()
 
+/**
+ * @brief C_CBORREQ
+ *
+ * Decoded request, filled in a single pass by CBOR_ReqDecode.
+ * hdr.cmd tells which of the following fields are meaningful,
+ * hdr must stay the first member (see CBOR_ReqHeader)
+ */
+typedef struct C_CBORREQ{
+	c_cborhreq hdr;
+	c_cborreqdwldevsconfig cfg;		// also cid of reboot, dev of scan line, usr/pwd/uri/cid of the fw updates
+	c_cborreqsetgwconfig gw;
+	c_cborreqlinesconfig line;
+	c_cborreqrdwrvalues rdwr;
+	c_cborreqfilelog file;			// also fid of the fw updates, fst is the fast flag of scan line
+	c_cborreqabort abort;
+	C_UINT16 wet;
+	C_BYTE abd;
+	C_URI dpu;						// patch of the GME fw update
+}c_cborreq;
+
 /*
  * @brief C_CBORFILEVALUE
  *
@@ -319,30 +434,21 @@ size_t CBOR_Connected(C_CHAR* cbor_stream, C_UINT16 cbor_status);
 
 void CBOR_ResHeader(C_CHAR* cbor_stream, c_cborhreq* cbor_req, CborEncoder* encoder, CborEncoder* mapEncoder);
 size_t CBOR_ResSimple(C_CHAR* cbor_response, c_cborhreq* cbor_req);
-size_t CBOR_ResScanLine(C_CHAR* cbor_response, c_cborhreq* cbor_req, C_UINT16 device, C_BYTE* answer, C_UINT16 answer_len);
-size_t CBOR_ResSendMbAdu(C_CHAR* cbor_response, c_cborhreq* cbor_req, C_UINT16 seq, C_BYTE* val, C_UINT16 val_len);
+size_t CBOR_ResScanLine(C_CHAR* cbor_response, c_cborhreq* cbor_req, C_UINT16 device, C_BYTE* answer, C_UINT16 answer_len, c_cborresscanline* scan);
+size_t CBOR_ResSendMbAdu(C_CHAR* cbor_response, c_cborhreq* cbor_req, C_UINT16 seq, c_cbor_res_mb_adu* res);
 size_t CBOR_ResRdWrValues(C_CHAR* cbor_response, c_cborhreq* cbor_req, C_CHAR* ali, C_CHAR* val);
 size_t CBOR_ResSendMbPassThrough(C_CHAR* cbor_response, c_cborhreq* cbor_req, C_UINT16 cbor_pass);
 size_t CBOR_ResSetDevsConfig(C_CHAR* cbor_response, c_cborhreq* cbor_req, C_UINT16 did);
 
 CborError CBOR_ReqHeader(C_CHAR* cbor_stream, C_UINT16 cbor_len, c_cborhreq* cbor_req);
-CborError CBOR_ReqSetLinesConfig(C_CHAR* cbor_stream, C_UINT16 cbor_len, c_cborreqlinesconfig *set_line_cfg);
-CborError CBOR_ReqSetDevsConfig(C_CHAR* cbor_stream, C_UINT16 cbor_len, c_cborreqdwldevsconfig* download_devs_config);
-CborError CBOR_ReqRdWrValues(C_CHAR* cbor_stream, C_UINT16 cbor_len, c_cborreqrdwrvalues* cbor_wv);
-CborError CBOR_ReqSetGwConfig(C_CHAR* cbor_stream, C_UINT16 cbor_len, c_cborreqsetgwconfig* cbor_setgwconfig);
-CborError CBOR_ReqScanLine(C_CHAR* cbor_stream, C_UINT16 cbor_len, C_UINT16 *device);
-CborError CBOR_ReqSendMbAdu(C_CHAR* cbor_stream, C_UINT16 cbor_len, C_UINT16* seq, C_CHAR* adu);
-CborError CBOR_ReqReboot(C_CHAR* cbor_stream, C_UINT16 cbor_len, C_UINT16* cid);
+CborError CBOR_ReqDecode(C_CHAR* cbor_stream, C_UINT16 cbor_len, c_cborreq* req);
+CborError CBOR_ReqSendMbAdu(C_CHAR* cbor_stream, C_UINT16 cbor_len, c_cbor_send_mb_adu* adu);
+CborError CBOR_ReqAuxPoll(C_CHAR* cbor_stream, C_UINT16 cbor_len, mb_aux_poll_cfg_t* cfg);
 CborError CBOR_ReqSendMbPassThrough(C_CHAR* cbor_stream, C_UINT16 cbor_len, C_UINT16* cbor_pass);
 
 // step 2
-CborError CBOR_ReqFileLog(C_CHAR* cbor_stream, C_UINT16 cbor_len, c_cborreqfilelog* RangeFileData);
 int CBOR_SendAsync_FileLog(filelog_info_t data, C_UINT16 numof);
 
-CborError CBOR_ReqAbort(C_CHAR* cbor_stream, C_UINT16 cbor_len, c_cborreqabort* AbortData);
-
-#define CBOR_ReqRangeFile CBOR_ReqFileLog
-#define CBOR_ReqFullFile  CBOR_ReqFileLog
 typedef c_cborreqfilelog  c_cborreqfullfile;
 typedef c_cborreqfilelog  c_cborreqrangefile;
 
@@ -350,24 +456,23 @@ typedef c_cborreqfilelog  c_cborreqrangefile;
 void RetrieveFileLog_Info(c_cborreqfilelog data);
 
 int CBOR_ReqTopicParser(C_CHAR* cbor_stream, C_UINT16 cbor_len);
+cloud_req_class_t CBOR_GetReqClass(C_CHAR* cbor_stream, C_UINT16 cbor_len);
+void CBOR_SendReqBusy(C_CHAR* cbor_stream, C_UINT16 cbor_len);
 CborError CBOR_DiscardElement(CborValue* recursed);
 CborError CBOR_ExtractInt(CborValue* recursed, int64_t* read);
 
-#define 	CBOR_ReqUpdateCaCertificate 	CBOR_ReqSetDevsConfig
-#define 	CBOR_ReqChangeCredentials		CBOR_ReqSetDevsConfig
 typedef 	c_cborreqdwldevsconfig			c_cborrequpdatecacert;
 typedef		c_cborreqdwldevsconfig			c_cborreqchangecred;
-typedef 	c_cborrequpddevfw				c_cborrequpdgmefw;
 typedef		c_cborreqdwldevsconfig			c_cborrequpdatefile;
-#define 	CBOR_ReqUpdateGMEFW 			CBOR_ReqUpdateDevFW
-#define		CBOR_ReqUpdateFile				CBOR_ReqSetDevsConfig
 
 
-C_RES execute_set_line_config(c_cborreqlinesconfig set_line_cfg);
+C_RES execute_set_line_config(c_cborreqlinesconfig set_line_cfg, const mb_aux_poll_cfg_t *aux_poll);
 C_RES execute_set_gw_config(c_cborreqsetgwconfig set_gw_config );
 C_RES execute_change_cred(c_cborreqdwldevsconfig change_cred);
 C_RES execute_scan_devices(C_BYTE* data_rx, C_UINT16 *add, C_INT16 * lnt);
+C_RES execute_scan_devices_fast(C_BYTE* data_rx, C_UINT16 *add, C_INT16 * lnt, C_BYTE mode, c_cborresscanline* scan);
 C_RES execute_update_file(c_cborrequpdatefile *update_file);
+C_RES execute_send_mb_adu(c_cbor_send_mb_adu *req, c_cbor_res_mb_adu *res);
 C_RES parse_write_values(c_cborreqrdwrvalues cbor_wv);
 C_RES parse_read_values(c_cborreqrdwrvalues* cbor_rv);
 
@@ -399,6 +504,23 @@ void mb_rw_execute(c_cborreqrdwrvalues cbor_rwv, c_cborhreq c_req);
 
 void mb_rw_call_execute(void);
 
+/* write of a local client (Modbus TCP), executed by the polling task
+   in mb_rw_call_execute as the cloud ones */
+#define MB_RW_LOCAL_IDLE		0
+#define MB_RW_LOCAL_QUEUED		1
+#define MB_RW_LOCAL_RUNNING		2
+#define MB_RW_LOCAL_DONE		3
+
+typedef struct mb_rw_local_s{
+	C_UINT16 func;				// mbW_COIL, mbW_HR, mbW_HRS
+	C_UINT16 addr;
+	C_CHAR   num;				// registers, 1 or 2
+	C_INT32  value;
+}mb_rw_local_t;
+
+C_RES  mb_rw_set_local(const mb_rw_local_t *w);
+C_BYTE mb_rw_get_local(C_RES *res);
+
 C_BOOL get_relax(void);
 void   set_relax(C_BOOL r);
 
@@ -0,0 +1,140 @@
+/**
+ * @file   CBOR_ReqKeys_CAREL.h
+ * @author carel
+ * @date   18 Oct 2026
+ * @brief  keys of the cloud requests and their perfect hash.
+ *
+ *         The keys are at most TAG_SIZE chars, packed in an integer they
+ *         index through a perfect hash a table telling where the value must
+ *         be stored in c_cborreq (see CBOR_ReqWalk). REQ_KEY_HASH_MUL has
+ *         been searched so that all the keys of REQ_FIELDS fall in different
+ *         slots: a new key in the same slot of another one doesn't build
+ *         (see ReqKey__SlotUsed), then search a new multiplier.
+ *         The list is kept here, without dependencies, to be checked and
+ *         fuzzed on the host (Test/host)
+ */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __CBOR_REQKEYS_CAREL_H
+#define __CBOR_REQKEYS_CAREL_H
+
+/* ==== Include ==== */
+#include "data_types_CAREL.h"
+
+/* ==== Define ==== */
+#define REQ_KEY_SIZE			3		// same of TAG_SIZE
+
+#define REQ_KEY(a,b,c)			((C_UINT32)(a) | ((C_UINT32)(b) << 8) | ((C_UINT32)(c) << 16))
+#define REQ_KEY_HASH_MUL		0xA11759C9u
+#define REQ_KEY_HASH_BITS		6
+#define REQ_KEY_SLOTS			(1 << REQ_KEY_HASH_BITS)
+#define REQ_KEY_SLOT(k)			((C_UINT32)((C_UINT32)(k) * REQ_KEY_HASH_MUL) >> (32 - REQ_KEY_HASH_BITS))
+
+#define REQ_FIELD_INT			0		// unsigned integer of 1, 2 or 4 bytes
+#define REQ_FIELD_TEXT			1		// text string, the size is the one of the buffer
+
+/*
+ * X(a,b,c, member of c_cborreq, type, 1 if part of the request header)
+ */
+#define REQ_FIELDS(X) \
+	/* header */ \
+	X('v','e','r', hdr.ver,        REQ_FIELD_INT,  1) \
+	X('r','t','o', hdr.rto,        REQ_FIELD_TEXT, 1) \
+	X('c','m','d', hdr.cmd,        REQ_FIELD_INT,  1) \
+	/* set_lines_config */ \
+	X('b','a','u', line.baud,      REQ_FIELD_INT,  0) \
+	X('c','o','n', line.conn,      REQ_FIELD_INT,  0) \
+	X('d','e','l', line.del,       REQ_FIELD_INT,  0) \
+	X('a','u','x', line.aux,       REQ_FIELD_INT,  0) \
+	/* set_devs_config and the requests sharing its structure */ \
+	X('u','s','r', cfg.usr,        REQ_FIELD_TEXT, 0) \
+	X('p','w','d', cfg.pwd,        REQ_FIELD_TEXT, 0) \
+	X('u','r','i', cfg.uri,        REQ_FIELD_TEXT, 0) \
+	X('c','i','d', cfg.cid,        REQ_FIELD_INT,  0) \
+	X('c','r','c', cfg.crc,        REQ_FIELD_INT,  0) \
+	X('d','e','v', cfg.dev,        REQ_FIELD_INT,  0) \
+	X('d','i','d', cfg.did,        REQ_FIELD_INT,  0) \
+	X('f','i','l', cfg.fil,        REQ_FIELD_TEXT, 0) \
+	X('s','h','a', cfg.sha,        REQ_FIELD_TEXT, 0) \
+	/* update_gme_firmware */ \
+	X('d','p','u', dpu,            REQ_FIELD_TEXT, 0) \
+	/* scan_devices */ \
+	X('a','b','d', abd,            REQ_FIELD_INT,  0) \
+	/* read/write values */ \
+	X('a','l','i', rdwr.alias,     REQ_FIELD_TEXT, 0) \
+	X('v','a','l', rdwr.val,       REQ_FIELD_TEXT, 0) \
+	X('f','u','n', rdwr.func,      REQ_FIELD_INT,  0) \
+	X('a','d','r', rdwr.addr,      REQ_FIELD_INT,  0) \
+	X('d','i','m', rdwr.dim,       REQ_FIELD_INT,  0) \
+	X('p','o','s', rdwr.pos,       REQ_FIELD_INT,  0) \
+	X('l','e','n', rdwr.len,       REQ_FIELD_INT,  0) \
+	X('a', 0 , 0 , rdwr.a,         REQ_FIELD_TEXT, 0) \
+	X('b', 0 , 0 , rdwr.b,         REQ_FIELD_TEXT, 0) \
+	X('f','l','g', rdwr.flags,     REQ_FIELD_INT,  0) \
+	/* set_gw_config */ \
+	X('p','v','a', gw.pva,         REQ_FIELD_INT,  0) \
+	X('p','s','t', gw.pst,         REQ_FIELD_INT,  0) \
+	X('m','k','a', gw.mka,         REQ_FIELD_INT,  0) \
+	X('l','s','s', gw.lss,         REQ_FIELD_INT,  0) \
+	X('h','s','s', gw.hss,         REQ_FIELD_INT,  0) \
+	X('a','g','t', gw.agt,         REQ_FIELD_INT,  0) \
+	X('a','g','f', gw.agf,         REQ_FIELD_INT,  0) \
+	/* update firmware, file/log download */ \
+	X('w','e','t', wet,            REQ_FIELD_INT,  0) \
+	X('f','i','d', file.fid,       REQ_FIELD_INT,  0) \
+	X('f','s','t', file.fst,       REQ_FIELD_INT,  0) \
+	X('f','l','e', file.fle,       REQ_FIELD_INT,  0) \
+	X('r','i','d', abort.rid,      REQ_FIELD_TEXT, 0)
+
+/* ==== Function ==== */
+
+/**
+ * @brief ReqKey__Pack
+ *        pack the chars of a key read from a request
+ *
+ * @param  const char *tag
+ * @param  size_t len
+ * @return C_UINT32 the key, 0 if it can't be a key (empty, too long
+ *         or with a NUL inside, that would alias a shorter key)
+ */
+static inline C_UINT32 ReqKey__Pack(const char *tag, size_t len)
+{
+	C_UINT32 key = 0;
+
+	if ((len == 0) || (len > REQ_KEY_SIZE))
+		return 0;
+
+	for (size_t i = 0; i < len; i++)
+	{
+		if (tag[i] == 0)
+			return 0;
+		key |= (C_UINT32)(C_BYTE)tag[i] << (8 * i);
+	}
+
+	return key;
+}
+
+#define REQ_KEY_CASE(a,b,c, member, type, hdr)	case REQ_KEY_SLOT(REQ_KEY(a,b,c)):
+
+/**
+ * @brief ReqKey__SlotUsed
+ *        tell if a slot of the hash is taken by a key of REQ_FIELDS.
+ *        Two keys in the same slot are duplicated case labels, so a
+ *        collision is a build error
+ *
+ * @param  C_UINT32 slot
+ * @return C_BOOL
+ */
+static inline C_BOOL ReqKey__SlotUsed(C_UINT32 slot)
+{
+	switch (slot)
+	{
+		REQ_FIELDS(REQ_KEY_CASE)
+			return C_TRUE;
+
+		default:
+			return C_FALSE;
+	}
+}
+
+#endif  /* __CBOR_REQKEYS_CAREL_H */
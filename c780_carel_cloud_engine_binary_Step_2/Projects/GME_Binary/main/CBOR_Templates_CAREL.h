@@ -0,0 +1,112 @@
+/**
+ * @file   CBOR_Templates_CAREL.h
+ * @author carel
+ * @date   18 Oct 2026
+ * @brief  pre-encoded templates of the outbound messages.
+ *
+ *         The constant keys of the outbound messages (and the constant "ver"
+ *         value) are kept already encoded and copied as they are, only the
+ *         variable fields go through the tinycbor encoder. The resulting
+ *         stream is byte by byte the same of the one built key by key.
+ *         Kept here, without the dependencies of CBOR_CAREL.c, to be
+ *         checked and benchmarked on the host (Test/host)
+ */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __CBOR_TEMPLATES_CAREL_H
+#define __CBOR_TEMPLATES_CAREL_H
+
+/* ==== Include ==== */
+#include <string.h>
+#include "CAREL_GLOBAL_DEF.h"
+#include "data_types_CAREL.h"
+#include "tinycbor/cbor.h"
+
+/* ==== Define ==== */
+#define CBOR_TXT1(a)			0x61, (a)
+#define CBOR_TXT2(a,b)			0x62, (a), (b)
+#define CBOR_TXT3(a,b,c)		0x63, (a), (b), (c)
+
+#if (CAREL_TYPES_VERSION < 0x100) || (CAREL_TYPES_VERSION > 0xFFFF)
+#error "CBOR_VER_VALUE must be updated to the new CAREL_TYPES_VERSION"
+#endif
+#define CBOR_VER_VALUE			0x19, (C_BYTE)(CAREL_TYPES_VERSION >> 8), (C_BYTE)(CAREL_TYPES_VERSION)
+
+// "ver":CAREL_TYPES_VERSION followed by the key of the first variable field
+static const C_BYTE tmpl_ver_cnt[] = { CBOR_TXT3('v','e','r'), CBOR_VER_VALUE, CBOR_TXT3('c','n','t') };
+static const C_BYTE tmpl_ver_aty[] = { CBOR_TXT3('v','e','r'), CBOR_VER_VALUE, CBOR_TXT3('a','t','y') };
+static const C_BYTE tmpl_ver_t[]   = { CBOR_TXT3('v','e','r'), CBOR_VER_VALUE, CBOR_TXT1('t') };
+static const C_BYTE tmpl_ver_rto[] = { CBOR_TXT3('v','e','r'), CBOR_VER_VALUE, CBOR_TXT3('r','t','o') };
+
+static const C_BYTE tmpl_key_ali[] = { CBOR_TXT3('a','l','i') };
+static const C_BYTE tmpl_key_aco[] = { CBOR_TXT3('a','c','o') };
+static const C_BYTE tmpl_key_btm[] = { CBOR_TXT3('b','t','m') };
+static const C_BYTE tmpl_key_cmd[] = { CBOR_TXT3('c','m','d') };
+static const C_BYTE tmpl_key_did[] = { CBOR_TXT3('d','i','d') };
+static const C_BYTE tmpl_key_est[] = { CBOR_TXT3('e','s','t') };
+static const C_BYTE tmpl_key_et[]  = { CBOR_TXT2('e','t') };
+static const C_BYTE tmpl_key_fme[] = { CBOR_TXT3('f','m','e') };
+static const C_BYTE tmpl_key_frm[] = { CBOR_TXT3('f','r','m') };
+static const C_BYTE tmpl_key_res[] = { CBOR_TXT3('r','e','s') };
+static const C_BYTE tmpl_key_sgn[] = { CBOR_TXT3('s','g','n') };
+static const C_BYTE tmpl_key_st[]  = { CBOR_TXT2('s','t') };
+static const C_BYTE tmpl_key_t[]   = { CBOR_TXT1('t') };
+static const C_BYTE tmpl_key_upt[] = { CBOR_TXT3('u','p','t') };
+static const C_BYTE tmpl_key_vls[] = { CBOR_TXT3('v','l','s') };
+static const C_BYTE tmpl_key_agg[] = { CBOR_TXT3('a','g','g') };
+#ifdef SAMPLE_MS_TIMESTAMP
+static const C_BYTE tmpl_key_tms[] = { CBOR_TXT3('t','m','s') };
+static const C_BYTE tmpl_key_sms[] = { CBOR_TXT3('s','m','s') };
+static const C_BYTE tmpl_key_ems[] = { CBOR_TXT3('e','m','s') };
+#endif
+#ifdef GW_STATUS_TELEMETRY
+static const C_BYTE tmpl_key_tlm[] = { CBOR_TXT3('t','l','m') };
+static const C_BYTE tmpl_key_hmn[] = { CBOR_TXT3('h','m','n') };
+static const C_BYTE tmpl_key_hlb[] = { CBOR_TXT3('h','l','b') };
+static const C_BYTE tmpl_key_tsk[] = { CBOR_TXT3('t','s','k') };
+static const C_BYTE tmpl_key_bfs[] = { CBOR_TXT3('b','f','s') };
+static const C_BYTE tmpl_key_mbl[] = { CBOR_TXT3('m','b','l') };
+static const C_BYTE tmpl_key_rcn[] = { CBOR_TXT3('r','c','n') };
+static const C_BYTE tmpl_key_pla[] = { CBOR_TXT3('p','l','a') };
+#endif
+
+#define CBOR_TMPL(encoder, tmpl, items)	CBOR_AppendTemplate((encoder), (tmpl), sizeof(tmpl), (items))
+
+
+/**
+ * @brief CBOR_AppendTemplate
+ *
+ * Copies a pre-encoded fragment into the stream of an encoder, the encoder
+ * state is updated as if the items were encoded one by one
+ *
+ * @param encoder, the (map) encoder
+ * @param tmpl, the pre-encoded fragment
+ * @param len, size of the fragment
+ * @param items, number of CBOR items contained in the fragment
+ * @return CborNoError or CborErrorOutOfMemory if the stream is full
+ */
+static inline CborError CBOR_AppendTemplate(CborEncoder* encoder, const C_BYTE* tmpl, size_t len, size_t items)
+{
+	encoder->remaining = (encoder->remaining > items) ? (encoder->remaining - items) : 0;
+
+	// the encoder already overflowed, tinycbor just counts the missing bytes
+	if (encoder->end == NULL)
+	{
+		encoder->data.bytes_needed += len;
+		return CborErrorOutOfMemory;
+	}
+
+	if ((size_t)(encoder->end - encoder->data.ptr) < len)
+	{
+		encoder->data.bytes_needed = len - (encoder->end - encoder->data.ptr);
+		encoder->end = NULL;
+		P_COV_LN;
+		return CborErrorOutOfMemory;
+	}
+
+	memcpy(encoder->data.ptr, tmpl, len);
+	encoder->data.ptr += len;
+	return CborNoError;
+}
+
+#endif  /* __CBOR_TEMPLATES_CAREL_H */
@@ -188,6 +188,30 @@ C_RES FS_SaveFile(const char* data_to_save, size_t data_size, const char* filena
 }
 
 
+/**
+ * @brief FS_ReplaceFile
+ *        replace a file with a complete and verified temporary one,
+ *        SPIFFS doesn't rename over an existing file so the old one is
+ *        removed just before
+ * @param tmp_name  the temporary file, it doesn't exist anymore on success
+ * @param filename  the fully qualified file name
+ * @return C_SUCCESS/C_FAIL
+ */
+C_RES FS_ReplaceFile(const char* tmp_name, const char* filename){
+
+		remove(filename);
+
+		if (0 != rename(tmp_name, filename)) {
+			PRINTF_DEBUG("%s - rename to %s failed\n", tmp_name, filename);
+			P_COV_LN;
+			return C_FAIL;
+		}
+
+		P_COV_LN;
+		return C_SUCCESS;
+}
+
+
 /**
  * @brief Check_spiffs_compatibility
  *		  USefull to check the spiffs version inside the device
@@ -294,6 +318,8 @@ C_RES SaveCfgDefDataToNVM(void) {
 
 	free(dati_1);
 
+	// one commit for the whole default configuration
+	err |= NVM__BeginTransaction();
 	err |= NVM__WriteString(MQTT_USER, CfgData.mqtt_user);
 	err |= NVM__WriteString(MQTT_PASSWORD, CfgData.mqtt_pssw);
 	err |= NVM__WriteString(MQTT_BROKER, CfgData.mqtt_broker);
@@ -303,6 +329,7 @@ C_RES SaveCfgDefDataToNVM(void) {
 	err |= NVM__WriteString(APN_USERNAME, CfgData.apn_user);
 	err |= NVM__WriteString(APN_PASSWORD, CfgData.apn_password);
 	err |= NVM__WriteString(GME_PN, CfgData.pn);
+	err |= NVM__EndTransaction();
 
 	if (err == C_SUCCESS)
 		err = NVM__WriteU8Value(CFG_DEF_NVM, 1);
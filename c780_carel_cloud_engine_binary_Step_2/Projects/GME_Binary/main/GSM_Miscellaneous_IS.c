@@ -18,6 +18,9 @@
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "driver/gpio.h"
+#ifdef GW_BYPASS_ESP32
+#include "esp_console.h"
+#endif
 
 #endif
 
@@ -64,6 +67,7 @@ void GSM_BypassEsp32(void)
     char* line;
     line = malloc(100);
     char answer[100];
+    int ret;
     while(1)
     {
     	// read a string from uart
@@ -74,6 +78,10 @@ void GSM_BypassEsp32(void)
     	if (line != NULL) {
         //  printf("received line %s\n", line);
 
+          // the local console commands (free, tasks, telemetry...) are run here
+          if (esp_console_run(line, &ret) == ESP_OK)
+        	  continue;
+
           // send command to M95
           Mobile_SendGenericCommand(line, answer);
 
@@ -90,13 +90,23 @@ typedef enum{
  */
 volatile C_UINT16 led_current_status = 0;
 
+/**
+ * @brief led_blink_active
+ *        set by Led_Status_Update when at least one led is blinking,
+ *        if nobody blinks the led task sleeps until the next status change
+ */
+static C_BYTE led_blink_active = 0;
+
 #ifdef INCLUDE_PLATFORM_DEPENDENT
 #define LED_TASK_TASK_STACK_SIZE   (1024)
 //configMINIMAL_STACK_SIZE
 #define LED_TASK_TASK_PRIO         tskIDLE_PRIORITY
-static xTaskHandle xLedTask;
+static xTaskHandle xLedTask = NULL;
 #endif
 
+/* time in ms between two updates of a blinking led */
+#define LED_TASK_BLINK_TICK_MS     500
+
 /* ------------------------------------------------------------------- */
 /*           BEGIN OF PLATFORM INDEPENDENT LED MANAGEMENT              */
 /* ------------------------------------------------------------------- */
@@ -120,6 +130,7 @@ static xTaskHandle xLedTask;
  */
 void Update_Led_Status(C_UINT16 set_status, C_BYTE status)
 {
+	C_UINT16 old_status = led_current_status;
 
 	if (status == LED_STAT_ON)
 	{
@@ -130,6 +141,11 @@ void Update_Led_Status(C_UINT16 set_status, C_BYTE status)
 		led_current_status = (led_current_status & (~set_status));
 	}
 
+	// wake up the led task only if something changed
+#ifdef INCLUDE_PLATFORM_DEPENDENT
+	if ((old_status != led_current_status) && (xLedTask != NULL))
+		xTaskNotifyGive(xLedTask);
+#endif
 }
 
 /**
@@ -251,6 +267,7 @@ void Led_Status_Update(Led_Show_Status_t status, int led){
 
 		case LED_BLINK_SLOW:
 		  /* put the I/O instruction here */
+		  led_blink_active = 1;
 
 		  if (RTC_Get_UTC_Current_Time() >= blink_timer)
 		  {
@@ -285,6 +302,7 @@ void Led_Status_Update(Led_Show_Status_t status, int led){
 
 		case LED_BLINK_FAST:
 		  /* put the I/O instruction here */
+		  led_blink_active = 1;
 
 		  if (RTC_Get_UTC_Current_Time() >= blink_timer)
 		  {
@@ -962,9 +980,15 @@ void Led_task(void)
 
     while(1)
     {
+		led_blink_active = 0;
 		Task_Led_Status();
-		/* include a task delay here to leave time for other task */		
-        Sys__Delay(500);
+
+		/* sleep until the next blink step, or until a status change if nothing blinks */
+#ifdef INCLUDE_PLATFORM_DEPENDENT
+		ulTaskNotifyTake(pdTRUE, (led_blink_active != 0) ? pdMS_TO_TICKS(LED_TASK_BLINK_TICK_MS) : portMAX_DELAY);
+#else
+		Sys__Delay(LED_TASK_BLINK_TICK_MS);
+#endif
     }
 }
 
@@ -25,6 +25,12 @@
 #include "mobile.h"
 
 #include "filelog_CAREL.h"
+#include "main_CAREL.h"
+#ifdef __CCL_COVERAGE_BIN
+#include "coverage_CAREL.h"
+#endif
+
+#include <stdlib.h>
 
 /**
  * @brief mqtt_engine_status contain the status of the MQTT engine 
@@ -142,6 +148,10 @@ C_RES MQTT_Start(void)
     Radio__WaitConnection();
     s_mqtt_event_group = xEventGroupCreate();
 
+    // requests are executed outside the MQTT task, started only once
+    if (C_SUCCESS != mqtt_cmd_executor_start(MQTT_CmdExecutor))
+    	PRINTF_DEBUG("MQTT_CmdExecutor not started\n");
+
     RTC_Set_UTC_MQTTConnect_Time();
 
     mqtt_client_init(&mqtt_cfg_nvm);
@@ -241,7 +251,7 @@ void CBOR_CreateSendValues(values_buffer_t *values_buffer, uint16_t values_buffe
 		PRINTF_DEBUG("i: %d, alias: %d, value: %Lf, err:%d\n", i, values_buffer[i].alias, values_buffer[i].value, values_buffer[i].info_err);
 		PRINTF_DEBUG("time %d\n", values_buffer[i].t);
 #endif
-		while(values_buffer[i].t == values_buffer[i+1].t) {
+		while(values_buffer[i].t == values_buffer[i+1].t && values_buffer[i].ms == values_buffer[i+1].ms) {
 			vals_for_ts++;   // j is the number of values with same t
 			i++;
 		}
@@ -261,6 +271,8 @@ void CBOR_CreateSendValues(values_buffer_t *values_buffer, uint16_t values_buffe
 void MQTT_FlushValues(void){
 
 	if (MQTT_GetFlags() == 1) {
+		// samples taken before the NTP sync are stamped from boot
+		PollEngine__RebaseValuesBuffer();
 		CBOR_CreateSendValues(PollEngine__GetValuesBuffer(), PollEngine__GetValuesBufferCount());
 		PollEngine__ResetValuesBuffer();
 	}
@@ -293,6 +305,11 @@ void MQTT_PeriodicTasks(void)
 		#endif
 		CBOR_SendStatus();
 		mqtt_status_time = RTC_Get_UTC_Current_Time();
+
+		#ifdef __CCL_COVERAGE_BIN
+		// new reached sites, if any, go out with the status
+		Cov__Report();
+		#endif
 	}
 
 	// send mobile payload only for 2G model every GW_MOBILE_TIME seconds (fixed)
@@ -306,7 +323,8 @@ void MQTT_PeriodicTasks(void)
 		}
 #ifdef GW_QUERY_RSSI
 		if(RTC_Get_UTC_Current_Time() > (query_rssi + GW_CSQ_TIME)) {
-			Sys__Delay(3000);	//this delay to hopefully complete previos qos1 publish
+			if (!Mobile__IsCmuxActive())
+				Sys__Delay(3000);	//this delay to hopefully complete previos qos1 publish
 			Mobile_QuerySignalQuality();
 			query_rssi = RTC_Get_UTC_Current_Time();
 		}
@@ -337,6 +355,47 @@ C_MQTT_TOPIC* MQTT_GetUuidTopic(C_SCHAR* topic)
 	return (C_MQTT_TOPIC*)mqtt_topic;
 }
 
+/**
+ * @brief MQTT_CmdExecutor
+ *        task that executes the requests queued by the EventHandler.
+ *        The polling is stopped only around the requests that need
+ *        the serial line (REQ_CLASS_BUS), the others run while it goes on
+ *
+ * @param  void *pvParameters
+ * @return none
+ */
+void MQTT_CmdExecutor(void *pvParameters)
+{
+	mqtt_cmd_t cmd;
+	int ret;
+	int previous_poll_engine_status;
+
+	while(1)
+	{
+		if (C_SUCCESS != mqtt_cmd_wait(&cmd))
+			continue;
+
+		if (REQ_CLASS_BUS == CBOR_GetReqClass(cmd.data, cmd.len))
+		{
+			previous_poll_engine_status = PollEngine_GetEngineStatus_CAREL();
+			PollEngine_StopEngine_CAREL();
+
+			ret = CBOR_ReqTopicParser(cmd.data, cmd.len);
+
+			if(previous_poll_engine_status == RUNNING && ret == 0)  // do not restart polling if the request restarts it by itself
+				PollEngine_StartEngine_CAREL();
+			P_COV_LN;
+		}
+		else
+		{
+			// START/STOP_ENGINE change the polling status by themselves
+			CBOR_ReqTopicParser(cmd.data, cmd.len);
+		}
+
+		free(cmd.data);
+	}
+}
+
 #ifdef INCLUDE_PLATFORM_DEPENDENT
 /**
  * @brief EventHandler
@@ -349,7 +408,6 @@ C_RES EventHandler(mqtt_event_handle_t event)
 {
 
 	int msg_id;
-	static int previous_poll_engine_status = STOPPED;
     switch (event->event_id) {
         case MQTT_EVENT_CONNECTED:
 
@@ -357,12 +415,23 @@ C_RES EventHandler(mqtt_event_handle_t event)
 
             #ifdef __DEBUG_MQTT_INTERFACE_LEV_2
             DEBUG_MQTT("MQTT_EVENT_CONNECTED");
+            DEBUG_MQTT("session present=%d", event->session_present);
             #endif
-            msg_id = mqtt_client_subscribe((C_SCHAR*)MQTT_GetUuidTopic("/req"), 0);
 
-            #ifdef __DEBUG_MQTT_INTERFACE_LEV_2
-            DEBUG_MQTT("sent subscribe successful, msg_id=%d", msg_id);
-            #endif
+            mqtt_client_tls_session_save();
+            WiFi__MqttConnected();
+
+#ifdef MQTT_PERSISTENT_SESSION
+            // the broker kept the subscription of the previous connection
+            if (0 == event->session_present)
+#endif
+            {
+            	msg_id = mqtt_client_subscribe((C_SCHAR*)MQTT_GetUuidTopic("/req"), 0);
+
+            	#ifdef __DEBUG_MQTT_INTERFACE_LEV_2
+            	DEBUG_MQTT("sent subscribe successful, msg_id=%d", msg_id);
+            	#endif
+            }
 
             if(2 == mqtt_init){
             	mqtt_init = 1;
@@ -397,6 +466,7 @@ C_RES EventHandler(mqtt_event_handle_t event)
 				mqtt_init = 1;
 			}
 
+            GME__PostEvent(GME_EVT_MQTT);
         	break;
 
         case MQTT_EVENT_DISCONNECTED:
@@ -406,6 +476,7 @@ C_RES EventHandler(mqtt_event_handle_t event)
         		mqtt_init = 2;
 
         	xEventGroupSetBits(s_mqtt_event_group, MQTT_DISCONNECTED_BIT);
+        	GME__PostEvent(GME_EVT_MQTT);
 
             #ifdef __DEBUG_MQTT_INTERFACE_LEV_2
             DEBUG_MQTT("MQTT_EVENT_DISCONNECTED");
@@ -449,10 +520,6 @@ C_RES EventHandler(mqtt_event_handle_t event)
             PRINTF_DEBUG("DATA=%.*s\r\n", event->data_len, event->data);
             #endif
 
-        	int ret = 0;
-            previous_poll_engine_status = PollEngine_GetEngineStatus_CAREL();
-            PollEngine_StopEngine_CAREL();
-
             C_GATEWAY_ID dev_id;
             Get_Gateway_ID(&dev_id);
 
@@ -472,11 +539,10 @@ C_RES EventHandler(mqtt_event_handle_t event)
                 #ifdef __DEBUG_MQTT_INTERFACE_LEV_1
 				PRINTF_DEBUG("/req found_topic\n");
                 #endif
-				ret = CBOR_ReqTopicParser((C_CHAR*)event->data, event->data_len);
+				// only queue the request, the MQTT task must not wait for the serial line
+				if (C_SUCCESS != mqtt_cmd_post((C_CHAR*)event->data, event->data_len))
+					CBOR_SendReqBusy((C_CHAR*)event->data, event->data_len);
 			}
-
-			if(previous_poll_engine_status == RUNNING && ret == 0)  // do not restart polling if received command was a stop polling
-				PollEngine_StartEngine_CAREL();
         }
             break;
         case MQTT_EVENT_ERROR:
@@ -15,15 +15,113 @@
 #include "data_types_CAREL.h"
 #include "MQTT_Interface_CAREL.h"
 #include "utilities_CAREL.h"
+#include "gme_config.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
 
 #ifdef INCLUDE_PLATFORM_DEPENDENT
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+
 static mqtt_client_handle_t mqtt_client;
+static QueueHandle_t mqtt_cmd_queue = NULL;
+
+#ifdef CONFIG_ESP_TLS_CLIENT_SESSION_TICKETS
+#include "esp_tls.h"
+#include "esp_attr.h"
+#include "esp32/rom/crc.h"
+
+#define MQTT_TLS_RTC_MAGIC		0x4D515454		// "MQTT"
+
+/**
+ * @brief mqtt_tls_rtc_t
+ *        copy of the TLS session in the RTC memory, it is not initialized
+ *        at reset so it survives a soft reboot but not a power cycle.
+ *        The heap pointers of the session are saved as NULL
+ */
+typedef struct mqtt_tls_rtc_s{
+	C_UINT32 magic;
+	C_UINT32 crc;						// from uri_crc to the end
+	C_UINT32 uri_crc;
+	C_UINT32 session_size;				// layout check after an update
+	mbedtls_ssl_session session;
+	C_UINT32 ticket_len;
+	C_BYTE ticket[MQTT_TLS_TICKET_MAX];
+}mqtt_tls_rtc_t;
+
+static RTC_NOINIT_ATTR mqtt_tls_rtc_t mqtt_tls_rtc;
+
+// session resumed by every connection to the broker
+static esp_tls_client_session_t mqtt_tls_session;
+static C_UINT32 mqtt_tls_uri_crc = 0;
+static C_BYTE mqtt_tls_init = 0;
+#endif
 #endif
 
 esp_mqtt_client_config_t mqtt_cfg;
 
 /* Functions implementations ------------------------------------------------------- */
 
+#if defined(INCLUDE_PLATFORM_DEPENDENT) && defined(CONFIG_ESP_TLS_CLIENT_SESSION_TICKETS)
+static C_UINT32 mqtt_tls_rtc_crc(void)
+{
+	return crc32_le(0, (const uint8_t*)&mqtt_tls_rtc.uri_crc, sizeof(mqtt_tls_rtc_t) - offsetof(mqtt_tls_rtc_t, uri_crc));
+}
+
+/**
+ * @brief mqtt_tls_session_restore
+ *        the first call takes the session saved before a soft reboot,
+ *        the copy is used only once and saved again when connected.
+ *        A session of another broker is discarded
+ *
+ * @param uri broker uri
+ * @return none
+ */
+static void mqtt_tls_session_restore(const C_CHAR *uri)
+{
+	C_UINT32 uri_crc = crc32_le(0, (const uint8_t*)uri, strlen(uri));
+
+	if (0 == mqtt_tls_init)
+	{
+		mqtt_tls_init = 1;
+		esp_tls_client_session_init(&mqtt_tls_session);
+
+		if ((MQTT_TLS_RTC_MAGIC == mqtt_tls_rtc.magic) &&
+			(sizeof(mbedtls_ssl_session) == mqtt_tls_rtc.session_size) &&
+			(mqtt_tls_rtc.ticket_len <= MQTT_TLS_TICKET_MAX) &&
+			(mqtt_tls_rtc_crc() == mqtt_tls_rtc.crc))
+		{
+			mbedtls_ssl_session *s = &mqtt_tls_session.saved_session;
+
+			memcpy((void*)s, (void*)&mqtt_tls_rtc.session, sizeof(mbedtls_ssl_session));
+			s->ticket_len = 0;
+			if (mqtt_tls_rtc.ticket_len > 0)
+			{
+				s->ticket = malloc(mqtt_tls_rtc.ticket_len);
+				if (s->ticket != NULL)
+				{
+					memcpy(s->ticket, mqtt_tls_rtc.ticket, mqtt_tls_rtc.ticket_len);
+					s->ticket_len = mqtt_tls_rtc.ticket_len;
+				}
+			}
+			mqtt_tls_session.valid = true;
+			mqtt_tls_uri_crc = mqtt_tls_rtc.uri_crc;
+			PRINTF_DEBUG_MQTT_INTERFACE_IS("TLS session restored\n");
+		}
+		mqtt_tls_rtc.magic = 0;
+	}
+
+	if (mqtt_tls_uri_crc != uri_crc)
+	{
+		esp_tls_client_session_free(&mqtt_tls_session);
+		mqtt_tls_uri_crc = uri_crc;
+	}
+}
+#endif
+
 
 
 /**
@@ -37,6 +135,10 @@ C_INT32 mqtt_client_subscribe(C_SCHAR *topic, C_INT16 qos)
 {
 	C_INT32 msg_id = C_FAIL;
 #ifdef INCLUDE_PLATFORM_DEPENDENT
+	// the acquisition can run before the client is created
+	if (NULL == MQTT__GetClient())
+		return C_FAIL;
+
 	msg_id = esp_mqtt_client_subscribe(MQTT__GetClient(), (C_SCHAR*)MQTT_GetUuidTopic("/req"), qos);
 #endif
 	return msg_id;
@@ -75,6 +177,10 @@ C_INT32 mqtt_client_publish(C_SCHAR *topic, C_SBYTE *data, C_INT16 len, C_INT16
 {
 	C_INT32 msg_id = C_FAIL;
 #ifdef INCLUDE_PLATFORM_DEPENDENT
+	// the acquisition can run before the client is created
+	if (NULL == MQTT__GetClient())
+		return C_FAIL;
+
 	msg_id = esp_mqtt_client_publish(MQTT__GetClient(), topic, (C_SCHAR*)data, len, qos, retain);
 #endif
 	return msg_id;
@@ -168,6 +274,13 @@ void* mqtt_client_init(mqtt_config_t* mqtt_cfg_nvm)
 		 mqtt_cfg.cert_pem = mqtt_cfg_nvm->cert_pem;
 		 mqtt_cfg.task_stack = 8192;
 		 mqtt_cfg.client_id = mac;
+#ifdef MQTT_PERSISTENT_SESSION
+		 mqtt_cfg.disable_clean_session = 1;
+#endif
+#ifdef CONFIG_ESP_TLS_CLIENT_SESSION_TICKETS
+		 mqtt_tls_session_restore(mqtt_cfg.uri);
+		 mqtt_cfg.tls_client_session = &mqtt_tls_session;
+#endif
 	
     mqtt_client = esp_mqtt_client_init(&mqtt_cfg);
 
@@ -177,6 +290,121 @@ void* mqtt_client_init(mqtt_config_t* mqtt_cfg_nvm)
 #endif
 }
 
+/**
+ * @brief mqtt_cmd_executor_start
+ *        create the request queue and the task that drains it,
+ *        only the first call has effect
+ * @param executor task body, it must loop on mqtt_cmd_wait
+ * @return C_SUCCESS/C_FAIL
+ */
+C_RES mqtt_cmd_executor_start(void (*executor)(void *))
+{
+#ifdef INCLUDE_PLATFORM_DEPENDENT
+	if (mqtt_cmd_queue != NULL)
+		return C_SUCCESS;
+
+	mqtt_cmd_queue = xQueueCreate(MQTT_CMD_QUEUE_LEN, sizeof(mqtt_cmd_t));
+	if (mqtt_cmd_queue == NULL)
+		return C_FAIL;
+
+	if (pdPASS != xTaskCreatePinnedToCore(executor, "MQTT_Cmd", MQTT_CMD_TASK_STACK_SIZE, NULL, MQTT_CMD_TASK_PRIO, NULL, GME_NET_CORE))
+	{
+		vQueueDelete(mqtt_cmd_queue);
+		mqtt_cmd_queue = NULL;
+		PRINTF_DEBUG_MQTT_INTERFACE_IS("MQTT_Cmd task not created\n");
+		return C_FAIL;
+	}
+#endif
+	return C_SUCCESS;
+}
+
+/**
+ * @brief mqtt_cmd_post
+ *        copy a request and queue it for the executor without blocking,
+ *        called from the MQTT event handler
+ * @param data request payload
+ * @param len  payload length
+ * @return C_FAIL if the executor is not running, no memory or queue full
+ */
+C_RES mqtt_cmd_post(const C_CHAR *data, C_UINT16 len)
+{
+#ifdef INCLUDE_PLATFORM_DEPENDENT
+	mqtt_cmd_t cmd;
+
+	if ((mqtt_cmd_queue == NULL) || (len == 0))
+		return C_FAIL;
+
+	cmd.data = malloc(len);
+	if (cmd.data == NULL)
+		return C_FAIL;
+
+	memcpy(cmd.data, data, len);
+	cmd.len = len;
+
+	if (pdTRUE != xQueueSend(mqtt_cmd_queue, &cmd, 0))
+	{
+		free(cmd.data);
+		PRINTF_DEBUG_MQTT_INTERFACE_IS("MQTT_Cmd queue full\n");
+		return C_FAIL;
+	}
+	return C_SUCCESS;
+#else
+	return C_FAIL;
+#endif
+}
+
+/**
+ * @brief mqtt_cmd_wait
+ *        block the executor until a request is queued,
+ *        the caller must free cmd->data when done
+ * @param cmd the received request
+ * @return C_SUCCESS/C_FAIL
+ */
+C_RES mqtt_cmd_wait(mqtt_cmd_t *cmd)
+{
+#ifdef INCLUDE_PLATFORM_DEPENDENT
+	if ((mqtt_cmd_queue != NULL) && (pdTRUE == xQueueReceive(mqtt_cmd_queue, cmd, portMAX_DELAY)))
+		return C_SUCCESS;
+#endif
+	return C_FAIL;
+}
+
+/**
+ * @brief mqtt_client_tls_session_save
+ *        copy the TLS session of the current connection in the RTC memory
+ *        to resume it after a soft reboot, called on connection
+ * @param None
+ * @return None
+ */
+void mqtt_client_tls_session_save(void)
+{
+#if defined(INCLUDE_PLATFORM_DEPENDENT) && defined(CONFIG_ESP_TLS_CLIENT_SESSION_TICKETS)
+	const mbedtls_ssl_session *s = &mqtt_tls_session.saved_session;
+
+	mqtt_tls_rtc.magic = 0;
+	if (!mqtt_tls_session.valid || (s->ticket_len > MQTT_TLS_TICKET_MAX))
+		return;
+
+	memcpy((void*)&mqtt_tls_rtc.session, (void*)s, sizeof(mbedtls_ssl_session));
+	mqtt_tls_rtc.session.peer_cert = NULL;
+	mqtt_tls_rtc.session.ticket = NULL;
+	mqtt_tls_rtc.session.ticket_len = 0;
+
+	memset((void*)mqtt_tls_rtc.ticket, 0, sizeof(mqtt_tls_rtc.ticket));
+	mqtt_tls_rtc.ticket_len = 0;
+	if (s->ticket != NULL)
+	{
+		memcpy(mqtt_tls_rtc.ticket, s->ticket, s->ticket_len);
+		mqtt_tls_rtc.ticket_len = s->ticket_len;
+	}
+
+	mqtt_tls_rtc.uri_crc = mqtt_tls_uri_crc;
+	mqtt_tls_rtc.session_size = sizeof(mbedtls_ssl_session);
+	mqtt_tls_rtc.crc = mqtt_tls_rtc_crc();
+	mqtt_tls_rtc.magic = MQTT_TLS_RTC_MAGIC;
+#endif
+}
+
 /**
  * @brief MQTT__GetClient
  *
@@ -57,8 +57,33 @@ typedef esp_mqtt_event_handle_t mqtt_event_handle_t;
 typedef esp_mqtt_client_handle_t mqtt_client_handle_t;
 #endif
 
+/**
+ * @brief mqtt_cmd_t
+ *        request received on /req waiting for the command executor,
+ *        data is a heap copy of the payload released by the executor
+ */
+typedef struct mqtt_cmd_s{
+	C_CHAR*  data;
+	C_UINT16 len;
+}mqtt_cmd_t;
+
 /* Exported constants --------------------------------------------------------*/
 
+/**
+ * @brief MQTT_CMD_QUEUE_LEN
+ *        max number of requests waiting for the command executor, when
+ *        full a new request is refused with ERROR_CMD
+ */
+#define MQTT_CMD_QUEUE_LEN          4
+#define MQTT_CMD_TASK_STACK_SIZE    8192
+#define MQTT_CMD_TASK_PRIO          CONFIG_GME_MQTT_CMD_TASK_PRIO
+
+/**
+ * @brief MQTT_TLS_TICKET_MAX
+ *        max size of the TLS session ticket kept across a soft reboot,
+ *        a longer ticket is resumed only until the reboot
+ */
+#define MQTT_TLS_TICKET_MAX         512
 
 
 /* Function prototypes -------------------------------------------------------*/
@@ -69,6 +94,10 @@ C_RES mqtt_client_start(void);
 C_RES mqtt_client_destroy(void);
 C_RES mqtt_client_stop(void);
 void* mqtt_client_init(mqtt_config_t* mqtt_cfg_nvm);
+C_RES mqtt_cmd_executor_start(void (*executor)(void *));
+C_RES mqtt_cmd_post(const C_CHAR *data, C_UINT16 len);
+C_RES mqtt_cmd_wait(mqtt_cmd_t *cmd);
+void mqtt_client_tls_session_save(void);
 #ifdef INCLUDE_PLATFORM_DEPENDENT
 mqtt_client_handle_t MQTT__GetClient (void);
 #endif
@@ -15,6 +15,8 @@
 #include "lwip/ip_addr.h"
 #include "lwip/err.h"
 #include "lwip/apps/sntp.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
 
 #endif
 /* Functions implementation -------------------------------------------------------*/
@@ -22,6 +24,63 @@
 C_TIME Boot_Time = 0;
 C_TIME MQTTConnect_Time = 0;
 
+// UTC - monotonic clock in us, updated at every NTP sync so the
+// scheduler never sees the steps of the system clock
+static int64_t Utc_Offset_us = 0;
+static C_BOOL Synced = C_FALSE;
+
+#ifdef INCLUDE_PLATFORM_DEPENDENT
+static portMUX_TYPE rtc_mux = portMUX_INITIALIZER_UNLOCKED;
+#define RTC_LOCK()		portENTER_CRITICAL(&rtc_mux)
+#define RTC_UNLOCK()	portEXIT_CRITICAL(&rtc_mux)
+#else
+#define RTC_LOCK()
+#define RTC_UNLOCK()
+#endif
+
+
+/**
+ * @brief RTC__UpdateOffset
+ *        take the UTC offset of the monotonic clock, called at every
+ *        sync of the system clock
+ *
+ * @param none
+ * @return none
+ */
+static void RTC__UpdateOffset(void)
+{
+  #ifdef INCLUDE_PLATFORM_DEPENDENT
+	struct timeval now_timeval;
+	int64_t offset;
+
+	gettimeofday(&now_timeval, NULL);
+	offset = ((int64_t)now_timeval.tv_sec * 1000000 + now_timeval.tv_usec) - esp_timer_get_time();
+
+	RTC_LOCK();
+	Utc_Offset_us = offset;
+	Synced = C_TRUE;
+	RTC_UNLOCK();
+  #endif
+}
+
+#ifdef INCLUDE_PLATFORM_DEPENDENT
+// SNTP keeps adjusting the system clock after the first sync
+static void RTC__SyncNotification(struct timeval *tv)
+{
+	RTC__UpdateOffset();
+}
+#endif
+
+static int64_t RTC__GetOffset(void)
+{
+	int64_t offset;
+
+	RTC_LOCK();
+	offset = Utc_Offset_us;
+	RTC_UNLOCK();
+	return offset;
+}
+
 /**
  * @brief RTC_Init
  *
@@ -41,6 +100,7 @@ C_RES RTC_Init(C_URI ntp_server, C_UINT16 ntp_port)
   sntp_stop();
   sntp_setoperatingmode(SNTP_OPMODE_POLL);
   sntp_setservername(0, ntp_server);
+  sntp_set_time_sync_notification_cb(RTC__SyncNotification);
   sntp_init();
   #endif
   
@@ -84,6 +144,7 @@ C_RES RTC_Sync(void)
         #ifdef __DEBUG_RTC_IS_LEV_2
 		PRINTF_DEBUG("got time: year:%d, month:%d, day:%d, hour:%d. minute:%d\n", timeinfo.tm_year, timeinfo.tm_mon, timeinfo.tm_mday, timeinfo.tm_hour, timeinfo.tm_min);
         #endif
+		RTC__UpdateOffset();
 		return C_SUCCESS;
 	}
 	else
@@ -112,6 +173,30 @@ C_TIME RTC_Get_UTC_Current_Time(void)
   
   return value;
 }
+
+/**
+ * @brief RTC_Get_UTC_Current_Time_ms
+ *        return the time in UTC format and the milliseconds of the second
+ *
+ * @param ms milliseconds 0-999, can be NULL
+ * @return C_TIME UTC Time
+ */
+C_TIME RTC_Get_UTC_Current_Time_ms(C_UINT16 *ms)
+{
+  C_TIME value = 0;
+  C_UINT16 value_ms = 0;
+
+  #ifdef INCLUDE_PLATFORM_DEPENDENT
+  struct timeval now_timeval;
+  gettimeofday(&now_timeval, NULL);
+  value = (uint32_t)now_timeval.tv_sec;
+  value_ms = (C_UINT16)(now_timeval.tv_usec / 1000);
+  #endif
+
+  if (ms != NULL)
+	  *ms = value_ms;
+  return value;
+}
   
   
 /**
@@ -169,3 +254,113 @@ C_TIME RTC_Get_UTC_MQTTConnect_Time(void)
 {
 	return MQTTConnect_Time;
 }
+
+
+/**
+ * @brief RTC_Get_Mono_us
+ *        return the us from boot, it is the clock of the scheduler
+ *        and it is never affected by the NTP sync
+ *
+ * @param none
+ * @return C_UINT64 us
+ */
+C_UINT64 RTC_Get_Mono_us(void)
+{
+	C_UINT64 value = 0;
+
+	#ifdef INCLUDE_PLATFORM_DEPENDENT
+	value = (C_UINT64)esp_timer_get_time();
+	#endif
+
+	return value;
+}
+
+
+/**
+ * @brief RTC_Get_Uptime
+ *        return the seconds from boot, not affected by the NTP sync
+ *
+ * @param none
+ * @return C_TIME seconds
+ */
+C_TIME RTC_Get_Uptime(void)
+{
+	return (C_TIME)(RTC_Get_Mono_us() / 1000000);
+}
+
+
+/**
+ * @brief RTC_Get_Uptime_ms
+ *        return the milliseconds from boot
+ *
+ * @param none
+ * @return C_UINT32 ms
+ */
+C_UINT32 RTC_Get_Uptime_ms(void)
+{
+	return (C_UINT32)(RTC_Get_Mono_us() / 1000);
+}
+
+
+/**
+ * @brief RTC_IsSynced
+ *        return if the time has been synchronized with NTP at least once
+ *
+ * @param none
+ * @return C_BOOL C_TRUE/C_FALSE
+ */
+C_BOOL RTC_IsSynced(void)
+{
+	return Synced;
+}
+
+
+/**
+ * @brief RTC_Mono_To_Sample_Time
+ *        convert a time of the monotonic clock in the stamp of a sample,
+ *        the UTC time once synchronized otherwise the seconds from boot.
+ *        A soft reboot does not reset the system clock, so before the
+ *        sync it can't be told from UTC
+ *
+ * @param mono_us time taken with RTC_Get_Mono_us
+ * @param ms milliseconds 0-999, can be NULL
+ * @return C_TIME UTC Time or seconds from boot
+ */
+C_TIME RTC_Mono_To_Sample_Time(C_UINT64 mono_us, C_UINT16 *ms)
+{
+	int64_t t_us = (int64_t)mono_us;
+
+	if (C_TRUE == Synced)
+		t_us += RTC__GetOffset();
+
+	if (ms != NULL)
+		*ms = (C_UINT16)((t_us / 1000) % 1000);
+
+	return (C_TIME)(t_us / 1000000);
+}
+
+
+/**
+ * @brief RTC_Rebase_Sample_Time
+ *        convert to UTC a stamp taken with RTC_Mono_To_Sample_Time
+ *        before the NTP sync, it is returned unchanged if already UTC
+ *        or if the sync is not done yet
+ *
+ * @param C_TIME t
+ * @param ms milliseconds 0-999, updated with t, can be NULL
+ * @return C_TIME UTC Time
+ */
+C_TIME RTC_Rebase_Sample_Time(C_TIME t, C_UINT16 *ms)
+{
+	int64_t t_ms;
+
+	if ((C_FALSE == Synced) || (t >= RTC_UTC_VALID_MIN))
+		return t;
+
+	t_ms = (int64_t)t * 1000 + ((ms != NULL) ? *ms : 0) + RTC__GetOffset() / 1000;
+
+	if (ms != NULL)
+		*ms = (C_UINT16)(t_ms % 1000);
+
+	return (C_TIME)(t_ms / 1000);
+}
@@ -46,6 +46,12 @@
 
 /* Exported constants --------------------------------------------------------*/
 
+/**
+ * @brief RTC_UTC_VALID_MIN
+ *        a time below this (1 Jan 2020) is not an UTC time, the samples
+ *        taken before the NTP sync are stamped with the seconds from boot
+ */
+#define RTC_UTC_VALID_MIN		1577836800
 
 
 /* Function prototypes -------------------------------------------------------*/
@@ -59,6 +65,15 @@ void RTC_Set_UTC_Boot_Time(void);
 C_TIME RTC_Get_UTC_MQTTConnect_Time(void);
 void RTC_Set_UTC_MQTTConnect_Time(void);
 
+C_TIME RTC_Get_UTC_Current_Time_ms(C_UINT16 *ms);
+
+C_UINT64 RTC_Get_Mono_us(void);
+C_TIME RTC_Get_Uptime(void);
+C_UINT32 RTC_Get_Uptime_ms(void);
+C_BOOL RTC_IsSynced(void);
+C_TIME RTC_Mono_To_Sample_Time(C_UINT64 mono_us, C_UINT16 *ms);
+C_TIME RTC_Rebase_Sample_Time(C_TIME t, C_UINT16 *ms);
+
 #ifdef __cplusplus
 }
 #endif
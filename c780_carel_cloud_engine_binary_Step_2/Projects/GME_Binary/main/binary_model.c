@@ -14,6 +14,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/stat.h>
 
 #include "binary_model.h"
 
@@ -68,6 +69,27 @@ static  uint8_t   *p_ir_alarm_sect;
 
 bool valid_model;
 
+/**
+ * @brief MODEL_CRC_CHUNK
+ *        size of the buffer used to compute the crc of the model file
+ *        without loading the whole file
+ */
+#define MODEL_CRC_CHUNK		128
+
+/**
+ * @brief model_crc_cache_t
+ *        crc of the last validated model, stored in NVM (MODEL_CRC_NVM)
+ *        it is valid until size and modification time of the file don't change
+ */
+typedef struct{
+	uint32_t size;
+	uint32_t mtime;
+	uint16_t crc;
+}model_crc_cache_t;
+
+static model_crc_cache_t crc_cache;
+static bool crc_cache_loaded = FALSE;
+
 
 #if WANT_DUMP_MODEL
 
@@ -319,66 +341,6 @@ static void dump_ir_alarm(void)
 
 
 
-/*
- CRC Function (for Modbus RTU with 16bit)
-*/
-uint16_t CRC16(const uint8_t *nData, uint16_t wLength)
-{
-	static const u_int wCRCTable[] = {
-	0X0000, 0XC0C1, 0XC181, 0X0140, 0XC301, 0X03C0, 0X0280, 0XC241,
-	0XC601, 0X06C0, 0X0780, 0XC741, 0X0500, 0XC5C1, 0XC481, 0X0440,
-	0XCC01, 0X0CC0, 0X0D80, 0XCD41, 0X0F00, 0XCFC1, 0XCE81, 0X0E40,
-	0X0A00, 0XCAC1, 0XCB81, 0X0B40, 0XC901, 0X09C0, 0X0880, 0XC841,
-	0XD801, 0X18C0, 0X1980, 0XD941, 0X1B00, 0XDBC1, 0XDA81, 0X1A40,
-	0X1E00, 0XDEC1, 0XDF81, 0X1F40, 0XDD01, 0X1DC0, 0X1C80, 0XDC41,
-	0X1400, 0XD4C1, 0XD581, 0X1540, 0XD701, 0X17C0, 0X1680, 0XD641,
-	0XD201, 0X12C0, 0X1380, 0XD341, 0X1100, 0XD1C1, 0XD081, 0X1040,
-	0XF001, 0X30C0, 0X3180, 0XF141, 0X3300, 0XF3C1, 0XF281, 0X3240,
-	0X3600, 0XF6C1, 0XF781, 0X3740, 0XF501, 0X35C0, 0X3480, 0XF441,
-	0X3C00, 0XFCC1, 0XFD81, 0X3D40, 0XFF01, 0X3FC0, 0X3E80, 0XFE41,
-	0XFA01, 0X3AC0, 0X3B80, 0XFB41, 0X3900, 0XF9C1, 0XF881, 0X3840,
-	0X2800, 0XE8C1, 0XE981, 0X2940, 0XEB01, 0X2BC0, 0X2A80, 0XEA41,
-	0XEE01, 0X2EC0, 0X2F80, 0XEF41, 0X2D00, 0XEDC1, 0XEC81, 0X2C40,
-	0XE401, 0X24C0, 0X2580, 0XE541, 0X2700, 0XE7C1, 0XE681, 0X2640,
-	0X2200, 0XE2C1, 0XE381, 0X2340, 0XE101, 0X21C0, 0X2080, 0XE041,
-	0XA001, 0X60C0, 0X6180, 0XA141, 0X6300, 0XA3C1, 0XA281, 0X6240,
-	0X6600, 0XA6C1, 0XA781, 0X6740, 0XA501, 0X65C0, 0X6480, 0XA441,
-	0X6C00, 0XACC1, 0XAD81, 0X6D40, 0XAF01, 0X6FC0, 0X6E80, 0XAE41,
-	0XAA01, 0X6AC0, 0X6B80, 0XAB41, 0X6900, 0XA9C1, 0XA881, 0X6840,
-	0X7800, 0XB8C1, 0XB981, 0X7940, 0XBB01, 0X7BC0, 0X7A80, 0XBA41,
-	0XBE01, 0X7EC0, 0X7F80, 0XBF41, 0X7D00, 0XBDC1, 0XBC81, 0X7C40,
-	0XB401, 0X74C0, 0X7580, 0XB541, 0X7700, 0XB7C1, 0XB681, 0X7640,
-	0X7200, 0XB2C1, 0XB381, 0X7340, 0XB101, 0X71C0, 0X7080, 0XB041,
-	0X5000, 0X90C1, 0X9181, 0X5140, 0X9301, 0X53C0, 0X5280, 0X9241,
-	0X9601, 0X56C0, 0X5780, 0X9741, 0X5500, 0X95C1, 0X9481, 0X5440,
-	0X9C01, 0X5CC0, 0X5D80, 0X9D41, 0X5F00, 0X9FC1, 0X9E81, 0X5E40,
-	0X5A00, 0X9AC1, 0X9B81, 0X5B40, 0X9901, 0X59C0, 0X5880, 0X9841,
-	0X8801, 0X48C0, 0X4980, 0X8941, 0X4B00, 0X8BC1, 0X8A81, 0X4A40,
-	0X4E00, 0X8EC1, 0X8F81, 0X4F40, 0X8D01, 0X4DC0, 0X4C80, 0X8C41,
-	0X4400, 0X84C1, 0X8581, 0X4540, 0X8701, 0X47C0, 0X4680, 0X8641,
-	0X8201, 0X42C0, 0X4380, 0X8341, 0X4100, 0X81C1, 0X8081, 0X4040 };
-
-	uint8_t nTemp;
-	uint16_t wCRCWord = 0xFFFF;
-
-
-	while (wLength)
-	{
-		nTemp = *nData++ ^ wCRCWord;
-		wCRCWord >>= 8;
-		wCRCWord ^= wCRCTable[nTemp];
-
-		//PRINTF_DEBUG("CRC %d - %X \r\n", wLength, wCRCWord);
-
-		wLength--;
-	}
-
-
-	return wCRCWord;
-
-}
-
-
 /**
  * @brief get_model_pointers
  *        return the pointers to the model structure in memory
@@ -538,6 +500,124 @@ uint8_t* BinaryModel_GetChunk(long sz){
 }
 
 
+/**
+ * @brief model_file_stat
+ *        size and modification time of the model file
+ *
+ * @param  model_crc_cache_t *info (crc not touched)
+ * @return C_SUCCESS/C_FAIL
+ */
+static C_RES model_file_stat(model_crc_cache_t *info)
+{
+	struct stat st;
+
+	if (stat(MODEL_FILE, &st) != 0)
+		return C_FAIL;
+
+	info->size = (uint32_t)st.st_size;
+	info->mtime = (uint32_t)st.st_mtime;
+	return C_SUCCESS;
+}
+
+/**
+ * @brief model_crc_cached
+ *        check if the cached crc belongs to the model file on board
+ *
+ * @param  none
+ * @return TRUE if the cache is valid
+ */
+static bool model_crc_cached(void)
+{
+	model_crc_cache_t info;
+	size_t len = sizeof(model_crc_cache_t);
+
+	if (model_file_stat(&info) != C_SUCCESS)
+		return FALSE;
+
+	if (!crc_cache_loaded)
+	{
+		if (NVM__ReadBlob(MODEL_CRC_NVM, (void*)&crc_cache, &len) != C_SUCCESS || len != sizeof(model_crc_cache_t))
+			return FALSE;
+		crc_cache_loaded = TRUE;
+	}
+
+	return ((crc_cache.size == info.size) && (crc_cache.mtime == info.mtime)) ? TRUE : FALSE;
+}
+
+/**
+ * @brief model_file_crc
+ *        compute the crc of the model file reading it in small chunks
+ *
+ * @param  long sz size of the file
+ * @param  uint16_t *calc crc computed
+ * @param  uint16_t *stored crc stored in the last 2 bytes of the file
+ * @return C_SUCCESS/C_FAIL
+ */
+static C_RES model_file_crc(long sz, uint16_t *calc, uint16_t *stored)
+{
+	uint8_t buf[MODEL_CRC_CHUNK];
+	uint16_t crc = CRC16_INIT;
+	long left = sz - 2;
+	size_t n;
+	FILE *fp;
+
+	if (sz <= 2)
+		return C_FAIL;
+
+	fp = fopen(MODEL_FILE, "rb");
+	if (fp == NULL)
+		return C_FAIL;
+
+	while (left > 0)
+	{
+		n = (left > MODEL_CRC_CHUNK) ? MODEL_CRC_CHUNK : (size_t)left;
+		if (fread(buf, sizeof(uint8_t), n, fp) != n)
+		{
+			fclose(fp);
+			return C_FAIL;
+		}
+		crc = CRC16_Update(crc, buf, n);
+		left -= n;
+	}
+
+	if (fread(buf, sizeof(uint8_t), 2, fp) != 2)
+	{
+		fclose(fp);
+		return C_FAIL;
+	}
+	fclose(fp);
+
+	*calc = crc;
+	*stored = (buf[0] & 0x00FF) | ((uint16_t)buf[1] << 8);
+	return C_SUCCESS;
+}
+
+/**
+ * @brief BinaryModel_SetCrcCache
+ *        save the crc of the model file just validated, the next checks
+ *        don't need to read the file until it changes
+ *
+ * @param  uint16_t crc
+ * @return none
+ */
+void BinaryModel_SetCrcCache(uint16_t crc)
+{
+	model_crc_cache_t info;
+
+	if (model_file_stat(&info) != C_SUCCESS)
+		return;
+
+	info.crc = crc;
+
+	if ((crc_cache_loaded == TRUE) && (memcmp(&info, &crc_cache, sizeof(model_crc_cache_t)) == 0))
+		return;
+
+	crc_cache = info;
+	crc_cache_loaded = TRUE;
+	NVM__WriteBlob(MODEL_CRC_NVM, (void*)&crc_cache, sizeof(model_crc_cache_t));
+	P_COV_LN;
+}
+
 /**
  * @brief BinaryModel_GetCrc
  *        calculate the CRC of the binary model
@@ -545,17 +625,21 @@ uint8_t* BinaryModel_GetChunk(long sz){
  * @return the crc value
  */
 uint16_t BinaryModel_GetCrc(void){
-	uint16_t Crc;
-	
+	uint16_t Crc, ModelCrc;
+
+	if (model_crc_cached())
+		return crc_cache.crc;
+
 	long sz = filesize(MODEL_FILE);
 	if(sz <= 0)
 		return 0;
 
-	uint8_t* chunk = BinaryModel_GetChunk(sz);
+	if (model_file_crc(sz, &Crc, &ModelCrc) != C_SUCCESS)
+		return 0;
 
-	Crc = CRC16(chunk, sz-2);
+	if (Crc == ModelCrc)
+		BinaryModel_SetCrcCache(Crc);
 
-	free(chunk);
 	P_COV_LN;
 	return Crc;
 }
@@ -567,23 +651,23 @@ uint16_t BinaryModel_GetCrc(void){
  * @return C_SUCCESS/C_FAIL
  */
 C_RES BinaryModel_CheckCrc(void){
-	uint16_t Crc;
+	uint16_t Crc, ModelCrc;
+
+	if (model_crc_cached())
+		return C_SUCCESS;
 
 	long sz = filesize(MODEL_FILE);
 	if(sz <= 0)
 		return C_FAIL;
-	uint8_t* chunk = BinaryModel_GetChunk(sz);
 
-	// calcolo del crc
-	Crc = CRC16(chunk, sz-2);
-	//Read crc
-	uint16_t ModelCrc = ((*(chunk + sz - 2)) & 0x00FF)|
-               ((uint16_t)(*(chunk + sz - 1)))<<8;
+	if (model_file_crc(sz, &Crc, &ModelCrc) != C_SUCCESS)
+		return C_FAIL;
 
-	free(chunk);
 	P_COV_LN;
-	if (Crc == ModelCrc) 
+	if (Crc == ModelCrc) {
+		BinaryModel_SetCrcCache(Crc);
 		return C_SUCCESS;
+	}
 	else
 		return C_FAIL;
 }
@@ -659,6 +743,8 @@ int BinaryModel_Init (void)
 
 	free(chunk);
 
+	BinaryModel_SetCrcCache(Crc);
+
 	valid_model = TRUE;
 	P_COV_LN;
 	return C_SUCCESS;
@@ -14,6 +14,7 @@
 #include "types.h"
 #include "common.h"
 #include "data_types_CAREL.h"
+#include "crc16_CAREL.h"
 
 /* ========================================================================== */
 /* typedefs and defines                                                       */
@@ -97,7 +98,7 @@ typedef union flag_s{
 		uint8_t  bit1:1;
 		uint8_t  ieee:1;
 		uint8_t  bit3:1;
-		uint8_t  bit4:1;
+		uint8_t  aggregate:1;	// sent as aggregate of the window (see POLL_AGG)
 		uint8_t  bit5:1;
 		uint8_t  signed_f:1;
 		uint8_t  bigendian:1;
@@ -148,7 +149,6 @@ typedef enum{
 	MAX_REG,
 }RegType_t;
 
-uint16_t CRC16(const uint8_t *nData, uint16_t wLength);
 int BinaryModel_Init (void);
 //int BinaryModel__GetNum(PollType_t polling_type, RegType_t reg_type);
 uint8_t* get_p_coil_alarm_sect (void);
@@ -159,6 +159,7 @@ uint16_t BinaryModel_CalcModelCrc(void);
 uint8_t* BinaryModel_GetChunk(long sz);
 uint16_t BinaryModel_GetCrc(void);
 C_RES BinaryModel_CheckCrc(void);
+void BinaryModel_SetCrcCache(uint16_t crc);
 
 bool CheckModelValidity(void);
 
@@ -48,4 +48,5 @@
 TaskHandle_t SM__GetTask();
 void GME__Reboot(void);
 void GME__CheckHTMLConfig(void);
+void GME__PostEvent(C_UINT32 events);
 #endif /* COMMON_H_ */
@@ -0,0 +1,262 @@
+/**
+ * @file   coverage_CAREL.c
+ * @author carel
+ * @date   18 Oct 2026
+ * @brief  binary backend of the coverage test and trace ring,
+ *         see coverage_CAREL.h
+ *
+ */
+
+#include "CAREL_GLOBAL_DEF.h"
+
+#ifdef __CCL_COVERAGE_BIN
+
+#include <stdio.h>
+#include <string.h>
+#include "coverage_CAREL.h"
+#include "MQTT_Interface_IS.h"
+#include "MQTT_Interface_CAREL.h"
+
+#ifdef INCLUDE_PLATFORM_DEPENDENT
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_timer.h"
+#endif
+
+#define COV_TRACE_MARK		"!#T"
+
+typedef struct cov_trace_s{
+	C_UINT32 t_us;
+	cov_unit_t *unit;
+	C_UINT16 line;
+}cov_trace_t;
+
+static cov_unit_t *cov_units = NULL;
+static C_BYTE cov_dirty = 0;
+
+#ifdef __CCL_TRACE_RING
+static cov_trace_t cov_trace[COV_TRACE_LEN];
+static C_UINT32 cov_trace_head = 0;			// total number of hits, wraps
+#endif
+
+#ifdef INCLUDE_PLATFORM_DEPENDENT
+static portMUX_TYPE cov_mux = portMUX_INITIALIZER_UNLOCKED;
+#define COV_LOCK()		portENTER_CRITICAL(&cov_mux)
+#define COV_UNLOCK()	portEXIT_CRITICAL(&cov_mux)
+#else
+#define COV_LOCK()
+#define COV_UNLOCK()
+#endif
+
+
+/**
+ * @brief Cov__FirstHit
+ *        mark a site as reached, called only the first time
+ *
+ * @param  cov_unit_t *unit
+ * @param  C_UINT16 id   the site
+ * @param  C_UINT16 line
+ * @return none
+ */
+void Cov__FirstHit(cov_unit_t *unit, C_UINT16 id, C_UINT16 line)
+{
+	COV_LOCK();
+	unit->line[id] = line;
+	unit->bits[id >> 3] |= (C_BYTE)(1 << (id & 7));
+	if (!unit->linked)
+	{
+		unit->linked = 1;
+		unit->next = cov_units;
+		cov_units = unit;
+	}
+	cov_dirty = 1;
+	COV_UNLOCK();
+}
+
+/**
+ * @brief Cov__Trace
+ *        save a hit with its timestamp in the ring
+ *
+ * @param  cov_unit_t *unit
+ * @param  C_UINT16 line
+ * @return none
+ */
+void Cov__Trace(cov_unit_t *unit, C_UINT16 line)
+{
+#ifdef __CCL_TRACE_RING
+	cov_trace_t *ev;
+	C_UINT32 t_us = 0;
+
+#ifdef INCLUDE_PLATFORM_DEPENDENT
+	t_us = (C_UINT32)esp_timer_get_time();
+#endif
+
+	COV_LOCK();
+	ev = &cov_trace[cov_trace_head % COV_TRACE_LEN];
+	cov_trace_head++;
+	ev->t_us = t_us;
+	ev->unit = unit;
+	ev->line = line;
+	COV_UNLOCK();
+#endif
+}
+
+/**
+ * @brief Cov__ExportStart
+ *        prepare an export of the reached sites and of the trace ring
+ *
+ * @param  cov_cursor_t *cur
+ * @return none
+ */
+void Cov__ExportStart(cov_cursor_t *cur)
+{
+	memset((void*)cur, 0, sizeof(cov_cursor_t));
+	cur->unit = cov_units;
+
+#ifdef __CCL_TRACE_RING
+	COV_LOCK();
+	if (cov_trace_head > COV_TRACE_LEN)
+	{
+		cur->trace_num = COV_TRACE_LEN;
+		cur->trace_first = (C_UINT16)(cov_trace_head % COV_TRACE_LEN);
+	}
+	else
+	{
+		cur->trace_num = (C_UINT16)cov_trace_head;
+		cur->trace_first = 0;
+	}
+	COV_UNLOCK();
+#endif
+}
+
+/**
+ * @brief Cov__ExportDeltaStart
+ *        prepare an export of the sites reached since the last delta
+ *        export, without the trace ring
+ *
+ * @param  cov_cursor_t *cur
+ * @return none
+ */
+void Cov__ExportDeltaStart(cov_cursor_t *cur)
+{
+	memset((void*)cur, 0, sizeof(cov_cursor_t));
+	cur->unit = cov_units;
+	cur->delta = 1;
+}
+
+/**
+ * @brief Cov__Export
+ *        fill buf with the next lines of the export, only whole lines
+ *        are written. The reached sites use the FWCoverageTool format
+ *        "!#!|file|line|", the trace events "!#T|t_us|file|line|"
+ *        (ignored by the tool) oldest first.
+ *        In a delta export the written sites are marked as sent
+ *
+ * @param  cov_cursor_t *cur
+ * @param  C_CHAR *buf
+ * @param  C_UINT32 size
+ * @return C_UINT32 number of bytes written, 0 at the end of the export
+ */
+C_UINT32 Cov__Export(cov_cursor_t *cur, C_CHAR *buf, C_UINT32 size)
+{
+	C_CHAR line[96];
+	C_UINT32 len = 0;
+	int n;
+
+	while (1)
+	{
+		// the cursor is moved only once the line has been written
+		if (cur->unit != NULL)
+		{
+			if (cur->site >= COV_UNIT_SITES)
+			{
+				cur->unit = cur->unit->next;
+				cur->site = 0;
+				continue;
+			}
+			if (!(cur->unit->bits[cur->site >> 3] & (1 << (cur->site & 7))) ||
+			    (cur->delta && (cur->unit->sent[cur->site >> 3] & (1 << (cur->site & 7)))))
+			{
+				cur->site++;
+				continue;
+			}
+			n = snprintf(line, sizeof(line), "%s|%s|%d|\r\n", COV_MARK, cur->unit->file, cur->unit->line[cur->site]);
+		}
+#ifdef __CCL_TRACE_RING
+		else if (cur->trace < cur->trace_num)
+		{
+			cov_trace_t *ev = &cov_trace[(cur->trace_first + cur->trace) % COV_TRACE_LEN];
+			n = snprintf(line, sizeof(line), "%s|%u|%s|%d|\r\n", COV_TRACE_MARK, (unsigned)ev->t_us, ev->unit->file, ev->line);
+		}
+#endif
+		else
+			break;
+
+		if (n < 0)
+			n = 0;
+		if (n >= (int)sizeof(line))
+			n = sizeof(line) - 1;
+		if ((len + n) > size)
+			break;
+
+		memcpy(buf + len, line, n);
+		len += n;
+
+		if ((cur->unit != NULL) && cur->delta)
+			cur->unit->sent[cur->site >> 3] |= (C_BYTE)(1 << (cur->site & 7));
+
+		if (cur->unit != NULL)
+			cur->site++;
+		else
+			cur->trace++;
+	}
+
+	return len;
+}
+
+/**
+ * @brief Cov__DumpConsole
+ *        print the whole export on the debug console
+ *
+ * @param  none
+ * @return none
+ */
+void Cov__DumpConsole(void)
+{
+	static C_CHAR chunk[256];
+	cov_cursor_t cur;
+	C_UINT32 len;
+
+	Cov__ExportStart(&cur);
+	while ((len = Cov__Export(&cur, chunk, sizeof(chunk))) > 0)
+		printf("%.*s", (int)len, chunk);
+}
+
+/**
+ * @brief Cov__Report
+ *        if new sites have been reached since the last report send
+ *        only them on the console and on the /cov MQTT topic, the
+ *        whole export is on http://<gme>/cov.txt
+ *
+ * @param  none
+ * @return none
+ */
+void Cov__Report(void)
+{
+	static C_CHAR chunk[COV_MQTT_CHUNK];
+	cov_cursor_t cur;
+	C_UINT32 len;
+
+	if (!cov_dirty)
+		return;
+	cov_dirty = 0;
+
+	Cov__ExportDeltaStart(&cur);
+	while ((len = Cov__Export(&cur, chunk, sizeof(chunk))) > 0)
+	{
+		printf("%.*s", (int)len, chunk);
+		mqtt_client_publish((C_SCHAR*)MQTT_GetUuidTopic("/cov"), (C_SBYTE*)chunk, len, QOS_0, NO_RETAIN);
+	}
+}
+
+#endif /* __CCL_COVERAGE_BIN */
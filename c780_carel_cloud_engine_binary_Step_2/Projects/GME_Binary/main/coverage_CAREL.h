@@ -0,0 +1,92 @@
+/**
+ * @file   coverage_CAREL.h
+ * @author carel
+ * @date   18 Oct 2026
+ * @brief  binary backend of the coverage test (P_COV_LN), every site
+ *         sets a bit in RAM instead of printing a line, the result is
+ *         exported in the FWCoverageTool format on request.
+ *         Optionally (__CCL_TRACE_RING) the last hits are kept with
+ *         their timestamp.
+ *
+ */
+
+/* Define to prevent recursive inclusion */
+#ifndef COVERAGE_CAREL_H_
+#define COVERAGE_CAREL_H_
+
+/* ==== Include ==== */
+#include "data_types_CAREL.h"
+
+/* ==== Define customizable ==== */
+
+/* max number of P_COV_LN of a single source file */
+#define COV_UNIT_SITES		128
+
+/* number of hits kept by the trace ring */
+#define COV_TRACE_LEN		256
+
+/* max size of a coverage MQTT message */
+#define COV_MQTT_CHUNK		1024
+
+/* ==== Types ==== */
+
+/**
+ * @brief cov_unit_t
+ *        coverage of a source file, the site id is given by __COUNTER__,
+ *        the line of a site is saved the first time it is reached
+ */
+typedef struct cov_unit_s{
+	const char *file;
+	struct cov_unit_s *next;
+	C_BYTE linked;
+	C_BYTE bits[COV_UNIT_SITES / 8];
+	C_BYTE sent[COV_UNIT_SITES / 8];		// already sent by Cov__Report
+	C_UINT16 line[COV_UNIT_SITES];
+}cov_unit_t;
+
+/**
+ * @brief cov_cursor_t
+ *        position of an export in progress
+ */
+typedef struct cov_cursor_s{
+	cov_unit_t *unit;
+	C_UINT16 site;
+	C_UINT16 trace;
+	C_UINT16 trace_num;
+	C_UINT16 trace_first;
+	C_BYTE delta;							// only the sites not yet sent
+}cov_cursor_t;
+
+/* ==== Function prototype ==== */
+void Cov__FirstHit(cov_unit_t *unit, C_UINT16 id, C_UINT16 line);
+void Cov__Trace(cov_unit_t *unit, C_UINT16 line);
+
+void Cov__ExportStart(cov_cursor_t *cur);
+void Cov__ExportDeltaStart(cov_cursor_t *cur);
+C_UINT32 Cov__Export(cov_cursor_t *cur, C_CHAR *buf, C_UINT32 size);
+void Cov__DumpConsole(void);
+void Cov__Report(void);
+
+/* ==== Instrumentation ==== */
+
+/* one unit for each source file, __BASE_FILE__ is the .c file also when
+   expanded here, the unit is dropped by the compiler if never used */
+static cov_unit_t cov_unit __attribute__((unused)) = { .file = __BASE_FILE__ };
+
+#ifdef __CCL_TRACE_RING
+	#define COV_TRACE(ln)		Cov__Trace(&cov_unit, (ln))
+#else
+	#define COV_TRACE(ln)
+#endif
+
+/* the id is a constant so the test is a single load and mask, the call
+   is done only the first time the site is reached. A file with more than
+   COV_UNIT_SITES sites doesn't build, raise COV_UNIT_SITES */
+#define COV_HIT(id, ln)		do { \
+		_Static_assert((id) < COV_UNIT_SITES, "too many P_COV_LN in this file, raise COV_UNIT_SITES"); \
+		if (!(cov_unit.bits[(id) >> 3] & (1 << ((id) & 7)))) \
+			Cov__FirstHit(&cov_unit, (id), (ln)); \
+		COV_TRACE(ln); \
+	} while(0)
+
+#endif /* COVERAGE_CAREL_H_ */
@@ -0,0 +1,201 @@
+/**
+ * @file   crc16_CAREL.c
+ * @author carel
+ * @date   18 Oct 2026
+ * @brief  modbus CRC16 (of the frames, of the model and of the files)
+ */
+
+#include "crc16_CAREL.h"
+
+/*
+ CRC Function (for Modbus RTU with 16bit)
+ slicing-by-4 tables, wCRCTable[k][b] is the crc of the byte b followed by k zero bytes
+ wCRCTable[0] is the classic byte-wise table
+*/
+static const uint16_t wCRCTable[4][256] = {
+	{
+	0X0000, 0XC0C1, 0XC181, 0X0140, 0XC301, 0X03C0, 0X0280, 0XC241,
+	0XC601, 0X06C0, 0X0780, 0XC741, 0X0500, 0XC5C1, 0XC481, 0X0440,
+	0XCC01, 0X0CC0, 0X0D80, 0XCD41, 0X0F00, 0XCFC1, 0XCE81, 0X0E40,
+	0X0A00, 0XCAC1, 0XCB81, 0X0B40, 0XC901, 0X09C0, 0X0880, 0XC841,
+	0XD801, 0X18C0, 0X1980, 0XD941, 0X1B00, 0XDBC1, 0XDA81, 0X1A40,
+	0X1E00, 0XDEC1, 0XDF81, 0X1F40, 0XDD01, 0X1DC0, 0X1C80, 0XDC41,
+	0X1400, 0XD4C1, 0XD581, 0X1540, 0XD701, 0X17C0, 0X1680, 0XD641,
+	0XD201, 0X12C0, 0X1380, 0XD341, 0X1100, 0XD1C1, 0XD081, 0X1040,
+	0XF001, 0X30C0, 0X3180, 0XF141, 0X3300, 0XF3C1, 0XF281, 0X3240,
+	0X3600, 0XF6C1, 0XF781, 0X3740, 0XF501, 0X35C0, 0X3480, 0XF441,
+	0X3C00, 0XFCC1, 0XFD81, 0X3D40, 0XFF01, 0X3FC0, 0X3E80, 0XFE41,
+	0XFA01, 0X3AC0, 0X3B80, 0XFB41, 0X3900, 0XF9C1, 0XF881, 0X3840,
+	0X2800, 0XE8C1, 0XE981, 0X2940, 0XEB01, 0X2BC0, 0X2A80, 0XEA41,
+	0XEE01, 0X2EC0, 0X2F80, 0XEF41, 0X2D00, 0XEDC1, 0XEC81, 0X2C40,
+	0XE401, 0X24C0, 0X2580, 0XE541, 0X2700, 0XE7C1, 0XE681, 0X2640,
+	0X2200, 0XE2C1, 0XE381, 0X2340, 0XE101, 0X21C0, 0X2080, 0XE041,
+	0XA001, 0X60C0, 0X6180, 0XA141, 0X6300, 0XA3C1, 0XA281, 0X6240,
+	0X6600, 0XA6C1, 0XA781, 0X6740, 0XA501, 0X65C0, 0X6480, 0XA441,
+	0X6C00, 0XACC1, 0XAD81, 0X6D40, 0XAF01, 0X6FC0, 0X6E80, 0XAE41,
+	0XAA01, 0X6AC0, 0X6B80, 0XAB41, 0X6900, 0XA9C1, 0XA881, 0X6840,
+	0X7800, 0XB8C1, 0XB981, 0X7940, 0XBB01, 0X7BC0, 0X7A80, 0XBA41,
+	0XBE01, 0X7EC0, 0X7F80, 0XBF41, 0X7D00, 0XBDC1, 0XBC81, 0X7C40,
+	0XB401, 0X74C0, 0X7580, 0XB541, 0X7700, 0XB7C1, 0XB681, 0X7640,
+	0X7200, 0XB2C1, 0XB381, 0X7340, 0XB101, 0X71C0, 0X7080, 0XB041,
+	0X5000, 0X90C1, 0X9181, 0X5140, 0X9301, 0X53C0, 0X5280, 0X9241,
+	0X9601, 0X56C0, 0X5780, 0X9741, 0X5500, 0X95C1, 0X9481, 0X5440,
+	0X9C01, 0X5CC0, 0X5D80, 0X9D41, 0X5F00, 0X9FC1, 0X9E81, 0X5E40,
+	0X5A00, 0X9AC1, 0X9B81, 0X5B40, 0X9901, 0X59C0, 0X5880, 0X9841,
+	0X8801, 0X48C0, 0X4980, 0X8941, 0X4B00, 0X8BC1, 0X8A81, 0X4A40,
+	0X4E00, 0X8EC1, 0X8F81, 0X4F40, 0X8D01, 0X4DC0, 0X4C80, 0X8C41,
+	0X4400, 0X84C1, 0X8581, 0X4540, 0X8701, 0X47C0, 0X4680, 0X8641,
+	0X8201, 0X42C0, 0X4380, 0X8341, 0X4100, 0X81C1, 0X8081, 0X4040
+	},
+	{
+	0X0000, 0X9001, 0X6001, 0XF000, 0XC002, 0X5003, 0XA003, 0X3002,
+	0XC007, 0X5006, 0XA006, 0X3007, 0X0005, 0X9004, 0X6004, 0XF005,
+	0XC00D, 0X500C, 0XA00C, 0X300D, 0X000F, 0X900E, 0X600E, 0XF00F,
+	0X000A, 0X900B, 0X600B, 0XF00A, 0XC008, 0X5009, 0XA009, 0X3008,
+	0XC019, 0X5018, 0XA018, 0X3019, 0X001B, 0X901A, 0X601A, 0XF01B,
+	0X001E, 0X901F, 0X601F, 0XF01E, 0XC01C, 0X501D, 0XA01D, 0X301C,
+	0X0014, 0X9015, 0X6015, 0XF014, 0XC016, 0X5017, 0XA017, 0X3016,
+	0XC013, 0X5012, 0XA012, 0X3013, 0X0011, 0X9010, 0X6010, 0XF011,
+	0XC031, 0X5030, 0XA030, 0X3031, 0X0033, 0X9032, 0X6032, 0XF033,
+	0X0036, 0X9037, 0X6037, 0XF036, 0XC034, 0X5035, 0XA035, 0X3034,
+	0X003C, 0X903D, 0X603D, 0XF03C, 0XC03E, 0X503F, 0XA03F, 0X303E,
+	0XC03B, 0X503A, 0XA03A, 0X303B, 0X0039, 0X9038, 0X6038, 0XF039,
+	0X0028, 0X9029, 0X6029, 0XF028, 0XC02A, 0X502B, 0XA02B, 0X302A,
+	0XC02F, 0X502E, 0XA02E, 0X302F, 0X002D, 0X902C, 0X602C, 0XF02D,
+	0XC025, 0X5024, 0XA024, 0X3025, 0X0027, 0X9026, 0X6026, 0XF027,
+	0X0022, 0X9023, 0X6023, 0XF022, 0XC020, 0X5021, 0XA021, 0X3020,
+	0XC061, 0X5060, 0XA060, 0X3061, 0X0063, 0X9062, 0X6062, 0XF063,
+	0X0066, 0X9067, 0X6067, 0XF066, 0XC064, 0X5065, 0XA065, 0X3064,
+	0X006C, 0X906D, 0X606D, 0XF06C, 0XC06E, 0X506F, 0XA06F, 0X306E,
+	0XC06B, 0X506A, 0XA06A, 0X306B, 0X0069, 0X9068, 0X6068, 0XF069,
+	0X0078, 0X9079, 0X6079, 0XF078, 0XC07A, 0X507B, 0XA07B, 0X307A,
+	0XC07F, 0X507E, 0XA07E, 0X307F, 0X007D, 0X907C, 0X607C, 0XF07D,
+	0XC075, 0X5074, 0XA074, 0X3075, 0X0077, 0X9076, 0X6076, 0XF077,
+	0X0072, 0X9073, 0X6073, 0XF072, 0XC070, 0X5071, 0XA071, 0X3070,
+	0X0050, 0X9051, 0X6051, 0XF050, 0XC052, 0X5053, 0XA053, 0X3052,
+	0XC057, 0X5056, 0XA056, 0X3057, 0X0055, 0X9054, 0X6054, 0XF055,
+	0XC05D, 0X505C, 0XA05C, 0X305D, 0X005F, 0X905E, 0X605E, 0XF05F,
+	0X005A, 0X905B, 0X605B, 0XF05A, 0XC058, 0X5059, 0XA059, 0X3058,
+	0XC049, 0X5048, 0XA048, 0X3049, 0X004B, 0X904A, 0X604A, 0XF04B,
+	0X004E, 0X904F, 0X604F, 0XF04E, 0XC04C, 0X504D, 0XA04D, 0X304C,
+	0X0044, 0X9045, 0X6045, 0XF044, 0XC046, 0X5047, 0XA047, 0X3046,
+	0XC043, 0X5042, 0XA042, 0X3043, 0X0041, 0X9040, 0X6040, 0XF041
+	},
+	{
+	0X0000, 0XC051, 0XC0A1, 0X00F0, 0XC141, 0X0110, 0X01E0, 0XC1B1,
+	0XC281, 0X02D0, 0X0220, 0XC271, 0X03C0, 0XC391, 0XC361, 0X0330,
+	0XC501, 0X0550, 0X05A0, 0XC5F1, 0X0440, 0XC411, 0XC4E1, 0X04B0,
+	0X0780, 0XC7D1, 0XC721, 0X0770, 0XC6C1, 0X0690, 0X0660, 0XC631,
+	0XCA01, 0X0A50, 0X0AA0, 0XCAF1, 0X0B40, 0XCB11, 0XCBE1, 0X0BB0,
+	0X0880, 0XC8D1, 0XC821, 0X0870, 0XC9C1, 0X0990, 0X0960, 0XC931,
+	0X0F00, 0XCF51, 0XCFA1, 0X0FF0, 0XCE41, 0X0E10, 0X0EE0, 0XCEB1,
+	0XCD81, 0X0DD0, 0X0D20, 0XCD71, 0X0CC0, 0XCC91, 0XCC61, 0X0C30,
+	0XD401, 0X1450, 0X14A0, 0XD4F1, 0X1540, 0XD511, 0XD5E1, 0X15B0,
+	0X1680, 0XD6D1, 0XD621, 0X1670, 0XD7C1, 0X1790, 0X1760, 0XD731,
+	0X1100, 0XD151, 0XD1A1, 0X11F0, 0XD041, 0X1010, 0X10E0, 0XD0B1,
+	0XD381, 0X13D0, 0X1320, 0XD371, 0X12C0, 0XD291, 0XD261, 0X1230,
+	0X1E00, 0XDE51, 0XDEA1, 0X1EF0, 0XDF41, 0X1F10, 0X1FE0, 0XDFB1,
+	0XDC81, 0X1CD0, 0X1C20, 0XDC71, 0X1DC0, 0XDD91, 0XDD61, 0X1D30,
+	0XDB01, 0X1B50, 0X1BA0, 0XDBF1, 0X1A40, 0XDA11, 0XDAE1, 0X1AB0,
+	0X1980, 0XD9D1, 0XD921, 0X1970, 0XD8C1, 0X1890, 0X1860, 0XD831,
+	0XE801, 0X2850, 0X28A0, 0XE8F1, 0X2940, 0XE911, 0XE9E1, 0X29B0,
+	0X2A80, 0XEAD1, 0XEA21, 0X2A70, 0XEBC1, 0X2B90, 0X2B60, 0XEB31,
+	0X2D00, 0XED51, 0XEDA1, 0X2DF0, 0XEC41, 0X2C10, 0X2CE0, 0XECB1,
+	0XEF81, 0X2FD0, 0X2F20, 0XEF71, 0X2EC0, 0XEE91, 0XEE61, 0X2E30,
+	0X2200, 0XE251, 0XE2A1, 0X22F0, 0XE341, 0X2310, 0X23E0, 0XE3B1,
+	0XE081, 0X20D0, 0X2020, 0XE071, 0X21C0, 0XE191, 0XE161, 0X2130,
+	0XE701, 0X2750, 0X27A0, 0XE7F1, 0X2640, 0XE611, 0XE6E1, 0X26B0,
+	0X2580, 0XE5D1, 0XE521, 0X2570, 0XE4C1, 0X2490, 0X2460, 0XE431,
+	0X3C00, 0XFC51, 0XFCA1, 0X3CF0, 0XFD41, 0X3D10, 0X3DE0, 0XFDB1,
+	0XFE81, 0X3ED0, 0X3E20, 0XFE71, 0X3FC0, 0XFF91, 0XFF61, 0X3F30,
+	0XF901, 0X3950, 0X39A0, 0XF9F1, 0X3840, 0XF811, 0XF8E1, 0X38B0,
+	0X3B80, 0XFBD1, 0XFB21, 0X3B70, 0XFAC1, 0X3A90, 0X3A60, 0XFA31,
+	0XF601, 0X3650, 0X36A0, 0XF6F1, 0X3740, 0XF711, 0XF7E1, 0X37B0,
+	0X3480, 0XF4D1, 0XF421, 0X3470, 0XF5C1, 0X3590, 0X3560, 0XF531,
+	0X3300, 0XF351, 0XF3A1, 0X33F0, 0XF241, 0X3210, 0X32E0, 0XF2B1,
+	0XF181, 0X31D0, 0X3120, 0XF171, 0X30C0, 0XF091, 0XF061, 0X3030
+	},
+	{
+	0X0000, 0XFC01, 0XB801, 0X4400, 0X3001, 0XCC00, 0X8800, 0X7401,
+	0X6002, 0X9C03, 0XD803, 0X2402, 0X5003, 0XAC02, 0XE802, 0X1403,
+	0XC004, 0X3C05, 0X7805, 0X8404, 0XF005, 0X0C04, 0X4804, 0XB405,
+	0XA006, 0X5C07, 0X1807, 0XE406, 0X9007, 0X6C06, 0X2806, 0XD407,
+	0XC00B, 0X3C0A, 0X780A, 0X840B, 0XF00A, 0X0C0B, 0X480B, 0XB40A,
+	0XA009, 0X5C08, 0X1808, 0XE409, 0X9008, 0X6C09, 0X2809, 0XD408,
+	0X000F, 0XFC0E, 0XB80E, 0X440F, 0X300E, 0XCC0F, 0X880F, 0X740E,
+	0X600D, 0X9C0C, 0XD80C, 0X240D, 0X500C, 0XAC0D, 0XE80D, 0X140C,
+	0XC015, 0X3C14, 0X7814, 0X8415, 0XF014, 0X0C15, 0X4815, 0XB414,
+	0XA017, 0X5C16, 0X1816, 0XE417, 0X9016, 0X6C17, 0X2817, 0XD416,
+	0X0011, 0XFC10, 0XB810, 0X4411, 0X3010, 0XCC11, 0X8811, 0X7410,
+	0X6013, 0X9C12, 0XD812, 0X2413, 0X5012, 0XAC13, 0XE813, 0X1412,
+	0X001E, 0XFC1F, 0XB81F, 0X441E, 0X301F, 0XCC1E, 0X881E, 0X741F,
+	0X601C, 0X9C1D, 0XD81D, 0X241C, 0X501D, 0XAC1C, 0XE81C, 0X141D,
+	0XC01A, 0X3C1B, 0X781B, 0X841A, 0XF01B, 0X0C1A, 0X481A, 0XB41B,
+	0XA018, 0X5C19, 0X1819, 0XE418, 0X9019, 0X6C18, 0X2818, 0XD419,
+	0XC029, 0X3C28, 0X7828, 0X8429, 0XF028, 0X0C29, 0X4829, 0XB428,
+	0XA02B, 0X5C2A, 0X182A, 0XE42B, 0X902A, 0X6C2B, 0X282B, 0XD42A,
+	0X002D, 0XFC2C, 0XB82C, 0X442D, 0X302C, 0XCC2D, 0X882D, 0X742C,
+	0X602F, 0X9C2E, 0XD82E, 0X242F, 0X502E, 0XAC2F, 0XE82F, 0X142E,
+	0X0022, 0XFC23, 0XB823, 0X4422, 0X3023, 0XCC22, 0X8822, 0X7423,
+	0X6020, 0X9C21, 0XD821, 0X2420, 0X5021, 0XAC20, 0XE820, 0X1421,
+	0XC026, 0X3C27, 0X7827, 0X8426, 0XF027, 0X0C26, 0X4826, 0XB427,
+	0XA024, 0X5C25, 0X1825, 0XE424, 0X9025, 0X6C24, 0X2824, 0XD425,
+	0X003C, 0XFC3D, 0XB83D, 0X443C, 0X303D, 0XCC3C, 0X883C, 0X743D,
+	0X603E, 0X9C3F, 0XD83F, 0X243E, 0X503F, 0XAC3E, 0XE83E, 0X143F,
+	0XC038, 0X3C39, 0X7839, 0X8438, 0XF039, 0X0C38, 0X4838, 0XB439,
+	0XA03A, 0X5C3B, 0X183B, 0XE43A, 0X903B, 0X6C3A, 0X283A, 0XD43B,
+	0XC037, 0X3C36, 0X7836, 0X8437, 0XF036, 0X0C37, 0X4837, 0XB436,
+	0XA035, 0X5C34, 0X1834, 0XE435, 0X9034, 0X6C35, 0X2835, 0XD434,
+	0X0033, 0XFC32, 0XB832, 0X4433, 0X3032, 0XCC33, 0X8833, 0X7432,
+	0X6031, 0X9C30, 0XD830, 0X2431, 0X5030, 0XAC31, 0XE831, 0X1430
+	}
+};
+
+/**
+ * @brief CRC16_Update
+ *        continue the computation of a modbus CRC16 over a new block of data,
+ *        the first call must pass CRC16_INIT
+ *
+ * @param wCRCWord the crc of the previous blocks
+ * @param nData pointer to the data
+ * @param wLength length of the data
+ * @return the updated crc
+ */
+uint16_t CRC16_Update(uint16_t wCRCWord, const uint8_t *nData, uint32_t wLength)
+{
+	uint8_t nTemp;
+
+	// 4 bytes for each step
+	while (wLength >= 4)
+	{
+		wCRCWord ^= (uint16_t)nData[0] | ((uint16_t)nData[1] << 8);
+		wCRCWord = wCRCTable[3][wCRCWord & 0xFF] ^ wCRCTable[2][wCRCWord >> 8] ^
+		           wCRCTable[1][nData[2]] ^ wCRCTable[0][nData[3]];
+		nData += 4;
+		wLength -= 4;
+	}
+
+	// tail
+	while (wLength)
+	{
+		nTemp = *nData++ ^ wCRCWord;
+		wCRCWord >>= 8;
+		wCRCWord ^= wCRCTable[0][nTemp];
+		wLength--;
+	}
+
+	return wCRCWord;
+}
+
+/**
+ * @brief CRC16
+ *        modbus CRC16 of a block of data
+ *
+ * @param nData pointer to the data
+ * @param wLength length of the data
+ * @return the crc
+ */
+uint16_t CRC16(const uint8_t *nData, uint16_t wLength)
+{
+	return CRC16_Update(CRC16_INIT, nData, wLength);
+}
@@ -0,0 +1,28 @@
+/**
+ * @file   crc16_CAREL.h
+ * @author carel
+ * @date   18 Oct 2026
+ * @brief  modbus CRC16 (of the frames, of the model and of the files),
+ *         kept without dependencies to be checked on the host (Test/host)
+ */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __CRC16_CAREL_H
+#define __CRC16_CAREL_H
+
+/* ==== Include ==== */
+#include <stdint.h>
+
+/* ==== Define ==== */
+
+/**
+ * @brief CRC16_INIT
+ *        initial value of the modbus CRC16, see CRC16_Update
+ */
+#define CRC16_INIT			0xFFFF
+
+/* ==== Function prototype ==== */
+uint16_t CRC16(const uint8_t *nData, uint16_t wLength);
+uint16_t CRC16_Update(uint16_t wCRCWord, const uint8_t *nData, uint32_t wLength);
+
+#endif  /* __CRC16_CAREL_H */
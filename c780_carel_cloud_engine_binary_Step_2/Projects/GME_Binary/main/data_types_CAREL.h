@@ -32,6 +32,7 @@
 #define RTO_SIZE 		64
 #define TOPIC_SIZE		100
 #define FIL_SIZE		20
+#define SHA_SIZE		65
 
 /* ======================================================= */
 /*                     ! WARNING !                         */
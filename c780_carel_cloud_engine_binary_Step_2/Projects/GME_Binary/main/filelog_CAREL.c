@@ -286,7 +286,14 @@ static logfile_sm_t FileLog_Full_SM(void)
 
 	    case SM_READ_SBLOCK:
 	    {
-	    	if(unlock_feature_control() == C_SUCCESS)
+	    	C_RES unlocked;
+
+	    	// the unlock sequence must not be interleaved with other transactions
+	    	Modbus__BusAcquire(MB_CLIENT_FILELOG);
+	    	unlocked = unlock_feature_control();
+	    	Modbus__BusRelease();
+
+	    	if(unlocked == C_SUCCESS)
 	    	{
 	    	  sm_full_file = SM_READ_HOW_MANY;
 	    	  ret = Dev_LogFile_GetSM();
@@ -567,7 +574,14 @@ static logfile_sm_t FileLog_Range_SM(void)
 		}
 	    case SM_READ_SBLOCK:
 	    {
-	    	if(unlock_feature_control() == C_SUCCESS)
+	    	C_RES unlocked;
+
+	    	// the unlock sequence must not be interleaved with other transactions
+	    	Modbus__BusAcquire(MB_CLIENT_FILELOG);
+	    	unlocked = unlock_feature_control();
+	    	Modbus__BusRelease();
+
+	    	if(unlocked == C_SUCCESS)
 	    	{
 	    	  sm_range_file = SM_READ_HOW_MANY;
 	    	  ret = Dev_LogFile_GetSM();
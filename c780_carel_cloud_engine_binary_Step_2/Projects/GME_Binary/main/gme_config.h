@@ -94,6 +94,18 @@
 #define MB_BAUDRATE     19200
 #define MB_PORTNUM_485  2
 #define MB_PORTNUM_TTL  0
+#define MB_PORTNUM_AUX  1		// aux line on the other connector, the 2G modem uses it
 #define MB_PARITY       UART_PARITY_DISABLE
 
+
+/*-------------------------------
+ * Tasks (menuconfig "GME Task Configuration")
+ *-----------------------------*/
+#define GME_ACQ_CORE		CONFIG_GME_ACQ_CORE		// modbus master, its interrupts, polling engine
+#define GME_NET_CORE		CONFIG_GME_NET_CORE		// main task, MQTT commands, OTA, Modbus TCP
+
+#define MODBUS_TASK_PRIO	CONFIG_GME_MODBUS_TASK_PRIO
+#define CAREL_TASK_PRIO		CONFIG_GME_MAIN_TASK_PRIO
+#define OTA_TASK_PRIO		CONFIG_GME_OTA_TASK_PRIO
+
 #endif /* MAIN_GME_CONFIG_H_ */
@@ -19,6 +19,10 @@
 
 #include "WebDebug.h"
 
+#ifdef __CCL_COVERAGE_BIN
+#include "coverage_CAREL.h"
+#endif
+
 static const char *TAG = "http_server";
 static C_BYTE ReceivedConfig = 0;
 static C_BYTE WpsMode = 0;
@@ -625,6 +629,36 @@ static esp_err_t delete_post_handler(httpd_req_t *req)
 }
 
 
+#ifdef __CCL_COVERAGE_BIN
+/**
+ * @brief coverage_get_handler
+ *        Handler to download the coverage export
+ *
+ * @param httpd_req_t *req
+ * @return none ESP_FAIL/ESP_OK
+ */
+static esp_err_t coverage_get_handler(httpd_req_t *req)
+{
+	static char chunk[512];
+	cov_cursor_t cur;
+	C_UINT32 len;
+
+	httpd_resp_set_type(req, "text/plain");
+
+	Cov__ExportStart(&cur);
+	while ((len = Cov__Export(&cur, chunk, sizeof(chunk))) > 0)
+	{
+		if (httpd_resp_send_chunk(req, chunk, len) != ESP_OK) {
+			ESP_LOGE(TAG, "Coverage sending failed!");
+			httpd_resp_send_chunk(req, NULL, 0);
+			return ESP_FAIL;
+		}
+	}
+
+	httpd_resp_send_chunk(req, NULL, 0);
+	return ESP_OK;
+}
+#endif
 
 
 
@@ -671,6 +705,9 @@ C_RES HTTPServer__StartFileServer (httpd_handle_t server, const char *base_path)
 	httpd_config_t config = HTTPD_DEFAULT_CONFIG();
 
 	config.max_uri_handlers = 10;
+#ifdef __CCL_COVERAGE_BIN
+	config.max_uri_handlers++;
+#endif
 
 	// Use the URI wildcard matching function in order to
 	//allow the same handler to respond to multiple different
@@ -769,6 +806,16 @@ C_RES HTTPServer__StartFileServer (httpd_handle_t server, const char *base_path)
 	};
 	httpd_register_uri_handler(server, &get_dbg_json);
 
+#ifdef __CCL_COVERAGE_BIN
+	httpd_uri_t get_coverage = {
+		.uri       = "/cov.txt",
+		.method    = HTTP_GET,
+		.handler   = coverage_get_handler,
+		.user_ctx  = NULL
+	};
+	httpd_register_uri_handler(server, &get_coverage);
+#endif
+
 
 /***********************/
 
@@ -810,6 +857,7 @@ esp_err_t HTTPServer__StopServer(httpd_handle_t server){
  */
 void SetConfigReceived(void){
 	ReceivedConfig = 1;
+	GME__PostEvent(GME_EVT_CONFIG);
 }
 
 
@@ -833,6 +881,7 @@ C_BYTE IsConfigReceived(void){
  */
 void SetWpsMode(void){
 	WpsMode = 1;
+	GME__PostEvent(GME_EVT_CONFIG);
 }
 
 
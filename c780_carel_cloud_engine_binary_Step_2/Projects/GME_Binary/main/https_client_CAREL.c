@@ -13,62 +13,377 @@
 #include "MQTT_Interface_CAREL.h"
 #include "binary_model.h"
 #include "nvm_CAREL.h"
+#include "File_System_CAREL.h"
+#include "sys_IS.h"
+#include "sha256_CAREL.h"
+#include <ctype.h>
+
+#ifdef INCLUDE_PLATFORM_DEPENDENT
+#include "mbedtls/sha256.h"
+#endif
+
+/**
+ * @brief DOWNLOAD_CHUNK_SIZE
+ *        the body is read and written in pieces of this size, the memory
+ *        in use doesn't depend on the size of the file
+ */
+#define DOWNLOAD_CHUNK_SIZE		512
+
+/* a broken transfer is resumed with a Range request up to this times */
+#define DOWNLOAD_MAX_RETRY		3
+#define DOWNLOAD_RETRY_DELAY_MS	2000
+
+/* the file is written here and renamed only when complete and verified */
+#define DOWNLOAD_TMP_SUFFIX		".tmp"
+
+/* first bytes of the file kept for the checks of the header */
+#define DOWNLOAD_HEAD_SIZE		sizeof(H_HeaderModel)
+
+#define CERT_SIGNATURE			"-----BEGIN"
+
+enum{
+	DWL_UNKNOWN = 0,
+	DWL_MODEL,
+	DWL_CERT,
+	DWL_WEB,
+};
 
 /**
- * @brief MAX_HTTP_RECV_BUFFER 
- *        is used to store temporarily the data coming from the HTTPS server the 
- *        space depends from the available memory
+ * @brief dwl_stream_t
+ *        state of a download, kept across the resumed connections
  */
-#define MAX_HTTP_RECV_BUFFER 2048
+typedef struct{
+	FILE *fp;
+	const C_CHAR *name;					// of the temporary file
+	C_UINT32 len;						// bytes in the temporary file
+	C_UINT32 max_len;					// 0 no limit
+	C_UINT16 crc;						// of the whole file
+	C_BYTE head[DOWNLOAD_HEAD_SIZE];
+	C_BYTE tail[2];						// last 2 bytes, the CRC of a model
+	C_BYTE buf[DOWNLOAD_CHUNK_SIZE];
+#ifdef INCLUDE_PLATFORM_DEPENDENT
+	mbedtls_sha256_context sha;
+#endif
+}dwl_stream_t;
 
 static const char *TAG = "HTTP_CLIENT_CAREL";
 
 
+/*
+ * dwl_kind
+ *        which checks the file needs, DWL_UNKNOWN is not downloaded
+ */
+static C_BYTE dwl_kind(const char *filename)
+{
+	if (memcmp(filename, MODEL_FILE, strlen(MODEL_FILE)) == 0)
+		return DWL_MODEL;
+
+	if ((memcmp(filename, CERT1_SPIFFS, strlen(CERT1_SPIFFS)) == 0) || (memcmp(filename, CERT2_SPIFFS, strlen(CERT2_SPIFFS)) == 0))
+		return DWL_CERT;
+
+	if ((memcmp(filename,LOGIN_HTML, strlen(LOGIN_HTML)))==0 ||
+		(memcmp(filename,CHANGE_CRED_HTML, strlen(CHANGE_CRED_HTML)))==0 ||
+		(memcmp(filename,CONFIG_HTML, strlen(CONFIG_HTML)))==0 ||
+		(memcmp(filename,STYLE_CSS, strlen(STYLE_CSS)))==0 ||
+		(memcmp(filename,FAV_ICON, strlen(FAV_ICON)))==0)
+		return DWL_WEB;
+
+	return DWL_UNKNOWN;
+}
+
+/*
+ * dwl_restart
+ *        empty the temporary file and restart CRC and SHA-256
+ */
+static C_RES dwl_restart(dwl_stream_t *s)
+{
+	if (s->len > 0)
+	{
+		fclose(s->fp);
+		s->fp = fopen(s->name, "wb");
+		if (s->fp == NULL)
+			return FILE_NOT_SAVED;
+	}
+
+	s->len = 0;
+	s->crc = CRC16_INIT;
+#ifdef INCLUDE_PLATFORM_DEPENDENT
+	// free releases the hardware SHA engine the context could hold
+	mbedtls_sha256_free(&s->sha);
+	mbedtls_sha256_init(&s->sha);
+	mbedtls_sha256_starts_ret(&s->sha, 0);
+#endif
+	return CONN_OK;
+}
+
+/*
+ * dwl_write
+ *        append n bytes of s->buf to the temporary file
+ */
+static C_RES dwl_write(dwl_stream_t *s, C_UINT32 n)
+{
+	C_UINT32 i;
+
+	if ((s->max_len != 0) && (s->len + n > s->max_len))
+		return WRONG_FILE;
+
+	if (n != fwrite(s->buf, 1, n, s->fp))
+		return FILE_NOT_SAVED;
+
+	for (i = 0; (i < n) && (s->len + i < DOWNLOAD_HEAD_SIZE); i++)
+		s->head[s->len + i] = s->buf[i];
+
+	if (n >= 2)
+	{
+		s->tail[0] = s->buf[n - 2];
+		s->tail[1] = s->buf[n - 1];
+	}
+	else if (n == 1)
+	{
+		s->tail[0] = s->tail[1];
+		s->tail[1] = s->buf[0];
+	}
+
+	s->crc = CRC16_Update(s->crc, s->buf, n);
+#ifdef INCLUDE_PLATFORM_DEPENDENT
+	mbedtls_sha256_update_ret(&s->sha, s->buf, n);
+#endif
+	s->len += n;
+	return CONN_OK;
+}
+
+/*
+ * dwl_range_num
+ *        decimal number of a Content-Range, at least a digit
+ */
+static C_RES dwl_range_num(const C_CHAR **p, C_UINT32 *v)
+{
+	C_UINT64 n = 0;
+
+	if (!isdigit((int)**p))
+		return C_FAIL;
+
+	while (isdigit((int)**p))
+	{
+		n = n * 10 + (C_UINT64)(**p - '0');
+		if (n > 0xFFFFFFFFu)
+			return C_FAIL;
+		(*p)++;
+	}
+	*v = (C_UINT32)n;
+	return C_SUCCESS;
+}
+
+/*
+ * dwl_check_range
+ *        the Content-Range of a 206, "bytes first-last/size" (size can be
+ *        "*"), must start at the bytes already received, match the length
+ *        of the body and reach the end of the file
+ */
+static C_RES dwl_check_range(const C_CHAR *cr, C_UINT32 from, C_INT32 content_length)
+{
+	C_UINT32 first, last, size;
+
+	if (0 != strncmp(cr, "bytes ", 6))
+		return C_FAIL;
+	cr += 6;
+
+	if ((C_SUCCESS != dwl_range_num(&cr, &first)) || (*cr++ != '-') ||
+		(C_SUCCESS != dwl_range_num(&cr, &last)) || (*cr++ != '/'))
+		return C_FAIL;
+
+	if ((first != from) || (last < first) || ((last - first + 1) != (C_UINT32)content_length))
+		return C_FAIL;
+
+	if (0 == strcmp(cr, "*"))
+		return C_SUCCESS;
+
+	if ((C_SUCCESS != dwl_range_num(&cr, &size)) || (*cr != '\0') || (size != last + 1))
+		return C_FAIL;
+
+	return C_SUCCESS;
+}
+
+/*
+ * dwl_session
+ *        one connection to the server, from s->len to the end of the file
+ *        or to the first error
+ */
+static C_RES dwl_session(c_http_client_config_t *c_config, uint8_t cert_num, dwl_stream_t *s)
+{
+	C_RES err = CONN_OK;
+	http_client_handle_t client;
+	C_CHAR range[24];
+	C_INT32 content_length, status, read_len;
+	C_UINT32 total, n;
+
+	client = http_client_init_IS(c_config, cert_num);
+	if (client == NULL)
+		return CONN_FAIL;
+
+	if (s->len > 0)
+	{
+		sprintf(range, "bytes=%u-", (unsigned)s->len);
+		http_client_set_header_IS(client, "Range", range);
+	}
+
+	if (http_client_open_IS(client, 0) != C_SUCCESS)
+	{
+		#ifdef _DEBUG_HTTPS_CLIENT_CAREL
+		PRINTF_DEBUG("Failed to open HTTP connection");
+		#endif
+		http_client_cleanup_IS(client);
+		P_COV_LN;
+		return CONN_FAIL;
+	}
+
+	content_length = http_client_fetch_headers_IS(client);
+	status = http_client_get_status_IS(client);
+
+	#ifdef _DEBUG_HTTPS_CLIENT_CAREL
+	ESP_LOGI(TAG, "HTTP Stream reader Status = %d, content_length = %d", status, content_length);
+	#endif
+
+	// the server ignored the Range, start again from the beginning
+	if ((s->len > 0) && (status == 200))
+		err = dwl_restart(s);
+
+	// a partial body that is not the rest of the file can't be appended,
+	// the next retry starts again from the beginning
+	if ((err == CONN_OK) && (s->len > 0) && (status == 206) && (content_length > 0) &&
+		(C_SUCCESS != dwl_check_range(http_client_get_content_range_IS(client), s->len, content_length)))
+	{
+		#ifdef _DEBUG_HTTPS_CLIENT_CAREL
+		PRINTF_DEBUG("Content-Range \"%s\" from %u, restart\n", http_client_get_content_range_IS(client), (unsigned)s->len);
+		#endif
+		err = dwl_restart(s);
+		if (err == CONN_OK)
+			err = CONN_FAIL;
+		P_COV_LN;
+	}
+
+	if ((err == CONN_OK) && ((content_length <= 0) || ((status != 200) && (status != 206))))
+		err = CONN_FAIL;
+
+	total = s->len + (C_UINT32)content_length;
+	if ((err == CONN_OK) && (s->max_len != 0) && (total > s->max_len))
+		err = WRONG_FILE;
+
+	while ((err == CONN_OK) && (s->len < total))
+	{
+		n = total - s->len;
+		if (n > sizeof(s->buf))
+			n = sizeof(s->buf);
+
+		read_len = http_client_read_IS(client, (C_CHAR*)s->buf, n);
+		if (read_len <= 0)
+		{
+			#ifdef _DEBUG_HTTPS_CLIENT_CAREL
+			PRINTF_DEBUG("HttpsClient__DownloadFile - Error read data");
+			#endif
+			err = CONN_FAIL;
+			P_COV_LN;
+			break;
+		}
+		err = dwl_write(s, (C_UINT32)read_len);
+	}
+
+	http_client_close_IS(client);
+	http_client_cleanup_IS(client);
+	return err;
+}
+
+/*
+ * dwl_check
+ *        checks of the complete file before it replaces the old one
+ */
+static C_RES dwl_check(dwl_stream_t *s, C_BYTE kind, c_cborreqdwldevsconfig *cfg)
+{
+	H_HeaderModel *hdr = (H_HeaderModel*)s->head;
+	C_RES err = CONN_OK;
+
+	if (kind == DWL_MODEL)
+	{
+		// the model ends with its own CRC, the CRC of the whole file is 0
+		if ((s->len < DOWNLOAD_HEAD_SIZE + 2) || (s->crc != 0))
+			err = WRONG_CRC;
+
+		if (memcmp(hdr->signature, GME_MODEL, strlen(GME_MODEL)) || (hdr->version != HEADER_VERSION))
+			err = WRONG_FILE;
+		P_COV_LN;
+	}
+	else if (kind == DWL_CERT)
+	{
+		if (s->crc != cfg->crc)
+			err = WRONG_CRC;
+		if ((s->len < strlen(CERT_SIGNATURE)) || memcmp(s->head, CERT_SIGNATURE, strlen(CERT_SIGNATURE)))
+			err = WRONG_FILE;
+		P_COV_LN;
+	}
+
+	if ((err == CONN_OK) && (cfg->sha[0] != 0))
+	{
+#ifdef INCLUDE_PLATFORM_DEPENDENT
+		C_BYTE digest[SHA256_DIGEST_LEN];
+
+		mbedtls_sha256_finish_ret(&s->sha, digest);
+		if (C_SUCCESS != Sha256__MatchHex(digest, cfg->sha))
+#endif
+			err = WRONG_CRC;
+	}
+
+	return err;
+}
+
+
 /**
  * @brief HttpsClient__DownloadFile
  *          Routine for downloading a file's from the server using the passed certificate
- *          Downloads the file and rewrite it in the filesystem*        
- *        
- * @param   download_devs_config : the connection data uri/password/username
+ *          The body is streamed in DOWNLOAD_CHUNK_SIZE pieces to a temporary file
+ *          while its CRC (and the optional SHA-256) is computed, an interrupted
+ *          transfer is resumed with a Range request, a partial answer whose
+ *          Content-Range doesn't match restarts it. Only a complete and
+ *          verified file replaces the old one
+ *
+ * @param   download_devs_config : the connection data uri/password/username,
+ *                                 crc and sha of the file
  *
  * @param   cert_num : the index of certificate to be used
  * @param   filename : the name of the file that will be updated
- * @return 
+ * @return  https_conn_err_t
  */
 C_RES HttpsClient__DownloadFile(c_cborreqdwldevsconfig *download_devs_config, uint8_t cert_num, const char *filename)
-{	
+{
 	C_RES err = CONN_FAIL;
 	c_http_client_config_t c_config;
-		
-    C_RES err2;
-	http_client_handle_t client;
-		
-	int total_read_len = 0;
-    int read_len = 0;
-    C_UINT32 content_length;
+	dwl_stream_t *s;
+	C_CHAR tmp_name[FIL_SIZE + sizeof(DOWNLOAD_TMP_SUFFIX) + 8];
+	C_BYTE kind = dwl_kind(filename);
+	C_BYTE retry;
 
-	char *buffer = malloc(MAX_HTTP_RECV_BUFFER + 1);
 	uint16_t url_len = strlen(download_devs_config->uri) + strlen(download_devs_config->pwd) + strlen(download_devs_config->usr);
 	char *url = malloc(url_len+5);
 
-    if (buffer == NULL) 
-    {
-        if (url != NULL) free(url);
+	if (kind == DWL_UNKNOWN)
+	{
+		if (url != NULL) free(url);
 		P_COV_LN;
-		return NO_HEAP_MEMORY;
-    }
-	
-	if (url == NULL)
+		return CONN_FAIL;
+	}
+
+	s = malloc(sizeof(dwl_stream_t));
+	if ((url == NULL) || (s == NULL))
 	{
-		free(buffer);
+		if (url != NULL) free(url);
+		if (s != NULL) free(s);
 		P_COV_LN;
 		return NO_HEAP_MEMORY;
 	}
 
-	memset((void*)url, 0, url_len);    
+	memset((void*)url, 0, url_len);
 	sprintf(url,"%.*s%s:%s@%s",8,download_devs_config->uri,download_devs_config->usr,download_devs_config->pwd,download_devs_config->uri+8);
-	
-	#ifdef _DEBUG_HTTPS_CLIENT_CAREL 
+
+	#ifdef _DEBUG_HTTPS_CLIENT_CAREL
 	printf("%s\n",url);
 	#endif
 
@@ -76,105 +391,66 @@ C_RES HttpsClient__DownloadFile(c_cborreqdwldevsconfig *download_devs_config, ui
 	c_config.username = download_devs_config->usr;
 	c_config.password = download_devs_config->pwd;
 	c_config.cert_num = cert_num;
-	
-	client = http_client_init_IS(&c_config, cert_num);
 
+	snprintf(tmp_name, sizeof(tmp_name), "%s%s", filename, DOWNLOAD_TMP_SUFFIX);
 
-	if ((err2 = http_client_open_IS(client, 0)) != C_SUCCESS) {
-		#ifdef _DEBUG_HTTPS_CLIENT_CAREL 		
-		//ESP_LOGE(TAG, "Failed to open HTTP connection: %s", esp_err_to_name(err2));				
-		PRINTF_DEBUG("Failed to open HTTP connection");		
-		#endif
-		
-		free(buffer);
+	memset((void*)s, 0, sizeof(dwl_stream_t));
+	s->name = tmp_name;
+	s->max_len = (kind == DWL_MODEL) ? GME_MODEL_MAX_SIZE : (kind == DWL_CERT) ? (CERT_MAX_SIZE - 2) : 0;
+	s->fp = fopen(tmp_name, "wb");
+	if (s->fp == NULL)
+	{
+		free(s);
 		free(url);
 		P_COV_LN;
-		return CONN_FAIL;
+		return FILE_NOT_SAVED;
 	}
+	dwl_restart(s);
 
-
-	content_length =  http_client_fetch_headers_IS(client);
-	
-	// download of certificate happens all at once:
-	// no need to break down download into multiple packets
-	// as certificate must be shorter than 2kB
-	if ((total_read_len < content_length) && (content_length <= MAX_HTTP_RECV_BUFFER)) {
-		
-		read_len = http_client_read_IS(client, buffer, content_length);
-		
-		if (read_len >= 0) 
-		{
-		  buffer[read_len] = 0;
-
-          #if (DEEP_DEBUG_PRINTF_DEFAULT == 1)
-		  ESP_LOGD(TAG, "read_len = %d", read_len);
-		  ESP_LOG_BUFFER_HEXDUMP(__func__, buffer, MAX_HTTP_RECV_BUFFER, ESP_LOG_INFO);
-          #endif
-
-		  if (memcmp(filename, MODEL_FILE, strlen(MODEL_FILE)) == 0) {
-			  err = CONN_OK;
-			  // Check received model before writing to NVM
-			  // Check CRC
-			  uint16_t Crc = CRC16((uint8_t*)buffer, read_len - 2);
-			  uint16_t ModelCrc = ((*(buffer + read_len - 2)) & 0x00FF)| ((uint16_t)(*(buffer + read_len - 1)))<<8;
-			  if (Crc != ModelCrc)
-				  err = WRONG_CRC;
-
-			  // Check header
-			  struct HeaderModel* tmpHeaderModel;
-			  tmpHeaderModel = (struct HeaderModel *)buffer;
-			  if (memcmp(tmpHeaderModel->signature, GME_MODEL, strlen(GME_MODEL)) || (tmpHeaderModel->version != HEADER_VERSION))
-				  err = WRONG_FILE;
-
-			  P_COV_LN;
-		  }
-		  else if ((memcmp(filename, CERT1_SPIFFS, strlen(CERT1_SPIFFS)) == 0) || (memcmp(filename, CERT2_SPIFFS, strlen(CERT2_SPIFFS)) == 0)) {
-			  err = CONN_OK;
-			  uint16_t Crc = CRC16((uint8_t*)buffer, content_length);
-			  if (Crc != download_devs_config->crc)
-			  	err = WRONG_CRC;
-			  if (memcmp(buffer, "-----BEGIN", strlen("-----BEGIN")))
-				  err = WRONG_FILE;
-			  P_COV_LN;
-		  }
-		  else if ((memcmp(filename,LOGIN_HTML, strlen(LOGIN_HTML)))==0 ||
-				  	  (memcmp(filename,CHANGE_CRED_HTML, strlen(CHANGE_CRED_HTML)))==0 ||
-					  (memcmp(filename,CONFIG_HTML, strlen(CONFIG_HTML)))==0 ||
-					  (memcmp(filename,STYLE_CSS, strlen(STYLE_CSS)))==0 ||
-					  (memcmp(filename,FAV_ICON, strlen(FAV_ICON)))==0) {
-			  P_COV_LN;
-			  err = CONN_OK;
-		  }
-
-		  // If controls are ok, write new file to NVM
-		  if (err == CONN_OK)
-			  if(C_SUCCESS != FS_SaveFile(buffer , (size_t)read_len, filename))
-				  err = FILE_NOT_SAVED;
-		}
-		else
+	// the transfer goes on from the received bytes after a broken connection
+	for (retry = 0; retry <= DOWNLOAD_MAX_RETRY; retry++)
+	{
+		if (retry > 0)
 		{
-			#ifdef _DEBUG_HTTPS_CLIENT_CAREL 
-			PRINTF_DEBUG("HttpsClient__DownloadModelFile - Error read data");			
+			#ifdef _DEBUG_HTTPS_CLIENT_CAREL
+			PRINTF_DEBUG("%s resume from %u, retry %d\n", filename, (unsigned)s->len, retry);
 			#endif
-			P_COV_LN;
+			Sys__Delay(DOWNLOAD_RETRY_DELAY_MS);
 		}
 
-		
+		err = dwl_session(&c_config, cert_num, s);
+		if ((err == CONN_OK) || (err == FILE_NOT_SAVED) || (err == WRONG_FILE))
+			break;
 	}
 
+	if (s->fp != NULL)
+		fclose(s->fp);
+
+	if (err == CONN_OK)
+		err = dwl_check(s, kind, download_devs_config);
+
+	if ((err == CONN_OK) && (C_SUCCESS != FS_ReplaceFile(tmp_name, filename)))
+		err = FILE_NOT_SAVED;
+
+	if (err == CONN_OK)
+	{
+		// crc already checked on the downloaded data, no need to read back the file
+		if (kind == DWL_MODEL)
+			BinaryModel_SetCrcCache((C_UINT16)s->tail[0] | ((C_UINT16)s->tail[1] << 8));
+		P_COV_LN;
+	}
+	else
+		remove(tmp_name);
+
+	#ifdef _DEBUG_HTTPS_CLIENT_CAREL
+	PRINTF_DEBUG("HttpsClient__DownloadFile %s len %u err %d\n", filename, (unsigned)s->len, err);
+	#endif
+
 #ifdef INCLUDE_PLATFORM_DEPENDENT
-    #ifdef _DEBUG_HTTPS_CLIENT_CAREL 
-	ESP_LOGI(TAG, "HTTP Stream reader Status = %d, content_length = %d",
-     				esp_http_client_get_status_code(client),
-					esp_http_client_get_content_length(client));
-    #endif					
+	mbedtls_sha256_free(&s->sha);
 #endif
-
-	free(buffer);
+	free(s);
 	free(url);
-
-	http_client_close_IS(client);
-	http_client_cleanup_IS(client);
 	return err;
 }
 
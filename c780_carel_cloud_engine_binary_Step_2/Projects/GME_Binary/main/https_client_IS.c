@@ -11,11 +11,16 @@
 #include "sys_CAREL.h"
 
 #ifdef INCLUDE_PLATFORM_DEPENDENT
+#include <string.h>
+#include <strings.h>
 #include "esp_http_client.h"
 #endif
 
 static const char *TAG = "HTTP_CLIENT_IS";
 
+// Content-Range of the last response, one download at a time
+static C_CHAR http_content_range[HTTP_CONTENT_RANGE_SIZE] = "";
+
 
 http_client_handle_t client_http_client_init_IS = NULL;
 esp_http_client_config_t esp_config_http_client_init_IS;
@@ -55,6 +60,8 @@ static esp_err_t _http_event_handler(esp_http_client_event_t *evt)
 			
         case HTTP_EVENT_ON_HEADER:
             ESP_LOGD(TAG, "HTTP_EVENT_ON_HEADER, key=%s, value=%s", evt->header_key, evt->header_value);
+            if (0 == strcasecmp(evt->header_key, "Content-Range"))
+                snprintf(http_content_range, sizeof(http_content_range), "%s", evt->header_value);
 			P_COV_LN;
             break;
 			
@@ -167,6 +174,7 @@ C_INT32 http_client_open_IS(http_client_handle_t client, C_INT32 write_len)
 	
     #ifdef INCLUDE_PLATFORM_DEPENDENT 
 	esp_err_t err2;
+	http_content_range[0] = '\0';
 	err2 = esp_http_client_open(client, 0);
 	
 	if (err2 != ESP_OK)
@@ -230,6 +238,69 @@ C_INT32 http_client_read_IS(http_client_handle_t client, C_CHAR *buffer, C_INT32
    
    return read_len;
 }
+
+
+
+/**
+ * @brief      Set a header of the request, call it before http_client_open
+ *
+ * @param[in]  client  The http_client handle
+ * @param[in]  key     The header key
+ * @param[in]  value   The header value
+ *
+ * @return
+ *     - C_SUCCESS
+ *     - C_FAIL
+ */
+C_INT32 http_client_set_header_IS(http_client_handle_t client, const C_CHAR *key, const C_CHAR *value)
+{
+  C_INT32 ret_val = C_FAIL;
+
+  #ifdef INCLUDE_PLATFORM_DEPENDENT
+  if (ESP_OK == esp_http_client_set_header(client, key, value))
+	 ret_val = C_SUCCESS;
+  #endif
+
+  return ret_val;
+}
+
+
+
+/**
+ * @brief      Content-Range header of the response, call it after http_client_fetch_headers
+ *
+ * @param[in]  client  The http_client handle
+ *
+ * @return
+ *     - the value of the header, as "bytes 100-199/200"
+ *     - "" if the response has none
+ */
+const C_CHAR* http_client_get_content_range_IS(http_client_handle_t client)
+{
+  return http_content_range;
+}
+
+
+
+/**
+ * @brief      HTTP status code of the response, call it after http_client_fetch_headers
+ *
+ * @param[in]  client  The http_client handle
+ *
+ * @return
+ *     - the status code (200, 206, ...)
+ *     - C_FAIL if any errors
+ */
+C_INT32 http_client_get_status_IS(http_client_handle_t client)
+{
+  C_INT32 ret_val = C_FAIL;
+
+  #ifdef INCLUDE_PLATFORM_DEPENDENT
+  ret_val = esp_http_client_get_status_code(client);
+  #endif
+
+  return ret_val;
+}
  
  
  
@@ -38,6 +38,9 @@
 /* typedefs and defines                                                       */
 /* ========================================================================== */
 
+/* longest Content-Range kept, "bytes " and three 32 bit numbers */
+#define HTTP_CONTENT_RANGE_SIZE		48
+
 /**
  * @brief c_http_client_config_t this structure is used to pass the parameters need to connect
  *          
@@ -75,6 +78,9 @@ http_client_handle_t http_client_init_IS(c_http_client_config_t *config, C_BYTE
 C_INT32 http_client_open_IS(http_client_handle_t client, C_INT32 write_len);
 C_INT32 http_client_fetch_headers_IS(http_client_handle_t client);
 C_INT32 http_client_read_IS(http_client_handle_t client, C_CHAR *buffer, C_INT32 len);
+C_INT32 http_client_set_header_IS(http_client_handle_t client, const C_CHAR *key, const C_CHAR *value);
+C_INT32 http_client_get_status_IS(http_client_handle_t client);
+const C_CHAR* http_client_get_content_range_IS(http_client_handle_t client);
 C_INT32 http_client_close_IS(http_client_handle_t client);
 C_INT32 http_client_cleanup_IS(http_client_handle_t client);
  
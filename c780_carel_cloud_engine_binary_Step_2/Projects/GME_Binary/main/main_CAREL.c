@@ -39,6 +39,9 @@
 #include "mobile.h"
 #include "radio.h"
 #include "binary_model.h"
+#include "RTC_IS.h"
+#include "modbus_tcp_IS.h"
+#include "modbus_aux_IS.h"
 
 #include "SoftWDT.h"
 #include "IO_Port_IS.h"
@@ -49,6 +52,7 @@
 #endif
 
 #include "WebDebug.h"
+#include "telemetry_IS.h"
 
 
 //#define __WANT_WDT
@@ -67,6 +71,9 @@
 //Variables
 static gme_sm_t sm = GME_INIT;
 
+static C_UINT32 GME__GetLoopTimeout(gme_sm_t prev_sm);
+static C_RES GME__StartAcquisition(void);
+
 /**
  * @brief app_main
  *		  main application of the project
@@ -126,22 +133,29 @@ void Carel_Main_Task(void)
   static uint8_t gw_config_status, line_config_status, devs_config_status;
   static uint8_t checked_files = 0;
 
-  static C_UINT32 NVMBaudrate;
-  static C_BYTE   NVMConnector;
-
   C_INT32 alivecount = RTC_Get_UTC_Current_Time() + 20;
 
+  C_UINT32 events;
+  gme_sm_t prev_sm = sm;
 
 
   SoftWDT_Init(SWWDT_MAIN_DEVICE, SWWDT_DEFAULT_TIME);
 
   while(1)
   {
-	  Sys__Delay(10);
-
+	  // sleep until an event arrives or the timeout of the current state expires
+	  events = GME_WaitEvent_IS(GME__GetLoopTimeout(prev_sm));
+	  prev_sm = sm;
 
       SoftWDT_Reset(SWWDT_MAIN_DEVICE);
 	  IsTimerForAPConnectionExpired();
+	  WiFi__SaveLastAP();
+
+	  if (events & GME_EVT_CONFIG)
+	  {
+		  GME__CheckHTMLConfig();
+		  P_COV_LN;
+	  }
 
 	  switch (sm)
 	  {
@@ -181,6 +195,11 @@ void Carel_Main_Task(void)
 	        			}
 	        			sm = GME_RADIO_CONFIG;
 
+	        			// load the model and start the polling before the radio,
+	        			// NTP and MQTT, the samples are buffered until MQTT connects
+	        			Utilities__Init();
+	        			GME__StartAcquisition();
+
 	        			if PLATFORM(PLATFORM_DETECTED_2G) {
 	        				GSM_Module_PwrKey_On_Off(GSM_PWRKEY_ON);
 	        				Mobile__Init();
@@ -222,6 +241,12 @@ void Carel_Main_Task(void)
 				if(CONNECTED == Radio__GetStatus()){
 					P_COV_LN;
 					PRINTF_DEBUG("SM__Start .... GME_WAITING_FOR_INTERNET\n");
+
+					// the local BMS/SCADA read the polled data on the LAN, not on
+					// the 2G. The sockets need the netif, it is up only from here
+					if (!PLATFORM(PLATFORM_DETECTED_2G))
+						ModbusTcp__Start();
+
 					sm = GME_STRAT_NTC;
 				}
 				GME__CheckHTMLConfig();
@@ -348,26 +373,9 @@ void Carel_Main_Task(void)
           	    	P_COV_LN;
           	    	break;
           	    }
-          	    
-          	    NVM__ReadU32Value(MB_BAUDRATE_NVM, &NVMBaudrate);		// read the baudrate from nvm
-          	    NVM__ReadU8Value(MB_CONNECTOR_NVM, &NVMConnector);		// read which uart to use (for rs485 or ttl) from nvm
-
-          	    MODBUS_PORT_SELECT(NVMConnector, modbusPort);
-
-          	    // in case of bcu only use ttl, pass proper parameter or force it somehow... TODO
-          	    retval = Modbus_Init(NVMBaudrate, GME__GetHEaderInfo()->Rs485Parity, GME__GetHEaderInfo()->Rs485Stop, modbusPort);
-                //TODO CPPCHECK test the return value
-
-          	    CAREL_CHECK(retval, "UART");
-
-          	    Sys__Delay(1000);
-
-          	    Modbus_Task_Start();
-          	    Sys__Delay(1000);
-
-
-         	    PollEngine_MBStart_IS();
 
+          	    // nothing to do if already started at boot
+          	    GME__StartAcquisition();
 
   				sm = GME_IDLE_INTERNET_CONNECTED;
   				P_COV_LN;
@@ -443,6 +451,8 @@ void Carel_Main_Task(void)
           RetriveDataDebug(WEBDBG_WIFI, Radio__GetStatus());
           RetriveDataDebug(WEBDBG_MQTT, MQTT_GetFlags());
 
+          Telemetry__Periodic();
+
       }
 }
 
@@ -452,6 +462,122 @@ void Carel_Main_Task(void)
 //********************************************************
 
 
+/**
+ * @brief GME__GetLoopTimeout
+ *		  return how long the main loop can sleep waiting for an event.
+ *		  The transient states are re-run quickly, the steady ones are
+ *		  woken up by the radio/MQTT/config/button events or by the timeout
+ *
+ * @param  gme_sm_t prev_sm  the state of the previous loop
+ * @return C_UINT32 timeout in ms
+ */
+static C_UINT32 GME__GetLoopTimeout(gme_sm_t prev_sm)
+{
+	// a state has just changed, run the new one immediately
+	if (prev_sm != sm)
+		return GME_LOOP_BUSY_MS;
+
+	// reset/factory sequence in progress, it works on the button level
+	if (Sys__GetButtonState() != BUTTON_WAIT)
+		return GME_LOOP_BUTTON_MS;
+
+	switch (sm)
+	{
+		case GME_CHECK_FILES:
+		case GME_WAITING_FOR_INTERNET:
+		case GME_WAITING_FOR_CONFIG_FROM_MQTT:
+		case GME_START_POLLING_ENGINE:
+		case GME_IDLE_INTERNET_CONNECTED:
+			P_COV_LN;
+			return GME_LOOP_IDLE_MS;
+
+		default:
+			return GME_LOOP_BUSY_MS;
+	}
+}
+
+
+/**
+ * @brief GME__StartAcquisition
+ *		  start the Modbus master and the polling engine as soon as the
+ *		  gateway is configured and the model is valid, without waiting
+ *		  for NTP and MQTT. Only the first successful call has effect
+ *
+ * @param  none
+ * @return C_SUCCESS if the polling engine is running, C_FAIL otherwise
+ */
+static C_RES GME__StartAcquisition(void)
+{
+	C_RES retval;
+	C_UINT32 baudrate = 0;
+	C_BYTE connector = 0, aux = 0;
+	static mb_aux_poll_cfg_t aux_poll;
+	size_t aux_len;
+	uint8_t gw_status = 0, line_status = 0, devs_status = 0;
+
+	if (C_TRUE == PollEngine_MBStarted_IS())
+		return C_SUCCESS;
+
+	NVM__ReadU8Value(SET_GW_CONFIG_NVM, &gw_status);
+	NVM__ReadU8Value(SET_LINE_CONFIG_NVM, &line_status);
+	NVM__ReadU8Value(SET_DEVS_CONFIG_NVM, &devs_status);
+
+	// not configured or invalid model, it is managed once MQTT is connected
+	if ((CONFIGURED != gw_status) || (CONFIGURED != line_status) || (CONFIGURED != devs_status) ||
+		(CheckModelValidity() == FALSE))
+		return C_FAIL;
+
+	NVM__ReadU32Value(MB_BAUDRATE_NVM, &baudrate);		// read the baudrate from nvm
+	NVM__ReadU8Value(MB_CONNECTOR_NVM, &connector);		// read which uart to use (for rs485 or ttl) from nvm
+
+	MODBUS_PORT_SELECT(connector, modbusPort);
+
+	// in case of bcu only use ttl, pass proper parameter or force it somehow... TODO
+	retval = Modbus_Init(baudrate, GME__GetHEaderInfo()->Rs485Parity, GME__GetHEaderInfo()->Rs485Stop, modbusPort);
+	//TODO CPPCHECK test the return value
+
+	CAREL_CHECK(retval, "UART");
+
+	Sys__Delay(1000);
+
+	Modbus_Task_Start();
+	Sys__Delay(1000);
+
+	PollEngine_MBStart_IS();
+
+	// the other connector as aux line, polled by its own task with its own
+	// poll table, its uart is the one of the 2G modem
+	NVM__ReadU8Value(MB_AUX_NVM, &aux);
+	if ((aux == 1) && !PLATFORM(PLATFORM_DETECTED_2G) &&
+		(C_SUCCESS == ModbusAux__Init(Modbus__GetBaudrate(), Modbus__GetParity(), modbusPort)))
+	{
+		aux_len = sizeof(aux_poll);
+		if ((C_SUCCESS == NVM__ReadBlob(MB_AUX_POLL_NVM, (void*)&aux_poll, &aux_len)) &&
+			(aux_len == sizeof(aux_poll)) && (aux_poll.num > 0))
+			ModbusAux__PollStart(&aux_poll);
+	}
+
+	PRINTF_DEBUG("polling engine started at %u ms from boot\n", (unsigned)RTC_Get_Uptime_ms());
+	P_COV_LN;
+	return C_SUCCESS;
+}
+
+
+/**
+ * @brief GME__PostEvent
+ *		  wake up the main state machine, use one or more GME_EVT_xxx
+ *		  do NOT call it from an ISR
+ *
+ * @param  C_UINT32 events
+ * @return none
+ */
+void GME__PostEvent(C_UINT32 events)
+{
+	GME_PostEvent_IS(events);
+}
+
+
+
 /**
  * @brief GME__CheckHTMLConfig
  *		  If we received a new WiFi configuration during system running (Re-Configure)
@@ -26,9 +26,32 @@
 #endif
 
 
+/* ========================================================================== */
+/* main loop events                                                           */
+/* ========================================================================== */
+/**
+ * @brief GME_EVT_xxx
+ *        events that wake up the main state machine, they are posted
+ *        through GME__PostEvent() by the radio, MQTT, html config and
+ *        button handlers
+ */
+#define GME_EVT_RADIO     0x0001
+#define GME_EVT_MQTT      0x0002
+#define GME_EVT_CONFIG    0x0004
+#define GME_EVT_BUTTON    0x0008
+#define GME_EVT_TIMER     0x0010
+#define GME_EVT_ALL       (GME_EVT_RADIO | GME_EVT_MQTT | GME_EVT_CONFIG | GME_EVT_BUTTON | GME_EVT_TIMER)
 
-
-
+/**
+ * @brief GME_LOOP_xxx_MS
+ *        max time in ms the main loop sleeps waiting for an event
+ *        BUSY   used just after a state change
+ *        BUTTON used while the reset/factory button sequence is in progress
+ *        IDLE   used in the steady states, keep it well below SWWDT_DEFAULT_TIME
+ */
+#define GME_LOOP_BUSY_MS     10
+#define GME_LOOP_BUTTON_MS   100
+#define GME_LOOP_IDLE_MS     1000
 
 
 
@@ -9,8 +9,30 @@
 #include "main_IS.h"
 #include "main_CAREL.h"
 #include "data_types_CAREL.h"
+#include "IO_Port_IS.h"
+#include "gme_config.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include "freertos/event_groups.h"
+
+#ifdef INCLUDE_PLATFORM_DEPENDENT
+#include "driver/gpio.h"
+#ifdef CONFIG_PM_ENABLE
+#include "esp_pm.h"
+#endif
+#endif
+
+
+/**
+ * @brief GME_PM_MIN_FREQ_MHZ
+ *        lowest cpu frequency used by the power manager between two events
+ *        (only if CONFIG_PM_ENABLE is set in sdkconfig)
+ */
+#define GME_PM_MIN_FREQ_MHZ   40
+
+#ifdef INCLUDE_PLATFORM_DEPENDENT
+static EventGroupHandle_t s_main_event_group = NULL;
+#endif
 
 
 /**
@@ -23,7 +45,10 @@
 void Carel_Main_Task_Start(void)
 {
 #ifdef INCLUDE_PLATFORM_DEPENDENT
-  xTaskCreate(Carel_Main_Task, "Carel_Task", 3*(CONFIG_SYSTEM_EVENT_TASK_STACK_SIZE+512), NULL, tskIDLE_PRIORITY, NULL );
+  GME_EventInit_IS();
+  GME_ButtonEventInit_IS();
+  GME_PowerSaveInit_IS();
+  xTaskCreatePinnedToCore(Carel_Main_Task, "Carel_Task", 3*(CONFIG_SYSTEM_EVENT_TASK_STACK_SIZE+512), NULL, CAREL_TASK_PRIO, NULL, GME_NET_CORE);
 #endif
 }
 
@@ -39,3 +64,149 @@ void GME_Reboot_IS(void)
 	esp_restart();
 #endif
 }
+
+/**
+ * @brief GME_EventInit_IS
+ *		  create the event group used to wake up the main task
+ *		  must be called before any GME_PostEvent_IS
+ * @param  none
+ * @return none
+ */
+void GME_EventInit_IS(void)
+{
+#ifdef INCLUDE_PLATFORM_DEPENDENT
+	if (s_main_event_group == NULL)
+		s_main_event_group = xEventGroupCreate();
+#endif
+}
+
+/**
+ * @brief GME_PostEvent_IS
+ *		  signal one or more GME_EVT_xxx to the main task
+ *		  do NOT call it from an ISR
+ * @param  C_UINT32 events
+ * @return none
+ */
+void GME_PostEvent_IS(C_UINT32 events)
+{
+#ifdef INCLUDE_PLATFORM_DEPENDENT
+	if (s_main_event_group != NULL)
+		xEventGroupSetBits(s_main_event_group, (EventBits_t)(events & GME_EVT_ALL));
+#endif
+}
+
+/**
+ * @brief GME_WaitEvent_IS
+ *		  block the caller until an event is posted or the timeout expires
+ *		  the returned events are cleared
+ * @param  C_UINT32 timeout_ms
+ * @return C_UINT32 the received events, GME_EVT_TIMER on timeout
+ */
+C_UINT32 GME_WaitEvent_IS(C_UINT32 timeout_ms)
+{
+	C_UINT32 events = GME_EVT_TIMER;
+#ifdef INCLUDE_PLATFORM_DEPENDENT
+	if (s_main_event_group == NULL)
+	{
+		vTaskDelay(pdMS_TO_TICKS(timeout_ms));
+		return events;
+	}
+
+	events = (C_UINT32)xEventGroupWaitBits(s_main_event_group, GME_EVT_ALL, pdTRUE, pdFALSE, pdMS_TO_TICKS(timeout_ms));
+	events &= GME_EVT_ALL;
+	if (events == 0)
+		events = GME_EVT_TIMER;
+#endif
+	return events;
+}
+
+
+#ifdef INCLUDE_PLATFORM_DEPENDENT
+/**
+ * @brief button_isr_handler
+ *		  wake up the main task as soon as the reset button is pressed
+ * @param  void* arg
+ * @return none
+ */
+static void IRAM_ATTR button_isr_handler(void* arg)
+{
+	BaseType_t xHigherPriorityTaskWoken = pdFALSE;
+
+	if (s_main_event_group != NULL)
+		xEventGroupSetBitsFromISR(s_main_event_group, GME_EVT_BUTTON, &xHigherPriorityTaskWoken);
+
+	if (xHigherPriorityTaskWoken == pdTRUE)
+		portYIELD_FROM_ISR();
+}
+#endif
+
+/**
+ * @brief GME_ButtonEventInit_IS
+ *		  arm the interrupt on the reset button pin, the pin must be already
+ *		  configured (see Init_Pins)
+ * @param  none
+ * @return none
+ */
+void GME_ButtonEventInit_IS(void)
+{
+#ifdef INCLUDE_PLATFORM_DEPENDENT
+	int pin = Get_Button_Pin();
+	esp_err_t err;
+
+	if (pin < 0)
+		return;
+
+	gpio_set_intr_type(pin, GPIO_INTR_NEGEDGE);
+
+	// the service could be already installed by someone else
+	err = gpio_install_isr_service(0);
+	if ((err != ESP_OK) && (err != ESP_ERR_INVALID_STATE))
+	{
+		PRINTF_DEBUG("button isr service fail %d\n", err);
+		P_COV_LN;
+		return;
+	}
+
+	gpio_isr_handler_add(pin, button_isr_handler, NULL);
+	P_COV_LN;
+#endif
+}
+
+/**
+ * @brief GME_PowerSaveInit_IS
+ *		  on the WiFi model let the power manager scale the cpu frequency
+ *		  and enter the automatic light-sleep when all the tasks are blocked
+ *		  waiting for an event. Requires CONFIG_PM_ENABLE and, for the
+ *		  light-sleep, CONFIG_FREERTOS_USE_TICKLESS_IDLE in sdkconfig
+ * @param  none
+ * @return none
+ */
+void GME_PowerSaveInit_IS(void)
+{
+#ifdef INCLUDE_PLATFORM_DEPENDENT
+#ifdef CONFIG_PM_ENABLE
+	if (!PLATFORM(PLATFORM_DETECTED_WIFI))
+		return;
+
+	esp_pm_config_esp32_t pm_config = {
+		.max_freq_mhz = CONFIG_ESP32_DEFAULT_CPU_FREQ_MHZ,
+		.min_freq_mhz = GME_PM_MIN_FREQ_MHZ,
+#ifdef CONFIG_FREERTOS_USE_TICKLESS_IDLE
+		.light_sleep_enable = true
+#endif
+	};
+
+	if (ESP_OK != esp_pm_configure(&pm_config))
+	{
+		PRINTF_DEBUG("power management not configured\n");
+		P_COV_LN;
+		return;
+	}
+
+	// the button is not armed as wakeup source (a level wakeup would replace the
+	// edge interrupt), the main loop never sleeps more than GME_LOOP_IDLE_MS
+	// so a pressure is anyway caught by Sys__ResetCheck()
+	P_COV_LN;
+#endif
+#endif
+}
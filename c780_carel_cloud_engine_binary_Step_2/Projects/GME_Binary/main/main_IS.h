@@ -6,5 +6,13 @@
  *
  */
 
+#include "data_types_CAREL.h"
+
 void Carel_Main_Task_Start(void);
 void GME_Reboot_IS(void);
+
+void GME_EventInit_IS(void);
+void GME_PostEvent_IS(C_UINT32 events);
+C_UINT32 GME_WaitEvent_IS(C_UINT32 timeout_ms);
+void GME_ButtonEventInit_IS(void);
+void GME_PowerSaveInit_IS(void);
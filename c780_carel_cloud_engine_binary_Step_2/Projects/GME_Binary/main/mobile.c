@@ -8,6 +8,7 @@
 #include "IO_Port_IS.h"
 #include "radio.h"
 #include "sys_IS.h"
+#include "main_CAREL.h"
 
 static EventGroupHandle_t mobile_event_group = NULL;
 static const int CONNECT_BIT = BIT0;
@@ -48,11 +49,13 @@ static void modem_event_handler(void *event_handler_arg, esp_event_base_t event_
         ESP_LOGI(TAG, "~~~~~~~~~~~~~~");
         xEventGroupSetBits(mobile_event_group, CONNECT_BIT);
         Mobile__SetStatus(CONNECTED);
+        GME__PostEvent(GME_EVT_RADIO);
 		P_COV_LN;
         break;
     case MODEM_EVENT_PPP_DISCONNECT:
         ESP_LOGI(TAG, "Modem Disconnect from PPP Server");
         Mobile__SetStatus(DISCONNECTED);
+        GME__PostEvent(GME_EVT_RADIO);
 		P_COV_LN;
         break;
     case MODEM_EVENT_PPP_STOP:
@@ -109,6 +112,15 @@ gme_sm_t Mobile__Init(void){
     Mobile__SaveImeiCode(dce->imei);
     Mobile__SaveImsiCode(dce->imsi);
 
+#ifdef CONFIG_MODEM_USE_CMUX
+    // PPP and AT commands on two virtual channels, if the modem refuses
+    // the signal quality is read switching between data and command mode
+    if (esp_modem_start_cmux(dte) != ESP_OK) {
+        ESP_LOGW(TAG, "CMUX not available");
+		P_COV_LN;
+    }
+#endif
+
     return GME_RADIO_CONFIG;
 }
 
@@ -246,6 +258,16 @@ void Mobile_QuerySignalQuality(void){
 	uint32_t rssi = 0, ber = 0;
 	C_RES err = C_FAIL;
 
+	if (Mobile__IsCmuxActive()) {
+		// the AT channel is always available, PPP keeps running
+		err = dce->get_signal_quality(dce, &rssi, &ber);
+		PRINTF_DEBUG("Get signal quality result %d\n", err);
+		if (err == ESP_OK)
+			Mobile_SetSignalQuality(rssi);
+		P_COV_LN;
+		return;
+	}
+
 	printf("Set COMMAND mode at %d\n", RTC_Get_UTC_Current_Time());
 	Mobile_SetCommandMode(1);
 	err = dte->change_mode(dte,MODEM_COMMAND_MODE);
@@ -314,6 +336,10 @@ int16_t Mobile_GetSignalQuality(void){
 	return rssi_mean;
 }
 
+C_BOOL Mobile__IsCmuxActive(void){
+	return (dte != NULL) && esp_modem_cmux_active(dte);
+}
+
 uint8_t Mobile_GetCommandMode(void){
 	return command_mode;
 }
@@ -38,6 +38,7 @@ C_TIME Mobile__GetConnTime(void);
 C_INT16 Mobile_GetSignalQuality(void);
 void Mobile_SetSignalQuality(uint16_t rssi);
 void Mobile_QuerySignalQuality(void);
+C_BOOL Mobile__IsCmuxActive(void);
 
 uint8_t Mobile_GetCommandMode(void);
 void Mobile_SetCommandMode(uint8_t mode);
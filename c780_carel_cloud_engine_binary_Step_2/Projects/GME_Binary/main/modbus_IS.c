@@ -29,15 +29,80 @@
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "freertos/event_groups.h"
+#include "freertos/semphr.h"
+#include "esp_timer.h"
 
 #include "sys_IS.h"
 #include "SoftWDT.h"
 
 #include "IO_Port_IS.h"
 
+#ifdef CONFIG_PM_ENABLE
+#include "esp_pm.h"
+#endif
+
+// the UART event task of freemodbus must run with the interrupts it serves
+#if defined(CONFIG_FMB_PORT_TASK_AFFINITY) && (CONFIG_FMB_PORT_TASK_AFFINITY != CONFIG_GME_ACQ_CORE)
+#warning "CONFIG_FMB_PORT_TASK_AFFINITY differs from CONFIG_GME_ACQ_CORE"
+#endif
+
 #define  MODBUS_TIME_OUT    100
 #define  MFT_DELAY_TIMEOUT  3000
 
+/**
+ * @brief MB_PROBE_TURNAROUND_MS, MB_PROBE_CHARS
+ *        the respond timeout of a probe is the max turnaround of the slave
+ *        plus the time of the first chars of the answer, after the first char
+ *        the end of frame is detected by the T3.5 timer
+ */
+#define  MB_PROBE_TURNAROUND_MS   30
+#define  MB_PROBE_CHARS           3
+
+/**
+ * @brief runtime timing calibration
+ *        the first MB_TIMING_LEARN_SAMPLES transactions of each class of
+ *        function codes are done with the default respond timeout and measure
+ *        the turnaround of the slave, then the respond timeout is
+ *        MB_TIMING_MARGIN times the max turnaround observed (decaying slowly)
+ *        plus MB_TIMING_GUARD_MS, never less than MB_TIMING_MIN_MS.
+ *        When a learned timeout expires the next request of the class
+ *        (i.e. the retry of the polling) is done again with the default
+ *        timeout, so a slave occasionally slow doesn't fail all the retries
+ *
+ *        the delay between two requests (MB_Delay from NVM) is the upper bound
+ *        of the gap, after MB_GAP_OK_TO_REDUCE good transactions the gap is
+ *        halved, a timeout raises it again and the value become the lower
+ *        bound until the next calibration
+ */
+#define  MB_TIMING_LEARN_SAMPLES  8
+#define  MB_TIMING_MARGIN         2
+#define  MB_TIMING_GUARD_MS       5
+#define  MB_TIMING_MIN_MS         10
+#define  MB_TIMING_DECAY_SHIFT    4       // decay of 1/16 of the difference each sample
+
+#define  MB_GAP_OK_TO_REDUCE      32
+#define  MB_GAP_MIN_STEP_MS       10      // Sys__Delay resolution
+
+enum{
+	MB_TIMING_READ_BIT = 0,      // 0x01 0x02
+	MB_TIMING_READ_REG,          // 0x03 0x04
+	MB_TIMING_WRITE,             // 0x05 0x06 0x0F 0x10
+	MB_TIMING_NUM,
+};
+
+typedef struct{
+	C_UINT16 samples;
+	C_UINT32 turnaround_us;
+	C_BOOL   expired;           // the last request timed out after the calibration
+}mb_timing_t;
+
+/**
+ * @brief MODBUS_DISABLED_WAIT_MS
+ *        max time the modbus task sleeps while the engine is disabled,
+ *        Modbus_Enable wakes it up immediately
+ */
+#define  MODBUS_DISABLED_WAIT_MS  1000
+
 /**
  * @brief xMBMasterPortSerialTxPoll
  *        implementatiotion depend on the sistem chip in use!!!
@@ -46,13 +111,49 @@
  */
 extern BOOL xMBMasterPortSerialTxPoll(void);
 
+/**
+ * @brief vMBMasterPortTimersSetRespondTimeout, vMBMasterPortTimersSetT35
+ *        added to freeModbus porttimer_m.c (see patches)
+ */
+extern void vMBMasterPortTimersSetRespondTimeout(USHORT usTimeOutMs);
+extern void vMBMasterPortTimersSetT35(USHORT usTimeOut50us);
+
 
 static TaskHandle_t MODBUS_TASK = NULL;
 static uint32_t MB_Device = 0;
 static uint16_t MB_Delay = 0;
 
+static C_BYTE   MB_Port = MB_PORTNUM_485;
+static C_UINT32 MB_Baud = 0;
+static C_BYTE   MB_Parity = MB_PARITY_NONE;
+
+static mb_timing_t MB_Timing[MB_TIMING_NUM];
+static uint16_t MB_Gap = 0;
+static uint16_t MB_GapFloor = 0;
+static uint16_t MB_GapOk = 0;
+
 C_UINT16 ModbusDisabled = 0;
 
+#ifdef CONFIG_PM_ENABLE
+/* the uart baudrate depends on the APB clock, keep it fixed while the engine is enabled */
+static esp_pm_lock_handle_t MB_PmLock = NULL;
+#endif
+
+
+/*
+ * bus arbiter
+ * a recursive mutex, FreeRTOS mutexes have priority inheritance and keep the
+ * waiting tasks ordered by priority, so the mutex waiting list is the request
+ * queue of the bus. A client that needs an atomic sequence of transactions
+ * (ex. read-modify-write) acquires the bus around the whole sequence, the
+ * nested acquire of the single transaction is then immediate and not counted
+ */
+static SemaphoreHandle_t MB_BusMutex = NULL;
+static C_UINT16 MB_BusDepth = 0;
+static mb_client_stats_t MB_BusStats[MB_CLIENT_NUM];
+
+static mb_line_stats_t MB_LineStats[MB_LINE_NUM];
+
 
 extern CHAR ucMBFileTransfer[256]; //256 is the right value but
 extern USHORT usMBFileTransferLen;
@@ -66,24 +167,26 @@ extern USHORT usMBFileTransferLen;
 
 
 /**
- * @brief Modbus_Init
- *        Initialize the modbus protocol
+ * @brief Modbus_InitOnCore
+ *        Initialize the modbus protocol on the core of the caller
  *
  *        C_BYTE port are passed but not used
  *        the library of idf-esp  set UART_STOP_BITS_1 in portserial_m.c (riga 244)
  *
  *
  * @param C_INT32 baud
- * @param C_SBYTE parity
+ * @param C_SBYTE parity  eMBParity, as in the header of the model
  * @param C_SBYTE stopbit
  * @param C_BYTE port
  * @return C_RES
  */
-C_RES Modbus_Init(C_INT32 baud, C_SBYTE parity, C_SBYTE stopbit, C_BYTE port)
+static C_RES Modbus_InitOnCore(C_INT32 baud, C_SBYTE parity, C_SBYTE stopbit, C_BYTE port)
 {
      eMBErrorCode eStatus;
      esp_err_t err = C_FAIL;
 
+     Modbus__BusInit();
+
      if(port == MB_PORTNUM_485)
      {
    	    err = uart_set_pin(port, Get_TEST_TXD(), Get_TEST_RXD(), Get_TEST_RTS(), -1);
@@ -100,6 +203,11 @@ C_RES Modbus_Init(C_INT32 baud, C_SBYTE parity, C_SBYTE stopbit, C_BYTE port)
    	 if(err != 0)
    	   PRINTF_DEBUG("Setting UART pin fail\n");
 
+	 MB_Port = port;
+	 MB_Baud = baud;
+	 MB_Parity = Modbus__ParityFromEMB(parity);
+	 Modbus__TimingReset();
+
 	 eStatus = eMBMasterInit(MB_RTU, port, baud, parity);
 	 Sys__Delay(50);
 
@@ -121,6 +229,11 @@ C_RES Modbus_Init(C_INT32 baud, C_SBYTE parity, C_SBYTE stopbit, C_BYTE port)
     		}
 
     		if (ESP_FAIL == err) return C_FAIL;
+
+#ifdef CONFIG_PM_ENABLE
+    		if ((MB_PmLock == NULL) && (ESP_OK == esp_pm_lock_create(ESP_PM_APB_FREQ_MAX, 0, "modbus", &MB_PmLock)))
+    			esp_pm_lock_acquire(MB_PmLock);
+#endif
     		P_COV_LN;
     		return C_SUCCESS;
     	}
@@ -139,6 +252,60 @@ C_RES Modbus_Init(C_INT32 baud, C_SBYTE parity, C_SBYTE stopbit, C_BYTE port)
      return C_FAIL;
 }
 
+#ifdef INCLUDE_PLATFORM_DEPENDENT
+typedef struct{
+	C_INT32 baud;
+	C_SBYTE parity;
+	C_SBYTE stopbit;
+	C_BYTE port;
+	C_RES res;
+	TaskHandle_t caller;
+}mb_init_args_t;
+
+/*
+ * Modbus_InitTask
+ *        run Modbus_InitOnCore on GME_ACQ_CORE, the UART and timer
+ *        interrupts are allocated on the core of the task installing them
+ */
+static void Modbus_InitTask(void *arg)
+{
+	mb_init_args_t *a = (mb_init_args_t*)arg;
+
+	a->res = Modbus_InitOnCore(a->baud, a->parity, a->stopbit, a->port);
+	xTaskNotifyGive(a->caller);
+	vTaskDelete(NULL);
+}
+#endif
+
+/**
+ * @brief Modbus_Init
+ *        Initialize the modbus protocol on GME_ACQ_CORE, so the UART
+ *        and T3.5 timer interrupts are served there
+ *
+ * @param C_INT32 baud
+ * @param C_SBYTE parity
+ * @param C_SBYTE stopbit
+ * @param C_BYTE port
+ * @return C_RES
+ */
+C_RES Modbus_Init(C_INT32 baud, C_SBYTE parity, C_SBYTE stopbit, C_BYTE port)
+{
+#ifdef INCLUDE_PLATFORM_DEPENDENT
+	mb_init_args_t args = { baud, parity, stopbit, port, C_FAIL, xTaskGetCurrentTaskHandle() };
+
+	if ((GME_ACQ_CORE == tskNO_AFFINITY) || (xPortGetCoreID() == GME_ACQ_CORE))
+		return Modbus_InitOnCore(baud, parity, stopbit, port);
+
+	if (pdPASS != xTaskCreatePinnedToCore(&Modbus_InitTask, "MODBUS_INIT", 2*2048, &args, MODBUS_TASK_PRIO, NULL, GME_ACQ_CORE))
+		return C_FAIL;
+
+	ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+	return args.res;
+#else
+	return Modbus_InitOnCore(baud, parity, stopbit, port);
+#endif
+}
+
 
 /**
  * @brief Modbus_Task
@@ -155,8 +322,9 @@ void Modbus_Task(void)
 #ifdef INCLUDE_PLATFORM_DEPENDENT
 	while(1)
 	{
+		// engine disabled, sleep until Modbus_Enable
 		if(Modbus__GetStatus())
-			Sys__Delay(100);
+			ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(MODBUS_DISABLED_WAIT_MS));
 
 		SoftWDT_Reset(SWWDT_MODBUS_RTU );
 
@@ -183,7 +351,7 @@ void Modbus_Task(void)
 void Modbus_Task_Start(void)
 {
 #ifdef INCLUDE_PLATFORM_DEPENDENT
-	xTaskCreate(&Modbus_Task, "MODBUS_START", 2*2048, NULL, 10, MODBUS_TASK );
+	xTaskCreatePinnedToCore(&Modbus_Task, "MODBUS_START", 2*2048, NULL, MODBUS_TASK_PRIO, &MODBUS_TASK, GME_ACQ_CORE);
 #endif
 
 }
@@ -192,6 +360,124 @@ void Modbus_Task_Start(void)
 
 
 
+#ifdef INCLUDE_PLATFORM_DEPENDENT
+/**
+ * @brief mb_frame_us
+ *        time on the line of a frame, 10 bits per char to not overestimate it
+ *
+ * @param  C_UINT16 bytes
+ * @return C_UINT32 time in us
+ */
+static C_UINT32 mb_frame_us(C_UINT16 bytes)
+{
+	if (MB_Baud == 0)
+		return 0;
+
+	return (C_UINT32)(((uint64_t)bytes * 10 * 1000000) / MB_Baud);
+}
+
+/**
+ * @brief mb_timing_start
+ *        set the respond timeout of the class before a request
+ *
+ * @param  C_BYTE cls  MB_TIMING_xxx
+ * @return int64_t start time of the request in us
+ */
+static int64_t mb_timing_start(C_BYTE cls)
+{
+	C_UINT32 timeout_ms = 0;
+	mb_timing_t *t = &MB_Timing[cls];
+
+	// calibration not yet done or retry of an expired learned timeout, use the default
+	if ((t->samples >= MB_TIMING_LEARN_SAMPLES) && (MB_Baud != 0) && (t->expired == C_FALSE))
+	{
+		timeout_ms = (t->turnaround_us * MB_TIMING_MARGIN + mb_frame_us(1)) / 1000 + MB_TIMING_GUARD_MS;
+		if (timeout_ms < MB_TIMING_MIN_MS)
+			timeout_ms = MB_TIMING_MIN_MS;
+		if (timeout_ms > 0xFFFF)
+			timeout_ms = 0;
+	}
+
+	vMBMasterPortTimersSetRespondTimeout((USHORT)timeout_ms);
+
+	return esp_timer_get_time();
+}
+
+/**
+ * @brief mb_timing_end
+ *        update the turnaround of the class and the gap between requests
+ *        with the result of the request
+ *
+ * @param  C_BYTE cls  MB_TIMING_xxx
+ * @param  int64_t t_start returned by mb_timing_start
+ * @param  C_UINT16 tx_bytes  length of the request
+ * @param  C_UINT16 rx_bytes  expected length of the answer
+ * @param  eMBMasterReqErrCode err
+ * @return none
+ */
+static void mb_timing_end(C_BYTE cls, int64_t t_start, C_UINT16 tx_bytes, C_UINT16 rx_bytes, eMBMasterReqErrCode err)
+{
+	mb_timing_t *t = &MB_Timing[cls];
+	C_UINT32 elapsed = (C_UINT32)(esp_timer_get_time() - t_start);
+	C_UINT32 frames = mb_frame_us(tx_bytes) + mb_frame_us(rx_bytes);
+	C_UINT32 turnaround;
+
+	vMBMasterPortTimersSetRespondTimeout(0);
+
+	// a timeout after the calibration, the next request uses the default one
+	t->expired = ((err == MB_MRE_TIMEDOUT) && (t->samples >= MB_TIMING_LEARN_SAMPLES)) ? C_TRUE : C_FALSE;
+
+	Modbus__LineAccount(MB_LINE_MAIN, elapsed, (err == MB_MRE_NO_ERR) ? tx_bytes + rx_bytes : tx_bytes, (err == MB_MRE_NO_ERR) ? C_TRUE : C_FALSE);
+
+	if (err == MB_MRE_NO_ERR)
+	{
+		turnaround = (elapsed > frames) ? (elapsed - frames) : 0;
+		Modbus__LineTurnaround(MB_LINE_MAIN, turnaround);
+
+		// follow immediately a slower slave, forget slowly a faster one
+		if ((t->samples == 0) || (turnaround > t->turnaround_us))
+			t->turnaround_us = turnaround;
+		else
+			t->turnaround_us -= (t->turnaround_us - turnaround) >> MB_TIMING_DECAY_SHIFT;
+
+		if (t->samples < MB_TIMING_LEARN_SAMPLES)
+			t->samples++;
+
+		// try a shorter gap
+		if ((MB_Gap > MB_GapFloor) && (++MB_GapOk >= MB_GAP_OK_TO_REDUCE))
+		{
+			MB_Gap = (MB_Gap / 2 < MB_GAP_MIN_STEP_MS) ? 0 : MB_Gap / 2;
+			if (MB_Gap < MB_GapFloor)
+				MB_Gap = MB_GapFloor;
+			MB_GapOk = 0;
+			#ifdef __DEBUG_MODBUS_INTERFACE_LEV_2
+			PRINTF_DEBUG("MB gap reduced to %d ms\n", MB_Gap);
+			#endif
+		}
+	}
+	else if (err == MB_MRE_TIMEDOUT)
+	{
+		// the timeout could be too short, relax it
+		if (t->samples >= MB_TIMING_LEARN_SAMPLES)
+		{
+			t->turnaround_us *= 2;
+			if (t->turnaround_us > (MB_MASTER_TIMEOUT_MS_RESPOND * 1000))
+				t->turnaround_us = MB_MASTER_TIMEOUT_MS_RESPOND * 1000;
+		}
+
+		// the gap could be too short, never go below this value again
+		if (MB_Gap < MB_Delay)
+		{
+			MB_GapFloor = (MB_Gap == 0) ? MB_GAP_MIN_STEP_MS : MB_Gap * 2;
+			if (MB_GapFloor > MB_Delay)
+				MB_GapFloor = MB_Delay;
+			MB_Gap = MB_GapFloor;
+		}
+		MB_GapOk = 0;
+	}
+}
+#endif
+
 /**
  * @brief app_coil_read
  *       execute the read function - 0x01 (single or multi-coils)
@@ -203,30 +489,24 @@ void Modbus_Task_Start(void)
  * @return int result
  */
 
-static volatile C_BYTE is_busy_coil = 0;
-
 int app_coil_read(const uint8_t addr, const int index, const int num)
 {
 	C_RES result = C_SUCCESS;
 
-	while(is_busy_coil)
-	{
-	  PRINTF_DEBUG("is busy modbus %d \r\n", is_busy_coil);
-	  Sys__Delay(1000);
-	}
-
-	is_busy_coil++;
+	Modbus__BusAcquire(MB_CLIENT_POLLING);
 
 #ifdef INCLUDE_PLATFORM_DEPENDENT
     const long timeout = MODBUS_TIME_OUT;
     eMBMasterReqErrCode errorCode = MB_MRE_NO_ERR;
     const USHORT saddr = index;
+    const int64_t t_start = mb_timing_start(MB_TIMING_READ_BIT);
     errorCode = eMBMasterReqReadCoils(addr, saddr, num, timeout);
+    mb_timing_end(MB_TIMING_READ_BIT, t_start, 8, 5 + (num + 7) / 8, errorCode);
     result = errorCode;
 #endif
     Modbus__Delay();
 
-    is_busy_coil--;
+    Modbus__BusRelease();
 
     return result;
 }
@@ -243,30 +523,24 @@ int app_coil_read(const uint8_t addr, const int index, const int num)
  * @return int result
  */
 
-static volatile C_BYTE is_busy_di = 0;
-
 int app_coil_discrete_input_read(const uint8_t addr, const int index, const int num)
 {
 	C_RES result = C_SUCCESS;
 
-	while(is_busy_di)
-	{
-	  PRINTF_DEBUG("is busy modbus %d \r\n", is_busy_di);
-	  Sys__Delay(1000);
-	}
-
-	is_busy_di++;
+	Modbus__BusAcquire(MB_CLIENT_POLLING);
 
 #ifdef INCLUDE_PLATFORM_DEPENDENT
     const long timeout = MODBUS_TIME_OUT;
     eMBMasterReqErrCode errorCode = MB_MRE_NO_ERR;
     const USHORT saddr = index;
+    const int64_t t_start = mb_timing_start(MB_TIMING_READ_BIT);
     errorCode = eMBMasterReqReadDiscreteInputs(addr, saddr, num, timeout);
+    mb_timing_end(MB_TIMING_READ_BIT, t_start, 8, 5 + (num + 7) / 8, errorCode);
     result = errorCode;
 #endif
     Modbus__Delay();
 
-    is_busy_di--;
+    Modbus__BusRelease();
 
     return result;
 }
@@ -283,30 +557,24 @@ int app_coil_discrete_input_read(const uint8_t addr, const int index, const int
  * @return int result
  */
 
-static volatile C_BYTE is_busy_hr = 0;
-
 int app_holding_register_read(const uint8_t addr, const int index, const int num)
 {
 	C_RES result = C_SUCCESS;
 
-	while(is_busy_hr)
-	{
-	  PRINTF_DEBUG("is busy modbus %d \r\n", is_busy_hr);
-	  Sys__Delay(1000);
-	}
-
-	is_busy_hr++;
+	Modbus__BusAcquire(MB_CLIENT_POLLING);
 
 #ifdef INCLUDE_PLATFORM_DEPENDENT
     const long timeout = MODBUS_TIME_OUT;
     eMBMasterReqErrCode errorCode = MB_MRE_NO_ERR;
     const USHORT saddr = index;
+    const int64_t t_start = mb_timing_start(MB_TIMING_READ_REG);
     errorCode = eMBMasterReqReadHoldingRegister(addr, saddr, num, timeout);
+    mb_timing_end(MB_TIMING_READ_REG, t_start, 8, 5 + 2 * num, errorCode);
     result = errorCode;
 #endif
     Modbus__Delay();
 
-    is_busy_hr--;
+    Modbus__BusRelease();
 
     return result;
 }
@@ -323,30 +591,92 @@ int app_holding_register_read(const uint8_t addr, const int index, const int num
  * @return int result
  */
 
-static volatile C_BYTE is_busy_ir = 0;
-
 int app_input_register_read(const uint8_t addr, const int index, const int num)
 {
 	C_RES result = C_SUCCESS;
 
-	while(is_busy_ir)
-	{
-	  PRINTF_DEBUG("is busy modbus %d \r\n", is_busy_ir);
-	  Sys__Delay(1000);
-	}
-
-	is_busy_ir++;
+	Modbus__BusAcquire(MB_CLIENT_POLLING);
 
 #ifdef INCLUDE_PLATFORM_DEPENDENT
     const long timeout = MODBUS_TIME_OUT;
     eMBMasterReqErrCode errorCode = MB_MRE_NO_ERR;
     const USHORT saddr = index;
+    const int64_t t_start = mb_timing_start(MB_TIMING_READ_REG);
     errorCode = eMBMasterReqReadInputRegister(addr, saddr, num, timeout);
+    mb_timing_end(MB_TIMING_READ_REG, t_start, 8, 5 + 2 * num, errorCode);
     result = errorCode;
 #endif
     Modbus__Delay();
 
-    is_busy_ir--;
+    Modbus__BusRelease();
+
+    return result;
+}
+
+
+/**
+ * @brief app_block_read
+ *       execute a read function (0x01, 0x02, 0x03, 0x04) of many
+ *       elements and return the data as they are on the wire: the bits
+ *       packed LSB first, the registers big endian. The answer doesn't
+ *       go through param_buffer, that holds only 32 bits
+ *
+ * @param  const uint8_t addr
+ * @param  const C_BYTE func
+ * @param  const int index
+ * @param  const int num
+ * @param  C_BYTE *data  at least 2 + the bytes of the data
+ * @param  C_UINT16 *data_len  in size of data, out bytes of the data
+ *
+ * @return int result, MB_MRE_EXE_FUN if the slave answered with an exception
+ */
+int app_block_read(const uint8_t addr, const C_BYTE func, const int index, const int num, C_BYTE *data, C_UINT16 *data_len)
+{
+	int result = MB_MRE_ILL_ARG;
+	const C_BYTE is_bit = ((func == MB_FUNC_READ_COILS) || (func == MB_FUNC_READ_DISCRETE_INPUTS)) ? 1 : 0;
+	const C_UINT16 bytes = is_bit ? (num + 7) / 8 : 2 * num;
+	C_BYTE pdu[5];
+
+	if ((num <= 0) || (*data_len < bytes + 2))
+		return result;
+
+	pdu[0] = func;
+	pdu[1] = (C_BYTE)(index >> 8);
+	pdu[2] = (C_BYTE)(index & 0xFF);
+	pdu[3] = (C_BYTE)(num >> 8);
+	pdu[4] = (C_BYTE)(num & 0xFF);
+
+	Modbus__BusAcquire(MB_CLIENT_POLLING);
+
+#ifdef INCLUDE_PLATFORM_DEPENDENT
+    const long timeout = MODBUS_TIME_OUT;
+    const C_BYTE cls = is_bit ? MB_TIMING_READ_BIT : MB_TIMING_READ_REG;
+    USHORT len = *data_len;
+    const int64_t t_start = mb_timing_start(cls);
+
+    // the answer PDU is received in place: function, byte count, data
+    result = eMBMasterReqRaw(addr, pdu, sizeof(pdu), data, &len, timeout);
+
+    if (result == MB_MRE_NO_ERR)
+    {
+    	if ((len >= 1) && (data[0] & 0x80))
+    		result = MB_MRE_EXE_FUN;
+    	else if ((len != bytes + 2) || (data[0] != func) || (data[1] != bytes))
+    		result = MB_MRE_REV_DATA;
+    }
+    mb_timing_end(cls, t_start, 8, 5 + bytes, result);
+
+    if (result == MB_MRE_NO_ERR)
+    {
+    	memmove(data, &data[2], bytes);
+    	*data_len = bytes;
+    }
+    else
+    	*data_len = 0;
+#endif
+    Modbus__Delay();
+
+    Modbus__BusRelease();
 
     return result;
 }
@@ -368,17 +698,23 @@ int app_coil_write(const uint8_t addr, const int index, short newData, int multi
 {
 	C_RES result = C_SUCCESS;
 
+	Modbus__BusAcquire(MB_CLIENT_POLLING);
+
 #ifdef INCLUDE_PLATFORM_DEPENDENT
     const long timeout = MODBUS_TIME_OUT;
     eMBMasterReqErrCode errorCode = MB_MRE_NO_ERR;
+    const int64_t t_start = mb_timing_start(MB_TIMING_WRITE);
     if (multi == SINGLE)
     	errorCode = eMBMasterReqWriteCoil( addr, index, newData,timeout);
     else
     	errorCode = eMBMasterReqWriteMultipleCoils(addr, index, 1, &newData, timeout);	// we are sending a multiple coils write even if we always write a single coil
                                                                                     	// this is just for compatibility with those devices only accepting multiple write operations
+    mb_timing_end(MB_TIMING_WRITE, t_start, (multi == SINGLE) ? 8 : 10, 8, errorCode);
     result = errorCode;
 #endif
     Modbus__Delay();
+
+    Modbus__BusRelease();
     return result;
 }
 
@@ -398,18 +734,24 @@ int app_hr_write(const uint8_t addr, const int index, C_CHAR num_of , C_UINT16 *
 {
 	C_RES result = C_SUCCESS;
 
+	Modbus__BusAcquire(MB_CLIENT_POLLING);
+
 #ifdef INCLUDE_PLATFORM_DEPENDENT
     const long timeout = MODBUS_TIME_OUT;
     eMBMasterReqErrCode errorCode = MB_MRE_NO_ERR;
+    const int64_t t_start = mb_timing_start(MB_TIMING_WRITE);
 
     if (multi == SINGLE)
     	errorCode = eMBMasterReqWriteHoldingRegister( addr, index, *newData, timeout );
     else
     	errorCode = eMBMasterReqWriteMultipleHoldingRegister( addr, index, num_of, newData, timeout );  // we are sending a multiple hrs write even if we can write at most 2 contiguous hrs
                                                                                                       	// this is just for compatibility with those devices only accepting multiple write operations
+    mb_timing_end(MB_TIMING_WRITE, t_start, (multi == SINGLE) ? 8 : 9 + 2 * num_of, 8, errorCode);
     result = errorCode;
 #endif
     Modbus__Delay();
+
+    Modbus__BusRelease();
     return result;
 }
 
@@ -423,17 +765,98 @@ int app_hr_write(const uint8_t addr, const int index, C_CHAR num_of , C_UINT16 *
  * @return int result
  */
 C_RES app_report_slave_id_read(const uint8_t addr)
+{
+   return app_report_slave_id_probe(addr, 0);
+}
+
+/**
+ * @brief app_report_slave_id_probe
+ *       execute the report slave id function with a custom respond timeout,
+ *       used to probe the presence of a device. If nobody answers the delay
+ *       between two requests is skipped
+ *
+ * @param  const uint8_t addr
+ * @param  C_UINT16 timeout_ms  respond timeout, 0 use the default one
+ * @return int result
+ */
+C_RES app_report_slave_id_probe(const uint8_t addr, C_UINT16 timeout_ms)
 {
    C_RES result = C_SUCCESS;
 
+   Modbus__BusAcquire(MB_CLIENT_SCAN);
+
 #ifdef INCLUDE_PLATFORM_DEPENDENT
     const long timeout = MODBUS_TIME_OUT;
     eMBMasterReqErrCode errorCode = MB_MRE_NO_ERR;
 
+    vMBMasterPortTimersSetRespondTimeout(timeout_ms);
     errorCode = eMBMAsterReqReportSlaveId(addr, timeout);
+    vMBMasterPortTimersSetRespondTimeout(0);
     result = errorCode;
 #endif
-    Modbus__Delay();
+    if (result != MB_MRE_TIMEDOUT)
+      Modbus__Delay();
+
+    Modbus__BusRelease();
+    return result;
+}
+
+/**
+ * @brief app_raw_adu
+ *        send a RTU ADU as it is and return the ADU of the response,
+ *        the CRC of the request is checked and the one of the response
+ *        is rebuilt. An exception response is a valid response
+ *
+ * @param  const C_BYTE *adu  address, PDU and CRC
+ * @param  C_UINT16 adu_len
+ * @param  C_BYTE *rsp  response ADU
+ * @param  C_UINT16 *rsp_len  in size of rsp, out length of the response
+ * @param  C_UINT16 timeout_ms  respond timeout, 0 use the default one
+ * @return int result, MB_MRE_NO_ERR if the slave answered
+ */
+int app_raw_adu(const C_BYTE *adu, C_UINT16 adu_len, C_BYTE *rsp, C_UINT16 *rsp_len, C_UINT16 timeout_ms)
+{
+   int result = MB_MRE_ILL_ARG;
+   C_UINT16 crc;
+
+   if ((adu_len < 4) || (*rsp_len < 4))
+	   return result;
+
+   crc = CRC16(adu, adu_len - 2);
+   if ((adu[adu_len - 2] != (C_BYTE)(crc & 0xFF)) || (adu[adu_len - 1] != (C_BYTE)(crc >> 8)))
+	   return result;
+
+   Modbus__BusAcquire(MB_CLIENT_TUNNEL);
+
+#ifdef INCLUDE_PLATFORM_DEPENDENT
+    const long timeout = MODBUS_TIME_OUT;
+    USHORT len = *rsp_len - 3;
+    const int64_t t_start = esp_timer_get_time();
+
+    vMBMasterPortTimersSetRespondTimeout(timeout_ms);
+    result = eMBMasterReqRaw(adu[0], &adu[1], adu_len - 3, &rsp[1], &len, timeout);
+    vMBMasterPortTimersSetRespondTimeout(0);
+
+    Modbus__LineAccount(MB_LINE_MAIN, (C_UINT32)(esp_timer_get_time() - t_start), adu_len + (((result == MB_MRE_NO_ERR) && (len > 0)) ? len + 3 : 0),
+    		(result == MB_MRE_NO_ERR) ? C_TRUE : C_FALSE);
+
+    if ((result == MB_MRE_NO_ERR) && (len == 0))
+    	*rsp_len = 0;		// broadcast
+    else if (result == MB_MRE_NO_ERR)
+    {
+    	rsp[0] = adu[0];
+    	crc = CRC16(rsp, len + 1);
+    	rsp[len + 1] = (C_BYTE)(crc & 0xFF);
+    	rsp[len + 2] = (C_BYTE)(crc >> 8);
+    	*rsp_len = len + 3;
+    }
+    else
+    	*rsp_len = 0;
+#endif
+    if (result != MB_MRE_TIMEDOUT)
+      Modbus__Delay();
+
+    Modbus__BusRelease();
     return result;
 }
 
@@ -456,6 +879,8 @@ C_RES app_file_transfer(unsigned char* data_tx, uint8_t packet_len)
    const int MAX_RETRY = 10;  //5  //3;
 
     C_RES result = C_SUCCESS;
+
+    Modbus__BusAcquire(MB_CLIENT_DEV_OTA);
 #ifdef INCLUDE_PLATFORM_DEPENDENT
 do{
 	retrypacket++;
@@ -487,6 +912,7 @@ do{
     	printf("app_file_transfer MAX_RETRY\r\n");
         #endif
     	result = C_FAIL;
+    	Modbus__BusRelease();
     	return result;
     }
 
@@ -494,7 +920,6 @@ do{
 
     //TODO CPPCHECK result non è testato maglio testare
     //errorcode che torna   MB_MRE_ILL_ARG / MB_MRE_MASTER_BUSY / più significativo
-    //sopratutto se un giorno implementiamo ADU .... Brrrrivido
 
     memset(data_rx, 0, 260);
     data_rx_len = usMBFileTransferLen + 3;
@@ -566,6 +991,8 @@ do{
 
 
     Modbus__Delay();
+
+    Modbus__BusRelease();
     return result;
 }
 
@@ -592,6 +1019,8 @@ C_RES app_file_read(unsigned char* data_tx, uint8_t packet_len, unsigned char* d
 
 	C_RES result = C_SUCCESS;
 
+	Modbus__BusAcquire(MB_CLIENT_FILELOG);
+
 #ifdef INCLUDE_PLATFORM_DEPENDENT
 
 	do{
@@ -632,6 +1061,7 @@ C_RES app_file_read(unsigned char* data_tx, uint8_t packet_len, unsigned char* d
 	}
 #endif
 
+	Modbus__BusRelease();
 	return result;
 }
 
@@ -649,6 +1079,10 @@ void Modbus_Disable(void)
 {
 #ifdef INCLUDE_PLATFORM_DEPENDENT
 	eMBMasterDisable();
+#ifdef CONFIG_PM_ENABLE
+	if ((MB_PmLock != NULL) && (ModbusDisabled == 0))
+		esp_pm_lock_release(MB_PmLock);
+#endif
 #endif
 	ModbusDisabled = 1;
 }
@@ -677,12 +1111,21 @@ C_UINT16 Modbus__GetStatus(void){
 void Modbus_Enable(void)
 {
 #ifdef INCLUDE_PLATFORM_DEPENDENT
+#ifdef CONFIG_PM_ENABLE
+	if ((MB_PmLock != NULL) && (ModbusDisabled == 1))
+		esp_pm_lock_acquire(MB_PmLock);
+#endif
 	ClearQueueMB();
 	eMBMasterEnable();
 	// avoid Modbus engine to stop
 	vMBMasterRunResRelease();
 #endif
 	ModbusDisabled = 0;
+
+#ifdef INCLUDE_PLATFORM_DEPENDENT
+	if (MODBUS_TASK != NULL)
+		xTaskNotifyGive(MODBUS_TASK);
+#endif
 }
 
 /**
@@ -714,6 +1157,7 @@ void Modbus__ReadDelayFromNVM(void){
 	else
 	    MB_Delay = 0;
 	PRINTF_DEBUG("MB_Delay %d\n", MB_Delay);
+	Modbus__TimingReset();
 }
 
 /**
@@ -729,12 +1173,406 @@ C_UINT16 Modbus__GetAddress(void){
 
 /**
  * @brief Modbus__Delay
- *		  execute the dalay between two request
+ *		  execute the dalay between two request, the gap is tuned at runtime
+ *		  and never exceeds the one configured in NVM
  *
  * @param  none
  * @return none
  */
 void Modbus__Delay(void){
-	if(MB_Delay > 0)
-	  Sys__Delay(MB_Delay);
+	if(MB_Gap > 0)
+	  Sys__Delay(MB_Gap);
+}
+
+/**
+ * @brief Modbus__TimingReset
+ *		  restart the calibration of the respond timeouts and of the gap
+ *		  between two requests, to call when the line or the slave change
+ *
+ * @param  none
+ * @return none
+ */
+void Modbus__TimingReset(void){
+	memset((void*)MB_Timing, 0, sizeof(MB_Timing));
+	MB_Gap = MB_Delay;
+	MB_GapFloor = 0;
+	MB_GapOk = 0;
+}
+
+/**
+ * @brief Modbus__GetRespondTimeout
+ *		  respond timeout calibrated for a read of registers
+ *
+ * @param  none
+ * @return C_UINT16 timeout in ms, 0 calibration in progress
+ */
+C_UINT16 Modbus__GetRespondTimeout(void){
+	C_UINT32 timeout_ms = 0;
+#ifdef INCLUDE_PLATFORM_DEPENDENT
+	if (MB_Timing[MB_TIMING_READ_REG].samples >= MB_TIMING_LEARN_SAMPLES)
+		timeout_ms = (MB_Timing[MB_TIMING_READ_REG].turnaround_us * MB_TIMING_MARGIN + mb_frame_us(1)) / 1000 + MB_TIMING_GUARD_MS;
+#endif
+	return (C_UINT16)timeout_ms;
+}
+
+/**
+ * @brief Modbus__GetGap
+ *		  actual gap between two requests
+ *
+ * @param  none
+ * @return C_UINT16 gap in ms
+ */
+C_UINT16 Modbus__GetGap(void){
+	return MB_Gap;
+}
+
+
+/**
+ * @brief Modbus__BusInit
+ *        create the bus arbiter, must be called before the first
+ *        transaction (see Modbus_Init)
+ *
+ * @param  none
+ * @return none
+ */
+void Modbus__BusInit(void)
+{
+#ifdef INCLUDE_PLATFORM_DEPENDENT
+	if (MB_BusMutex == NULL)
+	{
+		MB_BusMutex = xSemaphoreCreateRecursiveMutex();
+		memset((void*)MB_BusStats, 0, sizeof(MB_BusStats));
+	}
+#endif
+}
+
+/**
+ * @brief Modbus__BusAcquire
+ *        wait until the bus is granted to the caller, the waiting requests
+ *        are served by task priority and the holder inherits the priority
+ *        of the highest waiting one. The queueing delay is accounted to client
+ *        Every Modbus__BusAcquire must be paired with a Modbus__BusRelease
+ *
+ * @param  mb_client_t client
+ * @return C_RES
+ */
+C_RES Modbus__BusAcquire(mb_client_t client)
+{
+#ifdef INCLUDE_PLATFORM_DEPENDENT
+	int64_t t_req;
+	C_UINT32 wait_us;
+
+	// arbiter not yet created, nothing else can use the bus
+	if (MB_BusMutex == NULL)
+		return C_SUCCESS;
+
+	if (client >= MB_CLIENT_NUM)
+		client = MB_CLIENT_POLLING;
+
+	t_req = esp_timer_get_time();
+
+	xSemaphoreTakeRecursive(MB_BusMutex, portMAX_DELAY);
+
+	// nested acquire, the bus is already granted to the outer request
+	if (++MB_BusDepth > 1)
+		return C_SUCCESS;
+
+	wait_us = (C_UINT32)(esp_timer_get_time() - t_req);
+
+	MB_BusStats[client].count++;
+	MB_BusStats[client].wait_last_us = wait_us;
+	MB_BusStats[client].wait_tot_us += wait_us;
+	if (wait_us > MB_BusStats[client].wait_max_us)
+		MB_BusStats[client].wait_max_us = wait_us;
+
+	#ifdef __DEBUG_MODBUS_INTERFACE_LEV_2
+	PRINTF_DEBUG("MB bus to client %d after %d us\n", client, wait_us);
+	#endif
+#endif
+	return C_SUCCESS;
+}
+
+/**
+ * @brief Modbus__BusRelease
+ *        give back the bus acquired with Modbus__BusAcquire
+ *
+ * @param  none
+ * @return none
+ */
+void Modbus__BusRelease(void)
+{
+#ifdef INCLUDE_PLATFORM_DEPENDENT
+	if (MB_BusMutex == NULL)
+		return;
+
+	if (MB_BusDepth > 0)
+		MB_BusDepth--;
+
+	xSemaphoreGiveRecursive(MB_BusMutex);
+#endif
+}
+
+/**
+ * @brief Modbus__GetBusStats
+ *        copy the queueing delay statistics of a client
+ *
+ * @param  mb_client_t client
+ * @param  mb_client_stats_t *stats
+ * @return C_RES
+ */
+C_RES Modbus__GetBusStats(mb_client_t client, mb_client_stats_t *stats)
+{
+	if ((client >= MB_CLIENT_NUM) || (stats == NULL))
+		return C_FAIL;
+
+	*stats = MB_BusStats[client];
+	return C_SUCCESS;
+}
+
+/**
+ * @brief Modbus__ResetBusStats
+ *        clear the queueing delay statistics of all the clients
+ *
+ * @param  none
+ * @return none
+ */
+void Modbus__ResetBusStats(void)
+{
+	memset((void*)MB_BusStats, 0, sizeof(MB_BusStats));
+}
+
+/**
+ * @brief Modbus__LineAccount
+ *        account a transaction in the statistics of its line, called
+ *        with the line owned by the caller
+ *
+ * @param  mb_line_t line
+ * @param  C_UINT32 elapsed_us  from the request to the end of the answer
+ * @param  C_UINT16 bytes  sent and received
+ * @param  C_BOOL ok  C_FALSE the slave didn't answer or the answer is wrong
+ * @return none
+ */
+void Modbus__LineAccount(mb_line_t line, C_UINT32 elapsed_us, C_UINT16 bytes, C_BOOL ok)
+{
+	mb_line_stats_t *s;
+
+	if (line >= MB_LINE_NUM)
+		return;
+
+	s = &MB_LineStats[line];
+#ifdef INCLUDE_PLATFORM_DEPENDENT
+	if (s->since_us == 0)
+		s->since_us = esp_timer_get_time() - elapsed_us;
+#endif
+	s->requests++;
+	if (C_FALSE == ok)
+		s->errors++;
+	s->bytes += bytes;
+	s->busy_us += elapsed_us;
+	if (elapsed_us > s->lat_max_us)
+		s->lat_max_us = elapsed_us;
+}
+
+/**
+ * @brief Modbus__LineTurnaround
+ *        account the turnaround of an answer, the time on the line of
+ *        the frames excluded
+ *
+ * @param  mb_line_t line
+ * @param  C_UINT32 turnaround_us
+ * @return none
+ */
+void Modbus__LineTurnaround(mb_line_t line, C_UINT32 turnaround_us)
+{
+	mb_line_stats_t *s;
+
+	if (line >= MB_LINE_NUM)
+		return;
+
+	s = &MB_LineStats[line];
+	if ((s->ta_max_us == 0) || (turnaround_us < s->ta_min_us))
+		s->ta_min_us = turnaround_us;
+	if (turnaround_us > s->ta_max_us)
+		s->ta_max_us = turnaround_us;
+}
+
+/**
+ * @brief Modbus__GetLineStats
+ *        copy the statistics of a line
+ *
+ * @param  mb_line_t line
+ * @param  mb_line_stats_t *stats
+ * @return C_RES
+ */
+C_RES Modbus__GetLineStats(mb_line_t line, mb_line_stats_t *stats)
+{
+	if ((line >= MB_LINE_NUM) || (stats == NULL))
+		return C_FAIL;
+
+	*stats = MB_LineStats[line];
+	return C_SUCCESS;
+}
+
+/**
+ * @brief Modbus__ResetLineStats
+ *        restart the statistics of a line
+ *
+ * @param  mb_line_t line
+ * @return none
+ */
+void Modbus__ResetLineStats(mb_line_t line)
+{
+	if (line < MB_LINE_NUM)
+		memset((void*)&MB_LineStats[line], 0, sizeof(mb_line_stats_t));
+}
+
+/**
+ * @brief Modbus__GetProbeTimeout
+ *        respond timeout used to probe a device at the given baudrate
+ *
+ * @param  C_UINT32 baud
+ * @return C_UINT16 timeout in ms, 0 means the default one
+ */
+C_UINT16 Modbus__GetProbeTimeout(C_UINT32 baud)
+{
+	if (baud == 0)
+		return 0;
+
+	return MB_PROBE_TURNAROUND_MS + (C_UINT16)((MB_PROBE_CHARS * 11 * 1000 + baud - 1) / baud);
+}
+
+/**
+ * @brief Modbus__SetLineConfig
+ *        change at runtime baudrate and parity of the line in use,
+ *        the configuration in NVM is not changed
+ *        the caller must own the bus (see Modbus__BusAcquire)
+ *
+ * @param  C_UINT32 baud
+ * @param  C_BYTE parity (MB_PARITY_xxx)
+ * @return C_RES
+ */
+C_RES Modbus__SetLineConfig(C_UINT32 baud, C_BYTE parity)
+{
+#ifdef INCLUDE_PLATFORM_DEPENDENT
+	USHORT t35;
+
+	if (baud == 0)
+		return C_FAIL;
+
+	if (ESP_OK != uart_set_baudrate(MB_Port, baud))
+		return C_FAIL;
+
+	if (ESP_OK != uart_set_parity(MB_Port, (uart_parity_t)Modbus__UartParity(parity)))
+		return C_FAIL;
+
+	// same computation of eMBMasterRTUInit
+	if (baud > 19200)
+		t35 = 35;
+	else
+		t35 = (7UL * 220000UL) / (2UL * baud);
+	vMBMasterPortTimersSetT35(t35);
+#endif
+	MB_Baud = baud;
+	MB_Parity = parity;
+	Modbus__TimingReset();
+	P_COV_LN;
+	return C_SUCCESS;
+}
+
+/**
+ * @brief Modbus__GetBaudrate
+ *        baudrate of the line in use
+ *
+ * @param  none
+ * @return C_UINT32
+ */
+C_UINT32 Modbus__GetBaudrate(void)
+{
+	return MB_Baud;
+}
+
+/**
+ * @brief Modbus__GetParity
+ *        parity of the line in use
+ *
+ * @param  none
+ * @return C_BYTE MB_PARITY_xxx
+ */
+C_BYTE Modbus__GetParity(void)
+{
+	return MB_Parity;
+}
+
+/**
+ * @brief Modbus__ParityFromEMB
+ *        convert the eMBParity of freemodbus (the one of the header
+ *        of the model) in MB_PARITY_xxx
+ *
+ * @param  C_BYTE emb_parity  MB_PAR_xxx
+ * @return C_BYTE MB_PARITY_xxx
+ */
+C_BYTE Modbus__ParityFromEMB(C_BYTE emb_parity)
+{
+	switch (emb_parity)
+	{
+		case MB_PAR_ODD:
+			return MB_PARITY_ODD;
+
+		case MB_PAR_EVEN:
+			return MB_PARITY_EVEN;
+
+		default:
+			return MB_PARITY_NONE;
+	}
+}
+
+/**
+ * @brief Modbus__ParityToEMB
+ *        convert MB_PARITY_xxx in the eMBParity of freemodbus, the
+ *        encoding of the parity in the header of the model and in the
+ *        messages to the cloud
+ *
+ * @param  C_BYTE parity  MB_PARITY_xxx
+ * @return C_BYTE MB_PAR_xxx
+ */
+C_BYTE Modbus__ParityToEMB(C_BYTE parity)
+{
+	switch (parity)
+	{
+		case MB_PARITY_ODD:
+			return MB_PAR_ODD;
+
+		case MB_PARITY_EVEN:
+			return MB_PAR_EVEN;
+
+		default:
+			return MB_PAR_NONE;
+	}
+}
+
+/**
+ * @brief Modbus__UartParity
+ *        convert MB_PARITY_xxx in the uart_parity_t of the uart driver,
+ *        to be used for every uart configured with the parity of the line
+ *
+ * @param  C_BYTE parity  MB_PARITY_xxx
+ * @return C_BYTE uart_parity_t
+ */
+C_BYTE Modbus__UartParity(C_BYTE parity)
+{
+#ifdef INCLUDE_PLATFORM_DEPENDENT
+	switch (parity)
+	{
+		case MB_PARITY_ODD:
+			return UART_PARITY_ODD;
+
+		case MB_PARITY_EVEN:
+			return UART_PARITY_EVEN;
+
+		default:
+			return UART_PARITY_DISABLE;
+	}
+#else
+	return parity;
+#endif
 }
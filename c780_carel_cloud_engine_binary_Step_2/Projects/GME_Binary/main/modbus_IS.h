@@ -19,6 +19,72 @@
 
 /* Varaibles -----------------------------------------------------------------*/
 
+/* parity of the line, the only encoding used outside modbus_IS.c
+ * (Modbus__GetParity, Modbus__SetLineConfig, scan results).
+ * The header of the model and the cloud use the eMBParity of freemodbus,
+ * see Modbus__ParityFromEMB and Modbus__ParityToEMB
+ */
+#define MB_PARITY_NONE      0
+#define MB_PARITY_EVEN      2
+#define MB_PARITY_ODD       3
+
+/**
+ * @brief mb_client_t
+ *        the users of the modbus bus, every transaction is granted by the
+ *        bus arbiter on behalf of one of them
+ */
+typedef enum{
+	MB_CLIENT_POLLING = 0,
+	MB_CLIENT_CLOUD_RW,
+	MB_CLIENT_SCAN,
+	MB_CLIENT_FILELOG,
+	MB_CLIENT_DEV_OTA,
+	MB_CLIENT_TUNNEL,
+	MB_CLIENT_NUM,
+}mb_client_t;
+
+/**
+ * @brief mb_client_stats_t
+ *        queueing delay measured by the bus arbiter for a single client,
+ *        the wait is the time between the request and the grant of the bus
+ */
+typedef struct{
+	C_UINT32 count;          // number of bus grants
+	C_UINT32 wait_last_us;
+	C_UINT32 wait_max_us;
+	C_UINT64 wait_tot_us;
+}mb_client_stats_t;
+
+
+/**
+ * @brief mb_line_t
+ *        the serial lines, the main one is served by freemodbus and
+ *        polled with the model, the aux one (modbus_aux_IS) on the other
+ *        connector is polled by its own task with the "apl" table and
+ *        carries the raw ADUs of send_mb_adu "lin":1
+ */
+typedef enum{
+	MB_LINE_MAIN = 0,
+	MB_LINE_AUX,
+	MB_LINE_NUM,
+}mb_line_t;
+
+/**
+ * @brief mb_line_stats_t
+ *        throughput and latency of a line, the latency is the whole
+ *        transaction (request, turnaround and answer)
+ */
+typedef struct{
+	C_UINT32 requests;
+	C_UINT32 errors;
+	C_UINT32 bytes;          // sent and received
+	C_UINT32 lat_max_us;
+	C_UINT32 ta_min_us;      // turnaround of the slave seen by the master,
+	C_UINT32 ta_max_us;      // max - min is the jitter of the RTU timing
+	C_UINT64 busy_us;        // sum of the latencies
+	C_UINT64 since_us;       // start of the statistics
+}mb_line_stats_t;
+
 
 /* ========================================================================== */
 /* debugging purpose                                                          */
@@ -47,9 +113,12 @@ int app_coil_read(const uint8_t addr, const int index, const int num);
 int app_coil_discrete_input_read(const uint8_t addr, const int index, const int num);
 int app_holding_register_read(const uint8_t addr, const int index, const int num);   //  const int func,
 int app_input_register_read(const uint8_t addr, const int index, const int num);
+int app_block_read(const uint8_t addr, const C_BYTE func, const int index, const int num, C_BYTE *data, C_UINT16 *data_len);
 
 C_RES app_report_slave_id_read(const uint8_t addr);
+C_RES app_report_slave_id_probe(const uint8_t addr, C_UINT16 timeout_ms);
 C_RES app_file_transfer(unsigned char* data_tx, uint8_t packet_len);
+int app_raw_adu(const C_BYTE *adu, C_UINT16 adu_len, C_BYTE *rsp, C_UINT16 *rsp_len, C_UINT16 timeout_ms);
 
 // WRITE
 int app_coil_write(const uint8_t addr, const int index, short newData, int multi);
@@ -61,9 +130,32 @@ void Modbus__ReadAddressFromNVM(void);
 void Modbus__ReadDelayFromNVM(void);
 C_UINT16 Modbus__GetAddress(void);
 void Modbus__Delay(void);
+void Modbus__TimingReset(void);
+C_UINT16 Modbus__GetRespondTimeout(void);
+C_UINT16 Modbus__GetGap(void);
 C_UINT16 Modbus__GetStatus(void);
+C_UINT16 Modbus__GetProbeTimeout(C_UINT32 baud);
+C_RES Modbus__SetLineConfig(C_UINT32 baud, C_BYTE parity);
+C_UINT32 Modbus__GetBaudrate(void);
+C_BYTE Modbus__GetParity(void);
+C_BYTE Modbus__ParityFromEMB(C_BYTE emb_parity);
+C_BYTE Modbus__ParityToEMB(C_BYTE parity);
+C_BYTE Modbus__UartParity(C_BYTE parity);
 
 C_RES app_file_read(unsigned char* data_tx, uint8_t packet_len, unsigned char * data_rx);
 
+// BUS ARBITER
+void Modbus__BusInit(void);
+C_RES Modbus__BusAcquire(mb_client_t client);
+void Modbus__BusRelease(void);
+C_RES Modbus__GetBusStats(mb_client_t client, mb_client_stats_t *stats);
+void Modbus__ResetBusStats(void);
+
+// LINE STATISTICS
+void Modbus__LineAccount(mb_line_t line, C_UINT32 elapsed_us, C_UINT16 bytes, C_BOOL ok);
+void Modbus__LineTurnaround(mb_line_t line, C_UINT32 turnaround_us);
+C_RES Modbus__GetLineStats(mb_line_t line, mb_line_stats_t *stats);
+void Modbus__ResetLineStats(mb_line_t line);
+
 
 #endif   /* #ifndef __MODBUS_IS_H */
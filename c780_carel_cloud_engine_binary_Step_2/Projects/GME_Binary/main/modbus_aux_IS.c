@@ -0,0 +1,412 @@
+/**
+ * @file modbus_aux_IS.c
+ * @author carel
+ * @date 18 Oct 2026
+ * @brief  aux line, its poll task and the raw ADUs (see modbus_aux_IS.h).
+ *         freemodbus has a single master instance (the main line), this
+ *         one is a synchronous master on the uart driver: the length of
+ *         the answer is known from its function code, so the end of frame
+ *         doesn't need the T3.5 timer
+ */
+#include "stdint.h"
+#include "string.h"
+
+#include "modbus_aux_IS.h"
+#include "modbus_IS.h"
+#include "CAREL_GLOBAL_DEF.h"
+#include "data_types_CAREL.h"
+#include "binary_model.h"
+#include "gme_config.h"
+#include "mb_m.h"
+#include "IO_Port_IS.h"
+#include "RTC_IS.h"
+
+#ifdef INCLUDE_PLATFORM_DEPENDENT
+#include "driver/uart.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "esp_timer.h"
+#endif
+
+#define MB_AUX_ADU_MIN		4			// address, function code, CRC
+
+#ifdef INCLUDE_PLATFORM_DEPENDENT
+static SemaphoreHandle_t MB_AuxMutex = NULL;
+static SemaphoreHandle_t MB_AuxPollLock = NULL;		// readings, poll task vs polling engine
+#endif
+static C_UINT32 MB_AuxBaud = 0;
+
+static mb_aux_poll_cfg_t MB_AuxPoll;
+static mb_aux_poll_val_t MB_AuxPollVal[MB_AUX_POLL_MAX];
+static C_BYTE MB_AuxPollNew[MB_AUX_POLL_MAX];		// changed since ModbusAux__PollChanged
+
+
+/**
+ * @brief ModbusAux__Init
+ *        start the on-demand aux line on the connector not used by the
+ *        main one, with the same baudrate and parity
+ *
+ * @param C_UINT32 baud
+ * @param C_BYTE parity  MB_PARITY_xxx
+ * @param C_BYTE main_port  uart of the main line
+ * @return C_RES
+ */
+C_RES ModbusAux__Init(C_UINT32 baud, C_BYTE parity, C_BYTE main_port)
+{
+#ifdef INCLUDE_PLATFORM_DEPENDENT
+	uart_config_t uart_config = {
+		.baud_rate = baud,
+		.data_bits = UART_DATA_8_BITS,
+		.parity = (uart_parity_t)Modbus__UartParity(parity),
+		.stop_bits = UART_STOP_BITS_1,
+		.flow_ctrl = UART_HW_FLOWCTRL_DISABLE,
+		.rx_flow_ctrl_thresh = 0,
+	};
+	esp_err_t err;
+
+	if (MB_AuxMutex != NULL)
+		return C_SUCCESS;
+
+	err = uart_param_config(MB_PORTNUM_AUX, &uart_config);
+
+	if (main_port == MB_PORTNUM_485)
+		err |= uart_set_pin(MB_PORTNUM_AUX, Get_TTL_TXD(), Get_TTL_RXD(), Get_TTL_RTS(), UART_PIN_NO_CHANGE);
+	else
+		err |= uart_set_pin(MB_PORTNUM_AUX, Get_TEST_TXD(), Get_TEST_RXD(), Get_TEST_RTS(), UART_PIN_NO_CHANGE);
+
+	err |= uart_driver_install(MB_PORTNUM_AUX, MB_AUX_RX_BUF_SIZE, 0, 0, NULL, 0);
+	err |= uart_set_mode(MB_PORTNUM_AUX, UART_MODE_RS485_HALF_DUPLEX);
+
+	if (ESP_OK != err)
+	{
+		PRINTF_DEBUG("MODBUS aux initialize fail\n");
+		P_COV_LN;
+		return C_FAIL;
+	}
+
+	MB_AuxBaud = baud;
+	Modbus__ResetLineStats(MB_LINE_AUX);
+	MB_AuxMutex = xSemaphoreCreateMutex();
+
+	PRINTF_DEBUG("MODBUS aux line on %s\n", (main_port == MB_PORTNUM_485) ? "TTL" : "RS485");
+	P_COV_LN;
+	return (MB_AuxMutex != NULL) ? C_SUCCESS : C_FAIL;
+#else
+	return C_FAIL;
+#endif
+}
+
+/**
+ * @brief ModbusAux__IsStarted
+ *
+ * @param none
+ * @return C_BOOL
+ */
+C_BOOL ModbusAux__IsStarted(void)
+{
+#ifdef INCLUDE_PLATFORM_DEPENDENT
+	return (MB_AuxMutex != NULL) ? C_TRUE : C_FALSE;
+#else
+	return C_FALSE;
+#endif
+}
+
+/*
+ * mb_aux_rsp_len
+ *        length of the answer from its first 3 bytes, 0 if the function
+ *        code doesn't tell it
+ */
+static C_UINT16 mb_aux_rsp_len(const C_BYTE *hdr)
+{
+	if (hdr[1] & 0x80)
+		return 5;				// exception
+
+	switch (hdr[1])
+	{
+		case 0x01:
+		case 0x02:
+		case 0x03:
+		case 0x04:
+		case 0x11:
+		case 0x17:
+			return 5 + hdr[2];	// byte count
+		case 0x05:
+		case 0x06:
+		case 0x0F:
+		case 0x10:
+			return 8;
+		default:
+			return 0;
+	}
+}
+
+#ifdef INCLUDE_PLATFORM_DEPENDENT
+/*
+ * mb_aux_ticks
+ *        ticks to receive n chars, rounded up plus one tick of margin
+ */
+static TickType_t mb_aux_ticks(C_UINT16 chars)
+{
+	C_UINT32 ms = ((C_UINT32)chars * 11 * 1000 + MB_AuxBaud - 1) / MB_AuxBaud;
+	return pdMS_TO_TICKS(ms) + 2;
+}
+#endif
+
+/**
+ * @brief ModbusAux__RawAdu
+ *        send a RTU ADU on the aux line and return the ADU of the
+ *        answer, same contract of app_raw_adu. The requests of
+ *        different tasks are queued on the line mutex
+ *
+ * @param  const C_BYTE *adu  address, PDU and CRC
+ * @param  C_UINT16 adu_len
+ * @param  C_BYTE *rsp  response ADU
+ * @param  C_UINT16 *rsp_len  in size of rsp, out length of the response
+ * @param  C_UINT16 timeout_ms  respond timeout, 0 MB_AUX_RESPOND_TIMEOUT_MS
+ * @return int eMBMasterReqErrCode, MB_MRE_NO_ERR if the slave answered
+ */
+int ModbusAux__RawAdu(const C_BYTE *adu, C_UINT16 adu_len, C_BYTE *rsp, C_UINT16 *rsp_len, C_UINT16 timeout_ms)
+{
+	int result = MB_MRE_ILL_ARG;
+#ifdef INCLUDE_PLATFORM_DEPENDENT
+	C_UINT16 crc, exp_len, got = 0;
+	int64_t t_start;
+	C_UINT32 elapsed, frames;
+	int n;
+
+	if ((MB_AuxMutex == NULL) || (adu_len < MB_AUX_ADU_MIN) || (*rsp_len < MB_AUX_ADU_MIN))
+		return result;
+
+	crc = CRC16(adu, adu_len - 2);
+	if ((adu[adu_len - 2] != (C_BYTE)(crc & 0xFF)) || (adu[adu_len - 1] != (C_BYTE)(crc >> 8)))
+		return result;
+
+	if (pdTRUE != xSemaphoreTake(MB_AuxMutex, pdMS_TO_TICKS(MB_AUX_QUEUE_TIMEOUT_MS)))
+		return MB_MRE_MASTER_BUSY;
+
+	if (timeout_ms == 0)
+		timeout_ms = MB_AUX_RESPOND_TIMEOUT_MS;
+
+	t_start = esp_timer_get_time();
+
+	uart_flush_input(MB_PORTNUM_AUX);
+	uart_write_bytes(MB_PORTNUM_AUX, (const char*)adu, adu_len);
+	uart_wait_tx_done(MB_PORTNUM_AUX, mb_aux_ticks(adu_len));
+
+	if (adu[0] == 0)
+	{
+		// broadcast, no answer
+		vTaskDelay(pdMS_TO_TICKS(MB_AUX_BROADCAST_DELAY_MS));
+		*rsp_len = 0;
+		result = MB_MRE_NO_ERR;
+	}
+	else
+	{
+		result = MB_MRE_TIMEDOUT;
+
+		n = uart_read_bytes(MB_PORTNUM_AUX, rsp, 3, pdMS_TO_TICKS(timeout_ms) + 1);
+		if (n == 3)
+		{
+			got = 3;
+			exp_len = mb_aux_rsp_len(rsp);
+
+			if ((exp_len > 0) && (exp_len <= *rsp_len))
+			{
+				n = uart_read_bytes(MB_PORTNUM_AUX, &rsp[got], exp_len - got, mb_aux_ticks(exp_len - got));
+				got += (n > 0) ? n : 0;
+			}
+			else
+			{
+				// unknown length, read until the line is silent
+				while ((got < *rsp_len) &&
+					   ((n = uart_read_bytes(MB_PORTNUM_AUX, &rsp[got], *rsp_len - got, mb_aux_ticks(4))) > 0))
+					got += n;
+			}
+
+			crc = CRC16(rsp, got - 2);
+			if ((got >= 5) && (rsp[0] == adu[0]) &&
+				(rsp[got - 2] == (C_BYTE)(crc & 0xFF)) && (rsp[got - 1] == (C_BYTE)(crc >> 8)))
+				result = MB_MRE_NO_ERR;
+			else
+				result = MB_MRE_REV_DATA;
+		}
+
+		*rsp_len = (result == MB_MRE_NO_ERR) ? got : 0;
+	}
+
+	elapsed = (C_UINT32)(esp_timer_get_time() - t_start);
+	Modbus__LineAccount(MB_LINE_AUX, elapsed, adu_len + got, (result == MB_MRE_NO_ERR) ? C_TRUE : C_FALSE);
+
+	frames = ((C_UINT32)(adu_len + got) * 10 * 1000000) / MB_AuxBaud;
+	if ((result == MB_MRE_NO_ERR) && (got > 0))
+		Modbus__LineTurnaround(MB_LINE_AUX, (elapsed > frames) ? (elapsed - frames) : 0);
+
+	// T3.5 before the next request
+	vTaskDelay(1);
+
+	xSemaphoreGive(MB_AuxMutex);
+#endif
+	return result;
+}
+
+#ifdef INCLUDE_PLATFORM_DEPENDENT
+/*
+ * mb_aux_poll_read
+ *        read a value of the poll table, MB_MRE_NO_ERR and its value if
+ *        the slave answered
+ */
+static int mb_aux_poll_read(const mb_aux_poll_entry_t *ent, C_INT32 *value)
+{
+	C_BYTE adu[8], rsp[9];
+	C_UINT16 crc, rsp_len = sizeof(rsp);
+	C_BYTE regs = (ent->typ == MB_AUX_TYP_S32) ? 2 : 1;
+	int err;
+
+	adu[0] = ent->dev;
+	adu[1] = ent->fc;
+	adu[2] = (C_BYTE)(ent->reg >> 8);
+	adu[3] = (C_BYTE)(ent->reg & 0xFF);
+	adu[4] = 0;
+	adu[5] = regs;
+	crc = CRC16(adu, 6);
+	adu[6] = (C_BYTE)(crc & 0xFF);
+	adu[7] = (C_BYTE)(crc >> 8);
+
+	err = ModbusAux__RawAdu(adu, sizeof(adu), rsp, &rsp_len, 0);
+	if (err != MB_MRE_NO_ERR)
+		return err;
+
+	if (rsp[1] & 0x80)
+		return MB_MRE_EXE_FUN;
+
+	if ((rsp[1] != ent->fc) || (rsp[2] != ((ent->fc <= 2) ? 1 : 2 * regs)))
+		return MB_MRE_REV_DATA;
+
+	if (ent->fc <= 2)
+		*value = rsp[3] & 0x01;
+	else if (ent->typ == MB_AUX_TYP_S32)
+		*value = (C_INT32)(((C_UINT32)rsp[3] << 24) | ((C_UINT32)rsp[4] << 16) | ((C_UINT32)rsp[5] << 8) | rsp[6]);
+	else if (ent->typ == MB_AUX_TYP_S16)
+		*value = (int16_t)(((C_UINT16)rsp[3] << 8) | rsp[4]);
+	else
+		*value = ((C_UINT16)rsp[3] << 8) | rsp[4];
+
+	return MB_MRE_NO_ERR;
+}
+
+/*
+ * ModbusAux_PollTask
+ *        the scheduler of the aux line, every period it reads its poll
+ *        table. Its requests are queued on the line mutex with the raw
+ *        ADUs, the main line is not involved
+ */
+static void ModbusAux_PollTask(void *arg)
+{
+	TickType_t last = xTaskGetTickCount();
+	mb_aux_poll_val_t *val;
+	C_INT32 value;
+	C_BYTE i;
+	int err;
+
+	for (;;)
+	{
+		for (i = 0; i < MB_AuxPoll.num; i++)
+		{
+			value = 0;
+			err = mb_aux_poll_read(&MB_AuxPoll.ent[i], &value);
+			val = &MB_AuxPollVal[i];
+
+			xSemaphoreTake(MB_AuxPollLock, portMAX_DELAY);
+			// the first reading and then only the changes
+			if ((val->sample_us == 0) || (err != val->err) || ((err == MB_MRE_NO_ERR) && (value != val->value)))
+				MB_AuxPollNew[i] = 1;
+			val->err = (C_BYTE)err;
+			val->value = value;
+			val->sample_us = RTC_Get_Mono_us();
+			xSemaphoreGive(MB_AuxPollLock);
+		}
+
+		vTaskDelayUntil(&last, pdMS_TO_TICKS((C_UINT32)MB_AuxPoll.period * 1000));
+	}
+}
+#endif
+
+/**
+ * @brief ModbusAux__PollStart
+ *        start the poll task of the aux line, the line must be started
+ *        (ModbusAux__Init)
+ *
+ * @param const mb_aux_poll_cfg_t *cfg  poll table, nothing to do if empty
+ * @return C_RES
+ */
+C_RES ModbusAux__PollStart(const mb_aux_poll_cfg_t *cfg)
+{
+#ifdef INCLUDE_PLATFORM_DEPENDENT
+	if ((MB_AuxMutex == NULL) || (MB_AuxPollLock != NULL) ||
+		(cfg->num == 0) || (cfg->num > MB_AUX_POLL_MAX))
+		return C_FAIL;
+
+	MB_AuxPoll = *cfg;
+	if (MB_AuxPoll.period < MB_AUX_POLL_PERIOD_MIN_S)
+		MB_AuxPoll.period = MB_AUX_POLL_PERIOD_DEF_S;
+	memset(MB_AuxPollVal, 0, sizeof(MB_AuxPollVal));
+	memset(MB_AuxPollNew, 0, sizeof(MB_AuxPollNew));
+
+	MB_AuxPollLock = xSemaphoreCreateMutex();
+	if ((MB_AuxPollLock == NULL) ||
+		(pdPASS != xTaskCreatePinnedToCore(ModbusAux_PollTask, "MB_AUX_POLL", MB_AUX_POLL_TASK_STACK, NULL, MB_AUX_POLL_TASK_PRIO, NULL, GME_ACQ_CORE)))
+	{
+		PRINTF_DEBUG("MODBUS aux poll task fail\n");
+		MB_AuxPoll.num = 0;
+		return C_FAIL;
+	}
+
+	PRINTF_DEBUG("MODBUS aux line polls %d values every %d s\n", MB_AuxPoll.num, MB_AuxPoll.period);
+	P_COV_LN;
+	return C_SUCCESS;
+#else
+	return C_FAIL;
+#endif
+}
+
+/**
+ * @brief ModbusAux__PollNum
+ *
+ * @param none
+ * @return C_BYTE values of the aux poll table, 0 the aux line is not polled
+ */
+C_BYTE ModbusAux__PollNum(void)
+{
+	return MB_AuxPoll.num;
+}
+
+/**
+ * @brief ModbusAux__PollChanged
+ *        the last reading of a value of the aux poll table, if it changed
+ *        (value or error) since the last call for it
+ *
+ * @param C_BYTE i  index in the poll table
+ * @param C_UINT16 *ali  alias of the value
+ * @param mb_aux_poll_val_t *val  the reading
+ * @return C_BOOL C_TRUE if changed
+ */
+C_BOOL ModbusAux__PollChanged(C_BYTE i, C_UINT16 *ali, mb_aux_poll_val_t *val)
+{
+	C_BOOL changed = C_FALSE;
+#ifdef INCLUDE_PLATFORM_DEPENDENT
+	if ((i >= MB_AuxPoll.num) || (MB_AuxPollLock == NULL))
+		return C_FALSE;
+
+	xSemaphoreTake(MB_AuxPollLock, portMAX_DELAY);
+	if (MB_AuxPollNew[i])
+	{
+		MB_AuxPollNew[i] = 0;
+		*ali = MB_AuxPoll.ent[i].ali;
+		*val = MB_AuxPollVal[i];
+		changed = C_TRUE;
+	}
+	xSemaphoreGive(MB_AuxPollLock);
+#endif
+	return changed;
+}
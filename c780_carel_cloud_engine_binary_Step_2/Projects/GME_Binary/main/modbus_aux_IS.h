@@ -0,0 +1,89 @@
+/**
+ * @file modbus_aux_IS.h
+ * @author carel
+ * @date 18 Oct 2026
+ * @brief  aux line: a second Modbus RTU master on the connector not
+ *         used by the main line (RS485 or TTL). It has its own UART, its
+ *         own poll table (set_lines_config "apl", not the model) polled
+ *         by its own task, and the raw ADUs of send_mb_adu "lin":1. The
+ *         line mutex is its queue, shared by the poll task and the raw
+ *         ADUs, and it has its own statistics (MB_LINE_AUX), so the two
+ *         lines are polled at the same time
+ */
+#include "data_types_CAREL.h"
+#include "stdint.h"
+
+#ifndef __MODBUS_AUX_IS_H
+#define __MODBUS_AUX_IS_H
+
+
+/* Varaibles -----------------------------------------------------------------*/
+
+/* respond timeout when the request doesn't give one (ms) */
+#define MB_AUX_RESPOND_TIMEOUT_MS	500
+
+/* silence after a broadcast, the slaves are executing it (ms) */
+#define MB_AUX_BROADCAST_DELAY_MS	100
+
+#define MB_AUX_RX_BUF_SIZE			512
+
+/* max wait for the line owned by another request (ms) */
+#define MB_AUX_QUEUE_TIMEOUT_MS		5000
+
+/* poll table of the aux line */
+#define MB_AUX_POLL_MAX				32
+#define MB_AUX_POLL_PERIOD_MIN_S	1
+#define MB_AUX_POLL_PERIOD_DEF_S	10
+#define MB_AUX_POLL_TASK_STACK		3072
+#define MB_AUX_POLL_TASK_PRIO		MODBUS_TASK_PRIO
+
+/* type of a value of the aux poll table */
+#define MB_AUX_TYP_U16				0		// also coil and discrete input
+#define MB_AUX_TYP_S16				1
+#define MB_AUX_TYP_S32				2		// 2 registers, high word first
+
+/**
+ * @brief mb_aux_poll_entry_t
+ *        a value of the aux poll table, "apl" item [ali, dev, fc, reg, typ]
+ */
+#pragma pack(1)
+typedef struct{
+	C_UINT16 ali;			// alias in the values messages
+	C_BYTE dev;				// slave address
+	C_BYTE fc;				// 1 coil, 2 discrete input, 3 holding, 4 input
+	C_UINT16 reg;
+	C_BYTE typ;				// MB_AUX_TYP_xxx
+}mb_aux_poll_entry_t;
+
+/**
+ * @brief mb_aux_poll_cfg_t
+ *        poll table of the aux line, stored in NVM as MB_AUX_POLL_NVM
+ */
+typedef struct{
+	C_UINT16 period;		// s
+	C_BYTE num;				// 0 the aux line is not polled
+	mb_aux_poll_entry_t ent[MB_AUX_POLL_MAX];
+}mb_aux_poll_cfg_t;
+#pragma pack()
+
+/**
+ * @brief mb_aux_poll_val_t
+ *        last reading of a value of the aux poll table
+ */
+typedef struct{
+	C_INT32 value;
+	C_BYTE err;				// eMBMasterReqErrCode
+	C_UINT64 sample_us;		// RTC_Get_Mono_us of the reading
+}mb_aux_poll_val_t;
+
+
+/* Functions Implementation --------------------------------------------------*/
+C_RES ModbusAux__Init(C_UINT32 baud, C_BYTE parity, C_BYTE main_port);
+C_BOOL ModbusAux__IsStarted(void);
+int ModbusAux__RawAdu(const C_BYTE *adu, C_UINT16 adu_len, C_BYTE *rsp, C_UINT16 *rsp_len, C_UINT16 timeout_ms);
+C_RES ModbusAux__PollStart(const mb_aux_poll_cfg_t *cfg);
+C_BYTE ModbusAux__PollNum(void);
+C_BOOL ModbusAux__PollChanged(C_BYTE i, C_UINT16 *ali, mb_aux_poll_val_t *val);
+
+
+#endif   /* #ifndef __MODBUS_AUX_IS_H */
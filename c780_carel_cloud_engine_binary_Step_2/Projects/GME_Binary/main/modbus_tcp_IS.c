@@ -0,0 +1,411 @@
+/**
+ * @file   modbus_tcp_IS.c
+ * @author carel
+ * @date   18 Oct 2026
+ * @brief  Modbus TCP slave answering from the image of the polling
+ *         engine (PollEngine__ReadCache). A single task serves all
+ *         the clients with select(), the unit id is the one of the
+ *         polled device (0 and 255 are accepted too)
+ *
+ */
+
+#include <string.h>
+#include "CAREL_GLOBAL_DEF.h"
+#include "modbus_tcp_IS.h"
+#include "modbus_IS.h"
+#include "polling_CAREL.h"
+#include "CBOR_CAREL.h"
+#include "RTC_IS.h"
+#include "sys_IS.h"
+#include "gme_config.h"
+
+#ifdef INCLUDE_PLATFORM_DEPENDENT
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "lwip/sockets.h"
+#endif
+
+/* MBAP header: transaction id, protocol id, length, unit id */
+#define MBAP_HDR_LEN			7
+#define MBAP_PDU_MAX			253
+#define MB_TCP_ADU_MAX			(MBAP_HDR_LEN + MBAP_PDU_MAX)
+
+#define MB_TCP_MAX_BITS			2000
+#define MB_TCP_MAX_REGS			125
+
+#define MB_FC_READ_COILS		0x01
+#define MB_FC_READ_DI			0x02
+#define MB_FC_READ_HR			0x03
+#define MB_FC_READ_IR			0x04
+#define MB_FC_WRITE_COIL		0x05
+#define MB_FC_WRITE_HR			0x06
+#define MB_FC_WRITE_HRS			0x10
+
+#define GET_BE16(p)				((C_UINT16)(((C_UINT16)(p)[0] << 8) | (p)[1]))
+#define PUT_BE16(p, v)			do { (p)[0] = (C_BYTE)((v) >> 8); (p)[1] = (C_BYTE)(v); } while (0)
+
+typedef struct mb_tcp_client_s{
+	int sock;					// -1 free slot
+	C_UINT16 len;				// bytes in buf
+	C_UINT64 last_us;			// last request
+	C_BYTE buf[MB_TCP_ADU_MAX];
+}mb_tcp_client_t;
+
+static mb_tcp_client_t mbtcp_clients[MB_TCP_MAX_CLIENTS];
+
+// image of a request, static since the task stack is small
+static C_UINT16 mbtcp_image[MB_TCP_MAX_BITS];
+
+static C_BYTE mbtcp_started = 0;
+
+
+/*
+ * ModbusTcp__Exception
+ *        build an exception response
+ */
+static C_UINT16 ModbusTcp__Exception(C_BYTE fc, eMBException ex, C_BYTE *rsp)
+{
+	rsp[0] = fc | 0x80;
+	rsp[1] = (C_BYTE)ex;
+	return 2;
+}
+
+/*
+ * ModbusTcp__Write
+ *        forward a write to the device, only the addresses of the model
+ *        can be written. The write is queued to the polling task as the
+ *        cloud ones (mb_rw_set_local) and the task waits its result
+ */
+static eMBException ModbusTcp__Write(C_BYTE fc, C_UINT16 addr, C_UINT16 num, const C_BYTE *val)
+{
+#if (MB_TCP_WRITE_THROUGH == 0)
+	return MB_EX_ILLEGAL_FUNCTION;
+#else
+	eMBException ex;
+	mb_rw_local_t w;
+	C_RES res = C_FAIL;
+	C_UINT32 waited;
+
+	ex = PollEngine__ReadCache((MB_FC_WRITE_COIL == fc) ? COIL : HR, addr, num, mbtcp_image);
+	if ((MB_EX_NONE != ex) && (MB_EX_GATEWAY_TGT_FAILED != ex))
+		return ex;
+
+	w.addr = addr;
+	w.num = (C_CHAR)num;
+	if (MB_FC_WRITE_COIL == fc)
+	{
+		w.func = mbW_COIL;
+		w.value = (0xFF00 == GET_BE16(val)) ? 1 : 0;
+	}
+	else
+	{
+		w.func = (MB_FC_WRITE_HR == fc) ? mbW_HR : mbW_HRS;
+		w.value = (1 == num) ? GET_BE16(val) : (C_INT32)((C_UINT32)GET_BE16(val) | ((C_UINT32)GET_BE16(val + 2) << 16));
+	}
+
+	// a write that timed out is still to be executed
+	if (C_SUCCESS != mb_rw_set_local(&w))
+		return MB_EX_SLAVE_BUSY;
+
+	for (waited = 0; MB_RW_LOCAL_DONE != mb_rw_get_local(&res); waited += 10)
+	{
+		if (waited >= MB_TCP_WRITE_WAIT_MS)
+		{
+			PRINTF_DEBUG("mbtcp write fc %d addr %d, polling task busy\n", fc, addr);
+			return MB_EX_GATEWAY_TGT_FAILED;
+		}
+		Sys__Delay(10);
+	}
+
+	PRINTF_DEBUG("mbtcp write fc %d addr %d num %d res %d\n", fc, addr, num, res);
+	return (C_SUCCESS == res) ? MB_EX_NONE : MB_EX_GATEWAY_TGT_FAILED;
+#endif
+}
+
+/*
+ * ModbusTcp__Process
+ *        execute a request PDU
+ *
+ * @return length of the response PDU
+ */
+static C_UINT16 ModbusTcp__Process(const C_BYTE *req, C_UINT16 len, C_BYTE *rsp)
+{
+	C_BYTE fc = req[0];
+	C_UINT16 addr, num, i;
+	eMBException ex;
+
+	if (len < 5)
+		return ModbusTcp__Exception(fc, MB_EX_ILLEGAL_DATA_VALUE, rsp);
+
+	addr = GET_BE16(&req[1]);
+	num = GET_BE16(&req[3]);
+
+	switch (fc)
+	{
+		case MB_FC_READ_COILS:
+		case MB_FC_READ_DI:
+			if ((num == 0) || (num > MB_TCP_MAX_BITS))
+				return ModbusTcp__Exception(fc, MB_EX_ILLEGAL_DATA_VALUE, rsp);
+
+			ex = PollEngine__ReadCache((MB_FC_READ_COILS == fc) ? COIL : DI, addr, num, mbtcp_image);
+			if (MB_EX_NONE != ex)
+				return ModbusTcp__Exception(fc, ex, rsp);
+
+			rsp[0] = fc;
+			rsp[1] = (C_BYTE)((num + 7) / 8);
+			memset(&rsp[2], 0, rsp[1]);
+			for (i = 0; i < num; i++)
+			{
+				if (mbtcp_image[i])
+					rsp[2 + (i >> 3)] |= (C_BYTE)(1 << (i & 7));
+			}
+			return 2 + rsp[1];
+
+		case MB_FC_READ_HR:
+		case MB_FC_READ_IR:
+			if ((num == 0) || (num > MB_TCP_MAX_REGS))
+				return ModbusTcp__Exception(fc, MB_EX_ILLEGAL_DATA_VALUE, rsp);
+
+			ex = PollEngine__ReadCache((MB_FC_READ_HR == fc) ? HR : IR, addr, num, mbtcp_image);
+			if (MB_EX_NONE != ex)
+				return ModbusTcp__Exception(fc, ex, rsp);
+
+			rsp[0] = fc;
+			rsp[1] = (C_BYTE)(num * 2);
+			for (i = 0; i < num; i++)
+				PUT_BE16(&rsp[2 + i * 2], mbtcp_image[i]);
+			return 2 + rsp[1];
+
+		case MB_FC_WRITE_COIL:
+			if ((num != 0xFF00) && (num != 0x0000))
+				return ModbusTcp__Exception(fc, MB_EX_ILLEGAL_DATA_VALUE, rsp);
+			// no break
+		case MB_FC_WRITE_HR:
+			ex = ModbusTcp__Write(fc, addr, 1, &req[3]);
+			if (MB_EX_NONE != ex)
+				return ModbusTcp__Exception(fc, ex, rsp);
+			memcpy(rsp, req, 5);
+			return 5;
+
+		case MB_FC_WRITE_HRS:
+			// setpoints of one or two registers
+			if ((num == 0) || (num > 2) || (len < 6) || (req[5] != num * 2) || (len < 6 + num * 2))
+				return ModbusTcp__Exception(fc, MB_EX_ILLEGAL_DATA_VALUE, rsp);
+			ex = ModbusTcp__Write(fc, addr, num, &req[6]);
+			if (MB_EX_NONE != ex)
+				return ModbusTcp__Exception(fc, ex, rsp);
+			memcpy(rsp, req, 5);
+			return 5;
+
+		default:
+			return ModbusTcp__Exception(fc, MB_EX_ILLEGAL_FUNCTION, rsp);
+	}
+}
+
+#ifdef INCLUDE_PLATFORM_DEPENDENT
+/*
+ * ModbusTcp__Close
+ */
+static void ModbusTcp__Close(mb_tcp_client_t *client)
+{
+	if (client->sock >= 0)
+		close(client->sock);
+	client->sock = -1;
+	client->len = 0;
+}
+
+/*
+ * ModbusTcp__Receive
+ *        read what is available on a client and answer all the
+ *        complete requests
+ *
+ * @return C_FAIL if the client must be closed
+ */
+static C_RES ModbusTcp__Receive(mb_tcp_client_t *client)
+{
+	static C_BYTE rsp[MB_TCP_ADU_MAX];
+	C_UINT16 adu_len, pdu_len, rsp_len;
+	C_UINT16 unit;
+	int n;
+
+	n = recv(client->sock, &client->buf[client->len], sizeof(client->buf) - client->len, 0);
+	if (n <= 0)
+		return C_FAIL;
+
+	client->len += n;
+	client->last_us = RTC_Get_Mono_us();
+
+	while (client->len >= MBAP_HDR_LEN)
+	{
+		// the length counts the unit id and the PDU
+		adu_len = 6 + GET_BE16(&client->buf[4]);
+		if ((GET_BE16(&client->buf[2]) != 0) || (adu_len < MBAP_HDR_LEN + 1) || (adu_len > MB_TCP_ADU_MAX))
+			return C_FAIL;
+		if (client->len < adu_len)
+			break;
+
+		pdu_len = adu_len - MBAP_HDR_LEN;
+		unit = client->buf[6];
+
+		if ((unit == Modbus__GetAddress()) || (unit == 0) || (unit == 0xFF))
+			rsp_len = ModbusTcp__Process(&client->buf[MBAP_HDR_LEN], pdu_len, &rsp[MBAP_HDR_LEN]);
+		else
+			rsp_len = ModbusTcp__Exception(client->buf[MBAP_HDR_LEN], MB_EX_GATEWAY_PATH_FAILED, &rsp[MBAP_HDR_LEN]);
+
+		memcpy(rsp, client->buf, 4);
+		PUT_BE16(&rsp[4], rsp_len + 1);
+		rsp[6] = (C_BYTE)unit;
+
+		if (send(client->sock, rsp, MBAP_HDR_LEN + rsp_len, 0) < 0)
+			return C_FAIL;
+
+		client->len -= adu_len;
+		memmove(client->buf, &client->buf[adu_len], client->len);
+	}
+
+	return C_SUCCESS;
+}
+
+/*
+ * ModbusTcp__Listen
+ *
+ * @return the listening socket, -1 on error
+ */
+static int ModbusTcp__Listen(void)
+{
+	struct sockaddr_in addr;
+	int opt = 1;
+	int sock;
+
+	sock = socket(AF_INET, SOCK_STREAM, IPPROTO_IP);
+	if (sock < 0)
+		return -1;
+
+	setsockopt(sock, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
+
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = htonl(INADDR_ANY);
+	addr.sin_port = htons(MB_TCP_PORT);
+
+	if ((bind(sock, (struct sockaddr *)&addr, sizeof(addr)) != 0) || (listen(sock, MB_TCP_MAX_CLIENTS) != 0))
+	{
+		close(sock);
+		return -1;
+	}
+	return sock;
+}
+
+/*
+ * ModbusTcp__Task
+ */
+static void ModbusTcp__Task(void *pvParameters)
+{
+	int listen_sock = -1;
+	int sock, maxfd, i;
+	struct timeval tv;
+	fd_set rfds;
+	C_UINT64 now_us;
+
+	for (i = 0; i < MB_TCP_MAX_CLIENTS; i++)
+		mbtcp_clients[i].sock = -1;
+
+	while (1)
+	{
+		if (listen_sock < 0)
+		{
+			listen_sock = ModbusTcp__Listen();
+			if (listen_sock < 0)
+			{
+				Sys__Delay(5000);
+				continue;
+			}
+			PRINTF_DEBUG("mbtcp listening on %d\n", MB_TCP_PORT);
+		}
+
+		FD_ZERO(&rfds);
+		FD_SET(listen_sock, &rfds);
+		maxfd = listen_sock;
+		for (i = 0; i < MB_TCP_MAX_CLIENTS; i++)
+		{
+			if (mbtcp_clients[i].sock < 0)
+				continue;
+			FD_SET(mbtcp_clients[i].sock, &rfds);
+			if (mbtcp_clients[i].sock > maxfd)
+				maxfd = mbtcp_clients[i].sock;
+		}
+
+		tv.tv_sec = 1;
+		tv.tv_usec = 0;
+		if (select(maxfd + 1, &rfds, NULL, NULL, &tv) < 0)
+		{
+			// the interface went down, start again
+			for (i = 0; i < MB_TCP_MAX_CLIENTS; i++)
+				ModbusTcp__Close(&mbtcp_clients[i]);
+			close(listen_sock);
+			listen_sock = -1;
+			P_COV_LN;
+			continue;
+		}
+
+		now_us = RTC_Get_Mono_us();
+
+		if (FD_ISSET(listen_sock, &rfds))
+		{
+			sock = accept(listen_sock, NULL, NULL);
+			for (i = 0; (sock >= 0) && (i < MB_TCP_MAX_CLIENTS); i++)
+			{
+				if (mbtcp_clients[i].sock < 0)
+				{
+					mbtcp_clients[i].sock = sock;
+					mbtcp_clients[i].len = 0;
+					mbtcp_clients[i].last_us = now_us;
+					sock = -1;
+				}
+			}
+			if (sock >= 0)
+				close(sock);		// too many clients
+		}
+
+		for (i = 0; i < MB_TCP_MAX_CLIENTS; i++)
+		{
+			if (mbtcp_clients[i].sock < 0)
+				continue;
+
+			if (FD_ISSET(mbtcp_clients[i].sock, &rfds))
+			{
+				if (C_SUCCESS != ModbusTcp__Receive(&mbtcp_clients[i]))
+					ModbusTcp__Close(&mbtcp_clients[i]);
+			}
+			else if ((now_us - mbtcp_clients[i].last_us) > ((C_UINT64)MB_TCP_IDLE_TIMEOUT_SEC * 1000000))
+				ModbusTcp__Close(&mbtcp_clients[i]);
+		}
+	}
+}
+#endif
+
+/**
+ * @brief ModbusTcp__Start
+ *        start the Modbus TCP slave, only the first call has effect.
+ *        Call it with the network connected: the task opens its socket
+ *        at once and lwIP needs tcpip_adapter_init (radio config)
+ *
+ * @param  none
+ * @return C_RES
+ */
+C_RES ModbusTcp__Start(void)
+{
+#ifdef INCLUDE_PLATFORM_DEPENDENT
+	if (mbtcp_started)
+		return C_SUCCESS;
+
+	if (pdPASS != xTaskCreatePinnedToCore(ModbusTcp__Task, "MB_TCP", MB_TCP_TASK_STACK_SIZE, NULL, MB_TCP_TASK_PRIO, NULL, GME_NET_CORE))
+	{
+		PRINTF_DEBUG("MB_TCP task not created\n");
+		return C_FAIL;
+	}
+	mbtcp_started = 1;
+	P_COV_LN;
+#endif
+	return C_SUCCESS;
+}
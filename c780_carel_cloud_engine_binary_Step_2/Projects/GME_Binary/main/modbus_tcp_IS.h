@@ -0,0 +1,43 @@
+/**
+ * @file   modbus_tcp_IS.h
+ * @author carel
+ * @date   18 Oct 2026
+ * @brief  Modbus TCP slave on the LAN answering from the image of the
+ *         polling engine: the line is polled once and shared with the
+ *         local BMS/SCADA without another RS485 master.
+ *         Reads (01, 02, 03, 04) never go on the bus, the writes
+ *         (05, 06, 16) are forwarded to the device only if
+ *         MB_TCP_WRITE_THROUGH is enabled
+ *
+ */
+
+#ifndef MODBUS_TCP_IS_H_
+#define MODBUS_TCP_IS_H_
+
+#include "data_types_CAREL.h"
+
+/* ==== Define customizable ==== */
+
+#define MB_TCP_PORT					502
+
+/* max clients connected at the same time, the others are refused */
+#define MB_TCP_MAX_CLIENTS			2
+
+/* a client silent for this time is disconnected (seconds) */
+#define MB_TCP_IDLE_TIMEOUT_SEC		60
+
+/* 1 the writes of coils and holding registers of the model are
+   forwarded to the device, 0 the slave is read only */
+#define MB_TCP_WRITE_THROUGH		0
+
+/* max wait of a write executed by the polling task (ms), the client
+   gets a gateway target failed and, until the write is done, busy */
+#define MB_TCP_WRITE_WAIT_MS		3000
+
+#define MB_TCP_TASK_STACK_SIZE		4096
+#define MB_TCP_TASK_PRIO			CONFIG_GME_MB_TCP_TASK_PRIO
+
+/* ==== Function prototype ==== */
+C_RES ModbusTcp__Start(void);
+
+#endif /* MODBUS_TCP_IS_H_ */
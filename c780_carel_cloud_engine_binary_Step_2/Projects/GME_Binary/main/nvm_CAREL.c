@@ -10,6 +10,389 @@
 #include "nvm_CAREL.h"
 #include "nvm_IS.h"
 
+#include <stdlib.h>
+#include <string.h>
+
+
+/**
+ * @brief NVM_CACHE_ENTRIES
+ *        max number of U8/U32/string keys kept in RAM, the keys that
+ *        don't fit are read/written directly in the non volatile memory
+ */
+#define NVM_CACHE_ENTRIES   64
+#define NVM_KEY_SIZE        16
+
+#define NVM_ENTRY_DIRTY     0x01
+
+typedef struct nvm_cache_entry_s{
+	C_CHAR   key[NVM_KEY_SIZE];
+	C_BYTE   type;                 // NVM_TYPE_xxx, NVM_TYPE_NONE means free
+	C_BYTE   flags;
+	C_UINT32 u32;                  // value of U8 and U32 keys
+	C_CHAR*  str;                  // heap copy of string keys
+}nvm_cache_entry_t;
+
+static nvm_cache_entry_t nvm_cache[NVM_CACHE_ENTRIES];
+
+/* every U8/U32/string key of the nvm is in the cache, a miss means "not found" */
+static C_BOOL  nvm_cache_complete = 0;
+static C_BYTE  nvm_trans_depth = 0;
+static C_UINT16 nvm_trans_dirty = 0;
+static C_BOOL  nvm_trans_written = 0;
+static C_BOOL  nvm_trans_opened = 0;
+
+
+/**
+ * @brief nvm_cache_find
+ *
+ * @param  const C_CHAR* var
+ * @return nvm_cache_entry_t* or NULL if not cached
+ */
+static nvm_cache_entry_t* nvm_cache_find(const C_CHAR* var)
+{
+	C_UINT16 i;
+
+	for (i = 0; i < NVM_CACHE_ENTRIES; i++)
+	{
+		if ((nvm_cache[i].type != NVM_TYPE_NONE) && (strncmp(nvm_cache[i].key, var, NVM_KEY_SIZE) == 0))
+			return &nvm_cache[i];
+	}
+	return NULL;
+}
+
+/**
+ * @brief nvm_cache_add
+ *        take a free entry, when the cache is full it is no longer
+ *        complete and the key is handled directly in the nvm
+ *
+ * @param  const C_CHAR* var
+ * @param  C_BYTE type
+ * @return nvm_cache_entry_t* or NULL if the cache is full
+ */
+static nvm_cache_entry_t* nvm_cache_add(const C_CHAR* var, C_BYTE type)
+{
+	C_UINT16 i;
+
+	if (strlen(var) >= NVM_KEY_SIZE)
+		return NULL;
+
+	for (i = 0; i < NVM_CACHE_ENTRIES; i++)
+	{
+		if (nvm_cache[i].type == NVM_TYPE_NONE)
+		{
+			strcpy(nvm_cache[i].key, var);
+			nvm_cache[i].type = type;
+			nvm_cache[i].flags = 0;
+			nvm_cache[i].u32 = 0;
+			nvm_cache[i].str = NULL;
+			return &nvm_cache[i];
+		}
+	}
+
+	PRINTF_DEBUG_NVM("nvm cache full, %s not cached\n", var);
+	nvm_cache_complete = 0;
+	P_COV_LN;
+	return NULL;
+}
+
+/**
+ * @brief nvm_cache_drop
+ *
+ * @param  nvm_cache_entry_t* entry
+ * @return none
+ */
+static void nvm_cache_drop(nvm_cache_entry_t* entry)
+{
+	if (entry->flags & NVM_ENTRY_DIRTY)
+		nvm_trans_dirty--;
+
+	free(entry->str);
+	memset((void*)entry, 0, sizeof(nvm_cache_entry_t));
+}
+
+/**
+ * @brief nvm_cache_set_str
+ *
+ * @param  nvm_cache_entry_t* entry
+ * @param  const C_CHAR* str
+ * @return C_RES
+ */
+static C_RES nvm_cache_set_str(nvm_cache_entry_t* entry, const C_CHAR* str)
+{
+	C_CHAR* copy = malloc(strlen(str) + 1);
+
+	if (copy == NULL)
+		return C_FAIL;
+
+	strcpy(copy, str);
+	free(entry->str);
+	entry->str = copy;
+	return C_SUCCESS;
+}
+
+/**
+ * @brief nvm_cache_load_key
+ *        NVM__EnumKeys callback, copy one key in the cache
+ *
+ * @param  const C_CHAR* var
+ * @param  C_BYTE type
+ * @return none
+ */
+static void nvm_cache_load_key(const C_CHAR* var, C_BYTE type)
+{
+	nvm_cache_entry_t* entry = nvm_cache_add(var, type);
+	C_RES err = C_FAIL;
+	C_BYTE u8;
+	size_t len;
+
+	if (entry == NULL)
+		return;
+
+	switch (type)
+	{
+		case NVM_TYPE_U8:
+			err = NVM__GetU8(var, &u8);
+			entry->u32 = u8;
+			break;
+
+		case NVM_TYPE_U32:
+			err = NVM__GetU32(var, &entry->u32);
+			break;
+
+		case NVM_TYPE_STR:
+			if (C_SUCCESS == NVM__GetStringSize(var, &len))
+			{
+				entry->str = malloc(len);
+				if (entry->str != NULL)
+					err = NVM__GetString(var, entry->str, &len);
+			}
+			break;
+	}
+
+	if (err != C_SUCCESS)
+	{
+		nvm_cache_drop(entry);
+		nvm_cache_complete = 0;
+		P_COV_LN;
+	}
+}
+
+/**
+ * @brief nvm_cache_flush
+ *        write the dirty entries in the nvm
+ *
+ * @param  none
+ * @return C_RES
+ */
+static C_RES nvm_cache_flush(void)
+{
+	C_RES err = C_SUCCESS;
+	C_RES res;
+	C_UINT16 i;
+
+	for (i = 0; (i < NVM_CACHE_ENTRIES) && (nvm_trans_dirty != 0); i++)
+	{
+		if ((nvm_cache[i].flags & NVM_ENTRY_DIRTY) == 0)
+			continue;
+
+		switch (nvm_cache[i].type)
+		{
+			case NVM_TYPE_U8:  res = NVM__SetU8(nvm_cache[i].key, (C_BYTE)nvm_cache[i].u32);  break;
+			case NVM_TYPE_U32: res = NVM__SetU32(nvm_cache[i].key, nvm_cache[i].u32);         break;
+			default:           res = NVM__SetString(nvm_cache[i].key, nvm_cache[i].str);      break;
+		}
+
+		// on error the entry is left dirty, next commit will retry
+		if (res == C_SUCCESS)
+		{
+			nvm_cache[i].flags &= ~NVM_ENTRY_DIRTY;
+			nvm_trans_dirty--;
+		}
+		else
+		{
+			PRINTF_DEBUG_NVM("Writing %s in NVS failed\n", nvm_cache[i].key);
+			err = C_FAIL;
+			P_COV_LN;
+		}
+		nvm_trans_written = 1;
+	}
+	return err;
+}
+
+/**
+ * @brief nvm_cache_write
+ *        update the value of a key, only a changed value
+ *        becomes dirty
+ *
+ * @param  const C_CHAR* var
+ * @param  C_BYTE type
+ * @param  C_UINT32 val
+ * @param  const C_CHAR* str (NVM_TYPE_STR only)
+ * @return C_RES
+ */
+static C_RES nvm_cache_write(const C_CHAR* var, C_BYTE type, C_UINT32 val, const C_CHAR* str)
+{
+	nvm_cache_entry_t* entry = nvm_cache_find(var);
+
+	if (entry == NULL)
+	{
+		entry = nvm_cache_add(var, type);
+		if (entry == NULL)
+		{
+			// not cached, straight to the nvm
+			nvm_trans_written = 1;
+			switch (type)
+			{
+				case NVM_TYPE_U8:  return NVM__SetU8(var, (C_BYTE)val);
+				case NVM_TYPE_U32: return NVM__SetU32(var, val);
+				default:           return NVM__SetString(var, (C_CHAR*)str);
+			}
+		}
+	}
+	else if (entry->type != type)
+	{
+		PRINTF_DEBUG_NVM("%s has another type\n", var);
+		P_COV_LN;
+		return C_FAIL;
+	}
+	else if (type == NVM_TYPE_STR ? (strcmp(entry->str, str) == 0) : (entry->u32 == val))
+	{
+		return C_SUCCESS;			// unchanged, no flash write
+	}
+
+	if (type == NVM_TYPE_STR)
+	{
+		if (C_SUCCESS != nvm_cache_set_str(entry, str))
+		{
+			if (entry->str == NULL)
+				nvm_cache_drop(entry);
+			return C_FAIL;
+		}
+	}
+	else
+		entry->u32 = val;
+
+	if ((entry->flags & NVM_ENTRY_DIRTY) == 0)
+	{
+		entry->flags |= NVM_ENTRY_DIRTY;
+		nvm_trans_dirty++;
+	}
+	return C_SUCCESS;
+}
+
+/**
+ * @brief nvm_cache_miss
+ *        read a key not in the cache and keep it
+ *
+ * @param  const C_CHAR* var
+ * @param  C_BYTE type
+ * @return nvm_cache_entry_t* or NULL if not found
+ */
+static nvm_cache_entry_t* nvm_cache_miss(const C_CHAR* var, C_BYTE type)
+{
+	nvm_cache_entry_t* entry = NULL;
+
+	// after a complete load a miss means the key doesn't exist
+	if (nvm_cache_complete)
+		return NULL;
+
+	if (C_SUCCESS == NVM__BeginTransaction())
+	{
+		PRINTF_DEBUG_NVM("Reading %s from NVS ... ", var);
+		nvm_cache_load_key(var, type);
+		entry = nvm_cache_find(var);
+	}
+
+	NVM__EndTransaction();
+	return entry;
+}
+
+
+/**
+ * @brief NVM__CacheLoad
+ *        copy in RAM all the U8/U32/string keys, to be called once
+ *        after NVM_Init
+ *
+ * @param  none
+ *
+ * @return C_RES
+ */
+C_RES NVM__CacheLoad(void)
+{
+	C_RES err = NVM__BeginTransaction();
+
+	if (err == C_SUCCESS)
+	{
+		nvm_cache_complete = 1;		// cleared on any overflow/read error
+		err = NVM__EnumKeys(nvm_cache_load_key);
+		if (err != C_SUCCESS)
+			nvm_cache_complete = 0;
+	}
+	NVM__EndTransaction();
+
+	PRINTF_DEBUG_NVM("nvm cache %s\n", nvm_cache_complete ? "complete" : "partial");
+	P_COV_LN;
+	return err;
+}
+
+/**
+ * @brief NVM__BeginTransaction
+ *        the following writes are kept in RAM until the matching
+ *        NVM__EndTransaction, the transactions can be nested.
+ *        NVM__EndTransaction must be called also when this fails
+ *
+ * @param  none
+ *
+ * @return C_RES C_FAIL if the nvm cannot be opened
+ */
+C_RES NVM__BeginTransaction(void)
+{
+	NVM__Lock();
+
+	if (nvm_trans_depth++ == 0)
+	{
+		nvm_trans_written = 0;
+		nvm_trans_opened = (C_SUCCESS == NVM__Open());
+	}
+
+	return nvm_trans_opened ? C_SUCCESS : C_FAIL;
+}
+
+/**
+ * @brief NVM__EndTransaction
+ *        the outermost call writes the dirty keys and commits once
+ *
+ * @param  none
+ *
+ * @return C_RES result of the commit
+ */
+C_RES NVM__EndTransaction(void)
+{
+	C_RES err = C_SUCCESS;
+
+	if (nvm_trans_depth == 0)
+		return C_FAIL;
+
+	if (--nvm_trans_depth == 0)
+	{
+		if (nvm_trans_opened)
+		{
+			err = nvm_cache_flush();
+			if (nvm_trans_written && (C_SUCCESS != NVM__Commit()))
+				err = C_FAIL;
+			NVM__Close();
+			nvm_trans_opened = 0;
+		}
+		else
+			err = C_FAIL;		// dirty keys are kept for the next commit
+		P_COV_LN;
+	}
+	else if (!nvm_trans_opened)
+		err = C_FAIL;
+
+	NVM__Unlock();
+	return err;
+}
 
 /**
  * @brief NVM__ReadU8Value
@@ -22,13 +405,19 @@
  */
 C_RES NVM__ReadU8Value(const C_CHAR* var, C_BYTE* val)
 {
-	C_RES err =	NVM__Open();
-	if (err == C_SUCCESS) {
-		// Read
-		PRINTF_DEBUG_NVM("Reading %s from NVS ... ", var);
-		err = NVM__GetU8(var, val);
-		NVM__Close();
+	C_RES err = C_FAIL;
+	nvm_cache_entry_t* entry;
+
+	NVM__Lock();
+	entry = nvm_cache_find(var);
+	if (entry == NULL)
+		entry = nvm_cache_miss(var, NVM_TYPE_U8);
+
+	if ((entry != NULL) && (entry->type == NVM_TYPE_U8)) {
+		*val = (C_BYTE)entry->u32;
+		err = C_SUCCESS;
 	}
+	NVM__Unlock();
 	P_COV_LN;
     return err;
 }
@@ -44,13 +433,19 @@ C_RES NVM__ReadU8Value(const C_CHAR* var, C_BYTE* val)
  */
 C_RES NVM__ReadU32Value(const C_CHAR* var, C_UINT32* val)
 {
-	C_RES err =	NVM__Open();
-	if (err == C_SUCCESS) {
-		// Read
-		PRINTF_DEBUG_NVM("Reading %s from NVS ... ", var);
-		err = NVM__GetU32(var, val);
-		NVM__Close();
+	C_RES err = C_FAIL;
+	nvm_cache_entry_t* entry;
+
+	NVM__Lock();
+	entry = nvm_cache_find(var);
+	if (entry == NULL)
+		entry = nvm_cache_miss(var, NVM_TYPE_U32);
+
+	if ((entry != NULL) && (entry->type == NVM_TYPE_U32)) {
+		*val = entry->u32;
+		err = C_SUCCESS;
 	}
+	NVM__Unlock();
 	P_COV_LN;
 	return err;
 }
@@ -61,19 +456,26 @@ C_RES NVM__ReadU32Value(const C_CHAR* var, C_UINT32* val)
  *
  * @param  const C_CHAR* var
  * @param  C_CHAR* str
- * @param  size_t* len
+ * @param  size_t* len  size of the string, terminator included
  *
  * @return C_RES
  */
 C_RES NVM__ReadString(const C_CHAR* var, C_CHAR* str, size_t* len)
 {
-	C_RES err =	NVM__Open();
-	if (err == C_SUCCESS) {
-		// Read
-		PRINTF_DEBUG_NVM("Reading %s from NVS ... ",var);
-		err = NVM__GetString(var, str, len);
-		NVM__Close();
+	C_RES err = C_FAIL;
+	nvm_cache_entry_t* entry;
+
+	NVM__Lock();
+	entry = nvm_cache_find(var);
+	if (entry == NULL)
+		entry = nvm_cache_miss(var, NVM_TYPE_STR);
+
+	if ((entry != NULL) && (entry->type == NVM_TYPE_STR)) {
+		strcpy(str, entry->str);
+		*len = strlen(str) + 1;
+		err = C_SUCCESS;
 	}
+	NVM__Unlock();
 	P_COV_LN;
     return err;
 }
@@ -89,11 +491,11 @@ C_RES NVM__ReadString(const C_CHAR* var, C_CHAR* str, size_t* len)
  */
 C_RES NVM__WriteU8Value(const C_CHAR* var, C_BYTE val)
 {
-	C_RES err =	NVM__Open();
-	if (err == C_SUCCESS) {
-		err = NVM__SetU8(var, val);
-		NVM__Close();
-	}
+	C_RES err =	NVM__BeginTransaction();
+	if (err == C_SUCCESS)
+		err = nvm_cache_write(var, NVM_TYPE_U8, val, NULL);
+	if (C_SUCCESS != NVM__EndTransaction())
+		err = C_FAIL;
 	P_COV_LN;
     return err;
 }
@@ -109,11 +511,11 @@ C_RES NVM__WriteU8Value(const C_CHAR* var, C_BYTE val)
  */
 C_RES NVM__WriteU32Value(const C_CHAR* var, C_UINT32 val)
 {
-	C_RES err =	NVM__Open();
-	if (err == C_SUCCESS) {
-		err = NVM__SetU32(var, val);
-		NVM__Close();
-	}
+	C_RES err =	NVM__BeginTransaction();
+	if (err == C_SUCCESS)
+		err = nvm_cache_write(var, NVM_TYPE_U32, val, NULL);
+	if (C_SUCCESS != NVM__EndTransaction())
+		err = C_FAIL;
 	P_COV_LN;
 	return err;
 }
@@ -129,11 +531,11 @@ C_RES NVM__WriteU32Value(const C_CHAR* var, C_UINT32 val)
  */
 C_RES NVM__WriteString(const C_CHAR* var, C_CHAR* str)
 {
-	C_RES err =	NVM__Open();
-	if (err == C_SUCCESS) {
-		err = NVM__SetString(var, str);
-		NVM__Close();
-	}
+	C_RES err =	NVM__BeginTransaction();
+	if (err == C_SUCCESS)
+		err = nvm_cache_write(var, NVM_TYPE_STR, 0, str);
+	if (C_SUCCESS != NVM__EndTransaction())
+		err = C_FAIL;
 	P_COV_LN;
 	return err;
 }
@@ -148,11 +550,15 @@ C_RES NVM__WriteString(const C_CHAR* var, C_CHAR* str)
  */
 C_RES NVM__EraseKey(const C_CHAR* var)
 {
-	C_RES err = NVM__Open();
+	nvm_cache_entry_t* entry;
+	C_RES err = NVM__BeginTransaction();
 	if (err == C_SUCCESS) {
+		entry = nvm_cache_find(var);
+		if (entry != NULL)
+			nvm_cache_drop(entry);
 		err = NVM__EraseK(var);
-		NVM__Close();
 	}
+	NVM__EndTransaction();
 	P_COV_LN;
 	return err;
 }
@@ -167,11 +573,16 @@ C_RES NVM__EraseKey(const C_CHAR* var)
  */
 C_RES NVM__EraseAll(void)
 {
-	C_RES err = NVM__Open();
+	C_UINT16 i;
+	C_RES err = NVM__BeginTransaction();
 	if (err == C_SUCCESS) {
+		for (i = 0; i < NVM_CACHE_ENTRIES; i++)
+			nvm_cache_drop(&nvm_cache[i]);
+		nvm_trans_dirty = 0;
 		err = NVM__Erase();
-		NVM__Close();
+		nvm_cache_complete = (err == C_SUCCESS);
 	}
+	NVM__EndTransaction();
 	P_COV_LN;
 	return err;
 }
@@ -189,11 +600,11 @@ C_RES NVM__EraseAll(void)
  */
 C_RES NVM__ReadBlob(const C_CHAR* var, void* vec, size_t* len)
 {
-	C_RES err = NVM__Open();
+	C_RES err = NVM__BeginTransaction();
 	if (err == C_SUCCESS) {
 		err = NVM__GetBlob(var, vec, len);
-		NVM__Close();
 	}
+	NVM__EndTransaction();
 	P_COV_LN;
     return err;
 }
@@ -201,7 +612,8 @@ C_RES NVM__ReadBlob(const C_CHAR* var, void* vec, size_t* len)
 
 /**
  * @brief NVM__WriteBlob
- *        write a chunk of data to the non volatile memory
+ *        write a chunk of data to the non volatile memory,
+ *        blobs are not cached
  *
  * @param  const C_CHAR* var,
  * @param  void* vec
@@ -211,11 +623,13 @@ C_RES NVM__ReadBlob(const C_CHAR* var, void* vec, size_t* len)
  */
 C_RES NVM__WriteBlob (const C_CHAR* var, void* vec, size_t len)
 {
-	C_RES err = NVM__Open();
+	C_RES err = NVM__BeginTransaction();
     if (err == C_SUCCESS) {
     	err = NVM__SetBlob(var, vec, len);
-        NVM__Close();
+    	nvm_trans_written = 1;
     }
+    if (C_SUCCESS != NVM__EndTransaction())
+    	err = C_FAIL;
     P_COV_LN;
     return err;
 }
@@ -24,8 +24,14 @@
 #define MB_DEV_NVM "dev"
 #define MB_CERT_NVM "cert"
 #define MB_DELAY_NVM "del"
+#define MB_AUX_NVM "mb_aux"
+#define MB_AUX_POLL_NVM "mb_apl"
+#define AGG_WINDOW_NVM "agg_win"
+#define AGG_POLICY_NVM "agg_pol"
+#define WIFI_LAST_AP_NVM "wifi_last_ap"
 #define PE_STATUS_NVM "pe_status"
 #define CFG_DEF_NVM "cfg_def_copied"
+#define MODEL_CRC_NVM "mdl_crc"
 #define GME_PN "gme_pn"
 
 #define MQTT_USER "mqtt_user"
@@ -61,5 +67,9 @@ C_RES NVM__EraseAll(void);
 C_RES NVM__WriteBlob (const C_CHAR* var, void* vec, size_t len);
 C_RES NVM__ReadBlob(const C_CHAR* var, void* vec, size_t* len);
 
+C_RES NVM__CacheLoad(void);
+C_RES NVM__BeginTransaction(void);
+C_RES NVM__EndTransaction(void);
+
 
 #endif /* MAIN_NVM_CAREL_H_ */
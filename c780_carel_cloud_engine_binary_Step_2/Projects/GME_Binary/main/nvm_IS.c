@@ -10,8 +10,18 @@
 #include <errno.h>
 
 #include "mbedtls/aes.h"
+
+#ifdef INCLUDE_PLATFORM_DEPENDENT
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#endif
+
 static nvs_handle my_handle;
 
+#ifdef INCLUDE_PLATFORM_DEPENDENT
+static SemaphoreHandle_t nvm_mutex = NULL;
+#endif
+
 
 /**
  * @brief NVM_Init
@@ -26,6 +36,9 @@ C_RES NVM_Init(void)
 {
 #ifdef INCLUDE_PLATFORM_DEPENDENT
 
+	if (nvm_mutex == NULL)
+		nvm_mutex = xSemaphoreCreateRecursiveMutex();
+
   #ifdef CONFIG_NVS_ENCRYPTION
 	nvs_sec_cfg_t cfg;
 
@@ -70,6 +83,39 @@ C_RES NVM_Init(void)
 
 }
 
+/**
+ * @brief NVM__Lock
+ *        take the ownership of the nvm handle and of the cache,
+ *        can be nested by the same task
+ *
+ * @param  none
+ *
+ * @return none
+ */
+void NVM__Lock(void)
+{
+#ifdef INCLUDE_PLATFORM_DEPENDENT
+	if (nvm_mutex != NULL)
+		xSemaphoreTakeRecursive(nvm_mutex, portMAX_DELAY);
+#endif
+}
+
+/**
+ * @brief NVM__Unlock
+ *        release the ownership taken with NVM__Lock
+ *
+ * @param  none
+ *
+ * @return none
+ */
+void NVM__Unlock(void)
+{
+#ifdef INCLUDE_PLATFORM_DEPENDENT
+	if (nvm_mutex != NULL)
+		xSemaphoreGiveRecursive(nvm_mutex);
+#endif
+}
+
 /**
  * @brief NVM__Open
  *        call a "nvs_open" function,
@@ -84,7 +130,7 @@ C_RES NVM__Open(void)
 	PRINTF_DEBUG_NVM("Opening Non-Volatile Storage (NVS) handle... ");
 	C_RES err = C_FAIL;
 #ifdef INCLUDE_PLATFORM_DEPENDENT
-	err = nvs_open("storage", NVS_READWRITE, &my_handle);
+	err = nvs_open(NVM_NAMESPACE, NVS_READWRITE, &my_handle);
 	if (err != ESP_OK) {
 		PRINTF_DEBUG_NVM("Error (%s) opening NVS handle!\n", esp_err_to_name(err));
 		P_COV_LN;
@@ -111,6 +157,63 @@ void NVM__Close(void){
 	nvs_close(my_handle);
 }
 
+/**
+ * @brief NVM__Commit
+ *        call a "nvs_commit" function, the NVM__Setxxx functions
+ *        don't commit by themselves
+ *        for more details see esp-idf manual.
+ *
+ * @param  none
+ *
+ * @return C_RES
+ */
+C_RES NVM__Commit(void){
+	C_RES err = C_FAIL;
+#ifdef INCLUDE_PLATFORM_DEPENDENT
+	PRINTF_DEBUG_NVM("Committing updates in NVS ... ");
+	err = nvs_commit(my_handle);
+	PRINTF_DEBUG_NVM((err != ESP_OK) ? "Failed!\n" : "Done\n");
+#endif
+	return err;
+}
+
+/**
+ * @brief NVM__EnumKeys
+ *        call the callback for every U8/U32/string key of the
+ *        NVM_NAMESPACE, blobs are skipped
+ *        for more details see esp-idf manual (nvs_entry_find).
+ *
+ * @param  nvm_enum_cb_t callback
+ *
+ * @return C_RES
+ */
+C_RES NVM__EnumKeys(nvm_enum_cb_t callback){
+	C_RES err = C_FAIL;
+#ifdef INCLUDE_PLATFORM_DEPENDENT
+	nvs_entry_info_t info;
+	nvs_iterator_t it = nvs_entry_find(NVS_DEFAULT_PART_NAME, NVM_NAMESPACE, NVS_TYPE_ANY);
+	C_BYTE type;
+
+	while (it != NULL) {
+		nvs_entry_info(it, &info);
+		it = nvs_entry_next(it);		// released by itself at the end
+
+		switch (info.type) {
+			case NVS_TYPE_U8:  type = NVM_TYPE_U8;   break;
+			case NVS_TYPE_U32: type = NVM_TYPE_U32;  break;
+			case NVS_TYPE_STR: type = NVM_TYPE_STR;  break;
+			default:           type = NVM_TYPE_NONE; break;
+		}
+
+		if (type != NVM_TYPE_NONE)
+			callback(info.key, type);
+	}
+	P_COV_LN;
+	err = C_SUCCESS;
+#endif
+	return err;
+}
+
 /**
  * @brief NVM__SetU8
  *        call a "nvs_set_u8(...)" function
@@ -124,12 +227,8 @@ void NVM__Close(void){
 C_RES NVM__SetU8(const C_CHAR* var, C_BYTE val){
 	C_RES err = C_FAIL;
 #ifdef INCLUDE_PLATFORM_DEPENDENT
-	// Write
-
-	if (ESP_OK == nvs_set_u8(my_handle, var, val))
-	{
-	  err = nvs_commit(my_handle);
-	}
+	// Write, committed by the caller
+	err = nvs_set_u8(my_handle, var, val);
 #endif
 	return err;
 }
@@ -147,11 +246,8 @@ C_RES NVM__SetU8(const C_CHAR* var, C_BYTE val){
 C_RES NVM__SetU32(const C_CHAR* var, C_UINT32 val){
 	C_RES err = C_FAIL;
 #ifdef INCLUDE_PLATFORM_DEPENDENT
-	// Write
-	if (ESP_OK == nvs_set_u32(my_handle, var, val))
-	{
-	err = nvs_commit(my_handle);
-	}
+	// Write, committed by the caller
+	err = nvs_set_u32(my_handle, var, val);
 #endif
 	return err;
 }
@@ -169,11 +265,8 @@ C_RES NVM__SetU32(const C_CHAR* var, C_UINT32 val){
 C_RES NVM__SetString(const C_CHAR* var, char* str){
 	C_RES err = C_FAIL;
 #ifdef INCLUDE_PLATFORM_DEPENDENT
-	// Write
-	if (ESP_OK == nvs_set_str(my_handle, var, str))
-	{
-	   err = nvs_commit(my_handle);
-	}
+	// Write, committed by the caller
+	err = nvs_set_str(my_handle, var, str);
 #endif
 	return err;
 }
@@ -199,22 +292,7 @@ C_RES NVM__SetBlob(const C_CHAR* var, void* vec, size_t len){
 
 	PRINTF_DEBUG_NVM((err != ESP_OK) ? "Failed!" : "Done");
 	PRINTF_DEBUG_NVM(" ..... Value = err = 0x%X\n",err);
-
-	if (ESP_OK == err){
-	  PRINTF_DEBUG_NVM("Committing updates in NVS ... ");
-	  err = nvs_commit(my_handle);
-
-	  if (err != ESP_OK)
-	  {
-		  P_COV_LN;
-	  }
-	  else
-	  {
-		  P_COV_LN;
-	  }
-
-	  PRINTF_DEBUG_NVM((err != ESP_OK) ? "Failed!\n" : "Done\n");
-	}
+	P_COV_LN;
 #endif
 
 	return err;
@@ -323,6 +401,28 @@ C_RES NVM__GetString(const C_CHAR* var, char* str, size_t* len){
 	return err;
 }
 
+/**
+ * @brief NVM__GetStringSize
+ *        call a "nvs_get_str(...)" function to get the size of a string
+ *        (terminator included)
+ *        for more details see esp-idf manual.
+ *
+ * @param  const C_CHAR* var
+ * @param  size_t* len
+ *
+ * @return C_RES
+ */
+C_RES NVM__GetStringSize(const C_CHAR* var, size_t* len){
+	C_RES err = C_FAIL;
+#ifdef INCLUDE_PLATFORM_DEPENDENT
+	*len = 0;
+	err = nvs_get_str(my_handle, var, NULL, len);
+	if ((err == ESP_OK) && (*len == 0))
+		err = C_FAIL;
+#endif
+	return err;
+}
+
 /**
  * @brief NVM__GetBlob
  *        call a "nvs_get_blob(...)" function
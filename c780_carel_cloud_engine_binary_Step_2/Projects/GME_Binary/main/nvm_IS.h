@@ -29,15 +29,35 @@
 #endif
 
 
+/**
+ * @brief NVM_NAMESPACE
+ *        namespace of all the GME keys
+ */
+#define NVM_NAMESPACE       "storage"
 
+/**
+ * @brief NVM_TYPE_xxx
+ *        type of a key reported by NVM__EnumKeys
+ */
+#define NVM_TYPE_NONE       0
+#define NVM_TYPE_U8         1
+#define NVM_TYPE_U32        2
+#define NVM_TYPE_STR        3
+
+typedef void (*nvm_enum_cb_t)(const C_CHAR* var, C_BYTE type);
 
 
 C_RES NVM_Init(void);
+void NVM__Lock(void);
+void NVM__Unlock(void);
 C_RES NVM__Open(void);
 void NVM__Close(void);
+C_RES NVM__Commit(void);
+C_RES NVM__EnumKeys(nvm_enum_cb_t callback);
 C_RES NVM__GetU8(const C_CHAR* var, C_BYTE* val);
 C_RES NVM__GetU32(const C_CHAR* var, C_UINT32* val);
 C_RES NVM__GetString(const C_CHAR* var, C_CHAR* str, size_t* len);
+C_RES NVM__GetStringSize(const C_CHAR* var, size_t* len);
 C_RES NVM__SetU8(const C_CHAR* var, C_BYTE val);
 C_RES NVM__SetU32(const C_CHAR* var, C_UINT32 val);
 C_RES NVM__SetString(const C_CHAR* var, C_CHAR* str);
@@ -8,6 +8,7 @@
 
 #include "nvm_CAREL.h"
 #include "ota_IS.h"
+#include "ota_delta_IS.h"
 #include "ota_CAREL.h"
 #include "modbus_IS.h"
 #include "https_client_CAREL.h"
@@ -172,10 +173,13 @@ void Model_ota_task(void * pvParameter)
 		// model file has been saved, report it in nvm
 		// save also corresponding cid and did
 		// save also dev
-		if( (C_SUCCESS == NVM__WriteU8Value(SET_DEVS_CONFIG_NVM, CONFIGURED)) &&
-			(C_SUCCESS == NVM__WriteU32Value(MB_CID_NVM, myCborUpdate->cid)) &&
-			(C_SUCCESS == NVM__WriteU32Value(MB_DID_NVM, myCborUpdate->did)) &&
-			(C_SUCCESS == NVM__WriteU32Value(MB_DEV_NVM, myCborUpdate->dev)) ){
+		C_RES nvm_err = NVM__BeginTransaction();
+		nvm_err |= NVM__WriteU8Value(SET_DEVS_CONFIG_NVM, CONFIGURED);
+		nvm_err |= NVM__WriteU32Value(MB_CID_NVM, myCborUpdate->cid);
+		nvm_err |= NVM__WriteU32Value(MB_DID_NVM, myCborUpdate->did);
+		nvm_err |= NVM__WriteU32Value(MB_DEV_NVM, myCborUpdate->dev);
+		nvm_err |= NVM__EndTransaction();
+		if(C_SUCCESS == nvm_err){
             #ifdef __DEBUG_OTA_CAREL_LEV_1
 			PRINTF_DEBUG("MODEL FILE, CID, DID AND DEV SAVED\n");
             #endif
@@ -254,6 +258,8 @@ void CA_ota_task(void * pvParameter)
  *        server the GME firmware update.
  *		  Refer to the function "https_ota(...)" in ota_IS.c
  *		  for more details.
+ *		  If the request has a patch (dpu) the delta update is tried
+ *		  first, the full image is downloaded only if it fails
  *
  * @param  void * pvParameter
  *
@@ -293,7 +299,35 @@ void GME_ota_task(void * pvParameter)
 
 	c_config.cert_num = cert_num;
 
-    C_RES ret = https_ota(&c_config);
+    C_RES ret = C_FAIL;
+
+    if (myCborUpdate->dpu[0] != 0)
+    {
+    	c_http_client_config_t d_config = c_config;
+    	char *d_url = malloc(strlen(myCborUpdate->dpu) + strlen(myCborUpdate->usr) + strlen(myCborUpdate->pwd) + 5);
+
+    	if (d_url != NULL)
+    	{
+    		sprintf(d_url,"%.*s%s:%s@%s",8,myCborUpdate->dpu, myCborUpdate->usr, myCborUpdate->pwd, myCborUpdate->dpu+8);
+    		d_config.url = d_url;
+    		ret = OTA__DeltaUpdate(&d_config, myCborUpdate->sha);
+    		free(d_url);
+    	}
+#ifdef __DEBUG_OTA_CAREL_LEV_1
+    	if (ret != C_SUCCESS)
+    		ESP_LOGW(TAG, "Delta update failed, full image");
+#endif
+    	P_COV_LN;
+    }
+
+    if (ret != C_SUCCESS)
+    {
+    	ret = https_ota(&c_config);
+
+    	// the image is complete and valid, it must also be the expected one
+    	if (ret == C_SUCCESS)
+    		ret = OTA__VerifyBootImage(myCborUpdate->sha);
+    }
 
     Modbus_Enable();
 
@@ -338,8 +372,14 @@ void DEV_ota_range_task(void * pvParameter){
 
     C_BYTE is_connected = 0;
 
+    C_RES unlocked;
+
+    // the unlock sequence must not be interleaved with other transactions
+    Modbus__BusAcquire(MB_CLIENT_DEV_OTA);
+    unlocked = unlock_feature_control();
+    Modbus__BusRelease();
 
-    if(unlock_feature_control() != C_SUCCESS){
+    if(unlocked != C_SUCCESS){
 #ifdef __DEBUG_OTA_CAREL_LEV_1
     	PRINTF_DEBUG("cannot update device\n");
 #endif
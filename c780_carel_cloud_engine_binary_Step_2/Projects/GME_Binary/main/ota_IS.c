@@ -14,6 +14,8 @@
 #include "sys_CAREL.h"
 #include "nvm_CAREL.h"
 #include "CBOR_CAREL.h"
+#include "gme_config.h"
+#include "sha256_CAREL.h"
 
 #ifdef INCLUDE_PLATFORM_DEPENDENT
 #include "esp_https_ota.h"
@@ -183,11 +185,52 @@ void OTA_End(EventGroupHandle_t s_ota_group)
 void OTA__GMEInit(c_cborrequpdgmefw update_gw_fw)
 {
 #ifdef INCLUDE_PLATFORM_DEPENDENT
+	// the task reads the request also after the first download, keep a copy
+	static c_cborrequpdgmefw gme_fw;
+
+	gme_fw = update_gw_fw;
 	s_ota_gme_group = xEventGroupCreate();
-    xTaskCreate(&GME_ota_task, "GME_ota_task", 8192, (void*)&update_gw_fw, 5, NULL);
+    xTaskCreatePinnedToCore(&GME_ota_task, "GME_ota_task", 8192, (void*)&gme_fw, OTA_TASK_PRIO, NULL, GME_NET_CORE);
 #endif
 }
 
+/**
+ * @brief OTA__VerifyBootImage
+ *        check the sha-256 of the image just written in the boot
+ *        partition, if it isn't the expected one the running image
+ *        stays the boot one
+ *
+ * @param const C_CHAR *sha  sha-256 in hex, "" not checked
+ *
+ * @return C_SUCCESS/C_FAIL
+ */
+C_RES OTA__VerifyBootImage(const C_CHAR *sha)
+{
+	C_RES ret = C_FAIL;
+#ifdef INCLUDE_PLATFORM_DEPENDENT
+	const esp_partition_t *boot = esp_ota_get_boot_partition();
+	const esp_partition_t *run = esp_ota_get_running_partition();
+	C_BYTE digest[SHA256_DIGEST_LEN];
+
+	if (sha[0] == 0)
+		return C_SUCCESS;
+
+	if ((boot != NULL) && (run != NULL) && (boot->address != run->address) &&
+		(ESP_OK == esp_partition_get_sha256(boot, digest)) && (C_SUCCESS == Sha256__MatchHex(digest, sha)))
+	{
+		ret = C_SUCCESS;
+	}
+	else
+	{
+		ESP_LOGE(TAG, "new image sha-256 mismatch");
+		if (run != NULL)
+			esp_ota_set_boot_partition(run);
+	}
+	P_COV_LN;
+#endif
+	return ret;
+}
+
 
 
 
@@ -201,8 +244,12 @@ void OTA__GMEInit(c_cborrequpdgmefw update_gw_fw)
 void OTA__DEVInit(c_cborrequpddevfw update_dev_fw)
 {
 #ifdef INCLUDE_PLATFORM_DEPENDENT
+	// the task reads the request also after this returns, keep a copy
+	static c_cborrequpddevfw dev_fw;
+
+	dev_fw = update_dev_fw;
 	s_ota_dev_group = xEventGroupCreate();
-	xTaskCreate(&DEV_ota_range_task, "DEV_ota_task", 8192, (void*)&update_dev_fw, 5, NULL);
+	xTaskCreatePinnedToCore(&DEV_ota_range_task, "DEV_ota_task", 8192, (void*)&dev_fw, OTA_TASK_PRIO, NULL, GME_NET_CORE);
 #endif
 }
 
@@ -216,7 +263,11 @@ void OTA__DEVInit(c_cborrequpddevfw update_dev_fw)
 void OTA__ModelInit(c_cborreqdwldevsconfig download_devs_config)
 {
 #ifdef INCLUDE_PLATFORM_DEPENDENT
-	xTaskCreate(&Model_ota_task, "Model_ota_task", 8192, (void*)&download_devs_config, 5, NULL);
+	// the task reads the request (sha, crc) also after the download, keep a copy
+	static c_cborreqdwldevsconfig devs_config;
+
+	devs_config = download_devs_config;
+	xTaskCreatePinnedToCore(&Model_ota_task, "Model_ota_task", 8192, (void*)&devs_config, OTA_TASK_PRIO, NULL, GME_NET_CORE);
 #endif
 }
 
@@ -230,7 +281,11 @@ void OTA__ModelInit(c_cborreqdwldevsconfig download_devs_config)
 void OTA__CAInit(c_cborrequpdatecacert update_ca)
 {
 #ifdef INCLUDE_PLATFORM_DEPENDENT
-	xTaskCreate(&CA_ota_task, "CA_ota_task", 8192, (void*)&update_ca, 5, NULL);
+	// the task reads the request (sha, crc) also after the download, keep a copy
+	static c_cborrequpdatecacert ca_cert;
+
+	ca_cert = update_ca;
+	xTaskCreatePinnedToCore(&CA_ota_task, "CA_ota_task", 8192, (void*)&ca_cert, OTA_TASK_PRIO, NULL, GME_NET_CORE);
 #endif
 }
 
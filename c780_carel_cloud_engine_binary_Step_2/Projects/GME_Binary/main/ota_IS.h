@@ -44,5 +44,6 @@ void OTA__DEVInit(c_cborrequpddevfw update_dev_fw);
 void OTADEVGroup (bool ota_res);
 void OTA__CAInit(c_cborrequpdatecacert update_ca);
 void OTA__ModelInit(c_cborreqdwldevsconfig download_devs_config);
+C_RES OTA__VerifyBootImage(const C_CHAR *sha);
 
 #endif  //__OTA_IS
@@ -0,0 +1,420 @@
+/**
+ * @file   ota_delta_IS.c
+ * @author carel
+ * @date   18 Oct 2026
+ * @brief  delta update of the GME firmware, see ota_delta_IS.h for the
+ *         format of the patch. The patch is inflated and applied while
+ *         it arrives, the RAM in use (the 32K window of inflate and few
+ *         buffers) doesn't depend on the size of the image or of the patch
+ */
+
+/* Includes ------------------------------------------------------------------------ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ota_delta_IS.h"
+#include "sha256_CAREL.h"
+#include "https_client_CAREL.h"
+#include "sys_IS.h"
+
+#ifdef INCLUDE_PLATFORM_DEPENDENT
+#include "esp_ota_ops.h"
+#include "esp_partition.h"
+#include "esp32/rom/miniz.h"
+#include "esp_log.h"
+#endif
+
+#ifdef INCLUDE_PLATFORM_DEPENDENT
+
+#define DELTA_SHA_LEN		32
+#define DELTA_HDR_LEN		(4 + 4 + 2 * DELTA_SHA_LEN)
+#define DELTA_CTRL_LEN		12
+
+enum{
+	DELTA_ST_HEADER = 0,
+	DELTA_ST_CTRL,
+	DELTA_ST_DIFF,
+	DELTA_ST_EXTRA,
+	DELTA_ST_DONE,
+};
+
+/**
+ * @brief ota_delta_t
+ *        state of a delta update, kept across the resumed connections
+ */
+typedef struct{
+	tinfl_decompressor inf;
+	C_BYTE dict[TINFL_LZ_DICT_SIZE];	// output of inflate, also its window
+	C_UINT32 dict_pos;
+	C_BYTE inflate_done;
+
+	C_BYTE in[OTA_DELTA_CHUNK_SIZE];
+	C_BYTE old[OTA_DELTA_OLD_SIZE];
+	C_UINT32 rx_len;					// bytes of the patch received
+
+	C_BYTE state;
+	C_BYTE hdr[DELTA_HDR_LEN];			// header, then control of a block
+	C_UINT32 hdr_len;
+	C_UINT32 diff_len;
+	C_UINT32 extra_len;
+	C_INT32 seek;
+	C_UINT32 old_pos;
+	C_UINT32 new_len;
+	C_UINT32 new_size;
+
+	C_BYTE run_sha[DELTA_SHA_LEN];
+	C_BYTE new_sha[DELTA_SHA_LEN];
+	const esp_partition_t *run_part;
+	const esp_partition_t *upd_part;
+	esp_ota_handle_t upd;
+}ota_delta_t;
+
+static const char *TAG = "OTA_DELTA_IS";
+
+
+/*
+ * delta_u32
+ *        little endian integer of the patch
+ */
+static C_UINT32 delta_u32(const C_BYTE *p)
+{
+	return (C_UINT32)p[0] | ((C_UINT32)p[1] << 8) | ((C_UINT32)p[2] << 16) | ((C_UINT32)p[3] << 24);
+}
+
+/*
+ * delta_write
+ *        append n bytes to the new image
+ */
+static C_RES delta_write(ota_delta_t *d, const C_BYTE *buf, C_UINT32 n)
+{
+	if ((d->new_len + n > d->new_size) || (ESP_OK != esp_ota_write(d->upd, buf, n)))
+		return C_FAIL;
+
+	d->new_len += n;
+	return C_SUCCESS;
+}
+
+/*
+ * delta_next
+ *        state after the control of a block or after one of its sections,
+ *        the empty sections are skipped
+ */
+static C_RES delta_next(ota_delta_t *d)
+{
+	if (d->diff_len > 0)
+	{
+		d->state = DELTA_ST_DIFF;
+		return C_SUCCESS;
+	}
+	if (d->extra_len > 0)
+	{
+		d->state = DELTA_ST_EXTRA;
+		return C_SUCCESS;
+	}
+
+	// end of the block
+	if (((d->seek < 0) && ((C_UINT32)(-d->seek) > d->old_pos)) ||
+		((d->seek > 0) && (d->old_pos + (C_UINT32)d->seek > d->run_part->size)))
+		return C_FAIL;
+
+	d->old_pos += d->seek;
+	d->seek = 0;
+	d->hdr_len = 0;
+	d->state = (d->new_len == d->new_size) ? DELTA_ST_DONE : DELTA_ST_CTRL;
+	return C_SUCCESS;
+}
+
+/*
+ * delta_header
+ *        the patch must be made for the running image
+ */
+static C_RES delta_header(ota_delta_t *d)
+{
+	if (memcmp(d->hdr, OTA_DELTA_MAGIC, 4))
+		return C_FAIL;
+
+	d->new_size = delta_u32(&d->hdr[4]);
+	if ((d->new_size == 0) || (d->new_size > d->upd_part->size))
+		return C_FAIL;
+
+	if (memcmp(&d->hdr[8], d->run_sha, DELTA_SHA_LEN))
+	{
+		ESP_LOGW(TAG, "patch not made for the running image");
+		return C_FAIL;
+	}
+	memcpy(d->new_sha, &d->hdr[8 + DELTA_SHA_LEN], DELTA_SHA_LEN);
+	return C_SUCCESS;
+}
+
+/*
+ * delta_apply
+ *        apply n bytes of the inflated patch
+ */
+static C_RES delta_apply(ota_delta_t *d, const C_BYTE *p, C_UINT32 n)
+{
+	C_UINT32 k, i, need;
+
+	while (n > 0)
+	{
+		switch (d->state)
+		{
+			case DELTA_ST_HEADER:
+			case DELTA_ST_CTRL:
+				need = (d->state == DELTA_ST_HEADER) ? DELTA_HDR_LEN : DELTA_CTRL_LEN;
+				k = need - d->hdr_len;
+				if (k > n)
+					k = n;
+				memcpy(&d->hdr[d->hdr_len], p, k);
+				d->hdr_len += k;
+				if (d->hdr_len < need)
+					break;
+
+				if (d->state == DELTA_ST_HEADER)
+				{
+					if (C_SUCCESS != delta_header(d))
+						return C_FAIL;
+					d->hdr_len = 0;
+					d->state = DELTA_ST_CTRL;
+				}
+				else
+				{
+					d->diff_len = delta_u32(&d->hdr[0]);
+					d->extra_len = delta_u32(&d->hdr[4]);
+					d->seek = (C_INT32)delta_u32(&d->hdr[8]);
+					if ((d->diff_len == 0) && (d->extra_len == 0) && (d->seek == 0))
+						return C_FAIL;
+					if (C_SUCCESS != delta_next(d))
+						return C_FAIL;
+				}
+				break;
+
+			case DELTA_ST_DIFF:
+				k = (n < d->diff_len) ? n : d->diff_len;
+				if (k > sizeof(d->old))
+					k = sizeof(d->old);
+				if ((d->old_pos + k > d->run_part->size) ||
+					(ESP_OK != esp_partition_read(d->run_part, d->old_pos, d->old, k)))
+					return C_FAIL;
+
+				for (i = 0; i < k; i++)
+					d->old[i] += p[i];
+
+				if (C_SUCCESS != delta_write(d, d->old, k))
+					return C_FAIL;
+
+				d->old_pos += k;
+				d->diff_len -= k;
+				if ((d->diff_len == 0) && (C_SUCCESS != delta_next(d)))
+					return C_FAIL;
+				break;
+
+			case DELTA_ST_EXTRA:
+				k = (n < d->extra_len) ? n : d->extra_len;
+				if (C_SUCCESS != delta_write(d, p, k))
+					return C_FAIL;
+
+				d->extra_len -= k;
+				if ((d->extra_len == 0) && (C_SUCCESS != delta_next(d)))
+					return C_FAIL;
+				break;
+
+			default:
+				// data after the end of the new image
+				return C_FAIL;
+		}
+
+		p += k;
+		n -= k;
+	}
+	return C_SUCCESS;
+}
+
+/*
+ * delta_inflate
+ *        inflate n bytes of the patch, the output is applied as soon as
+ *        it comes out of the window
+ */
+static C_RES delta_inflate(ota_delta_t *d, const C_BYTE *in, C_UINT32 n)
+{
+	tinfl_status st;
+	size_t in_size, out_size;
+
+	do{
+		if (d->inflate_done)
+			return C_FAIL;
+
+		in_size = n;
+		out_size = TINFL_LZ_DICT_SIZE - d->dict_pos;
+		st = tinfl_decompress(&d->inf, in, &in_size, d->dict, &d->dict[d->dict_pos], &out_size,
+							  TINFL_FLAG_PARSE_ZLIB_HEADER | TINFL_FLAG_HAS_MORE_INPUT);
+		in += in_size;
+		n -= in_size;
+
+		if ((out_size > 0) && (C_SUCCESS != delta_apply(d, &d->dict[d->dict_pos], out_size)))
+			return C_FAIL;
+		d->dict_pos = (d->dict_pos + out_size) & (TINFL_LZ_DICT_SIZE - 1);
+
+		if (st < TINFL_STATUS_DONE)
+			return C_FAIL;
+		if (st == TINFL_STATUS_DONE)
+			d->inflate_done = 1;
+
+	}while ((n > 0) || (st == TINFL_STATUS_HAS_MORE_OUTPUT));
+
+	return C_SUCCESS;
+}
+
+/*
+ * delta_session
+ *        one connection to the server, from d->rx_len to the end of the
+ *        patch or to the first error. Only the errors of the connection
+ *        are worth a retry
+ */
+static C_RES delta_session(c_http_client_config_t *c_config, ota_delta_t *d)
+{
+	C_RES err = CONN_OK;
+	http_client_handle_t client;
+	C_CHAR range[24];
+	C_INT32 content_length, status, read_len;
+	C_UINT32 total, n;
+
+	client = http_client_init_IS(c_config, c_config->cert_num);
+	if (client == NULL)
+		return CONN_FAIL;
+
+	if (d->rx_len > 0)
+	{
+		sprintf(range, "bytes=%u-", (unsigned)d->rx_len);
+		http_client_set_header_IS(client, "Range", range);
+	}
+
+	if (http_client_open_IS(client, 0) != C_SUCCESS)
+	{
+		http_client_cleanup_IS(client);
+		P_COV_LN;
+		return CONN_FAIL;
+	}
+
+	content_length = http_client_fetch_headers_IS(client);
+	status = http_client_get_status_IS(client);
+
+	ESP_LOGI(TAG, "patch status = %d, content_length = %d, from %u", status, content_length, (unsigned)d->rx_len);
+
+	// no patch for this image, or the server can't resume a patch
+	// already half applied
+	if ((status != 200) && (status != 206))
+		err = WRONG_FILE;
+	else if ((d->rx_len > 0) && (status == 200))
+		err = WRONG_FILE;
+	else if (content_length <= 0)
+		err = CONN_FAIL;
+
+	total = d->rx_len + (C_UINT32)content_length;
+
+	while ((err == CONN_OK) && (d->rx_len < total))
+	{
+		n = total - d->rx_len;
+		if (n > sizeof(d->in))
+			n = sizeof(d->in);
+
+		read_len = http_client_read_IS(client, (C_CHAR*)d->in, n);
+		if (read_len <= 0)
+		{
+			err = CONN_FAIL;
+			P_COV_LN;
+			break;
+		}
+
+		d->rx_len += (C_UINT32)read_len;
+		if (C_SUCCESS != delta_inflate(d, d->in, (C_UINT32)read_len))
+			err = WRONG_FILE;
+	}
+
+	http_client_close_IS(client);
+	http_client_cleanup_IS(client);
+	return err;
+}
+#endif
+
+
+/**
+ * @brief OTA__DeltaUpdate
+ *        download the patch and rebuild the new image in the update
+ *        partition. The image is verified (image check of esp_ota_end,
+ *        sha-256 of the patch header and the expected one if given)
+ *        before it becomes the boot partition
+ *
+ * @param  c_http_client_config_t *c_config  connection to the patch
+ * @param  const C_CHAR *sha  sha-256 in hex of the new image, "" not checked
+ * @return C_SUCCESS the new image boots at the next restart
+ */
+C_RES OTA__DeltaUpdate(c_http_client_config_t *c_config, const C_CHAR *sha)
+{
+	C_RES ret = C_FAIL;
+#ifdef INCLUDE_PLATFORM_DEPENDENT
+	C_RES err = CONN_FAIL;
+	C_BYTE digest[DELTA_SHA_LEN];
+	C_BYTE retry;
+	ota_delta_t *d;
+
+	d = malloc(sizeof(ota_delta_t));
+	if (d == NULL)
+	{
+		ESP_LOGE(TAG, "no memory for the delta update");
+		return C_FAIL;
+	}
+
+	memset((void*)d, 0, sizeof(ota_delta_t));
+	tinfl_init(&d->inf);
+	d->state = DELTA_ST_HEADER;
+	d->run_part = esp_ota_get_running_partition();
+	d->upd_part = esp_ota_get_next_update_partition(NULL);
+
+	if ((d->run_part == NULL) || (d->upd_part == NULL) ||
+		(ESP_OK != esp_partition_get_sha256(d->run_part, d->run_sha)) ||
+		(ESP_OK != esp_ota_begin(d->upd_part, OTA_SIZE_UNKNOWN, &d->upd)))
+	{
+		free(d);
+		P_COV_LN;
+		return C_FAIL;
+	}
+
+	for (retry = 0; retry <= OTA_DELTA_MAX_RETRY; retry++)
+	{
+		if (retry > 0)
+			Sys__Delay(OTA_DELTA_RETRY_DELAY_MS);
+
+		err = delta_session(c_config, d);
+		if (err != CONN_FAIL)
+			break;
+	}
+
+	if ((err == CONN_OK) && (!d->inflate_done || (d->state != DELTA_ST_DONE)))
+		err = WRONG_FILE;
+
+	// esp_ota_end also frees the handle, it is called anyway
+	if ((ESP_OK != esp_ota_end(d->upd)) && (err == CONN_OK))
+		err = WRONG_FILE;
+
+	if ((err == CONN_OK) &&
+		((ESP_OK != esp_partition_get_sha256(d->upd_part, digest)) ||
+		 memcmp(digest, d->new_sha, sizeof(digest)) ||
+		 ((sha[0] != 0) && (C_SUCCESS != Sha256__MatchHex(digest, sha)))))
+	{
+		ESP_LOGE(TAG, "new image sha-256 mismatch");
+		err = WRONG_CRC;
+	}
+
+	if ((err == CONN_OK) && (ESP_OK == esp_ota_set_boot_partition(d->upd_part)))
+		ret = C_SUCCESS;
+
+	ESP_LOGI(TAG, "delta update patch %u image %u/%u err %d",
+			 (unsigned)d->rx_len, (unsigned)d->new_len, (unsigned)d->new_size, err);
+
+	free(d);
+	P_COV_LN;
+#endif
+	return ret;
+}
@@ -0,0 +1,60 @@
+/**
+ * @file   ota_delta_IS.h
+ * @author carel
+ * @date   18 Oct 2026
+ * @brief  delta update of the GME firmware: the server gives a patch
+ *         against the running image, the new image is rebuilt from the
+ *         running partition into the update partition while the patch
+ *         is downloaded. On any error the caller falls back to the full
+ *         image
+ *
+ *         The patch is a zlib stream (RFC 1950) of
+ *           header  "GDP1", u32 size of the new image,
+ *                   sha-256 of the running image, sha-256 of the new image
+ *                   (the digests of esp_partition_get_sha256 for the app
+ *                   partitions, i.e. the ones appended to the .bin)
+ *           blocks  u32 diff len, u32 extra len, s32 seek,
+ *                   diff len bytes added to the running image,
+ *                   extra len bytes copied as they are,
+ *                   after a block the position in the running image moves
+ *                   of diff len + seek
+ *         the integers are little endian. The blocks are the control,
+ *         diff and extra of bsdiff interleaved in a single stream, so
+ *         the patch is applied in one pass
+ */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __OTA_DELTA_IS
+#define __OTA_DELTA_IS
+
+
+/* ========================================================================== */
+/* include                                                                    */
+/* ========================================================================== */
+#include "CAREL_GLOBAL_DEF.h"
+#include "data_types_CAREL.h"
+#include "https_client_IS.h"
+
+/* ========================================================================== */
+/* typedefs and defines                                                       */
+/* ========================================================================== */
+
+#define OTA_DELTA_MAGIC				"GDP1"
+
+/* the patch is read from the connection in pieces of this size */
+#define OTA_DELTA_CHUNK_SIZE		512
+
+/* bytes of the running image read at once for the diff */
+#define OTA_DELTA_OLD_SIZE			256
+
+/* a broken transfer is resumed with a Range request up to this times */
+#define OTA_DELTA_MAX_RETRY			3
+#define OTA_DELTA_RETRY_DELAY_MS	2000
+
+/* ========================================================================== */
+/* Functions prototypes                                                       */
+/* ========================================================================== */
+
+C_RES OTA__DeltaUpdate(c_http_client_config_t *c_config, const C_CHAR *sha);
+
+#endif  //__OTA_DELTA_IS
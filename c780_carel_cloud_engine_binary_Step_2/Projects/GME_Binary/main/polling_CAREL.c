@@ -25,12 +25,14 @@
 
 #include "RTC_IS.h"
 #include "modbus_IS.h"
+#include "modbus_aux_IS.h"
 
 #include "polling_IS.h"
 #include "polling_CAREL.h"
 #include "nvm_CAREL.h"
 #include "sys_IS.h"
 #include "utilities_CAREL.h"
+#include "gme_config.h"
 
 #include "Led_Manager_IS.h"
 #include "mobile.h"
@@ -46,6 +48,9 @@
 
 #define REDUCE_SPEED_ALARM 				(5)  // seconds
 
+#define POLL_MS_TO_US(ms)				((uint64_t)(ms) * 1000)
+#define POLL_SEC_TO_US(sec)				((uint64_t)(sec) * 1000000)
+
 #define FILTER_OFFLINE                  (1)
 
 static const char *TAG = "POLLING_CAREL";
@@ -58,12 +63,17 @@ static poll_engine_flags_t PollEngine_Status = {
 
 static uint8_t DeviceParamCount[MAX_POLLING][MAX_REG] = {0};
 
-static coil_di_poll_tables_t 	COILLowPollTab = {.reg = NULL,};
-static coil_di_poll_tables_t 	COILHighPollTab = {.reg = NULL,};
+// all the polling tables are carved from a single allocation
+static uint8_t					*PollArena = NULL;
+// odd while PollEngine__CreateTables rebuilds the tables, see PollEngine__ReadCache
+static volatile C_UINT16		PollTablesGen = 0;
+
+static coil_di_poll_tables_t 	COILLowPollTab;
+static coil_di_poll_tables_t 	COILHighPollTab;
 static coil_di_alarm_tables_t 	*COILAlarmPollTab = NULL;
 
-static coil_di_poll_tables_t 	DILowPollTab = {.reg = NULL,};
-static coil_di_poll_tables_t 	DIHighPollTab = {.reg = NULL,};
+static coil_di_poll_tables_t 	DILowPollTab;
+static coil_di_poll_tables_t 	DIHighPollTab;
 static coil_di_alarm_tables_t 	*DIAlarmPollTab = NULL;
 
 static poll_req_num_t low_n, high_n, alarm_n;
@@ -78,6 +88,17 @@ static hr_ir_poll_tables_t 		IRLowPollTab;
 static hr_ir_poll_tables_t 		IRHighPollTab;
 static hr_ir_alarm_tables_t		*IRAlarmPollTab;
 
+// alarms grouped in blocks, their state packed in bits (see alarm_blocks_build)
+#define ALARM_WORDS(n)			(((n) + 31) / 32)
+static alarm_block_t			*AlarmBlocks = NULL;
+static uint16_t					alarm_block_n = 0;
+static uint16_t					*AlarmOrder = NULL;		// (type << 8) | index in the table
+static uint32_t					*AlarmCur = NULL;
+static uint32_t					*AlarmPrev = NULL;
+// data of the answer to the read of a block
+static C_BYTE alarm_rx[2 + ((ALARM_BLOCK_MAX_BITS / 8) > (2 * ALARM_BLOCK_MAX_REGS) ?
+                            (ALARM_BLOCK_MAX_BITS / 8) : (2 * ALARM_BLOCK_MAX_REGS))];
+
 static sampling_tstamp_t timestamp = {0};
 
 // Values and time buffers
@@ -94,6 +115,13 @@ static values_buffer_t *values_buffer = NULL;
 
 static uint32_t MB_BaudRate = 0;
 
+// edge aggregation, window (s) and policy from SET_GW_CONFIG
+static uint32_t agg_window_s = 0;
+static uint8_t agg_policy = POLL_AGG_LAST;
+// min/max/mean of the aggregate records in the values buffer
+static values_agg_t values_agg[POLL_AGG_OUT_LEN];
+static uint16_t values_agg_count = 0;
+
 // useful for a MODBUS READING AND QWRITING
 
 USHORT param_buffer[2];				// max 32 bits
@@ -106,17 +134,28 @@ static uint8_t first_low = 1;
 // this helps us in deciding whether we should send an empty values payload
 static C_BYTE something_sent = 0;
 
+// ms from boot to the first successful polling, 0 until then
+static C_UINT32 first_sample_ms = 0;
+static poll_stats_t PollStats = {0};
+
 static C_INT32 modbus_error = 0;
+
+// tunnel session (passing mode), the fsm is run by the polling task
+static volatile passing_mode_fsm_t pass_mode_fsm = DEACTIVATE_PASS_MODE;
+static uint8_t pass_mode_resume = 0;		// engine was RUNNING at the start of the session
+static uint64_t pass_mode_hold_us = 0;
+static uint64_t pass_mode_deadline = 0;
+
 /*Static Function*/
 
 static void check_increment_values_buff_len(uint16_t *values_buffer_idx);
 static void check_hr_ir_read_val(hr_ir_poll_tables_t *arr, uint8_t arr_len, uint8_t first);
 static void check_coil_di_read_val(coil_di_poll_tables_t *arr, uint8_t arr_len, uint8_t first);
 static void compare_prev_curr_reads(PollType_t poll_type, uint8_t first);
-static void save_coil_di_value(coil_di_low_high_t *arr, void* instance_ptr);
-static void save_hr_ir_value(hr_ir_low_high_poll_t *arr, void* instance_ptr);
-static void save_alarm_coil_di_value(coil_di_alarm_tables_t *alarm,  void* instance_ptr);
-static void save_alarm_hr_ir_value(hr_ir_alarm_tables_t *alarm, void* instance_ptr);
+static void save_coil_di_value(uint8_t *c_value, void* instance_ptr);
+static void save_hr_ir_value(const r_hr_ir *info, hr_ir_low_high_value_t *c_value, void* instance_ptr);
+static void alarm_blocks_build(void);
+static void PollEngine__PassModeFsm(void);
 
 /**
  * @brief SetAllErrors
@@ -131,197 +170,285 @@ static void SetAllErrors(eMBMasterReqErrCode error){
 
 	//Coil
 	for(i=0;i<low_n.coil;i++)
-		COILLowPollTab.reg[i].error = error;
+		COILLowPollTab.error[i] = error;
 	//DI
 	for(i=0;i<low_n.di;i++)
-		DILowPollTab.reg[i].error = error;
+		DILowPollTab.error[i] = error;
 	//HR
 	for(i=0;i<low_n.hr;i++)
-		HRLowPollTab.tab[i].error = error;
+		HRLowPollTab.error[i] = error;
 	//IR
 	for(i=0;i<low_n.ir;i++)
-		IRLowPollTab.tab[i].error = error;
+		IRLowPollTab.error[i] = error;
 	//Coil
 	for(i=0;i<high_n.coil;i++)
-		COILHighPollTab.reg[i].error = error;
+		COILHighPollTab.error[i] = error;
 	//DI
 	for(i=0;i<high_n.di;i++)
-		DIHighPollTab.reg[i].error = error;
+		DIHighPollTab.error[i] = error;
 	//HR
 	for(i=0;i<high_n.hr;i++)
-		HRHighPollTab.tab[i].error = error;
+		HRHighPollTab.error[i] = error;
 	//IR
 	for(i=0;i<high_n.ir;i++)
-		IRHighPollTab.tab[i].error = error;
+		IRHighPollTab.error[i] = error;
 }
 
+/*
+ * POLL_ARENA_TAKE
+ *        reserve n elements of a table array at the offset off of the arena,
+ *        with base == NULL only the size is computed
+ */
+#define POLL_ARENA_ALIGN(x)		(((x) + 3) & ~((size_t)3))
+#define POLL_ARENA_TAKE(base, off, ptr, n, type)	do { \
+		(ptr) = ((base) != NULL && (n) != 0) ? (type*)((base) + (off)) : NULL; \
+		(off) += POLL_ARENA_ALIGN((size_t)(n) * sizeof(type)); \
+	} while(0)
+
 /**
- * @brief create_tables
- *        this function creates the Coil, Di, Hr and Ir buffers
- *        starting from the file system table
+ * @brief poll_tables_layout
+ *        place all the polling tables in the arena: first the hot arrays
+ *        (current/previous values and errors) of every table, then the
+ *        model records and the alarm tables
  *
- * @param  none
- * @return none
+ * @param  uint8_t *base  the arena, NULL to compute only the size
+ * @return size_t the size of the arena
  */
-void PollEngine__CreateTables(void){
+static size_t poll_tables_layout(uint8_t *base)
+{
+	size_t off = 0;
+	uint8_t i, n;
+	uint16_t n_alarm;
+
+	hr_ir_poll_tables_t   *hr_ir[4]   = {&HRLowPollTab, &HRHighPollTab, &IRLowPollTab, &IRHighPollTab};
+	coil_di_poll_tables_t *coil_di[4] = {&COILLowPollTab, &COILHighPollTab, &DILowPollTab, &DIHighPollTab};
+	const uint8_t hr_ir_n[4]   = {DeviceParamCount[LOW_POLLING][HR],   DeviceParamCount[HIGH_POLLING][HR],
+	                              DeviceParamCount[LOW_POLLING][IR],   DeviceParamCount[HIGH_POLLING][IR]};
+	const uint8_t coil_di_n[4] = {DeviceParamCount[LOW_POLLING][COIL], DeviceParamCount[HIGH_POLLING][COIL],
+	                              DeviceParamCount[LOW_POLLING][DI],   DeviceParamCount[HIGH_POLLING][DI]};
+
+	// hot
+	for (i = 0; i < 4; i++) {
+		n = hr_ir_n[i];
+		POLL_ARENA_TAKE(base, off, hr_ir[i]->c_value, n, hr_ir_low_high_value_t);
+		POLL_ARENA_TAKE(base, off, hr_ir[i]->p_value, n, hr_ir_low_high_value_t);
+		POLL_ARENA_TAKE(base, off, hr_ir[i]->error,   n, uint8_t);
+		POLL_ARENA_TAKE(base, off, hr_ir[i]->p_error, n, uint8_t);
+		POLL_ARENA_TAKE(base, off, hr_ir[i]->agg, (0 != agg_window_s) ? n : 0, poll_agg_t);
+	}
+	for (i = 0; i < 4; i++) {
+		n = coil_di_n[i];
+		POLL_ARENA_TAKE(base, off, coil_di[i]->c_value, n, uint8_t);
+		POLL_ARENA_TAKE(base, off, coil_di[i]->p_value, n, uint8_t);
+		POLL_ARENA_TAKE(base, off, coil_di[i]->error,   n, uint8_t);
+		POLL_ARENA_TAKE(base, off, coil_di[i]->p_error, n, uint8_t);
+	}
 
-	BinaryModel__GetNum(DeviceParamCount);
+	// cold
+	for (i = 0; i < 4; i++) {
+		POLL_ARENA_TAKE(base, off, hr_ir[i]->info,      hr_ir_n[i], r_hr_ir);
+		POLL_ARENA_TAKE(base, off, hr_ir[i]->read_type, hr_ir_n[i], uint8_t);
+	}
+	for (i = 0; i < 4; i++)
+		POLL_ARENA_TAKE(base, off, coil_di[i]->info, coil_di_n[i], r_coil_di);
+
+	POLL_ARENA_TAKE(base, off, COILAlarmPollTab, DeviceParamCount[ALARM_POLLING][COIL], coil_di_alarm_tables_t);
+	POLL_ARENA_TAKE(base, off, DIAlarmPollTab,   DeviceParamCount[ALARM_POLLING][DI],   coil_di_alarm_tables_t);
+	POLL_ARENA_TAKE(base, off, HRAlarmPollTab,   DeviceParamCount[ALARM_POLLING][HR],   hr_ir_alarm_tables_t);
+	POLL_ARENA_TAKE(base, off, IRAlarmPollTab,   DeviceParamCount[ALARM_POLLING][IR],   hr_ir_alarm_tables_t);
+
+	n_alarm = DeviceParamCount[ALARM_POLLING][COIL] + DeviceParamCount[ALARM_POLLING][DI] +
+	          DeviceParamCount[ALARM_POLLING][HR]   + DeviceParamCount[ALARM_POLLING][IR];
+	POLL_ARENA_TAKE(base, off, AlarmCur,    ALARM_WORDS(n_alarm), uint32_t);
+	POLL_ARENA_TAKE(base, off, AlarmPrev,   ALARM_WORDS(n_alarm), uint32_t);
+	POLL_ARENA_TAKE(base, off, AlarmOrder,  n_alarm, uint16_t);
+	POLL_ARENA_TAKE(base, off, AlarmBlocks, n_alarm, alarm_block_t);
+
+	return off;
+}
 
-	//Coil
-	uint8_t temp=0;
+/**
+ * @brief load_coil_di_table
+ *        copy the model records of a Coil/DI low or high polling table
+ *
+ * @param  coil_di_poll_tables_t *tab
+ * @param  PollType_t poll_type
+ * @param  RegType_t reg_type
+ * @return none
+ */
+static void load_coil_di_table(coil_di_poll_tables_t *tab, PollType_t poll_type, RegType_t reg_type)
+{
+	uint8_t n = DeviceParamCount[poll_type][reg_type];
 
-	temp = DeviceParamCount[LOW_POLLING][COIL];
-	if(0 != temp){
-		COILLowPollTab.reg = malloc(temp * sizeof(coil_di_low_high_t));
-		memset((void*)&COILLowPollTab.reg[0] , 0, temp*sizeof(coil_di_low_high_t));
-		uint8_t  *p_coil_low_sect = BinaryModel__GetPtrSec(LOW_POLLING, COIL);
-		for(int i=0;i<temp;i++){
-			COILLowPollTab.reg[i].info =  *((r_coil_di*)(p_coil_low_sect + (i * sizeof(r_coil_di))));
-		}
+	if(0 != n){
+		memcpy((void*)tab->info, BinaryModel__GetPtrSec(poll_type, reg_type), n * sizeof(r_coil_di));
 		P_COV_LN;
 	}
+}
 
+/**
+ * @brief load_hr_ir_table
+ *        copy the model records of a HR/IR low or high polling table
+ *        and solve the read type of every register
+ *
+ * @param  hr_ir_poll_tables_t *tab
+ * @param  PollType_t poll_type
+ * @param  RegType_t reg_type
+ * @return none
+ */
+static void load_hr_ir_table(hr_ir_poll_tables_t *tab, PollType_t poll_type, RegType_t reg_type)
+{
+	uint8_t n = DeviceParamCount[poll_type][reg_type];
 
-	temp = DeviceParamCount[HIGH_POLLING][COIL];
-	if(0 != temp){
-		COILHighPollTab.reg = malloc(temp * sizeof(coil_di_low_high_t));
-		memset((void*)&COILHighPollTab.reg[0] , 0, temp*sizeof(coil_di_low_high_t));
-		uint8_t  *p_coil_high_sect = BinaryModel__GetPtrSec(HIGH_POLLING, COIL);
-		for(int i=0;i<temp;i++){
-			COILHighPollTab.reg[i].info =  *((r_coil_di*)(p_coil_high_sect + (i * sizeof(r_coil_di))));
+	if(0 != n){
+		memcpy((void*)tab->info, BinaryModel__GetPtrSec(poll_type, reg_type), n * sizeof(r_hr_ir));
+		for(int i=0;i<n;i++){
+			tab->read_type[i] = check_hr_ir_reg_type(tab->info[i]);
 		}
 		P_COV_LN;
 	}
 
-
-	temp = DeviceParamCount[ALARM_POLLING][COIL];
-	if(0 != temp){
-		COILAlarmPollTab = malloc(temp * sizeof(coil_di_alarm_tables_t));
-		memset((void*)&COILAlarmPollTab[0] , 0, temp*sizeof(coil_di_alarm_tables_t));
-		uint8_t  *p_coil_alarm_sect = BinaryModel__GetPtrSec(ALARM_POLLING, COIL);
-		for(int i=0;i<temp;i++){
-			COILAlarmPollTab[i].info =  *((r_coil_di_alarm*)(p_coil_alarm_sect + (i * sizeof(r_coil_di_alarm))));
+	tab->agg_end_us = 0;
+	if(NULL != tab->agg){
+		// the bits (TYPE_D) are not aggregated, they are not noisy
+		for(int i=0;i<n;i++){
+			tab->agg[i].on = (tab->read_type[i] != TYPE_D) &&
+							 (tab->info[i].flag.bit.aggregate ||
+							  ((agg_policy & POLL_AGG_ALL_HIGH) && (poll_type == HIGH_POLLING)));
 		}
 		P_COV_LN;
 	}
+}
 
-	//Descrete Input
+/**
+ * @brief poll_agg_read_cfg
+ *        read the aggregation window and policy, they must be known
+ *        before the layout of the tables
+ *
+ * @param  none
+ * @return none
+ */
+static void poll_agg_read_cfg(void)
+{
+	C_UINT32 window;
+	C_BYTE policy;
 
-	temp = DeviceParamCount[LOW_POLLING][DI];
-	if(0 != temp){
-		DILowPollTab.reg = malloc(temp * sizeof(coil_di_low_high_t));
-		memset((void*)&DILowPollTab.reg[0] , 0, temp*sizeof(coil_di_low_high_t));
-		uint8_t  *p_di_low_sect = BinaryModel__GetPtrSec(LOW_POLLING, DI);
-		for(int i=0;i<temp;i++){
-			DILowPollTab.reg[i].info =  *((r_coil_di*)(p_di_low_sect + (i * sizeof(r_coil_di))));
-		}
-		P_COV_LN;
-	}
+	if(C_SUCCESS != NVM__ReadU32Value(AGG_WINDOW_NVM, &window))
+		window = 0;
+	if(C_SUCCESS != NVM__ReadU8Value(AGG_POLICY_NVM, &policy))
+		policy = POLL_AGG_LAST;
 
+	agg_window_s = window;
+	agg_policy = policy;
 
-	temp = DeviceParamCount[HIGH_POLLING][DI];
-	if(0 != temp){
-		DIHighPollTab.reg = malloc(temp * sizeof(coil_di_low_high_t));
-		memset((void*)&DIHighPollTab.reg[0] , 0, temp*sizeof(coil_di_low_high_t));
-		uint8_t  *p_di_high_sect = BinaryModel__GetPtrSec(HIGH_POLLING, DI);
-		for(int i=0;i<temp;i++){
-			DIHighPollTab.reg[i].info =  *((r_coil_di*)(p_di_high_sect + (i * sizeof(r_coil_di))));
-		}
-		P_COV_LN;
-	}
+    #ifdef __DEBUG_POLLING_CAREL_LEV_1
+	PRINTF_DEBUG("aggregation window %d s, policy %02X\n", agg_window_s, agg_policy);
+    #endif
+}
 
+/**
+ * @brief create_tables
+ *        this function creates the Coil, Di, Hr and Ir buffers
+ *        starting from the file system table, all of them in a
+ *        single allocation (see poll_tables_layout)
+ *
+ * @param  none
+ * @return none
+ */
+void PollEngine__CreateTables(void){
 
-	temp = DeviceParamCount[ALARM_POLLING][DI];
-	if(0 != temp){
-		DIAlarmPollTab = malloc(temp * sizeof(coil_di_alarm_tables_t));
-		memset((void*)&DIAlarmPollTab[0] , 0, temp*sizeof(coil_di_alarm_tables_t));
-		uint8_t  *p_di_alarm_sect = BinaryModel__GetPtrSec(ALARM_POLLING, DI);
-		for(int i=0;i<temp;i++){
-			DIAlarmPollTab[i].info =  *((r_coil_di_alarm*)(p_di_alarm_sect + (i * sizeof(r_coil_di_alarm))));
-		}
-		P_COV_LN;
-	}
+	size_t arena_size;
+	uint8_t temp=0;
 
-	//Holding Register
+	PollTablesGen++;
 
-	temp = DeviceParamCount[LOW_POLLING][HR];
-	if(0 != temp){
-		HRLowPollTab.tab = malloc(temp * sizeof(hr_ir_low_high_poll_t));
-		memset((void*)&HRLowPollTab.tab[0] , 0, temp*sizeof(hr_ir_low_high_poll_t));
-		uint8_t  *p_hr_low_sect = BinaryModel__GetPtrSec(LOW_POLLING, HR);
-		for(int i=0;i<temp;i++){
-			HRLowPollTab.tab[i].info =  *((r_hr_ir*)(p_hr_low_sect + (i * sizeof(r_hr_ir))));
-			HRLowPollTab.tab[i].read_type = check_hr_ir_reg_type(HRLowPollTab.tab[i].info);
+	BinaryModel__GetNum(DeviceParamCount);
+	poll_agg_read_cfg();
+
+	free(PollArena);
+	PollArena = NULL;
+
+	arena_size = poll_tables_layout(NULL);
+	if(0 != arena_size){
+		PollArena = malloc(arena_size);
+		if(NULL == PollArena){
+			// no table, nothing will be polled
+			PRINTF_DEBUG("poll tables, no memory for %d bytes\n", (int)arena_size);
+			memset((void*)DeviceParamCount, 0, sizeof(DeviceParamCount));
+			arena_size = 0;
+			P_COV_LN;
 		}
-		P_COV_LN;
+		else
+			memset((void*)PollArena, 0, arena_size);
 	}
+	poll_tables_layout(PollArena);
 
+	PollStats.arena = arena_size;
+	if (arena_size > PollStats.arena_hwm)
+		PollStats.arena_hwm = arena_size;
 
-	temp = DeviceParamCount[HIGH_POLLING][HR];
-	if(0 != temp){
-		HRHighPollTab.tab = malloc(temp * sizeof(hr_ir_low_high_poll_t));
-		memset((void*)&HRHighPollTab.tab[0] , 0, temp*sizeof(hr_ir_low_high_poll_t));
-		uint8_t  *p_hr_high_sect = BinaryModel__GetPtrSec(HIGH_POLLING, HR);
-		for(int i=0;i<temp;i++){
-			HRHighPollTab.tab[i].info =  *((r_hr_ir*)(p_hr_high_sect + (i * sizeof(r_hr_ir))));
-			HRHighPollTab.tab[i].read_type = check_hr_ir_reg_type(HRHighPollTab.tab[i].info);
-		}
-		P_COV_LN;
-	}
+    #ifdef __DEBUG_POLLING_CAREL_LEV_1
+	PRINTF_DEBUG("poll tables arena %d bytes\n", (int)arena_size);
+    #endif
 
+	//Coil
+	load_coil_di_table(&COILLowPollTab, LOW_POLLING, COIL);
+	load_coil_di_table(&COILHighPollTab, HIGH_POLLING, COIL);
 
-	temp = DeviceParamCount[ALARM_POLLING][HR];
+	temp = DeviceParamCount[ALARM_POLLING][COIL];
 	if(0 != temp){
-		HRAlarmPollTab = malloc(temp * sizeof(hr_ir_alarm_tables_t));
-		memset((void*)&HRAlarmPollTab[0] , 0, temp*sizeof(hr_ir_alarm_tables_t));
-		uint8_t  *p_hr_alarm_sect = BinaryModel__GetPtrSec(ALARM_POLLING, HR);
+		uint8_t  *p_coil_alarm_sect = BinaryModel__GetPtrSec(ALARM_POLLING, COIL);
 		for(int i=0;i<temp;i++){
-			HRAlarmPollTab[i].info =  *((r_hr_ir_alarm*)(p_hr_alarm_sect + (i * sizeof(r_hr_ir_alarm))));
+			COILAlarmPollTab[i].info =  *((r_coil_di_alarm*)(p_coil_alarm_sect + (i * sizeof(r_coil_di_alarm))));
 		}
 		P_COV_LN;
 	}
 
-	//Input Register
-
+	//Descrete Input
+	load_coil_di_table(&DILowPollTab, LOW_POLLING, DI);
+	load_coil_di_table(&DIHighPollTab, HIGH_POLLING, DI);
 
-	temp = DeviceParamCount[LOW_POLLING][IR];
+	temp = DeviceParamCount[ALARM_POLLING][DI];
 	if(0 != temp){
-		IRLowPollTab.tab = malloc(temp * sizeof(hr_ir_low_high_poll_t));
-		memset((void*)&IRLowPollTab.tab[0] , 0, temp*sizeof(hr_ir_low_high_poll_t));
-		uint8_t  *p_ir_low_sect = BinaryModel__GetPtrSec(LOW_POLLING, IR);
+		uint8_t  *p_di_alarm_sect = BinaryModel__GetPtrSec(ALARM_POLLING, DI);
 		for(int i=0;i<temp;i++){
-			IRLowPollTab.tab[i].info =  *((r_hr_ir*)(p_ir_low_sect + (i * sizeof(r_hr_ir))));
-			IRLowPollTab.tab[i].read_type = check_hr_ir_reg_type(IRLowPollTab.tab[i].info);
+			DIAlarmPollTab[i].info =  *((r_coil_di_alarm*)(p_di_alarm_sect + (i * sizeof(r_coil_di_alarm))));
 		}
 		P_COV_LN;
 	}
 
+	//Holding Register
+	load_hr_ir_table(&HRLowPollTab, LOW_POLLING, HR);
+	load_hr_ir_table(&HRHighPollTab, HIGH_POLLING, HR);
 
-	temp = DeviceParamCount[HIGH_POLLING][IR];
+	temp = DeviceParamCount[ALARM_POLLING][HR];
 	if(0 != temp){
-		IRHighPollTab.tab = malloc(temp * sizeof(hr_ir_low_high_poll_t));
-		memset((void*)&IRHighPollTab.tab[0] , 0, temp*sizeof(hr_ir_low_high_poll_t));
-		uint8_t  *p_ir_high_sect = BinaryModel__GetPtrSec(HIGH_POLLING, IR);
+		uint8_t  *p_hr_alarm_sect = BinaryModel__GetPtrSec(ALARM_POLLING, HR);
 		for(int i=0;i<temp;i++){
-			IRHighPollTab.tab[i].info =  *((r_hr_ir*)(p_ir_high_sect + (i * sizeof(r_hr_ir))));
-			IRHighPollTab.tab[i].read_type = check_hr_ir_reg_type(IRHighPollTab.tab[i].info);
+			HRAlarmPollTab[i].info =  *((r_hr_ir_alarm*)(p_hr_alarm_sect + (i * sizeof(r_hr_ir_alarm))));
 		}
 		P_COV_LN;
 	}
 
+	//Input Register
+	load_hr_ir_table(&IRLowPollTab, LOW_POLLING, IR);
+	load_hr_ir_table(&IRHighPollTab, HIGH_POLLING, IR);
 
 	temp = DeviceParamCount[ALARM_POLLING][IR];
 	if(0 != temp){
-		IRAlarmPollTab = malloc(temp * sizeof(hr_ir_alarm_tables_t));
-		memset((void*)&IRAlarmPollTab[0] , 0, temp*sizeof(hr_ir_alarm_tables_t));
 		uint8_t  *p_ir_alarm_sect = BinaryModel__GetPtrSec(ALARM_POLLING, IR);
 		for(int i=0;i<temp;i++){
 			IRAlarmPollTab[i].info =  *((r_hr_ir_alarm*)(p_ir_alarm_sect + (i * sizeof(r_hr_ir_alarm))));
 		}
 		P_COV_LN;
 	}
-	SetAllErrors(MB_MRE_TIMEDOUT);
+	alarm_blocks_build();
+
+	// the counts of the new model first, SetAllErrors walks the tables with them
 	create_modbus_tables();
+	SetAllErrors(MB_MRE_TIMEDOUT);
+
+	PollTablesGen++;
 }
 
 /**
@@ -380,6 +507,53 @@ void create_values_buffers(void){
 }
 
 
+/*
+ * conv_type_x
+ *		  convert a raw register value according to its model record,
+ *		  used directly on the polling table arrays
+ */
+static inline float conv_type_a(const r_hr_ir *info, hr_ir_low_high_value_t raw){
+	float temp = *((float*)(&raw.value));
+	return (temp * info->linA) + info->linB;
+}
+
+static inline float conv_type_b(const r_hr_ir *info, hr_ir_low_high_value_t raw){
+	float temp = *((int16_t*)(&raw.value));
+	return (float)((temp * info->linA) + info->linB);
+}
+
+static inline int32_t conv_type_c_signed(const r_hr_ir *info, hr_ir_low_high_value_t raw){
+	int32_t temp = *((int32_t*)(&raw.value));
+	return (temp * info->linA) + info->linB;
+}
+
+static inline uint32_t conv_type_c_unsigned(const r_hr_ir *info, hr_ir_low_high_value_t raw){
+	uint32_t temp = *((uint32_t*)(&raw.value));
+	return (temp * info->linA) + info->linB;
+}
+
+static inline uint8_t conv_type_d(const r_hr_ir *info, hr_ir_low_high_value_t raw){
+	uint16_t temp = *((uint16_t*)(&raw.value));
+	return (uint8_t)((temp & ((uint16_t) (1 << info->bitposition))) >> (info->bitposition));
+}
+
+static inline int16_t conv_type_e(const r_hr_ir *info, hr_ir_low_high_value_t raw){
+	uint16_t temp = *((uint16_t*)(&raw.value));
+	return (int16_t)((uint16_t)((temp & ((0x000F) << (info->bitposition))) >> (info->bitposition)));
+}
+
+static inline int16_t conv_type_f_signed(const r_hr_ir *info, hr_ir_low_high_value_t raw){
+	int16_t temp = *((int16_t*)(&raw.value));
+	return (temp * info->linA) + info->linB;
+}
+
+static inline uint16_t conv_type_f_unsigned(const r_hr_ir *info, hr_ir_low_high_value_t raw){
+	uint16_t temp = *((uint16_t*)(&raw.value));
+	return (temp * info->linA) + info->linB;
+}
+
+#define GET_RAW(arr, read_kind)		((read_kind) == CURRENT ? (arr)->c_value : (arr)->p_value)
+
 /**
  * @brief get_type_a
  *		  return a data of type A
@@ -389,11 +563,7 @@ void create_values_buffers(void){
  * @return none
  */
 float get_type_a(hr_ir_low_high_poll_t *arr, uint8_t read_kind){
-
-	float temp, read= 0.0;
-	read_kind == CURRENT ? (temp = *((float*)(&arr->c_value.value))) : (temp = *((float*)(&arr->p_value.value)));
-	read = (temp * arr->info.linA) + arr->info.linB;
-	return read;
+	return conv_type_a(&arr->info, GET_RAW(arr, read_kind));
 }
 
 
@@ -406,11 +576,7 @@ float get_type_a(hr_ir_low_high_poll_t *arr, uint8_t read_kind){
  * @return none
  */
 float get_type_b(hr_ir_low_high_poll_t *arr, uint8_t read_kind){
-
-	float temp, read= 0.0;
-	read_kind == CURRENT ? (temp = *((int16_t*)(&arr->c_value.value))) : (temp = *((int16_t*)(&arr->p_value.value)));  //(float*)
-	read = (temp * arr->info.linA) + arr->info.linB;
-	return (float)read;
+	return conv_type_b(&arr->info, GET_RAW(arr, read_kind));
 }
 
 /**
@@ -422,10 +588,7 @@ float get_type_b(hr_ir_low_high_poll_t *arr, uint8_t read_kind){
  * @return none
  */
 int32_t get_type_c_signed(hr_ir_low_high_poll_t *arr, uint8_t read_kind){
-	int32_t temp, read= 0;
-	read_kind == CURRENT ? (temp = *((int32_t*)(&arr->c_value.value))) : (temp = *((int32_t*)(&arr->p_value.value)));
-	read = (temp * arr->info.linA) + arr->info.linB;
-	return read;
+	return conv_type_c_signed(&arr->info, GET_RAW(arr, read_kind));
 }
 
 
@@ -438,10 +601,7 @@ int32_t get_type_c_signed(hr_ir_low_high_poll_t *arr, uint8_t read_kind){
  * @return none
  */
 uint32_t get_type_c_unsigned(hr_ir_low_high_poll_t *arr, uint8_t read_kind){
-	uint32_t temp, read= 0;
-	read_kind == CURRENT ? (temp = *((uint32_t*)(&arr->c_value.value))) : (temp = *((uint32_t*)(&arr->p_value.value)));
-	read = (temp * arr->info.linA) + arr->info.linB;
-	return read;
+	return conv_type_c_unsigned(&arr->info, GET_RAW(arr, read_kind));
 }
 
 /**
@@ -453,12 +613,7 @@ uint32_t get_type_c_unsigned(hr_ir_low_high_poll_t *arr, uint8_t read_kind){
  * @return none
  */
 uint8_t get_type_d(hr_ir_low_high_poll_t *arr, uint8_t read_kind){
-	uint16_t temp, read= 0;
-	read_kind == CURRENT ? (temp = *((uint16_t*)(&arr->c_value.value))) : (temp = *((uint16_t*)(&arr->p_value.value)));
-	read = (temp & ((uint16_t) (1 << arr->info.bitposition))) >> (arr->info.bitposition) ;
-
-
-	return (uint8_t)read;
+	return conv_type_d(&arr->info, GET_RAW(arr, read_kind));
 }
 
 /**
@@ -470,10 +625,7 @@ uint8_t get_type_d(hr_ir_low_high_poll_t *arr, uint8_t read_kind){
  * @return none
  */
 int16_t get_type_e(hr_ir_low_high_poll_t *arr, uint8_t read_kind){
-	uint16_t temp , read= 0;
-	read_kind == CURRENT ? (temp = *((uint16_t*)(&arr->c_value.value))) : (temp = *((uint16_t*)(&arr->p_value.value)));
-	read = (temp &  ((0x000F)<< (arr->info.bitposition))) >> (arr->info.bitposition);
-    return (int16_t)read;
+	return conv_type_e(&arr->info, GET_RAW(arr, read_kind));
 }
 
 /**
@@ -485,12 +637,7 @@ int16_t get_type_e(hr_ir_low_high_poll_t *arr, uint8_t read_kind){
  * @return none
  */
 int16_t get_type_f_signed(hr_ir_low_high_poll_t *arr, uint8_t read_kind){
-	int16_t temp, read= 0;
-
-	read_kind == CURRENT ? (temp = *((int16_t*)(&arr->c_value.value))) : (temp = *((int16_t*)(&arr->p_value.value)));
-	//PRINTF_DEBUG("get_type_f_signed\n");
-	read = (temp * arr->info.linA) + arr->info.linB;
-	return read;
+	return conv_type_f_signed(&arr->info, GET_RAW(arr, read_kind));
 }
 
 /**
@@ -502,11 +649,7 @@ int16_t get_type_f_signed(hr_ir_low_high_poll_t *arr, uint8_t read_kind){
  * @return none
  */
 uint16_t get_type_f_unsigned(hr_ir_low_high_poll_t *arr, uint8_t read_kind){
-	uint16_t temp, read= 0;
-	read_kind == CURRENT ? (temp = *((uint16_t*)(&arr->c_value.value))) : (temp = *((uint16_t*)(&arr->p_value.value)));
-	//PRINTF_DEBUG("get_type_f_unsigned\n");
-	read = (temp * arr->info.linA) + arr->info.linB;
-	return read;
+	return conv_type_f_unsigned(&arr->info, GET_RAW(arr, read_kind));
 }
 
 
@@ -529,6 +672,126 @@ static void check_increment_values_buff_len(uint16_t *values_buffer_idx){
 
 }
 
+/**
+ * @brief PollEngine__StampValue
+ *        stamp a value with the time of the high polling, the stamp
+ *        is from boot if the NTP sync is not done yet
+ *
+ * @param  values_buffer_t *value
+ * @return none
+ */
+static void PollEngine__StampValue(values_buffer_t *value)
+{
+	C_UINT16 ms;
+
+	value->t = RTC_Mono_To_Sample_Time(timestamp.sample_us, &ms);
+	value->ms = ms;
+}
+
+/*
+ * conv_hr_ir
+ *		  current value of a HR/IR of a polling table, any analog type
+ */
+static float conv_hr_ir(hr_ir_poll_tables_t *arr, uint8_t i)
+{
+	switch(arr->read_type[i]){
+	case TYPE_A:			return conv_type_a(&arr->info[i], arr->c_value[i]);
+	case TYPE_B:			return conv_type_b(&arr->info[i], arr->c_value[i]);
+	case TYPE_C_SIGNED:		return (float)conv_type_c_signed(&arr->info[i], arr->c_value[i]);
+	case TYPE_C_UNSIGNED:	return (float)conv_type_c_unsigned(&arr->info[i], arr->c_value[i]);
+	case TYPE_E:			return (float)conv_type_e(&arr->info[i], arr->c_value[i]);
+	case TYPE_F_SIGNED:		return (float)conv_type_f_signed(&arr->info[i], arr->c_value[i]);
+	case TYPE_F_UNSIGNED:	return (float)conv_type_f_unsigned(&arr->info[i], arr->c_value[i]);
+	default:				return 0;
+	}
+}
+
+/**
+ * @brief poll_agg_sample
+ *        add a sample to the running aggregate of a variable
+ *
+ * @param  poll_agg_t *agg
+ * @param  float value
+ * @return none
+ */
+static void poll_agg_sample(poll_agg_t *agg, float value)
+{
+	if(0 == agg->count){
+		agg->min = value;
+		agg->max = value;
+		agg->sum = 0;
+	}
+	else{
+		if(value < agg->min)
+			agg->min = value;
+		if(value > agg->max)
+			agg->max = value;
+	}
+	agg->last = value;
+	agg->sum += value;
+	if(agg->count < UINT16_MAX)
+		agg->count++;
+}
+
+/**
+ * @brief poll_agg_flush
+ *        end of the aggregation window of a table: one record in the
+ *        values buffer for every aggregated variable with samples, its
+ *        min/max/mean/count are kept aside for the values message
+ *
+ * @param  hr_ir_poll_tables_t *arr
+ * @param  uint8_t arr_len
+ * @return none
+ */
+static void poll_agg_flush(hr_ir_poll_tables_t *arr, uint8_t arr_len)
+{
+	poll_agg_t *agg;
+	values_agg_t *out;
+	float mean;
+	uint16_t j;
+
+	for(uint8_t i=0; i<arr_len; i++){
+		agg = &arr->agg[i];
+		if(!agg->on || (0 == agg->count))
+			continue;
+
+		mean = agg->sum / agg->count;
+
+		values_buffer[values_buffer_index].alias = arr->info[i].Alias;
+		switch(agg_policy & POLL_AGG_VALUE_MASK){
+		case POLL_AGG_MEAN:	values_buffer[values_buffer_index].value = mean;		break;
+		case POLL_AGG_MIN:	values_buffer[values_buffer_index].value = agg->min;	break;
+		case POLL_AGG_MAX:	values_buffer[values_buffer_index].value = agg->max;	break;
+		default:			values_buffer[values_buffer_index].value = agg->last;	break;
+		}
+		values_buffer[values_buffer_index].info_err = 0;
+		values_buffer[values_buffer_index].data_type = arr->info[i].dim;
+		PollEngine__StampValue(&values_buffer[values_buffer_index]);
+
+		// a record of the same slot left by a wrap of the buffer is replaced
+		for(j = 0; (j < values_agg_count) && (values_agg[j].index != values_buffer_index); j++);
+		if(j < POLL_AGG_OUT_LEN){
+			out = &values_agg[j];
+			out->index = values_buffer_index;
+			out->alias = arr->info[i].Alias;
+			out->min = agg->min;
+			out->max = agg->max;
+			out->mean = mean;
+			out->count = agg->count;
+			if(j == values_agg_count)
+				values_agg_count++;
+		}
+
+		check_increment_values_buff_len(&values_buffer_index);
+		values_buffer_count++;
+		if (values_buffer_count > values_buffer_len)
+			values_buffer_count = values_buffer_len;
+
+		agg->count = 0;
+		P_COV_LN;
+	}
+}
+
 
 /**
  * @brief check_hr_ir_read_val
@@ -549,21 +812,31 @@ static void check_hr_ir_read_val(hr_ir_poll_tables_t *arr, uint8_t arr_len, uint
 	int changed;		// set to 1 when a variable changes
 	for(uint8_t i=0; i<arr_len; i++){
 		changed = 0;
-		if( arr->tab[i].error != arr->tab[i].p_error && ( (arr->tab[i].error != 0) )){
-			values_buffer[values_buffer_index].alias = arr->tab[i].info.Alias;
+		if( arr->error[i] != arr->p_error[i] && ( (arr->error[i] != 0) )){
+			values_buffer[values_buffer_index].alias = arr->info[i].Alias;
 			values_buffer[values_buffer_index].value = 0;
-			values_buffer[values_buffer_index].info_err = arr->tab[i].error;
-			values_buffer[values_buffer_index].t = timestamp.current_high;
+			values_buffer[values_buffer_index].info_err = arr->error[i];
+			PollEngine__StampValue(&values_buffer[values_buffer_index]);
 			check_increment_values_buff_len(&values_buffer_index);
 			values_buffer_count++;
 			if (values_buffer_count > values_buffer_len)
 				values_buffer_count = values_buffer_len;
 			P_COV_LN;
 		}
-		else if (arr->tab[i].error == 0){	// manage read values only if there is no error
+		else if (arr->error[i] == 0){	// manage read values only if there is no error
+			// aggregated, sent at the end of the window (the first read goes as usual
+			// and starts a new window)
+			if((NULL != arr->agg) && arr->agg[i].on){
+				if(!first_run){
+					poll_agg_sample(&arr->agg[i], conv_hr_ir(arr, i));
+					arr->p_value[i] = arr->c_value[i];
+					continue;
+				}
+				arr->agg[i].count = 0;
+			}
 			// reinit value otherwise all variables will be considered changed
 			value = 0;
-			switch(arr->tab[i].read_type){
+			switch(arr->read_type[i]){
 			case TYPE_A:
 			{
                 #ifdef __DEBUG_POLLING_CAREL_LEV_2
@@ -571,16 +844,16 @@ static void check_hr_ir_read_val(hr_ir_poll_tables_t *arr, uint8_t arr_len, uint
                 #endif
 
 				float temp, c_read, p_read= 0.0;
-				c_read = get_type_a(&arr->tab[i], CURRENT);
-				p_read = get_type_a(&arr->tab[i], PREVIOUS);
+				c_read = conv_type_a(&arr->info[i], arr->c_value[i]);
+				p_read = conv_type_a(&arr->info[i], arr->p_value[i]);
 				temp = fabs(c_read - p_read);
 
                 #ifdef __DEBUG_POLLING_CAREL_LEV_2
 				PRINTF_DEBUG("c_read: %f, p_read: %f, temp: %f\n",c_read, p_read, temp);
                 #endif
 
-				if(temp > arr->tab[i].info.Hyster || first_run){
-					arr->tab[i].p_value = arr->tab[i].c_value;
+				if(temp > arr->info[i].Hyster || first_run){
+					arr->p_value[i] = arr->c_value[i];
 					value = (long double)c_read;
 					changed = 1;
 
@@ -600,22 +873,22 @@ static void check_hr_ir_read_val(hr_ir_poll_tables_t *arr, uint8_t arr_len, uint
 				PRINTF_DEBUG("check_hr_ir_read_val B \n");
 				#endif
 				float temp, c_read, p_read= 0.0;
-				c_read = get_type_b(&arr->tab[i], CURRENT);
-				p_read = get_type_b(&arr->tab[i], PREVIOUS);
+				c_read = conv_type_b(&arr->info[i], arr->c_value[i]);
+				p_read = conv_type_b(&arr->info[i], arr->p_value[i]);
 				temp = fabs(c_read - p_read);
 
                 #ifdef __DEBUG_POLLING_CAREL_LEV_2
 				PRINTF_DEBUG("c_read: %f, p_read: %f, temp: %f\n",c_read, p_read, temp);
                 #endif
 
-				if(temp > arr->tab[i].info.Hyster || first_run){
-					arr->tab[i].p_value = arr->tab->c_value;
+				if(temp > arr->info[i].Hyster || first_run){
+					arr->p_value[i] = arr->c_value[i];
 					value = (long double)c_read;
 					changed = 1;
 			        #ifdef __DEBUG_POLLING_CAREL_LEV_2
-					PRINTF_DEBUG("TYPE_B REG low = %d\n",arr->tab[i].c_value.reg.low);
-					PRINTF_DEBUG("TYPE_B REG high = %d\n",arr->tab[i].c_value.reg.high);
-					PRINTF_DEBUG("TYPE_B REG val = %d\n",arr->tab[i].c_value.value);
+					PRINTF_DEBUG("TYPE_B REG low = %d\n",arr->c_value[i].reg.low);
+					PRINTF_DEBUG("TYPE_B REG high = %d\n",arr->c_value[i].reg.high);
+					PRINTF_DEBUG("TYPE_B REG val = %d\n",arr->c_value[i].value);
 					PRINTF_DEBUG("TYPE_B c_read = %f\n",c_read);
 					PRINTF_DEBUG("TYPE_B Value = %Lf\n",value);
                     #endif
@@ -631,16 +904,16 @@ static void check_hr_ir_read_val(hr_ir_poll_tables_t *arr, uint8_t arr_len, uint
 				PRINTF_DEBUG("check_hr_ir_read_val C_SIGNED \n");
 				#endif
 				int32_t temp, c_read, p_read= 0;
-				c_read = get_type_c_signed(&arr->tab[i], CURRENT);
-				p_read = get_type_c_signed(&arr->tab[i], PREVIOUS);
+				c_read = conv_type_c_signed(&arr->info[i], arr->c_value[i]);
+				p_read = conv_type_c_signed(&arr->info[i], arr->p_value[i]);
 				temp = abs(c_read - p_read);
 
                 #ifdef __DEBUG_POLLING_CAREL_LEV_2
 				PRINTF_DEBUG("c_read: %d, p_read: %d, temp: %d\n",c_read, p_read, temp);
                 #endif
 
-				if(temp > arr->tab[i].info.Hyster || first_run){
-					arr->tab[i].p_value = arr->tab[i].c_value;
+				if(temp > arr->info[i].Hyster || first_run){
+					arr->p_value[i] = arr->c_value[i];
 					value = (long double)c_read;
 					changed = 1;
 					P_COV_LN;
@@ -655,14 +928,14 @@ static void check_hr_ir_read_val(hr_ir_poll_tables_t *arr, uint8_t arr_len, uint
 				PRINTF_DEBUG("check_hr_ir_read_val C_UNSIGNED \n");
 				#endif
 				uint32_t temp, c_read, p_read= 0;
-				c_read = get_type_c_unsigned(&arr->tab[i], CURRENT);
-				p_read = get_type_c_unsigned(&arr->tab[i], PREVIOUS);
+				c_read = conv_type_c_unsigned(&arr->info[i], arr->c_value[i]);
+				p_read = conv_type_c_unsigned(&arr->info[i], arr->p_value[i]);
 				temp = abs(c_read - p_read);
                 #ifdef __DEBUG_POLLING_CAREL_LEV_2
 				PRINTF_DEBUG("c_read: %d, p_read: %d, temp: %d\n",c_read, p_read, temp);
                 #endif
-				if(temp > arr->tab[i].info.Hyster || first_run){
-					arr->tab[i].p_value = arr->tab[i].c_value;
+				if(temp > arr->info[i].Hyster || first_run){
+					arr->p_value[i] = arr->c_value[i];
 					value = (long double)c_read;
 					changed = 1;
 					P_COV_LN;
@@ -677,11 +950,11 @@ static void check_hr_ir_read_val(hr_ir_poll_tables_t *arr, uint8_t arr_len, uint
 				PRINTF_DEBUG("check_hr_ir_read_val D \n");
 				#endif
 				uint8_t c_read, p_read= 0;
-				c_read = get_type_d(&arr->tab[i], CURRENT);
-				p_read = get_type_d(&arr->tab[i], PREVIOUS);
+				c_read = conv_type_d(&arr->info[i], arr->c_value[i]);
+				p_read = conv_type_d(&arr->info[i], arr->p_value[i]);
 				if(c_read != p_read  || first_run)
 				{
-					arr->tab[i].p_value = arr->tab[i].c_value;
+					arr->p_value[i] = arr->c_value[i];
 					value = (long double)c_read;
 					changed = 1;
 					P_COV_LN;
@@ -699,12 +972,12 @@ static void check_hr_ir_read_val(hr_ir_poll_tables_t *arr, uint8_t arr_len, uint
 				PRINTF_DEBUG("check_hr_ir_read_val E \n");
 				#endif
 				int32_t temp, c_read, p_read= 0;
-				c_read = get_type_e(&arr->tab[i], CURRENT);
-				p_read = get_type_e(&arr->tab[i], PREVIOUS);
+				c_read = conv_type_e(&arr->info[i], arr->c_value[i]);
+				p_read = conv_type_e(&arr->info[i], arr->p_value[i]);
 				temp = abs(c_read - p_read);
-				if(temp > arr->tab[i].info.Hyster || first_run)
+				if(temp > arr->info[i].Hyster || first_run)
 				{
-					arr->tab[i].p_value = arr->tab[i].c_value;
+					arr->p_value[i] = arr->c_value[i];
 					value = (long double)c_read;
 					changed = 1;
 					P_COV_LN;
@@ -722,15 +995,15 @@ static void check_hr_ir_read_val(hr_ir_poll_tables_t *arr, uint8_t arr_len, uint
 				PRINTF_DEBUG("check_hr_ir_read_val F_SIGNED \n");
 				#endif
 				int16_t temp, c_read, p_read= 0;
-				c_read = get_type_f_signed(&arr->tab[i], CURRENT);
-				p_read = get_type_f_signed(&arr->tab[i], PREVIOUS);
+				c_read = conv_type_f_signed(&arr->info[i], arr->c_value[i]);
+				p_read = conv_type_f_signed(&arr->info[i], arr->p_value[i]);
 				temp = abs(c_read - p_read);
                 #ifdef __DEBUG_POLLING_CAREL_LEV_2
 				PRINTF_DEBUG("c_read: %d, p_read: %d, temp: %d\n",c_read, p_read, temp);
                 #endif
-				if(temp > arr->tab[i].info.Hyster || first_run)
+				if(temp > arr->info[i].Hyster || first_run)
 				{
-					arr->tab[i].p_value = arr->tab[i].c_value;
+					arr->p_value[i] = arr->c_value[i];
 					value = (long double)c_read;
 					changed = 1;
 					P_COV_LN;
@@ -745,15 +1018,15 @@ static void check_hr_ir_read_val(hr_ir_poll_tables_t *arr, uint8_t arr_len, uint
 				PRINTF_DEBUG("check_hr_ir_read_val F_UNSIGNED \n");
 				#endif
 				uint16_t temp, c_read, p_read= 0;
-				c_read = get_type_f_unsigned(&arr->tab[i], CURRENT);
-				p_read = get_type_f_unsigned(&arr->tab[i], PREVIOUS);
+				c_read = conv_type_f_unsigned(&arr->info[i], arr->c_value[i]);
+				p_read = conv_type_f_unsigned(&arr->info[i], arr->p_value[i]);
 				temp = abs(c_read - p_read);
                 #ifdef __DEBUG_POLLING_CAREL_LEV_2
 				PRINTF_DEBUG("c_read: %d, p_read: %d, temp: %d\n",c_read, p_read, temp);
                 #endif
-				if(temp > arr->tab[i].info.Hyster || first_run)
+				if(temp > arr->info[i].Hyster || first_run)
 				{
-					arr->tab[i].p_value = arr->tab[i].c_value;
+					arr->p_value[i] = arr->c_value[i];
 					value = (long double)c_read;
 					changed = 1;
 					P_COV_LN;
@@ -766,11 +1039,11 @@ static void check_hr_ir_read_val(hr_ir_poll_tables_t *arr, uint8_t arr_len, uint
 				break;
 			}
 			if(changed != 0 || (first_run)){
-				values_buffer[values_buffer_index].alias = arr->tab[i].info.Alias;
+				values_buffer[values_buffer_index].alias = arr->info[i].Alias;
 				values_buffer[values_buffer_index].value = value;
 				values_buffer[values_buffer_index].info_err = 0;
-				values_buffer[values_buffer_index].data_type = arr->tab[i].info.dim;
-				values_buffer[values_buffer_index].t = timestamp.current_high;
+				values_buffer[values_buffer_index].data_type = arr->info[i].dim;
+				PollEngine__StampValue(&values_buffer[values_buffer_index]);
 				check_increment_values_buff_len(&values_buffer_index);
 				values_buffer_count++;
 				if (values_buffer_count > values_buffer_len)
@@ -779,6 +1052,21 @@ static void check_hr_ir_read_val(hr_ir_poll_tables_t *arr, uint8_t arr_len, uint
 			}
 		}
 	}
+
+	if(NULL != arr->agg){
+		uint64_t window_us = (uint64_t)agg_window_s * 1000000;
+
+		if((0 == arr->agg_end_us) || first_run)
+			arr->agg_end_us = timestamp.sample_us + window_us;
+		else if(timestamp.sample_us >= arr->agg_end_us){
+			poll_agg_flush(arr, arr_len);
+			// windows aligned, unless the polling has been suspended for longer
+			arr->agg_end_us += window_us;
+			if(arr->agg_end_us <= timestamp.sample_us)
+				arr->agg_end_us = timestamp.sample_us + window_us;
+			P_COV_LN;
+		}
+	}
 }
 
 
@@ -800,24 +1088,24 @@ static void check_coil_di_read_val(coil_di_poll_tables_t *arr, uint8_t arr_len,
 {
 	for(uint8_t i=0; i<arr_len; i++){
 		//error?
-		if( arr->reg[i].error != arr->reg[i].p_error && ( (arr->reg[i].error != 0)) ){
+		if( arr->error[i] != arr->p_error[i] && ( (arr->error[i] != 0)) ){
 			//send values to values buffer as error
-			values_buffer[values_buffer_index].alias = arr->reg[i].info.Alias;
+			values_buffer[values_buffer_index].alias = arr->info[i].Alias;
 			values_buffer[values_buffer_index].value = 0;
-			values_buffer[values_buffer_index].info_err = arr->reg[i].error;
-			values_buffer[values_buffer_index].t = timestamp.current_high;
+			values_buffer[values_buffer_index].info_err = arr->error[i];
+			PollEngine__StampValue(&values_buffer[values_buffer_index]);
 			check_increment_values_buff_len(&values_buffer_index);
 			values_buffer_count++;
 			if (values_buffer_count > values_buffer_len)
 				values_buffer_count = values_buffer_len;
 		}
 		//value changed and no error
-		else if((arr->reg[i].error == 0) && (arr->reg[i].c_value != arr->reg[i].p_value || (first_run))){
+		else if((arr->error[i] == 0) && (arr->c_value[i] != arr->p_value[i] || (first_run))){
 			//send values to values buffer
-			values_buffer[values_buffer_index].alias = arr->reg[i].info.Alias;
-			values_buffer[values_buffer_index].value = (long double)arr->reg[i].c_value;
+			values_buffer[values_buffer_index].alias = arr->info[i].Alias;
+			values_buffer[values_buffer_index].value = (long double)arr->c_value[i];
 			values_buffer[values_buffer_index].info_err = 0;
-			values_buffer[values_buffer_index].t = timestamp.current_high;
+			PollEngine__StampValue(&values_buffer[values_buffer_index]);
 			check_increment_values_buff_len(&values_buffer_index);
 			values_buffer_count++;
 			if (values_buffer_count > values_buffer_len)
@@ -936,56 +1224,56 @@ static void update_current_previous_tables(RegType_t poll_type){
 	case LOW_POLLING:
 		//Coil
 		for(i=0;i<low_n.coil;i++){
-			COILLowPollTab.reg[i].p_value = COILLowPollTab.reg[i].c_value;
-			COILLowPollTab.reg[i].c_value = 0;
-			COILLowPollTab.reg[i].p_error = COILLowPollTab.reg[i].error;
+			COILLowPollTab.p_value[i] = COILLowPollTab.c_value[i];
+			COILLowPollTab.c_value[i] = 0;
+			COILLowPollTab.p_error[i] = COILLowPollTab.error[i];
 		}
 		//DI
 		for(i=0;i<low_n.di;i++){
-			DILowPollTab.reg[i].p_value = DILowPollTab.reg[i].c_value;
-			DILowPollTab.reg[i].c_value = 0;
-			DILowPollTab.reg[i].p_error = DILowPollTab.reg[i].error;
+			DILowPollTab.p_value[i] = DILowPollTab.c_value[i];
+			DILowPollTab.c_value[i] = 0;
+			DILowPollTab.p_error[i] = DILowPollTab.error[i];
 		}
 		//HR
 		for(i=0;i<low_n.hr;i++){
-			//HRLowPollTab.tab[i].p_value.value = HRLowPollTab.tab[i].c_value.value;
-			HRLowPollTab.tab[i].c_value.value = 0;
-			HRLowPollTab.tab[i].p_error = HRLowPollTab.tab[i].error;
+			//HRLowPollTab.p_value[i].value = HRLowPollTab.c_value[i].value;
+			HRLowPollTab.c_value[i].value = 0;
+			HRLowPollTab.p_error[i] = HRLowPollTab.error[i];
 
 		}
 		//IR
 		for(i=0;i<low_n.ir;i++){
-			//IRLowPollTab.tab[i].p_value.value = IRLowPollTab.tab[i].c_value.value;
-			IRLowPollTab.tab[i].c_value.value = 0;
-			IRLowPollTab.tab[i].p_error = IRLowPollTab.tab[i].error;
+			//IRLowPollTab.p_value[i].value = IRLowPollTab.c_value[i].value;
+			IRLowPollTab.c_value[i].value = 0;
+			IRLowPollTab.p_error[i] = IRLowPollTab.error[i];
 		}
 		break;
 
 	case HIGH_POLLING:
 		//Coil
 		for(i=0;i<high_n.coil;i++){
-			COILHighPollTab.reg[i].p_value = COILHighPollTab.reg[i].c_value;
-			COILHighPollTab.reg[i].c_value = 0;
-			COILHighPollTab.reg[i].p_error = COILHighPollTab.reg[i].error;
+			COILHighPollTab.p_value[i] = COILHighPollTab.c_value[i];
+			COILHighPollTab.c_value[i] = 0;
+			COILHighPollTab.p_error[i] = COILHighPollTab.error[i];
 		}
 		//DI
 		for(i=0;i<high_n.di;i++){
-			DIHighPollTab.reg[i].p_value = DIHighPollTab.reg[i].c_value;
-			DIHighPollTab.reg[i].c_value = 0;
-			DIHighPollTab.reg[i].p_error = DIHighPollTab.reg[i].error;
+			DIHighPollTab.p_value[i] = DIHighPollTab.c_value[i];
+			DIHighPollTab.c_value[i] = 0;
+			DIHighPollTab.p_error[i] = DIHighPollTab.error[i];
 		}
 		//HR
 		for(i=0;i<high_n.hr;i++){
-			//HRHighPollTab.tab[i].p_value.value = HRHighPollTab.tab[i].c_value.value;
-			HRHighPollTab.tab[i].c_value.value = 0;
-			HRHighPollTab.tab[i].p_error = HRHighPollTab.tab[i].error;
+			//HRHighPollTab.p_value[i].value = HRHighPollTab.c_value[i].value;
+			HRHighPollTab.c_value[i].value = 0;
+			HRHighPollTab.p_error[i] = HRHighPollTab.error[i];
 		}
 
 		//IR
 		for(i=0;i<high_n.ir;i++){
-			//IRHighPollTab.tab[i].p_value.value = IRHighPollTab.tab[i].c_value.value;
-			IRHighPollTab.tab[i].c_value.value = 0;
-			IRHighPollTab.tab[i].p_error = IRHighPollTab.tab[i].error;
+			//IRHighPollTab.p_value[i].value = IRHighPollTab.c_value[i].value;
+			IRHighPollTab.c_value[i].value = 0;
+			IRHighPollTab.p_error[i] = IRHighPollTab.error[i];
 		}
 		break;
 
@@ -999,12 +1287,12 @@ static void update_current_previous_tables(RegType_t poll_type){
  * @brief save_coil_di_value
  *        Save the value into the relative tab
  *
- * @param  coil_di_low_high_t *arr
+ * @param  uint8_t *c_value
  * @param  void* instance_ptr
  *
  * @return void
  */
-static void save_coil_di_value(coil_di_low_high_t *arr, void* instance_ptr){
+static void save_coil_di_value(uint8_t *c_value, void* instance_ptr){
 	uint16_t temp, read_val = 0;
 	uint8_t bit=0;
 
@@ -1013,7 +1301,7 @@ static void save_coil_di_value(coil_di_low_high_t *arr, void* instance_ptr){
 	temp = (0x000F)&read_val;                         //& (uint16_t)(1 << bit);
 
 	temp == 0 ? (temp = 0) : (temp = 1);
-	arr->c_value = temp;
+	*c_value = temp;
 	P_COV_LN;
 }
 
@@ -1023,99 +1311,220 @@ static void save_coil_di_value(coil_di_low_high_t *arr, void* instance_ptr){
  * @brief save_hr_ir_value
  *        Save the value into the relative tab
  *
- * @param hr_ir_low_high_poll_t *arr
+ * @param const r_hr_ir *info
+ * @param hr_ir_low_high_value_t *c_value
  * @param void* instance_ptr
  *
  * @return void
  */
-static void save_hr_ir_value(hr_ir_low_high_poll_t *arr, void* instance_ptr){
-	if(arr->info.dim > 16){
+static void save_hr_ir_value(const r_hr_ir *info, hr_ir_low_high_value_t *c_value, void* instance_ptr){
+	if(info->dim > 16){
 	int32_t temp = 0;
-		if(1 == arr->info.flag.bit.bigendian){
+		if(1 == info->flag.bit.bigendian){
 			temp = (*(int32_t*)(instance_ptr));
-			arr->c_value.reg.high = (uint16_t)temp;
-			arr->c_value.reg.low = 	(uint16_t)(temp >> 16);
+			c_value->reg.high = (uint16_t)temp;
+			c_value->reg.low = 	(uint16_t)(temp >> 16);
 
 		}else{
-			arr->c_value.value = (*(int32_t*)(instance_ptr));
+			c_value->value = (*(int32_t*)(instance_ptr));
 		}
 	}else{
 
-		arr->c_value.value =(uint32_t)(*(int16_t*)(instance_ptr));
+		c_value->value =(uint32_t)(*(int16_t*)(instance_ptr));
 	}
 }
 
 
 /**
- * @brief save_alarm_coil_di_value
- *        Save the value into the relative tab
+ * @brief alarm_ref
+ *        model record and state of an alarm from its entry of alarm_order
  *
- * @param coil_di_alarm_tables_t *alarm
- * @param void* instance_ptr
+ * @param uint16_t ord  (type << 8) | index in the alarm table of the type
+ * @param uint16_t *alias
+ * @param uint16_t *addr
+ * @param uint8_t *bit  bit of the register, 0 for coils and DI
  *
- * @return void
+ * @return alarm_read_t* the state of the alarm
  */
-static void save_alarm_coil_di_value(coil_di_alarm_tables_t *alarm,  void* instance_ptr)
+static alarm_read_t* alarm_ref(uint16_t ord, uint16_t *alias, uint16_t *addr, uint8_t *bit)
 {
-	uint16_t temp, read_val = 0;
-	uint8_t  bit=0;
+	uint8_t i = (uint8_t)(ord & 0xFF);
+
+	switch(ord >> 8){
+	case COIL:
+		*alias = COILAlarmPollTab[i].info.Alias;
+		*addr = COILAlarmPollTab[i].info.Addr;
+		*bit = 0;
+		return &COILAlarmPollTab[i].data;
+	case DI:
+		*alias = DIAlarmPollTab[i].info.Alias;
+		*addr = DIAlarmPollTab[i].info.Addr;
+		*bit = 0;
+		return &DIAlarmPollTab[i].data;
+	case HR:
+		*alias = HRAlarmPollTab[i].info.Alias;
+		*addr = HRAlarmPollTab[i].info.Addr;
+		*bit = HRAlarmPollTab[i].info.dim;
+		return (alarm_read_t*)&HRAlarmPollTab[i].data;
+	default:
+		*alias = IRAlarmPollTab[i].info.Alias;
+		*addr = IRAlarmPollTab[i].info.Addr;
+		*bit = IRAlarmPollTab[i].info.dim;
+		return (alarm_read_t*)&IRAlarmPollTab[i].data;
+	}
+}
+
+/**
+ * @brief alarm_blocks_build
+ *        sort the alarms of every type by address and group the near ones
+ *        in blocks read with a single request. The state of the alarm in
+ *        position k of alarm_order is the bit k of AlarmCur/AlarmPrev
+ *
+ * @param none
+ * @return none
+ */
+static void alarm_blocks_build(void)
+{
+	alarm_block_t *blk = NULL;
+	uint16_t k = 0, base, j, m, ord;
+	uint16_t alias, addr, addr_m, last = 0;
+	uint16_t max_span, max_gap;
+	uint8_t bit;
+
+	alarm_block_n = 0;
+	if((NULL == AlarmOrder) || (NULL == AlarmBlocks))
+		return;
+
+	for(uint8_t t = COIL; t < MAX_REG; t++){
+		base = k;
+
+		// insertion sort, done once at the load of the model
+		for(uint16_t i = 0; i < DeviceParamCount[ALARM_POLLING][t]; i++){
+			ord = (uint16_t)((t << 8) | i);
+			alarm_ref(ord, &alias, &addr, &bit);
+			for(m = k; m > base; m--){
+				alarm_ref(AlarmOrder[m - 1], &alias, &addr_m, &bit);
+				if(addr_m <= addr)
+					break;
+				AlarmOrder[m] = AlarmOrder[m - 1];
+			}
+			AlarmOrder[m] = ord;
+			k++;
+		}
+
+		max_span = (t == COIL || t == DI) ? ALARM_BLOCK_MAX_BITS : ALARM_BLOCK_MAX_REGS;
+		max_gap = (t == COIL || t == DI) ? ALARM_BLOCK_MAX_GAP_BITS : ALARM_BLOCK_MAX_GAP_REGS;
+
+		for(j = base; j < k; j++){
+			alarm_ref(AlarmOrder[j], &alias, &addr, &bit);
+			if((j == base) || ((addr - blk->start) >= max_span) || ((addr - last) > max_gap)){
+				blk = &AlarmBlocks[alarm_block_n++];
+				blk->start = addr;
+				blk->first = j;
+				blk->count = 0;
+				blk->type = t;
+				blk->split = 0;
+			}
+			blk->count++;
+			blk->num = addr - blk->start + 1;
+			last = addr;
+		}
+	}
 
-	//bit = alarm->info.Addr % 16;
+    #ifdef __DEBUG_POLLING_CAREL_LEV_1
+	PRINTF_DEBUG("alarms %d in %d blocks\n", k, alarm_block_n);
+    #endif
+}
 
-	read_val = *((uint16_t*)(instance_ptr));
+/**
+ * @brief alarm_apply
+ *        save the result of the read of an alarm, the value goes in its
+ *        bit of AlarmCur, on error the bit is left as it is
+ *
+ * @param uint16_t j  position in alarm_order
+ * @param uint16_t start  first address of the data in alarm_rx
+ * @param int err
+ *
+ * @return void
+ */
+static void alarm_apply(uint16_t j, uint16_t start, int err)
+{
+	uint16_t alias, addr, off, reg;
+	uint8_t bit, value;
+	alarm_read_t *data = alarm_ref(AlarmOrder[j], &alias, &addr, &bit);
 
-	temp = (0x000F)&read_val;    //& (uint16_t)(1 << bit);
-	temp == 0 ? (temp = 0) : (temp = 1);
+	data->error = err;
+	if(MB_MRE_NO_ERR != err)
+		return;
 
-	if(temp != alarm->data.value){
-		if(0 != temp){
-			alarm->data.start_time = RTC_Get_UTC_Current_Time();
-			alarm->data.stop_time = 0;
-			alarm->data.value = 1;
-			alarm->data.send_flag = 1;
-			P_COV_LN;
-		}else{
-			alarm->data.stop_time = RTC_Get_UTC_Current_Time();
-			alarm->data.value = 0;
-			alarm->data.send_flag = 1;
-			P_COV_LN;
-		}
+	off = addr - start;
+	if(((AlarmOrder[j] >> 8) == COIL) || ((AlarmOrder[j] >> 8) == DI)){
+		value = (alarm_rx[off >> 3] >> (off & 7)) & 1;
+	}
+	else{
+		reg = ((uint16_t)alarm_rx[2 * off] << 8) | alarm_rx[2 * off + 1];
+		value = (reg >> bit) & 1;
 	}
+
+	data->value = value;
+	if(value)
+		AlarmCur[j >> 5] |= (uint32_t)1 << (j & 31);
+	else
+		AlarmCur[j >> 5] &= ~((uint32_t)1 << (j & 31));
 }
 
 /**
- * @brief save_alarm_hr_ir_value
- *        Save the value into the relative tab
+ * @brief alarm_block_read
+ *        read a block, or its alarms one by one if the device refused it
+ *        (the holes of a block can be out of the map of the device)
  *
- * @param hr_ir_alarm_tables_t *alarm
- * @param void* instance_ptr
+ * @param alarm_block_t *blk
  *
- * @return void
+ * @return int MB_MRE_NO_ERR if all its alarms have been read
  */
-static void save_alarm_hr_ir_value(hr_ir_alarm_tables_t *alarm, void* instance_ptr)
+static int alarm_block_read(alarm_block_t *blk)
 {
-	uint16_t temp, read_val = 0;
+	static const C_BYTE alarm_fc[MAX_REG] = {MB_FUNC_READ_COILS, MB_FUNC_READ_DISCRETE_INPUTS,
+	                                         MB_FUNC_READ_HOLDING_REGISTER, MB_FUNC_READ_INPUT_REGISTER};
+	int errorReq = MB_MRE_NO_ERR, result = MB_MRE_NO_ERR;
+	uint16_t len, alias, addr;
+	uint8_t retry, bit;
 
-	read_val = *((uint16_t*)(instance_ptr));
-	temp = read_val & (uint16_t)(1 << alarm->info.dim);
+	if(!blk->split){
+		retry = 0;
+		do {
+			len = sizeof(alarm_rx);
+			errorReq = app_block_read(Modbus__GetAddress(), alarm_fc[blk->type], blk->start, blk->num, alarm_rx, &len);
+			retry++;
+		} while(errorReq != MB_MRE_NO_ERR && errorReq != MB_MRE_EXE_FUN && retry < 3);
 
-	temp == 0 ? (temp = 0) : (temp = 1);
+		if((MB_MRE_EXE_FUN != errorReq) || (1 == blk->num)){
+			for(uint16_t j = blk->first; j < blk->first + blk->count; j++)
+				alarm_apply(j, blk->start, errorReq);
+			return errorReq;
+		}
 
-	if(temp != alarm->data.value){
-		//temp is not shifted, so it can have the entire value in uint16_t
-		if(0 != temp){
-			alarm->data.start_time = RTC_Get_UTC_Current_Time();
-			alarm->data.stop_time = 0;
-			alarm->data.value = 1;
-			alarm->data.send_flag = 1;
-			P_COV_LN;
-		}else{
-			alarm->data.stop_time = RTC_Get_UTC_Current_Time();
-			alarm->data.value = 0;
-			alarm->data.send_flag = 1;
-			P_COV_LN;
+		blk->split = 1;
+		P_COV_LN;
+	}
+
+	for(uint16_t j = blk->first; j < blk->first + blk->count; j++){
+		alarm_ref(AlarmOrder[j], &alias, &addr, &bit);
+		retry = 0;
+		do {
+			len = sizeof(alarm_rx);
+			errorReq = app_block_read(Modbus__GetAddress(), alarm_fc[blk->type], addr, 1, alarm_rx, &len);
+			retry++;
+		} while(errorReq != MB_MRE_NO_ERR && errorReq != MB_MRE_EXE_FUN && retry < 3);
+
+		alarm_apply(j, addr, errorReq);
+		if(MB_MRE_NO_ERR != errorReq){
+			result = errorReq;
+			if(MB_MRE_TIMEDOUT == errorReq)
+				break;		// offline, don't wait the timeout of every alarm
 		}
 	}
+	return result;
 }
 
 /**
@@ -1131,6 +1540,8 @@ static void send_cbor_alarm(uint16_t alias, alarm_read_t *data){
 	c_cboralarms cbor_al;
 	cbor_al.st = data->start_time;
 	cbor_al.et = data->stop_time;
+	cbor_al.st_ms = data->start_ms;
+	cbor_al.et_ms = data->stop_ms;
 	cbor_al.aty = 1;
 	cbor_al.aco = 0;
 	itoa(alias,(char*)cbor_al.ali,10);
@@ -1153,6 +1564,8 @@ static void send_cbor_offalarm(uint16_t alias, uint32_t st, uint32_t et){
 
 	cbor_al.st = st;
 	cbor_al.et = et;
+	cbor_al.st_ms = 0;
+	cbor_al.et_ms = 0;
 	cbor_al.aty = 2;
 	cbor_al.aco = 1;
 	strcpy((char*)cbor_al.ali, "");
@@ -1163,64 +1576,53 @@ static void send_cbor_offalarm(uint16_t alias, uint32_t st, uint32_t et){
 
 /**
  * @brief check_alarms_change
-*          Description: Check if any alarm's value is changed, activated or deactivated
-*
+*          Description: Check if any alarm's value is changed, activated or deactivated.
+*          The changes are the bits of AlarmCur ^ AlarmPrev, 32 alarms at a time
+ *
  * @param void
  *
  * @return void
  */
 static void check_alarms_change(void)
 {
-	uint16_t i;
-
-	for(i=0; i<alarm_n.coil; i++){
-		if (1 == COILAlarmPollTab[i].data.send_flag){
-			send_cbor_alarm(COILAlarmPollTab[i].info.Alias, &COILAlarmPollTab[i].data);
-
-            #ifdef __DEBUG_POLLING_CAREL_LEV_2
-			if(COILAlarmPollTab[i].data.value == 1)
-			   printf("Coil Alarm rise num %d \n ",i);
-			else
-			   printf("Coil Alarm fall num %d \n ",i);
-            #endif
-
-			COILAlarmPollTab[i].data.send_flag = 0;
-		}
-	}
-
-	for(i=0; i<alarm_n.di; i++){
-		if (1 == DIAlarmPollTab[i].data.send_flag){
-			send_cbor_alarm(DIAlarmPollTab[i].info.Alias, &DIAlarmPollTab[i].data);
+	uint32_t diff;
+	uint16_t w, j, alias, addr;
+	uint8_t b, bit;
+	alarm_read_t *data;
+	C_UINT32 now;
+	C_UINT16 ms;
+
+	now = RTC_Get_UTC_Current_Time_ms(&ms);
+
+	for(w = 0; w < ALARM_WORDS(alarm_n.total); w++){
+		diff = AlarmCur[w] ^ AlarmPrev[w];
+		AlarmPrev[w] = AlarmCur[w];
+
+		while(0 != diff){
+			b = (uint8_t)__builtin_ctz(diff);
+			diff &= diff - 1;
+			j = (w << 5) + b;
+
+			data = alarm_ref(AlarmOrder[j], &alias, &addr, &bit);
+			if((AlarmCur[w] >> b) & 1){
+				data->start_time = now;
+				data->start_ms = ms;
+				data->stop_time = 0;
+				data->stop_ms = 0;
+				P_COV_LN;
+			}else{
+				data->stop_time = now;
+				data->stop_ms = ms;
+				P_COV_LN;
+			}
+			send_cbor_alarm(alias, data);
 
             #ifdef __DEBUG_POLLING_CAREL_LEV_2
-				PRINTF_POLL_ENG(("DI Alarm changed num %d \n ",i))	  
+			PRINTF_POLL_ENG(("Alarm %d (type %d) %s \n", alias, AlarmOrder[j] >> 8, ((AlarmCur[w] >> b) & 1) ? "rise" : "fall"))
             #endif
-			DIAlarmPollTab[i].data.send_flag = 0;
 		}
 	}
-
-	for(i=0; i<alarm_n.hr; i++){
-		if (1 == HRAlarmPollTab[i].data.send_flag){
-			send_cbor_alarm(HRAlarmPollTab[i].info.Alias,(alarm_read_t*) &HRAlarmPollTab[i].data);
-
-            #ifdef __DEBUG_POLLING_CAREL_LEV_2
-				PRINTF_POLL_ENG(("HR Alarm changed num %d \n ",i))		
-            #endif
-			HRAlarmPollTab[i].data.send_flag = 0;
-		}
-	}
-
-	for(i=0; i<alarm_n.ir; i++){
-		if (1 == IRAlarmPollTab[i].data.send_flag){
-			send_cbor_alarm(IRAlarmPollTab[i].info.Alias,(alarm_read_t*) &IRAlarmPollTab[i].data);
-
-            #ifdef __DEBUG_POLLING_CAREL_LEV_2
-				PRINTF_POLL_ENG(("IR Alarm changed num %d \n ",i))
-            #endif
-			IRAlarmPollTab[i].data.send_flag = 0;
-		}
-	}
-}
+}
 
 #ifdef __DEBUG_POLLING_CAREL_LEV_2
 void print_ValuesTable(void){
@@ -1282,18 +1684,18 @@ static C_RES DoPolling (coil_di_poll_tables_t *Coil, coil_di_poll_tables_t *Di,
 	{
 		errorReq = MB_MRE_NO_ERR;
 		retry = 0;
-		addr = (Coil->reg[i].info.Addr);
+		addr = (Coil->info[i].Addr);
 
 		do {
 			errorReq = app_coil_read(Modbus__GetAddress(), addr, 1);
 			retry++;
 		} while(errorReq != MB_MRE_NO_ERR && retry < 3);
 
-		Coil->reg[i].error = errorReq;
+		Coil->error[i] = errorReq;
 		if(errorReq == MB_MRE_NO_ERR) {
 			// reset to the default for the next reading
 			SetResult(MB_ENOERR);
-			save_coil_di_value(&Coil->reg[i] , param_buffer);
+			save_coil_di_value(&Coil->c_value[i], param_buffer);
 		}
 		else
 		{
@@ -1320,18 +1722,18 @@ static C_RES DoPolling (coil_di_poll_tables_t *Coil, coil_di_poll_tables_t *Di,
 	{
 		errorReq = MB_MRE_NO_ERR;
 		retry = 0;
-		addr = (Di->reg[i].info.Addr);
+		addr = (Di->info[i].Addr);
 
 		do {
 			errorReq = app_coil_discrete_input_read(Modbus__GetAddress(), addr, 1);
 			retry++;
 		} while(errorReq != MB_MRE_NO_ERR && retry < 3);
 
-		Di->reg[i].error = errorReq;
+		Di->error[i] = errorReq;
 		if(errorReq == MB_MRE_NO_ERR) {
 			// reset to the default for the next reading
 			SetResult(MB_ENOERR);
-			save_coil_di_value(&Di->reg[i] , param_buffer);
+			save_coil_di_value(&Di->c_value[i], param_buffer);
 		}
 		else
 		{
@@ -1358,9 +1760,9 @@ static C_RES DoPolling (coil_di_poll_tables_t *Coil, coil_di_poll_tables_t *Di,
 	{
 		errorReq = MB_MRE_NO_ERR;
 		retry = 0;
-		addr = Hr->tab[i].info.Addr;
+		addr = Hr->info[i].Addr;
 
-		if((Hr->tab[i].info.dim) == 16)
+		if((Hr->info[i].dim) == 16)
 		  numOf = 1;
 		else
 		  numOf = 2;
@@ -1370,11 +1772,11 @@ static C_RES DoPolling (coil_di_poll_tables_t *Coil, coil_di_poll_tables_t *Di,
 			retry++;
 		} while(errorReq != MB_MRE_NO_ERR && retry < 3);
 
-		Hr->tab[i].error = errorReq;
+		Hr->error[i] = errorReq;
 		if(errorReq == MB_MRE_NO_ERR) {
 			// reset to the default for the next reading
 			SetResult(MB_ENOERR);
-			save_hr_ir_value(&Hr->tab[i], param_buffer);   // &HRLowPollTab.tab[i]
+			save_hr_ir_value(&Hr->info[i], &Hr->c_value[i], param_buffer);
 		}
 		else
 		{
@@ -1400,9 +1802,9 @@ static C_RES DoPolling (coil_di_poll_tables_t *Coil, coil_di_poll_tables_t *Di,
 	{
 		errorReq = MB_MRE_NO_ERR;
 		retry = 0;
-		addr = Ir->tab[i].info.Addr;
+		addr = Ir->info[i].Addr;
 
-		if((Ir->tab[i].info.dim) == 16)
+		if((Ir->info[i].dim) == 16)
 		  numOf = 1;
 		else
 		  numOf = 2;
@@ -1412,11 +1814,11 @@ static C_RES DoPolling (coil_di_poll_tables_t *Coil, coil_di_poll_tables_t *Di,
 			retry++;
 		} while(errorReq != MB_MRE_NO_ERR && retry < 3);
 
-		Ir->tab[i].error = errorReq;
+		Ir->error[i] = errorReq;
 		if(errorReq == MB_MRE_NO_ERR) {
 			// reset to the default for the next reading
 			SetResult(MB_ENOERR);
-			save_hr_ir_value(&Ir->tab[i], param_buffer);
+			save_hr_ir_value(&Ir->info[i], &Ir->c_value[i], param_buffer);
 		}
 		else
 		{
@@ -1446,175 +1848,36 @@ static C_RES DoPolling (coil_di_poll_tables_t *Coil, coil_di_poll_tables_t *Di,
 
 /**
  * @brief DoAlarmPolling
- *        Check the allarm poll variable (Coil, Di, Hr, Ir)
+ *        Check the allarm poll variable (Coil, Di, Hr, Ir), a request
+ *        for every block of alarms (see alarm_blocks_build)
  *
- * @param coil_di_poll_tables_t *Coil
- *        coil_di_poll_tables_t *Di
- *        hr_ir_poll_tables_t *Hr
- *	      hr_ir_poll_tables_t *Ir
+ * @param none
  * @return C_RES
  */
 
-static C_RES DoAlarmPolling(coil_di_alarm_tables_t *Coil, coil_di_alarm_tables_t *Di, hr_ir_alarm_tables_t *Hr, hr_ir_alarm_tables_t *Ir)
+static C_RES DoAlarmPolling(void)
 {
-	uint8_t addr = 0;
-	uint8_t retry = 0;
 	uint8_t is_offline = 0;
-	eMBMasterReqErrCode errorReq = MB_MRE_NO_ERR;
+	int errorReq;
 
-	// Polling the Coil register
-	for (uint16_t i = 0; i < alarm_n.coil; i++)
+	for (uint16_t i = 0; i < alarm_block_n; i++)
 	{
-		errorReq = MB_MRE_NO_ERR;
-		retry = 0;
-		addr = (Coil[i].info.Addr);
-		do {
-			errorReq = app_coil_read(Modbus__GetAddress(), addr, 1);
-			retry++;
-		} while(errorReq != MB_MRE_NO_ERR && retry < 3);
-
-        Coil->data.error = errorReq;
-		if(errorReq == MB_MRE_NO_ERR)
-		{
-			// reset to the default for the next reading
-			SetResult(MB_ENOERR);
-			//is_offline = 0;
-			save_alarm_coil_di_value(&Coil[i], param_buffer);
-		}
-		else
+		errorReq = alarm_block_read(&AlarmBlocks[i]);
+		if(errorReq != MB_MRE_NO_ERR)
 		{
 			modbus_error++; // only for web debug
 
 			is_offline++;
             #ifdef __DEBUG_POLLING_CAREL_LEV_1
-			PRINTF_DEBUG("DoAlarmPolling Coil i=%X errorReq %X \r\n", i, errorReq);
+			PRINTF_DEBUG("DoAlarmPolling block %d type %d errorReq %X \r\n", i, AlarmBlocks[i].type, errorReq);
             #endif
 		}
 
 		if(is_offline == 2)
 		{
 			P_COV_LN;
-			//P_COV_LN_OFF("A_COIL");
 			return C_FAIL; //this is an offline
 		}
-
-		param_buffer[0] = param_buffer[1] = 0;
-	}
-
-
-
-	// Polling the Di register
-	for (uint16_t i = 0; i < alarm_n.di; i++)
-	{
-		errorReq = MB_MRE_NO_ERR;
-		retry = 0;
-		addr = (Di[i].info.Addr);
-
-		do {
-			errorReq = app_coil_discrete_input_read(Modbus__GetAddress(), addr, 1);
-			retry++;
-		} while(errorReq != MB_MRE_NO_ERR && retry < 3);
-
-		Di->data.error = errorReq;
-
-		if(errorReq == MB_MRE_NO_ERR)
-		{
-			// reset to the default for the next reading
-			SetResult(MB_ENOERR);
-			save_alarm_coil_di_value(&Di[i], param_buffer);
-		}
-		else
-		{
-			modbus_error++; // only for web debug
-
-			is_offline++;
-            #ifdef __DEBUG_POLLING_CAREL_LEV_1
-			PRINTF_DEBUG("DoAlarmPolling DI i=%X errorReq %X \r\n", i, errorReq);
-            #endif
-		}
-
-		if(is_offline == 2)
-		{
-			P_COV_LN;
-		    //P_COV_LN_OFF("A_DI");
-			return C_FAIL; //this is an offline
-		}
-
-		param_buffer[0] = param_buffer[1] = 0;
-	}
-
-	// Polling the Hr register
-	for (uint16_t i = 0; i < alarm_n.hr; i++)
-	{
-		errorReq = MB_MRE_NO_ERR;
-		retry = 0;
-		addr = (Hr[i].info.Addr);
-
-		do {
-			errorReq = app_holding_register_read(Modbus__GetAddress(), addr, 1);
-			retry++;
-		} while(errorReq != MB_MRE_NO_ERR && retry < 3);
-		Hr->data.error = errorReq;
-		if(errorReq == MB_MRE_NO_ERR)
-		{
-			// reset to the default for the next reading
-			SetResult(MB_ENOERR);
-			save_alarm_hr_ir_value(&Hr[i], param_buffer);
-		}else
-		{
-			modbus_error++; // only for web debug
-
-			is_offline++;
-            #ifdef __DEBUG_POLLING_CAREL_LEV_1
-			PRINTF_DEBUG("DoAlarmPolling HR i=%X errorReq %X \r\n", i, errorReq);
-            #endif
-		}
-
-		if(is_offline == 2)
-		{
-			P_COV_LN;
-			//P_COV_LN_OFF("A_HR");
-			return C_FAIL; //this is an offline
-		}
-
-		param_buffer[0] = param_buffer[1] = 0;
-	}
-
-	// Polling the Ir register
-	for (uint16_t i = 0; i < alarm_n.ir; i++)
-	{
-		errorReq = MB_MRE_NO_ERR;  //TODO CPPCHECK di fatto non serve a nulla viene assegnata sotto
-		retry = 0;
-		addr = (Ir[i].info.Addr);
-
-		do {
-			errorReq = app_input_register_read(Modbus__GetAddress(), addr, 1);
-			retry++;
-		} while(errorReq != MB_MRE_NO_ERR && retry < 3);
-		Ir->data.error = errorReq;
-		if(errorReq == MB_MRE_NO_ERR)
-		{
-			// reset to the default for the next reading
-			SetResult(MB_ENOERR);
-			save_alarm_hr_ir_value(&Ir[i], param_buffer);
-		}else
-		{
-			modbus_error++; // only for web debug
-
-			is_offline++;
-            #ifdef __DEBUG_POLLING_CAREL_LEV_1
-			PRINTF_DEBUG("DoAlarmPolling IR i=%X errorReq %X \r\n", i, errorReq);
-            #endif
-		}
-
-		if(is_offline == 2)
-		{
-			P_COV_LN;
-			//P_COV_LN_OFF("A_IR");
-			return C_FAIL; //this is an offline
-		}
-
-		param_buffer[0] = param_buffer[1] = 0;
 	}
 	return C_SUCCESS;
 
@@ -1646,7 +1909,6 @@ uint8_t IsForced(PollType_t type)
 //CHIEBAO A.
 
 
-static uint32_t timeout = 0;
 static uint32_t start_offline = 0;
 static uint32_t end_offline = 0;
 static C_BYTE   real_offline = 0;
@@ -1655,6 +1917,11 @@ void SendOffline(C_RES poll_done) {
 
 	uint32_t time_tmp;
 
+	// the polling starts before NTP and MQTT, the line status is
+	// evaluated once the offline alarm can be sent
+	if (0 == MQTT_GetFlags())
+		return;
+
 	if (poll_done == C_FAIL) {
 		if (start_offline == 0) {
 			start_offline = RTC_Get_UTC_Current_Time();
@@ -1711,6 +1978,84 @@ bool IsRealOffline(void)
 	return real_offline;
 }
 
+/**
+ * @brief PollEngine__SetFirstSample
+ *        take the time from boot to the first successful polling
+ *
+ * @param  C_RES poll_done
+ * @return none
+ */
+static void PollEngine__SetFirstSample(C_RES poll_done)
+{
+	if ((0 != first_sample_ms) || (C_SUCCESS != poll_done))
+		return;
+
+	first_sample_ms = RTC_Get_Uptime_ms();
+	PRINTF_DEBUG("boot to first sample %u ms\n", (unsigned)first_sample_ms);
+	P_COV_LN;
+}
+
+/**
+ * @brief PollEngine__AuxValues
+ *        move the changed readings of the aux line in the values buffer,
+ *        stamped with the time of their reading. The aux line is polled
+ *        by its own task (modbus_aux_IS), the values buffer has a single
+ *        writer, the polling task
+ *
+ * @param  none
+ * @return none
+ */
+static void PollEngine__AuxValues(void)
+{
+	mb_aux_poll_val_t val;
+	C_UINT16 ali, ms;
+	C_BYTE i;
+
+	for (i = 0; i < ModbusAux__PollNum(); i++)
+	{
+		if (C_FALSE == ModbusAux__PollChanged(i, &ali, &val))
+			continue;
+
+		values_buffer[values_buffer_index].alias = ali;
+		values_buffer[values_buffer_index].value = (val.err == 0) ? (long double)val.value : 0;
+		values_buffer[values_buffer_index].info_err = val.err;
+		values_buffer[values_buffer_index].data_type = 16;		// integer
+		values_buffer[values_buffer_index].t = RTC_Mono_To_Sample_Time(val.sample_us, &ms);
+		values_buffer[values_buffer_index].ms = ms;
+		check_increment_values_buff_len(&values_buffer_index);
+		values_buffer_count++;
+		if (values_buffer_count > values_buffer_len)
+			values_buffer_count = values_buffer_len;
+		P_COV_LN;
+	}
+}
+
+/**
+ * @brief poll_stats_cycle
+ *        account the time of a polling cycle and of its compare/update pass
+ *
+ * @param  C_UINT64 start_us  start of the cycle
+ * @param  C_UINT64 diff_us   start of the compare/update pass
+ * @return none
+ */
+static void poll_stats_cycle(C_UINT64 start_us, C_UINT64 diff_us)
+{
+	C_UINT64 end_us = RTC_Get_Mono_us();
+
+	PollStats.cycle_last_us = (uint32_t)(end_us - start_us);
+	if (PollStats.cycle_last_us > PollStats.cycle_max_us)
+		PollStats.cycle_max_us = PollStats.cycle_last_us;
+
+	PollStats.diff_last_us = (uint32_t)(end_us - diff_us);
+	if (PollStats.diff_last_us > PollStats.diff_max_us)
+		PollStats.diff_max_us = PollStats.diff_last_us;
+
+	#ifdef __DEBUG_POLLING_CAREL_LEV_1
+	PRINTF_DEBUG("poll cycle %u us, tables pass %u us, arena %u/%u bytes\n", (unsigned)PollStats.cycle_last_us,
+	             (unsigned)PollStats.diff_last_us, (unsigned)PollStats.arena, (unsigned)PollStats.arena_hwm);
+	#endif
+}
+
 /**
  * @brief DoPolling_CAREL
  *        function with the timing to apply for low check and high check
@@ -1727,6 +2072,8 @@ void DoPolling_CAREL(req_set_gw_config_t * polling_times)
 	C_BYTE high_trigger = 0;
 	C_BYTE pva_trigger = 0;
 	C_BYTE relax_alarm_polling = 0;
+	C_UINT64 now_us;
+	C_UINT64 diff_us;
 
 
 	#ifdef __DEBUG_POLLING_CAREL_LEV_1
@@ -1735,18 +2082,35 @@ void DoPolling_CAREL(req_set_gw_config_t * polling_times)
 
 		mb_rw_call_execute();
 
+		PollEngine__PassModeFsm();
+
 		if(RUNNING == PollEngine_Status.engine && Mobile_GetCommandMode() == 0)
 		{
 		    SoftWDT_Reset(SWWDT_POLLING);
 
 			PollEngine_Status.polling = RUNNING;
 
-			timeout = RTC_Get_UTC_Current_Time();
+			// the aux line is polled in parallel, its changes go out
+			// with the values of the main line
+			PollEngine__AuxValues();
 
-			if(timeout > (timestamp.current_alarm) && alarm_n.total > 0) {
+			// values buffered while MQTT was not connected go out as soon as it is
+			if ((PollEngine__GetValuesBufferCount() > 0) && (MQTT_GetFlags() == 1)) {
+				MQTT_FlushValues();
+				something_sent = 1;
+				P_COV_LN;
+			}
+
+			// the scheduler runs on the monotonic clock, the NTP steps
+			// of the system clock don't skip or burst the cycles
+			now_us = RTC_Get_Mono_us();
+
+			// alarms are polled only once they can be sent, they are
+			// not buffered as the values
+			if(now_us >= timestamp.current_alarm && alarm_n.total > 0 && MQTT_GetFlags() != 0) {
 			   //ALARM POLLING
                 #ifdef __DEBUG_POLLING_CAREL_LEV_2
-	//			PRINTF_DEBUG("ALR %X\n", timeout);
+	//			PRINTF_DEBUG("ALR %u\n", (unsigned)(now_us / 1000));
                 #endif
 
 				relax_alarm_polling = (get_relax() == true ? 10 : 0);
@@ -1754,19 +2118,19 @@ void DoPolling_CAREL(req_set_gw_config_t * polling_times)
 				PRINTF_DEBUG("relax time %d \r\n", relax_alarm_polling);
 #endif
 				if((Dev_LogFile_GetSM() == LOGFILE_INIT) || (Dev_LogFile_GetSM() == LOGFILE_IDLE))
-				   timestamp.current_alarm = RTC_Get_UTC_Current_Time() + relax_alarm_polling;  // Polling allarm best effort
+				   timestamp.current_alarm = now_us + POLL_MS_TO_US(ALARM_SCAN_PERIOD_MS) + POLL_SEC_TO_US(relax_alarm_polling);  // Polling allarm best effort
 				else
-					timestamp.current_alarm = RTC_Get_UTC_Current_Time() + REDUCE_SPEED_ALARM;  // reduce the polling of alarm during download log
+					timestamp.current_alarm = now_us + POLL_SEC_TO_US(REDUCE_SPEED_ALARM);  // reduce the polling of alarm during download log
 
                 #ifdef __DEBUG_POLLING_CAREL_LEV_1
-				cronometro = RTC_Get_UTC_Current_Time();
+				cronometro = RTC_Get_Uptime_ms();
                 #endif
 
-				poll_done = DoAlarmPolling(COILAlarmPollTab, DIAlarmPollTab, HRAlarmPollTab, IRAlarmPollTab);
+				poll_done = DoAlarmPolling();
 
                 #ifdef __DEBUG_POLLING_CAREL_LEV_1
-				cronometro = RTC_Get_UTC_Current_Time() - cronometro;
-			//	PRINTF_DEBUG("ALR POLL TIME %X\n", cronometro);
+				cronometro = RTC_Get_Uptime_ms() - cronometro;
+			//	PRINTF_DEBUG("ALR POLL TIME %u ms\n", cronometro);
                 #endif
 
 				#ifdef __DEBUG_POLLING_CAREL_LEV_1
@@ -1779,21 +2143,23 @@ void DoPolling_CAREL(req_set_gw_config_t * polling_times)
 				set_relax(false);
 			}
 
-			timeout = RTC_Get_UTC_Current_Time();
+			now_us = RTC_Get_Mono_us();
 
-			if(timeout > (timestamp.current_high + polling_times->hispeedsamplevalue)   &&   high_n.total > 0) { high_trigger = 1; }
-			if(timeout > (timestamp.current_low + polling_times->lowspeedsamplevalue)   &&   low_n.total > 0) { low_trigger = 1; }
-			if(timeout > (timestamp.current_pva + Utilities__GetGWConfigData()->valuesPeriod)  &&  high_trigger == 1) { pva_trigger = 1; }
+			// the first time poll at once
+			if((0 == timestamp.current_high || (now_us - timestamp.current_high) > POLL_SEC_TO_US(polling_times->hispeedsamplevalue))   &&   high_n.total > 0) { high_trigger = 1; }
+			if((0 == timestamp.current_low || (now_us - timestamp.current_low) > POLL_SEC_TO_US(polling_times->lowspeedsamplevalue))   &&   low_n.total > 0) { low_trigger = 1; }
+			if((0 == timestamp.current_pva || (now_us - timestamp.current_pva) > POLL_SEC_TO_US(Utilities__GetGWConfigData()->valuesPeriod))  &&  high_trigger == 1) { pva_trigger = 1; }
 
 			if((high_trigger && low_trigger)) {
 
 				mb_rw_call_execute();
 
-				timestamp.current_high = timeout;
-				timestamp.current_low = timeout;
+				timestamp.current_high = now_us;
+				timestamp.current_low = now_us;
+				timestamp.sample_us = RTC_Get_Mono_us();
 				//HIGH POLLING
                 #ifdef __DEBUG_POLLING_CAREL_LEV_1
-				cronometro = RTC_Get_UTC_Current_Time();
+				cronometro = RTC_Get_Uptime_ms();
                 #endif
 
 				poll_done = DoPolling(&COILHighPollTab, &DIHighPollTab, &HRHighPollTab, &IRHighPollTab, HIGH_POLLING);
@@ -1802,16 +2168,19 @@ void DoPolling_CAREL(req_set_gw_config_t * polling_times)
 
 				poll_done = DoPolling(&COILLowPollTab, &DILowPollTab, &HRLowPollTab, &IRLowPollTab, LOW_POLLING);
 				PRINTF_DEBUG("%s COILLowPollTab poll_done = %d \n", TAG, poll_done);
+				PollEngine__SetFirstSample(poll_done);
 
                 #ifdef __DEBUG_POLLING_CAREL_LEV_1
-				cronometro = RTC_Get_UTC_Current_Time() - cronometro;
-				PRINTF_DEBUG("H+L POLL TIME %X\n", cronometro);
+				cronometro = RTC_Get_Uptime_ms() - cronometro;
+				PRINTF_DEBUG("H+L POLL TIME %u ms\n", cronometro);
                 #endif
 
 
 				SendOffline(poll_done);
+				diff_us = RTC_Get_Mono_us();
 				FlushValues(LOW_POLLING);
 				FlushValues(HIGH_POLLING);
+				poll_stats_cycle(timestamp.sample_us, diff_us);
 				if (PollEngine__GetValuesBufferCount()) {
 					MQTT_FlushValues();
 					something_sent = 1;
@@ -1825,23 +2194,27 @@ void DoPolling_CAREL(req_set_gw_config_t * polling_times)
 
 				mb_rw_call_execute();
 
-				timestamp.current_high = timeout;
+				timestamp.current_high = now_us;
+				timestamp.sample_us = RTC_Get_Mono_us();
 
                 #ifdef __DEBUG_POLLING_CAREL_LEV_1
-				cronometro = RTC_Get_UTC_Current_Time();
+				cronometro = RTC_Get_Uptime_ms();
                 #endif
 
 				poll_done = DoPolling(&COILHighPollTab, &DIHighPollTab, &HRHighPollTab, &IRHighPollTab, HIGH_POLLING);
 
                 #ifdef __DEBUG_POLLING_CAREL_LEV_1
-				cronometro = RTC_Get_UTC_Current_Time() - cronometro;
-				PRINTF_DEBUG("H POLL TIME %X\n", cronometro);
+				cronometro = RTC_Get_Uptime_ms() - cronometro;
+				PRINTF_DEBUG("H POLL TIME %u ms\n", cronometro);
                 #endif
 
 				SendOffline(poll_done);
 				PRINTF_DEBUG("%s COILHighPollTab poll_done = %d \n", TAG, poll_done);
+				PollEngine__SetFirstSample(poll_done);
 
+				diff_us = RTC_Get_Mono_us();
 				FlushValues(HIGH_POLLING);
+				poll_stats_cycle(timestamp.sample_us, diff_us);
 				if (PollEngine__GetValuesBufferCount()) {
 					MQTT_FlushValues();
 					something_sent = 1;
@@ -1851,9 +2224,9 @@ void DoPolling_CAREL(req_set_gw_config_t * polling_times)
 
 			if (pva_trigger) {
 				#ifdef __DEBUG_POLLING_CAREL_LEV_2
-				PRINTF_DEBUG("PVA %d\n", timeout);
+				PRINTF_DEBUG("PVA %u\n", (unsigned)(now_us / 1000));
 				#endif
-				timestamp.current_pva = timeout;
+				timestamp.current_pva = now_us;
 				pva_trigger = 0;
 				if(something_sent == 0) {
 				// in previous pva seconds no values message was sent, then send an empty one now
@@ -2137,6 +2510,294 @@ uint8_t PollEngine_GetEngineStatus_CAREL(void){
 	return PollEngine_Status.engine;
 }
 
+/**
+ * @brief PollEngine__PassModeEnter
+ *        called before every command of a tunnel session: the first one
+ *        stops the polling and waits for the end of the current cycle,
+ *        so that the frames of the session are not interleaved with it.
+ *        The session timer is stopped while the command runs.
+ *        If the cycle doesn't end in PASS_MODE_WAIT_IDLE_MS the session
+ *        is not started and the polling restarted as it was
+ *
+ * @param  none
+ * @return C_RES C_FAIL the command must not be executed
+ */
+C_RES PollEngine__PassModeEnter(void){
+	C_UINT32 waited = 0;
+
+	if (DEACTIVATED == PollEngine_Status.passing_mode)
+	{
+		pass_mode_resume = (RUNNING == PollEngine_Status.engine) ? 1 : 0;
+		pass_mode_deadline = 0;
+		PollEngine_StopEngine_CAREL();
+		PollEngine_Status.passing_mode = ACTIVATED;
+
+		while ((RUNNING == PollEngine_Status.polling) && (waited < PASS_MODE_WAIT_IDLE_MS))
+		{
+			Sys__Delay(10);
+			waited += 10;
+		}
+
+		if (RUNNING == PollEngine_Status.polling)
+		{
+			PollEngine_Status.passing_mode = DEACTIVATED;
+			if (pass_mode_resume)
+				PollEngine_StartEngine_CAREL();
+			PRINTF_DEBUG("%s pass mode refused, polling still running\n", TAG);
+			P_COV_LN;
+			return C_FAIL;
+		}
+
+		PRINTF_DEBUG("%s pass mode on, resume %d\n", TAG, pass_mode_resume);
+		P_COV_LN;
+	}
+	pass_mode_fsm = EXECUTE_CMD;
+	return C_SUCCESS;
+}
+
+/**
+ * @brief PollEngine__PassModeLeave
+ *        called after every command of a tunnel session, (re)starts the
+ *        timer that ends the session or ends it at once
+ *
+ * @param  C_UINT16 hold_s  polling suspended for hold_s, 0 PASS_MODE_TIMER
+ * @param  C_BOOL close     C_TRUE end the session now
+ * @return none
+ */
+void PollEngine__PassModeLeave(C_UINT16 hold_s, C_BOOL close){
+
+	if (DEACTIVATED == PollEngine_Status.passing_mode)
+		return;
+
+	if (C_TRUE == close)
+	{
+		pass_mode_fsm = DEACTIVATE_PASS_MODE;
+		return;
+	}
+
+	if (0 == hold_s)
+		hold_s = PASS_MODE_TIMER;
+	if (hold_s > PASS_MODE_MAX_HOLD_S)
+		hold_s = PASS_MODE_MAX_HOLD_S;
+	pass_mode_hold_us = POLL_SEC_TO_US(hold_s);
+
+	pass_mode_fsm = (0 == pass_mode_deadline) ? START_TIMER : RESET_TIMER;
+}
+
+/**
+ * @brief PollEngine__PassModeFsm
+ *        end the tunnel session when its timer expires, the polling is
+ *        restarted if it was running and a STOP_ENGINE didn't come meanwhile
+ *
+ * @param  none
+ * @return none
+ */
+static void PollEngine__PassModeFsm(void){
+	C_BYTE pe_status = RUNNING;
+
+	if (DEACTIVATED == PollEngine_Status.passing_mode)
+		return;
+
+	switch (pass_mode_fsm)
+	{
+		case START_TIMER:
+		case RESET_TIMER:
+			pass_mode_deadline = RTC_Get_Mono_us() + pass_mode_hold_us;
+			pass_mode_fsm = WAIT_MQTT_CMD;
+			break;
+
+		case WAIT_MQTT_CMD:
+			if (RTC_Get_Mono_us() >= pass_mode_deadline)
+				pass_mode_fsm = DEACTIVATE_PASS_MODE;
+			break;
+
+		case EXECUTE_CMD:
+			break;
+
+		case DEACTIVATE_PASS_MODE:
+		default:
+			pass_mode_deadline = 0;
+			PollEngine_Status.passing_mode = DEACTIVATED;
+			NVM__ReadU8Value(PE_STATUS_NVM, &pe_status);
+			if (pass_mode_resume && (STOPPED != pe_status))
+				PollEngine_StartEngine_CAREL();
+			PRINTF_DEBUG("%s pass mode off\n", TAG);
+			P_COV_LN;
+			break;
+	}
+}
+
+/**
+ * @brief PollEngine__GetPassMode
+ *
+ * @param  none
+ * @return uint8_t ACTIVATED during a tunnel session
+ */
+uint8_t PollEngine__GetPassMode(void){
+	return PollEngine_Status.passing_mode;
+}
+
+/*
+ * cache_mark
+ *        store a polled value in the slot of its address, if it is
+ *        in the requested range
+ */
+static void cache_mark(C_UINT16 addr, C_UINT16 value, C_UINT16 start, C_UINT16 num, C_UINT16 *dest, C_BYTE *found)
+{
+	C_UINT16 pos;
+
+	if ((addr < start) || (addr >= (C_UINT32)start + num))
+		return;
+
+	pos = addr - start;
+	dest[pos] = value;
+	found[pos >> 3] |= (C_BYTE)(1 << (pos & 7));
+}
+
+/*
+ * cache_coil_di
+ *        copy in dest the coils/DI of a table falling in the range, an
+ *        error of the last reading of one of them is returned
+ */
+static C_BYTE cache_coil_di(coil_di_poll_tables_t *tab, uint8_t n, C_UINT16 start, C_UINT16 num, C_UINT16 *dest, C_BYTE *found)
+{
+	C_BYTE err = 0;
+	uint8_t i;
+
+	for (i = 0; i < n; i++)
+	{
+		if ((tab->info[i].Addr < start) || (tab->info[i].Addr >= (C_UINT32)start + num))
+			continue;
+		cache_mark(tab->info[i].Addr, tab->c_value[i], start, num, dest, found);
+		err |= tab->error[i];
+	}
+	return err;
+}
+
+/*
+ * cache_hr_ir
+ *        copy in dest the raw registers of a table falling in the range,
+ *        32 bits values take two registers in the order of the slave
+ */
+static C_BYTE cache_hr_ir(hr_ir_poll_tables_t *tab, uint8_t n, C_UINT16 start, C_UINT16 num, C_UINT16 *dest, C_BYTE *found)
+{
+	C_BYTE err = 0;
+	hr_ir_low_high_value_t val;
+	C_UINT16 addr;
+	uint8_t i;
+
+	for (i = 0; i < n; i++)
+	{
+		addr = tab->info[i].Addr;
+		if ((addr + 1 < start) || (addr >= (C_UINT32)start + num))
+			continue;
+
+		val = tab->c_value[i];
+		if (tab->info[i].dim > 16)
+		{
+			// see save_hr_ir_value
+			if (1 == tab->info[i].flag.bit.bigendian)
+			{
+				cache_mark(addr, (C_UINT16)val.reg.high, start, num, dest, found);
+				cache_mark(addr + 1, (C_UINT16)val.reg.low, start, num, dest, found);
+			}
+			else
+			{
+				cache_mark(addr, (C_UINT16)val.reg.low, start, num, dest, found);
+				cache_mark(addr + 1, (C_UINT16)val.reg.high, start, num, dest, found);
+			}
+		}
+		else
+			cache_mark(addr, (C_UINT16)val.value, start, num, dest, found);
+
+		err |= tab->error[i];
+	}
+	return err;
+}
+
+/**
+ * @brief PollEngine__ReadCache
+ *        read the image of the last polling, without going on the bus.
+ *        HR/IR give a register for every element of dest, coils/DI
+ *        0 or 1. All the addresses must be in the model
+ *
+ * @param  RegType_t type
+ * @param  C_UINT16 start  first address
+ * @param  C_UINT16 num    up to POLL_CACHE_MAX_NUM
+ * @param  C_UINT16 *dest  num elements
+ * @return eMBException MB_EX_NONE, MB_EX_ILLEGAL_DATA_ADDRESS if an address
+ *         is not polled, MB_EX_GATEWAY_TGT_FAILED if its last reading failed,
+ *         MB_EX_GATEWAY_PATH_FAILED if there are no tables or they have been
+ *         rebuilt meanwhile. With the polling suspended (tunnel, bus requests)
+ *         the last image is served
+ */
+eMBException PollEngine__ReadCache(RegType_t type, C_UINT16 start, C_UINT16 num, C_UINT16 *dest){
+
+	C_BYTE found[(POLL_CACHE_MAX_NUM + 7) / 8] = {0};
+	C_BYTE err = 0;
+	C_UINT16 i, gen;
+	uint8_t j;
+
+	if ((num == 0) || (num > POLL_CACHE_MAX_NUM))
+		return MB_EX_ILLEGAL_DATA_VALUE;
+
+	// the tables are rebuilt by another task, discard a reading across it
+	gen = PollTablesGen;
+	if ((gen & 1) || (NULL == PollArena))
+		return MB_EX_GATEWAY_PATH_FAILED;
+
+	switch (type)
+	{
+		case COIL:
+			err |= cache_coil_di(&COILLowPollTab, low_n.coil, start, num, dest, found);
+			err |= cache_coil_di(&COILHighPollTab, high_n.coil, start, num, dest, found);
+			for (j = 0; j < alarm_n.coil; j++)
+			{
+				if ((COILAlarmPollTab[j].info.Addr < start) || (COILAlarmPollTab[j].info.Addr >= (C_UINT32)start + num))
+					continue;
+				cache_mark(COILAlarmPollTab[j].info.Addr, COILAlarmPollTab[j].data.value, start, num, dest, found);
+				err |= COILAlarmPollTab[j].data.error;
+			}
+			break;
+
+		case DI:
+			err |= cache_coil_di(&DILowPollTab, low_n.di, start, num, dest, found);
+			err |= cache_coil_di(&DIHighPollTab, high_n.di, start, num, dest, found);
+			for (j = 0; j < alarm_n.di; j++)
+			{
+				if ((DIAlarmPollTab[j].info.Addr < start) || (DIAlarmPollTab[j].info.Addr >= (C_UINT32)start + num))
+					continue;
+				cache_mark(DIAlarmPollTab[j].info.Addr, DIAlarmPollTab[j].data.value, start, num, dest, found);
+				err |= DIAlarmPollTab[j].data.error;
+			}
+			break;
+
+		case HR:
+			err |= cache_hr_ir(&HRLowPollTab, low_n.hr, start, num, dest, found);
+			err |= cache_hr_ir(&HRHighPollTab, high_n.hr, start, num, dest, found);
+			break;
+
+		case IR:
+			err |= cache_hr_ir(&IRLowPollTab, low_n.ir, start, num, dest, found);
+			err |= cache_hr_ir(&IRHighPollTab, high_n.ir, start, num, dest, found);
+			break;
+
+		default:
+			return MB_EX_ILLEGAL_FUNCTION;
+	}
+
+	if (gen != PollTablesGen)
+		return MB_EX_GATEWAY_PATH_FAILED;
+
+	for (i = 0; i < num; i++)
+	{
+		if (!(found[i >> 3] & (1 << (i & 7))))
+			return MB_EX_ILLEGAL_DATA_ADDRESS;
+	}
+
+	return (err != 0) ? MB_EX_GATEWAY_TGT_FAILED : MB_EX_NONE;
+}
+
 /**
  * @brief PollEngine_GetStatusForSending_CAREL
  *        Get the polling engine status of the engine
@@ -2207,6 +2868,47 @@ void PollEngine__ResetValuesBuffer(void){
 	memset((void*)values_buffer, 0, values_buffer_len * sizeof(values_buffer_t));
 	values_buffer_count = 0;
 	values_buffer_index = 0;
+	values_agg_count = 0;
+}
+
+/**
+ * @brief PollEngine__RebaseValuesBuffer
+ *        convert to UTC the stamps of the values taken before the NTP sync
+ *
+ * @param  none
+ * @return void
+ */
+void PollEngine__RebaseValuesBuffer(void){
+	uint16_t i;
+	C_UINT16 ms;
+
+	for(i = 0; i < values_buffer_count; i++) {
+		ms = values_buffer[i].ms;
+		values_buffer[i].t = RTC_Rebase_Sample_Time(values_buffer[i].t, &ms);
+		values_buffer[i].ms = ms;
+	}
+}
+
+/**
+ * @brief PollEngine__GetFirstSampleTime
+ *        ms from boot to the first successful polling
+ *
+ * @param  none
+ * @return C_UINT32 ms, 0 if not polled yet
+ */
+C_UINT32 PollEngine__GetFirstSampleTime(void){
+	return first_sample_ms;
+}
+
+/**
+ * @brief PollEngine__GetStats
+ *        size of the arena of the poll tables and time of the polling cycle
+ *
+ * @param  poll_stats_t *stats
+ * @return none
+ */
+void PollEngine__GetStats(poll_stats_t *stats){
+	*stats = PollStats;
 }
 
 /**
@@ -2272,6 +2974,17 @@ C_TIME Get_SamplingTime(C_UINT16 index) {
 	return values_buffer[index].t;
 }
 
+/**
+ * @brief Get_SamplingTime_ms
+ *
+ *
+ * @param  C_UINT16 index
+ * @return C_UINT16 ms of the sampling time
+ */
+C_UINT16 Get_SamplingTime_ms(C_UINT16 index) {
+	return values_buffer[index].ms;
+}
+
 /**
  * @brief Get_Alias
  *
@@ -2312,3 +3025,52 @@ C_CHAR* Get_Value(C_UINT16 index, char* value_tmp) {
 	}
 	return value_tmp;
 }
+
+/*
+ * agg_to_str
+ *		  same format of Get_Value
+ */
+static void agg_to_str(float value, uint8_t data_type, char* str)
+{
+	if(data_type != 16)
+		sprintf(str, "%.1f", value);
+	else
+		itoa((int)value, str, 10);
+}
+
+/**
+ * @brief Get_Aggregate
+ *        min/max/mean/count of an aggregate record of the values buffer
+ *
+ * @param  C_UINT16 index
+ * @param  char* min, max, mean  VAL_SIZE strings
+ * @param  C_UINT16* count
+ *
+ * @return C_BOOL C_TRUE if the record is an aggregate
+ */
+C_BOOL Get_Aggregate(C_UINT16 index, char* min, char* max, char* mean, C_UINT16* count) {
+	uint16_t j;
+
+	for(j = 0; j < values_agg_count; j++){
+		if((values_agg[j].index == index) && (values_agg[j].alias == values_buffer[index].alias))
+			break;
+	}
+	if((j == values_agg_count) || (0 != values_buffer[index].info_err))
+		return C_FALSE;
+
+	agg_to_str(values_agg[j].min, values_buffer[index].data_type, min);
+	agg_to_str(values_agg[j].max, values_buffer[index].data_type, max);
+	agg_to_str(values_agg[j].mean, values_buffer[index].data_type, mean);
+	*count = values_agg[j].count;
+	return C_TRUE;
+}
+
+/**
+ * @brief PollEngine__GetAggWindow
+ *
+ * @param  none
+ * @return C_UINT32 aggregation window (s), 0 no aggregation
+ */
+C_UINT32 PollEngine__GetAggWindow(void) {
+	return agg_window_s;
+}
@@ -58,26 +58,45 @@
  *   
  */
 #define SENSE_TRIGGER_TASK_STACK_SIZE   (1024 * 7)  //(1024 * 6)
-#define SENSE_TRIGGER_TASK_PRIO         (6)
+#define SENSE_TRIGGER_TASK_PRIO         (CONFIG_GME_POLL_TASK_PRIO)
 
 #define T_LOW_POLL	(30)   //(120)   //120
 #define TSEND		(10*60)
 #define T_HIGH_POLL	(10)   //(65)
 
+/* period of the alarm scan (ms), the scheduler runs on the monotonic
+   clock so it can be shorter than 1 s (ie. 250) */
+#define ALARM_SCAN_PERIOD_MS	(1000)
+
+/* the alarms are read in blocks of near addresses: max span of a block
+   and max hole between two alarms of the same block (coils/DI in bits,
+   HR/IR in registers). The holes are read too, they cost less than
+   the turnaround of another request */
+#define ALARM_BLOCK_MAX_BITS	(256)
+#define ALARM_BLOCK_MAX_GAP_BITS	(64)
+#define ALARM_BLOCK_MAX_REGS	(32)
+#define ALARM_BLOCK_MAX_GAP_REGS	(8)
+
+/* edge aggregation: the HR/IR variables with the aggregate model flag
+   (or all the analog ones of the high polling with POLL_AGG_ALL_HIGH)
+   are not sent at every change but once per window, the value of the
+   record is the one chosen by the policy, min/max/mean/count are sent
+   aside ("agg" of the values message). Window and policy are the
+   "agt" and "agf" of SET_GW_CONFIG, window 0 disables it */
+#define POLL_AGG_LAST			0x00	// value of the record
+#define POLL_AGG_MEAN			0x01
+#define POLL_AGG_MIN			0x02
+#define POLL_AGG_MAX			0x03
+#define POLL_AGG_VALUE_MASK		0x03
+#define POLL_AGG_ALL_HIGH		0x80	// all the analog variables of the high polling
+
+/* max aggregate records waiting for the values message, when full
+   the records are sent with their value only */
+#define POLL_AGG_OUT_LEN		(64)
+
 #define SINGLE    	0
 #define MULTI    	1
 
-//Register: Coil and DI low polling and high polling
-#pragma pack(1)
-typedef struct coil_di_low_high_s{
-	r_coil_di		 	info;
-	uint8_t 			c_value:1;
-	uint8_t 			p_value:1;
-	uint8_t				error:3;
-	uint8_t				p_error:3;
-}coil_di_low_high_t;
-#pragma pack()
-
 // usefull to write a Holding regiaster via modbus
 #pragma pack(1)
 typedef union Data{
@@ -102,13 +121,15 @@ typedef union Data_Int{
 
 
 //Table: Coil and DI low polling and high polling tables
-#pragma pack(1)
+//structure of arrays, the hot arrays (values and errors) are touched
+//every cycle, info is the model record. All live in the poll arena
 typedef struct coil_di_poll_tables_s{
-	coil_di_low_high_t 	*reg;
-	//uint32_t 			cur_time_stamp;
-	//uint32_t			prev_time_stamp;
+	uint8_t				*c_value;
+	uint8_t				*p_value;
+	uint8_t				*error;
+	uint8_t				*p_error;
+	r_coil_di			*info;
 }coil_di_poll_tables_t;
-#pragma pack()
 
 
 //Register: Coil and DI alarm polling tables
@@ -116,10 +137,11 @@ typedef struct coil_di_poll_tables_s{
 typedef struct alarm_read_s{
 	uint32_t	start_time;
 	uint32_t	stop_time;
+	uint16_t	start_ms;
+	uint16_t	stop_ms;
 	uint8_t 	value:1;
 	uint8_t		error:3;
-	uint8_t 	send_flag:1;
-	uint8_t 	dummy:3;
+	uint8_t 	dummy:4;
 }alarm_read_t;
 #pragma pack()
 
@@ -172,24 +194,49 @@ typedef struct hr_ir_low_high_poll_s{
 #pragma pack()
 
 //struct for HR and IR low polling and high polling tables
-#pragma pack(1)
+//structure of arrays as coil_di_poll_tables_t, hr_ir_low_high_poll_t
+//is only the view of a single register
 typedef struct hr_ir_poll_tables_s{
-	hr_ir_low_high_poll_t 	*tab;
-
-	//uint32_t 				cur_time_stamp;
-	//uint32_t				prev_time_stamp;
+	hr_ir_low_high_value_t	*c_value;
+	hr_ir_low_high_value_t	*p_value;
+	uint8_t					*error;
+	uint8_t					*p_error;
+	r_hr_ir					*info;
+	uint8_t					*read_type;		// hr_ir_read_type_t
+	struct poll_agg_s		*agg;			// NULL if no aggregation
+	uint64_t				agg_end_us;		// end of the aggregation window
 }hr_ir_poll_tables_t;
-#pragma pack()
+
+//running aggregate of a variable over the window
+typedef struct poll_agg_s{
+	float		min;
+	float		max;
+	float		last;
+	float		sum;
+	uint16_t	count;
+	uint8_t		on;				// the variable is aggregated
+}poll_agg_t;
+
+//min/max/mean of an aggregate record of the values buffer
+typedef struct values_agg_s{
+	uint16_t	index;			// in the values buffer
+	uint16_t	alias;
+	float		min;
+	float		max;
+	float		mean;
+	uint16_t	count;
+}values_agg_t;
 
 //struct for HR and IR alarm polling
 #pragma pack(1)
 typedef struct hr_ir_alarm_s{
 	uint32_t	start_time;
 	uint32_t	stop_time;
+	uint16_t	start_ms;
+	uint16_t	stop_ms;
 	uint8_t 	value:1;
 	uint8_t		error:3;
-	uint8_t 	send_flag:1;
-	uint8_t 	dummy:3;
+	uint8_t 	dummy:4;
 }hr_ir_alarm_t;
 #pragma pack()
 
@@ -201,6 +248,17 @@ typedef struct hr_ir_alarm_tables_s{
 }hr_ir_alarm_tables_t;
 #pragma pack()
 
+//block of alarms of the same type read with a single request, its
+//alarms are alarm_order[first .. first + count - 1]
+typedef struct alarm_block_s{
+	uint16_t	start;			// first coil/register read
+	uint16_t	num;			// coils/registers read
+	uint16_t	first;
+	uint16_t	count;
+	uint8_t		type;			// RegType_t
+	uint8_t		split;			// the device refused the block, read one by one
+}alarm_block_t;
+
 #pragma pack(1)
 typedef struct poll_req_num_s{
 	uint8_t coil;
@@ -213,6 +271,16 @@ typedef struct poll_req_num_s{
 
 
 
+// memory and timing of the poll tables, see PollEngine__GetStats
+typedef struct poll_stats_s{
+	uint32_t	arena;			// bytes of the arena of the model in use
+	uint32_t	arena_hwm;		// max bytes of the arena since boot
+	uint32_t	cycle_last_us;	// last high (+low) polling, Modbus included
+	uint32_t	cycle_max_us;
+	uint32_t	diff_last_us;	// last compare/update pass of the tables
+	uint32_t	diff_max_us;
+}poll_stats_t;
+
 #pragma pack(1)
 typedef struct mb_param_char_s{
 	char p_ch[6];
@@ -220,11 +288,13 @@ typedef struct mb_param_char_s{
 #pragma pack()
 
 #pragma pack(1)
+// times of the monotonic clock (us), 0 = never done
 typedef struct sampling_tstamp{
-	uint32_t current_alarm;
-	uint32_t current_high;
-	uint32_t current_low;
-	uint32_t current_pva;
+	uint64_t current_alarm;		// next alarm scan
+	uint64_t current_high;
+	uint64_t current_low;
+	uint64_t current_pva;
+	uint64_t sample_us;			// time of the high polling, stamp of the values
 }sampling_tstamp_t;
 #pragma pack()
 
@@ -236,6 +306,7 @@ typedef struct values_buffer_s{
 	uint8_t		info_err;
 	uint8_t     data_type;
 	uint32_t 	t;
+	uint16_t	ms;
 }values_buffer_t;
 #pragma pack()
 
@@ -314,6 +385,16 @@ typedef struct poll_engine_flags_s{
 }poll_engine_flags_t;
 #pragma pack()
 
+/* the polling stays suspended for PASS_MODE_TIMER s (gme_config.h) after
+   the last command of a tunnel session, or for the hold the cloud asks,
+   up to PASS_MODE_MAX_HOLD_S */
+#define PASS_MODE_MAX_HOLD_S		(600)
+/* max wait for the current polling cycle to end before a session starts */
+#define PASS_MODE_WAIT_IDLE_MS		(2000)
+
+/* max elements of a PollEngine__ReadCache, the coils of a modbus read */
+#define POLL_CACHE_MAX_NUM			(2000)
+
 #pragma pack(1)
 typedef struct passing_mode_Param_s{
 	uint8_t cmd_received;
@@ -338,6 +419,12 @@ uint8_t PollEngine_GetEngineStatus_CAREL(void);
 uint8_t PollEngine_GetPollingStatus_CAREL(void);
 uint8_t PollEngine_GetStatusForSending_CAREL(void);
 
+C_RES PollEngine__PassModeEnter(void);
+void PollEngine__PassModeLeave(C_UINT16 hold_s, C_BOOL close);
+uint8_t PollEngine__GetPassMode(void);
+
+eMBException PollEngine__ReadCache(RegType_t type, C_UINT16 start, C_UINT16 num, C_UINT16 *dest);
+
 C_RES PollEngine__Read_HR_IR_Req(C_UINT16 func, C_UINT16 addr,C_BYTE dim , C_UINT16* read_value);
 C_RES PollEngine__Read_COIL_DI_Req(C_UINT16 func, C_UINT16 addr, C_UINT16* read_value);
 C_RES PollEngine__Write_COIL_Req(uint16_t write_value, uint16_t addr, C_UINT16 fun);
@@ -347,6 +434,9 @@ C_RES PollEngine__Write_HR_Req_Int(C_INT32 write_value, uint16_t addr, C_CHAR nu
 values_buffer_t* PollEngine__GetValuesBuffer(void);
 uint16_t PollEngine__GetValuesBufferCount(void);
 void PollEngine__ResetValuesBuffer(void);
+void PollEngine__RebaseValuesBuffer(void);
+C_UINT32 PollEngine__GetFirstSampleTime(void);
+void PollEngine__GetStats(poll_stats_t *stats);
 uint32_t PollEngine__GetMBBaudrate(void);
 
 float get_type_a(hr_ir_low_high_poll_t *arr, uint8_t read_kind);
@@ -382,10 +472,11 @@ void PollEngine__ReadBaudRateFromNVM(void);
 bool IsOffline(void);
 bool IsRealOffline(void);
 
-#define MB_RESPONSE_TIMEOUT(size) pdMS_TO_TICKS(30 + (2 * ((size << 1) + 8) * 11 * 1000 / PollEngine__GetMBBaudrate()))
-
 C_TIME Get_SamplingTime(C_UINT16 index);
+C_UINT16 Get_SamplingTime_ms(C_UINT16 index);
 C_CHAR* Get_Alias(C_UINT16 index, char* alias);
 C_CHAR* Get_Value(C_UINT16 index, char* value);
+C_BOOL Get_Aggregate(C_UINT16 index, char* min, char* max, char* mean, C_UINT16* count);
+C_UINT32 PollEngine__GetAggWindow(void);
 
 #endif
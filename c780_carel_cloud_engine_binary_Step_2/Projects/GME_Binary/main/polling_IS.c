@@ -21,13 +21,14 @@
 #include "polling_IS.h"
 #include "utilities_CAREL.h"
 #include "sys_IS.h"
+#include "gme_config.h"
 
 #include "SoftWDT.h"
 
 #include "filelog_CAREL.h"
 
 #ifdef INCLUDE_PLATFORM_DEPENDENT
-static xTaskHandle xPollingEngine;
+static xTaskHandle xPollingEngine = NULL;
 #endif
 
 /**
@@ -89,11 +90,27 @@ void Polling_Engine_Init_IS(void)
 void PollEngine_MBStart_IS(void){
    #ifdef INCLUDE_PLATFORM_DEPENDENT
 
-   xTaskCreate(&Polling_Engine_Init_IS, "Poll_engine_init",SENSE_TRIGGER_TASK_STACK_SIZE, NULL, SENSE_TRIGGER_TASK_PRIO, &xPollingEngine);
+   xTaskCreatePinnedToCore(&Polling_Engine_Init_IS, "Poll_engine_init",SENSE_TRIGGER_TASK_STACK_SIZE, NULL, SENSE_TRIGGER_TASK_PRIO, &xPollingEngine, GME_ACQ_CORE);
 
    #endif
 }
 
+/**
+ * @brief PollEngine_MBStarted_IS
+ *        tell if the polling task has been created, from then on
+ *        the polling tables are in use
+ *
+ * @param  none
+ * @return C_BOOL C_TRUE/C_FALSE
+ */
+C_BOOL PollEngine_MBStarted_IS(void){
+#ifdef INCLUDE_PLATFORM_DEPENDENT
+	return (xPollingEngine != NULL) ? C_TRUE : C_FALSE;
+#else
+	return C_FALSE;
+#endif
+}
+
 /**
  * @brief PollEngine_MBResume_IS
  *        resume the task  Polling_Engine
@@ -8,10 +8,14 @@
 #ifndef _POLLING_IS_H_
 #define _POLLING_IS_H_
 
+#include "data_types_CAREL.h"
+
 void PollEngine_MBResume_IS(void);
 
 void PollEngine_MBSuspend_IS(void);
 
 void PollEngine_MBStart_IS(void);
 
+C_BOOL PollEngine_MBStarted_IS(void);
+
 #endif
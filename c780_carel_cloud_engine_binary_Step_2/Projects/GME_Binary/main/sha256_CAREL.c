@@ -0,0 +1,37 @@
+/**
+ * @file   sha256_CAREL.c
+ * @author carel
+ * @date   18 Oct 2026
+ * @brief  checks of the sha-256 digests that the cloud gives in hex
+ */
+
+#include <ctype.h>
+#include <string.h>
+
+#include "sha256_CAREL.h"
+
+/**
+ * @brief Sha256__MatchHex
+ *        compare a sha-256 with the expected one in hex, upper or
+ *        lower case digits
+ *
+ * @param const C_BYTE *digest  SHA256_DIGEST_LEN bytes
+ * @param const C_CHAR *sha  2 * SHA256_DIGEST_LEN hex digits
+ *
+ * @return C_SUCCESS/C_FAIL
+ */
+C_RES Sha256__MatchHex(const C_BYTE *digest, const C_CHAR *sha)
+{
+	static const C_CHAR hex[] = "0123456789abcdef";
+	C_BYTE i;
+
+	if (strlen(sha) != 2 * SHA256_DIGEST_LEN)
+		return C_FAIL;
+
+	for (i = 0; i < SHA256_DIGEST_LEN; i++)
+	{
+		if ((tolower((int)sha[2 * i]) != hex[digest[i] >> 4]) || (tolower((int)sha[2 * i + 1]) != hex[digest[i] & 0x0F]))
+			return C_FAIL;
+	}
+	return C_SUCCESS;
+}
@@ -0,0 +1,22 @@
+/**
+ * @file   sha256_CAREL.h
+ * @author carel
+ * @date   18 Oct 2026
+ * @brief  checks of the sha-256 digests that the cloud gives in hex
+ *         (downloaded files, firmware images)
+ */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __SHA256_CAREL_H
+#define __SHA256_CAREL_H
+
+/* ==== Include ==== */
+#include "data_types_CAREL.h"
+
+/* ==== Define ==== */
+#define SHA256_DIGEST_LEN		32
+
+/* ==== Function prototype ==== */
+C_RES Sha256__MatchHex(const C_BYTE *digest, const C_CHAR *sha);
+
+#endif  /* __SHA256_CAREL_H */
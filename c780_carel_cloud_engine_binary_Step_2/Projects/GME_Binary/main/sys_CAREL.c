@@ -13,6 +13,7 @@
 #include "common.h"
 
 #include "nvm_IS.h"
+#include "nvm_CAREL.h"
 
 static char certificates[CERT_MAX_NUMBER][CERT_MAX_SIZE] = {0};
 
@@ -36,6 +37,9 @@ C_RES Sys__Init (void)
         return C_FAIL;
     }
 
+    // from now on the configuration is read from RAM
+    NVM__CacheLoad();
+
     if (C_SUCCESS != File_System_Init()){
     	PRINTF_DEBUG_SYS("SPIFFS PROBLEM\n");
     	P_COV_LN;
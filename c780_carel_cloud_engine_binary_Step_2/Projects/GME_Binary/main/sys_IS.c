@@ -32,10 +32,14 @@
   #include "esp_console.h"
   #include "linenoise/linenoise.h"
   #include "esp_vfs_dev.h"
+  #include "cmd_system.h"
+  #include "telemetry_IS.h"
 #endif
 #endif
 #include "Led_Manager_IS.h"
 
+static int button_state = BUTTON_WAIT;
+
  /**
  * @brief Sys_ResetCheck
  *      test the button for system reset   
@@ -50,7 +54,6 @@ void Sys__ResetCheck(void){
 
 	static C_TIME TimerForButton = 0;
 	C_TIME CurrentTime = 0;
-	static int button_state = BUTTON_WAIT;
 
 	switch(button_state){
 		case BUTTON_WAIT:
@@ -150,6 +153,17 @@ void Sys__ResetCheck(void){
 	return;
 }
 
+/**
+* @brief Sys__GetButtonState
+*      return the state of the reset/factory button sequence
+*
+* @param  none
+* @return C_BYTE BUTTON_WAIT when no sequence is in progress
+*/
+C_BYTE Sys__GetButtonState(void){
+	return (C_BYTE)button_state;
+}
+
 /**
 * @brief Sys__GetFreeHeapSize
 *      this function call  esp_get_free_heap_size(),
@@ -251,6 +265,10 @@ void Sys__ConsoleInit(void){
 
 	// Set command history size
 	linenoiseHistorySetMaxLen(100);
+
+	// local commands, everything else goes to the modem
+	register_system();
+	register_telemetry(&Telemetry__ConsoleCmd);
 }
 
 const char* prompt = "> ";		// Prompt to be printed before each line
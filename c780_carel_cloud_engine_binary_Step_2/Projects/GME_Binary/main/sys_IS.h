@@ -28,6 +28,7 @@
 #define	BUTTON_WAITFACTORY	 	5
 
 void Sys__ResetCheck(void);
+C_BYTE Sys__GetButtonState(void);
 C_UINT32 Sys__GetFreeHeapSize(void);
 C_UINT32 Sys__GetTaskHighWaterMark(void);
 void Sys__Delay(C_UINT32 delay);
@@ -0,0 +1,202 @@
+/**
+ * @file   telemetry_IS.c
+ * @author carel
+ * @date   18 Oct 2026
+ * @brief  runtime telemetry of the tasks and of the heap, sampled
+ *         every TELEMETRY_PERIOD_SEC by the main task and reported in
+ *         the status payload and on the console
+ *
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "CAREL_GLOBAL_DEF.h"
+#include "telemetry_IS.h"
+
+#ifdef INCLUDE_PLATFORM_DEPENDENT
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_heap_caps.h"
+#include "esp_timer.h"
+#endif
+
+static telemetry_task_t tlm_tasks[TELEMETRY_MAX_TASKS];
+static C_BYTE tlm_tasks_num = 0;
+
+#ifdef INCLUDE_PLATFORM_DEPENDENT
+#if (configUSE_TRACE_FACILITY == 1)
+static TaskStatus_t tlm_status[TELEMETRY_MAX_TASKS];
+
+#if (configGENERATE_RUN_TIME_STATS == 1)
+// run time counters of the previous sample, the tasks are matched
+// by their number because the order of the list is not fixed
+typedef struct tlm_prev_s{
+	UBaseType_t number;
+	uint32_t counter;
+}tlm_prev_t;
+
+static tlm_prev_t tlm_prev[TELEMETRY_MAX_TASKS];
+static C_BYTE tlm_prev_num = 0;
+static uint32_t tlm_prev_total = 0;
+#endif
+#endif
+#endif
+
+
+/**
+ * @brief Telemetry__Periodic
+ *        take a sample every TELEMETRY_PERIOD_SEC, the first call
+ *        only sets the base of the cpu load
+ *
+ * @param  none
+ * @return none
+ */
+void Telemetry__Periodic(void)
+{
+#ifdef INCLUDE_PLATFORM_DEPENDENT
+	static int64_t last_us = 0;
+	int64_t now_us = esp_timer_get_time();
+
+	if ((last_us != 0) && ((now_us - last_us) < ((int64_t)TELEMETRY_PERIOD_SEC * 1000000)))
+		return;
+
+	last_us = now_us;
+	Telemetry__Sample();
+#endif
+}
+
+/**
+ * @brief Telemetry__Sample
+ *        read the state of all the tasks, the cpu load is computed on
+ *        the time elapsed from the previous sample
+ *
+ * @param  none
+ * @return none
+ */
+void Telemetry__Sample(void)
+{
+#ifdef INCLUDE_PLATFORM_DEPENDENT
+#if (configUSE_TRACE_FACILITY == 1)
+	UBaseType_t num, i;
+	uint32_t total = 0;
+
+	num = uxTaskGetSystemState(tlm_status, TELEMETRY_MAX_TASKS, &total);
+	if (num == 0)
+	{
+		PRINTF_DEBUG("telemetry more than %d tasks\n", TELEMETRY_MAX_TASKS);
+		P_COV_LN;
+		return;
+	}
+
+#if (configGENERATE_RUN_TIME_STATS == 1)
+	// every core counts the run time, the per mille is on all the cores
+	uint64_t elapsed = (uint64_t)(total - tlm_prev_total) * portNUM_PROCESSORS;
+	UBaseType_t j;
+#endif
+
+	for (i = 0; i < num; i++)
+	{
+		telemetry_task_t *task = &tlm_tasks[i];
+
+		strncpy(task->name, tlm_status[i].pcTaskName, TELEMETRY_NAME_LEN - 1);
+		task->name[TELEMETRY_NAME_LEN - 1] = '\0';
+		task->hwm = (C_UINT16)tlm_status[i].usStackHighWaterMark;
+		task->cpu = 0;
+
+#if (configGENERATE_RUN_TIME_STATS == 1)
+		// a task created after the previous sample has no load yet
+		for (j = 0; (j < tlm_prev_num) && (elapsed > 0); j++)
+		{
+			if (tlm_prev[j].number == tlm_status[i].xTaskNumber)
+			{
+				uint64_t cpu = ((uint64_t)(tlm_status[i].ulRunTimeCounter - tlm_prev[j].counter) * 1000) / elapsed;
+				task->cpu = (C_UINT16)((cpu > 1000) ? 1000 : cpu);
+				break;
+			}
+		}
+#endif
+	}
+
+#if (configGENERATE_RUN_TIME_STATS == 1)
+	for (i = 0; i < num; i++)
+	{
+		tlm_prev[i].number = tlm_status[i].xTaskNumber;
+		tlm_prev[i].counter = tlm_status[i].ulRunTimeCounter;
+	}
+	tlm_prev_num = (C_BYTE)num;
+	tlm_prev_total = total;
+#endif
+
+	tlm_tasks_num = (C_BYTE)num;
+	P_COV_LN;
+#endif
+#endif
+}
+
+/**
+ * @brief Telemetry__GetTasks
+ *        return the tasks of the last sample
+ *
+ * @param  const telemetry_task_t **tasks
+ * @return C_BYTE number of tasks, 0 if not available
+ */
+C_BYTE Telemetry__GetTasks(const telemetry_task_t **tasks)
+{
+	*tasks = tlm_tasks;
+	return tlm_tasks_num;
+}
+
+/**
+ * @brief Telemetry__GetHeap
+ *        read the current state of the heap, the largest free block
+ *        much lower than the free memory points out a fragmentation
+ *
+ * @param  telemetry_heap_t *heap
+ * @return none
+ */
+void Telemetry__GetHeap(telemetry_heap_t *heap)
+{
+	memset((void*)heap, 0, sizeof(telemetry_heap_t));
+#ifdef INCLUDE_PLATFORM_DEPENDENT
+	heap->free = heap_caps_get_free_size(MALLOC_CAP_8BIT);
+	heap->min_free = heap_caps_get_minimum_free_size(MALLOC_CAP_8BIT);
+	heap->largest = heap_caps_get_largest_free_block(MALLOC_CAP_8BIT);
+#endif
+}
+
+/**
+ * @brief Telemetry__Print
+ *        print the heap and the last sample of the tasks
+ *
+ * @param  none
+ * @return none
+ */
+void Telemetry__Print(void)
+{
+	telemetry_heap_t heap;
+	C_BYTE i;
+
+	Telemetry__GetHeap(&heap);
+	printf("heap free %u min %u largest %u\r\n", (unsigned)heap.free, (unsigned)heap.min_free, (unsigned)heap.largest);
+
+	printf("%-16s %6s %6s\r\n", "task", "cpu%", "hwm");
+	for (i = 0; i < tlm_tasks_num; i++)
+	{
+		printf("%-16s %4u.%u %6u\r\n", tlm_tasks[i].name,
+				tlm_tasks[i].cpu / 10, tlm_tasks[i].cpu % 10, tlm_tasks[i].hwm);
+	}
+}
+
+/**
+ * @brief Telemetry__ConsoleCmd
+ *        handler of the "telemetry" console command
+ *
+ * @param  int argc
+ * @param  char **argv
+ * @return int 0
+ */
+int Telemetry__ConsoleCmd(int argc, char **argv)
+{
+	Telemetry__Print();
+	return 0;
+}
@@ -0,0 +1,55 @@
+/**
+ * @file   telemetry_IS.h
+ * @author carel
+ * @date   18 Oct 2026
+ * @brief  runtime telemetry: cpu load and stack high water mark of every
+ *         task, heap free / minimum ever / largest free block.
+ *         The cpu load requires CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS,
+ *         the task list CONFIG_FREERTOS_USE_TRACE_FACILITY
+ *
+ */
+
+#ifndef TELEMETRY_IS_H_
+#define TELEMETRY_IS_H_
+
+#include "data_types_CAREL.h"
+
+/* ==== Define customizable ==== */
+
+/* sampling period of the telemetry (seconds) */
+#define TELEMETRY_PERIOD_SEC	60
+
+/* max number of tasks followed, if more tasks are running the
+   sample is skipped */
+#define TELEMETRY_MAX_TASKS		24
+
+#define TELEMETRY_NAME_LEN		16
+
+/* ==== Types ==== */
+
+/**
+ * @brief telemetry_task_t
+ *        cpu is the per mille of the cpu time (of all the cores) used
+ *        in the last period, hwm the minimum free stack ever in bytes
+ */
+typedef struct telemetry_task_s{
+	C_CHAR   name[TELEMETRY_NAME_LEN];
+	C_UINT16 cpu;
+	C_UINT16 hwm;
+}telemetry_task_t;
+
+typedef struct telemetry_heap_s{
+	C_UINT32 free;
+	C_UINT32 min_free;
+	C_UINT32 largest;
+}telemetry_heap_t;
+
+/* ==== Function prototype ==== */
+void Telemetry__Periodic(void);
+void Telemetry__Sample(void);
+C_BYTE Telemetry__GetTasks(const telemetry_task_t **tasks);
+void Telemetry__GetHeap(telemetry_heap_t *heap);
+void Telemetry__Print(void);
+int Telemetry__ConsoleCmd(int argc, char **argv);
+
+#endif /* TELEMETRY_IS_H_ */
@@ -11,6 +11,7 @@
 #include "nvm_CAREL.h"
 #include "utilities_CAREL.h"
 #include "polling_CAREL.h"
+#include "polling_IS.h"
 #include "modbus_IS.h"
 #include "gme_config.h"
 #include "Led_Manager_IS.h"
@@ -147,7 +148,11 @@ void Utilities__Init(void){
 	Modbus__ReadAddressFromNVM();
 	Modbus__ReadDelayFromNVM();
 	CBOR_ReadDidFromNVM();
-	BinaryModel_Init();
+
+	// the polling can start before the radio and MQTT, from then on the
+	// tables built from the model are in use and must not be rebuilt
+	if (C_FALSE == PollEngine_MBStarted_IS())
+		BinaryModel_Init();
 
 	Utilities__ReadPNFromNVM();
 
@@ -15,6 +15,10 @@
 #include "esp_wps.h"
 #include "lwip/inet.h"
 #include "IO_Port_IS.h"
+#include "main_CAREL.h"
+#include "main_IS.h"
+#include "esp_timer.h"
+#include "esp32/rom/crc.h"
 
 static const char *TAG = "wifi";
 
@@ -79,6 +83,165 @@ char* GetAvailableAPs(uint8_t index){
 static C_INT32 TimerForAPConnection = 0;
 static uint16_t connect_attempt = 0;
 
+/**
+ * @brief wifi_last_ap_t
+ *        AP of the last connection, saved in NVM so that the next one
+ *        (also after a reboot) goes directly to its BSSID and channel.
+ *        The DHCP lease is kept by lwip (LWIP_DHCP_RESTORE_LAST_IP)
+ */
+typedef struct wifi_last_ap_s{
+	C_UINT32 ssid_crc;
+	C_BYTE bssid[6];
+	C_BYTE channel;
+	C_BYTE dummy;
+}wifi_last_ap_t;
+
+static wifi_last_ap_t wifi_last_ap;
+static C_BYTE wifi_last_ap_valid = 0;
+static C_BYTE wifi_last_ap_dirty = 0;
+static C_BYTE wifi_directed = 0;
+static C_BYTE fast_attempt = 0;
+
+static int64_t wifi_down_us = 0;
+static wifi_reconnect_stats_t wifi_rc_stats;
+
+#ifndef GW_GSM_WIFI
+static esp_timer_handle_t wifi_scan_timer = NULL;
+#endif
+
+/**
+ * @brief wifi_set_directed
+ *        set/clear the BSSID and the channel of the last AP in the station
+ *        config, without them the connect does a full scan
+ *
+ * @param  C_BOOL on
+ * @return none
+ */
+static void wifi_set_directed(C_BOOL on)
+{
+	wifi_config_t cfg;
+
+	if (ESP_OK != esp_wifi_get_config(ESP_IF_WIFI_STA, &cfg))
+		return;
+
+	if (on)
+	{
+		cfg.sta.bssid_set = true;
+		memcpy(cfg.sta.bssid, wifi_last_ap.bssid, sizeof(cfg.sta.bssid));
+		cfg.sta.channel = wifi_last_ap.channel;
+	}
+	else
+	{
+		cfg.sta.bssid_set = false;
+		cfg.sta.channel = 0;
+	}
+
+	if (ESP_OK == esp_wifi_set_config(ESP_IF_WIFI_STA, &cfg))
+		wifi_directed = on;
+}
+
+/**
+ * @brief wifi_connect
+ *        the first WIFI_FAST_RETRY attempts go to the last AP,
+ *        the next ones scan all the channels
+ *
+ * @param  none
+ * @return none
+ */
+static void wifi_connect(void)
+{
+	if (wifi_last_ap_valid && (fast_attempt < WIFI_FAST_RETRY))
+	{
+		if (!wifi_directed)
+			wifi_set_directed(C_TRUE);
+		fast_attempt++;
+	}
+	else if (wifi_directed)
+	{
+		PRINTF_DEBUG("last AP not found, full scan\n");
+		wifi_set_directed(C_FALSE);
+		wifi_rc_stats.fallback++;
+	}
+
+	ESP_ERROR_CHECK(esp_wifi_connect());
+}
+
+/**
+ * @brief wifi_last_ap_load
+ *        read the last AP from NVM, it is used only if it was saved
+ *        for the same SSID
+ *
+ * @param  const char* ssid
+ * @return none
+ */
+static void wifi_last_ap_load(const char* ssid)
+{
+	size_t len = sizeof(wifi_last_ap_t);
+
+	wifi_last_ap_valid = 0;
+	if ((C_SUCCESS == NVM__ReadBlob(WIFI_LAST_AP_NVM, (void*)&wifi_last_ap, &len)) &&
+		(len == sizeof(wifi_last_ap_t)) &&
+		(wifi_last_ap.ssid_crc == crc32_le(0, (const uint8_t*)ssid, strlen(ssid))) &&
+		(wifi_last_ap.channel >= 1) && (wifi_last_ap.channel <= 14))
+	{
+		wifi_last_ap_valid = 1;
+		P_COV_LN;
+	}
+}
+
+/**
+ * @brief wifi_last_ap_update
+ *        take the AP just connected, it is written in NVM by
+ *        WiFi__SaveLastAP only if it changed
+ *
+ * @param  none
+ * @return none
+ */
+static void wifi_last_ap_update(void)
+{
+	wifi_ap_record_t ap;
+	C_UINT32 ssid_crc;
+
+	if (ESP_OK != esp_wifi_sta_get_ap_info(&ap))
+		return;
+
+	ssid_crc = crc32_le(0, (const uint8_t*)ap.ssid, strlen((const char*)ap.ssid));
+
+	if (!wifi_last_ap_valid || (wifi_last_ap.ssid_crc != ssid_crc) ||
+		(wifi_last_ap.channel != ap.primary) || memcmp(wifi_last_ap.bssid, ap.bssid, sizeof(ap.bssid)))
+	{
+		wifi_last_ap.ssid_crc = ssid_crc;
+		memcpy(wifi_last_ap.bssid, ap.bssid, sizeof(ap.bssid));
+		wifi_last_ap.channel = ap.primary;
+		wifi_last_ap.dummy = 0;
+		wifi_last_ap_valid = 1;
+		wifi_last_ap_dirty = 1;
+	}
+}
+
+#ifndef GW_GSM_WIFI
+/**
+ * @brief wifi_scan_timer_cb
+ *        start the scan of the AP list, the result arrives
+ *        with SYSTEM_EVENT_SCAN_DONE
+ *
+ * @param  void *arg
+ * @return none
+ */
+static void wifi_scan_timer_cb(void *arg)
+{
+	wifi_scan_config_t scanConf = {
+		.ssid = NULL,
+		.bssid = NULL,
+		.channel = 0,
+		.show_hidden = true
+	};
+
+	if (ESP_OK != esp_wifi_scan_start(&scanConf, false))
+		PRINTF_DEBUG("AP list scan not started\n");
+}
+#endif
+
 /**
  * @brief event_handler
  *        manage the access point event
@@ -106,19 +269,22 @@ static esp_err_t event_handler(void *ctx, system_event_t *event)
 					MAC2STR(event->event_info.sta_connected.mac),
 					event->event_info.sta_connected.aid);
 
-			PRINTF_DEBUG("wait for some time before scanning\n");
-			Sys__Delay(3000);
 			connect_attempt = 21;
 
-			// Let us test a WiFi scan ...
-			wifi_scan_config_t scanConf = {
-				.ssid = NULL,
-				.bssid = NULL,
-				.channel = 0,
-				.show_hidden = true
-			};
-			ESP_ERROR_CHECK(esp_wifi_scan_start(&scanConf, true));	//The true parameter cause the function to block until
-																	//the scan is done.
+			// scan in background after a while, the event task is not blocked
+			if (wifi_scan_timer == NULL)
+			{
+				esp_timer_create_args_t scan_timer_args = {
+					.callback = wifi_scan_timer_cb,
+					.name = "ap_scan"
+				};
+				esp_timer_create(&scan_timer_args, &wifi_scan_timer);
+			}
+			if (wifi_scan_timer != NULL)
+			{
+				esp_timer_stop(wifi_scan_timer);
+				esp_timer_start_once(wifi_scan_timer, WIFI_AP_SCAN_DELAY_MS * 1000);
+			}
 
 #endif
 		break;
@@ -133,8 +299,9 @@ static esp_err_t event_handler(void *ctx, system_event_t *event)
 					event->event_info.sta_disconnected.aid);
 			if(WIFI__GetSTAStatus() == DISCONNECTED){
 				connect_attempt = 0;
+				fast_attempt = 0;
 				StartTimerForAPConnection();
-				ESP_ERROR_CHECK(esp_wifi_connect());
+				wifi_connect();
 			}
 #endif
 		break;
@@ -154,11 +321,16 @@ static esp_err_t event_handler(void *ctx, system_event_t *event)
 			wifi_config_t wifi_config_STA;
 			ESP_ERROR_CHECK(esp_wifi_get_config(ESP_IF_WIFI_STA, &wifi_config_STA));
 			if(wifi_config_STA.ap.ssid[0] != '\0') // only attempt to connect if a ssid is specified
-				ESP_ERROR_CHECK(esp_wifi_connect());
+			{
+				wifi_down_us = esp_timer_get_time();
+				wifi_connect();
+			}
 		break;
 
 		case SYSTEM_EVENT_STA_CONNECTED:
 			connect_attempt = 0;
+			if (wifi_directed)
+				wifi_rc_stats.directed++;
 			ESP_LOGI(TAG, "SYSTEM_EVENT_STA_CONNECTED");
 		break;
 
@@ -168,9 +340,12 @@ static esp_err_t event_handler(void *ctx, system_event_t *event)
 			ip4addr_ntoa(&event->event_info.got_ip.ip_info.ip));
 
 //			connect_attempt = 0;
+			fast_attempt = 0;
+			wifi_last_ap_update();
 			xEventGroupSetBits(s_wifi_event_group, CONNECTED_BIT);
 
 			WIFI__SetSTAStatus(CONNECTED);
+			GME__PostEvent(GME_EVT_RADIO);
 
 			P_COV_LN;
 		break;
@@ -178,10 +353,17 @@ static esp_err_t event_handler(void *ctx, system_event_t *event)
 		case SYSTEM_EVENT_STA_DISCONNECTED:
 			ESP_LOGI(TAG, "SYSTEM_EVENT_STA_DISCONNECTED %d", connect_attempt);
 
+			if (wifi_down_us == 0)
+				wifi_down_us = esp_timer_get_time();
+
+			// the last AP is not on its channel anymore, don't insist
+			if (wifi_directed && (event->event_info.disconnected.reason == WIFI_REASON_NO_AP_FOUND))
+				fast_attempt = WIFI_FAST_RETRY;
+
 			// try to reconnect for about one minute, then make a 2 minute break
 			if(connect_attempt < 20) {
 				connect_attempt++;
-				ESP_ERROR_CHECK(esp_wifi_connect());
+				wifi_connect();
 			}
 			else{
 				connect_attempt = 21;
@@ -193,6 +375,7 @@ static esp_err_t event_handler(void *ctx, system_event_t *event)
 
 			xEventGroupClearBits(s_wifi_event_group, CONNECTED_BIT);
 			WIFI__SetSTAStatus(DISCONNECTED);
+			GME__PostEvent(GME_EVT_RADIO);
 			P_COV_LN;
 		break;
 
@@ -316,11 +499,67 @@ void IsTimerForAPConnectionExpired(void){
 			PRINTF_DEBUG("TimerForAPConnection Expired \n");
 			TimerForAPConnection = 0;
 			connect_attempt = 0;
-			ESP_ERROR_CHECK(esp_wifi_connect());
+			fast_attempt = 0;
+			wifi_connect();
 		}
 	}
 }
 
+/**
+ * @brief WiFi__SaveLastAP
+ *        write the last AP in NVM if it changed, called by the
+ *        main loop and not by the event task that has a small stack
+ *
+ * @param  none
+ * @return none
+ */
+void WiFi__SaveLastAP(void){
+	wifi_last_ap_t ap;
+
+	if (wifi_last_ap_dirty == 0)
+		return;
+
+	wifi_last_ap_dirty = 0;
+	ap = wifi_last_ap;
+	if (C_SUCCESS != NVM__WriteBlob(WIFI_LAST_AP_NVM, (void*)&ap, sizeof(wifi_last_ap_t)))
+		PRINTF_DEBUG("last AP not saved\n");
+	P_COV_LN;
+}
+
+/**
+ * @brief WiFi__MqttConnected
+ *        close the measure of the time from the link down
+ *        (or the start of the station) to the MQTT connection
+ *
+ * @param  none
+ * @return none
+ */
+void WiFi__MqttConnected(void){
+	C_UINT32 ms;
+
+	if (wifi_down_us == 0)
+		return;
+
+	ms = (C_UINT32)((esp_timer_get_time() - wifi_down_us) / 1000);
+	wifi_down_us = 0;
+
+	wifi_rc_stats.last_ms = ms;
+	if (ms > wifi_rc_stats.max_ms)
+		wifi_rc_stats.max_ms = ms;
+
+	PRINTF_DEBUG("link down to MQTT up %d ms\n", ms);
+}
+
+/**
+ * @brief WiFi__GetReconnectStats
+ *
+ * @param  wifi_reconnect_stats_t *stats
+ * @return none
+ */
+void WiFi__GetReconnectStats(wifi_reconnect_stats_t *stats){
+	*stats = wifi_rc_stats;
+}
+
 /**
  * @brief WiFi_GetConfigSM
  *       return state machine config status
@@ -440,6 +679,10 @@ gme_sm_t WiFi__Config (config_sm_t sm)
             	UnSetWpsMode();
             	P_COV_LN;
             }
+
+            // nothing to do until the html page, the WPS or the button wake us up
+            if(config_sm == WAITING_FOR_HTML_CONF_PARAMETERS)
+            	GME_WaitEvent_IS((Sys__GetButtonState() != BUTTON_WAIT) ? GME_LOOP_BUTTON_MS : GME_LOOP_IDLE_MS);
             break;
 
         case CONFIGURE_GME:
@@ -654,6 +897,8 @@ void WiFi__WriteCustomConfigInNVM(html_config_param_t config){
 	//TODO CPPCHECK valori di ritorno non testati che succede se sbagliamo a scrivere la es. la pwd
 	//ne scriviamo una sporca e poi ciccia non si ricollegano più ?
 
+    NVM__BeginTransaction();
+
     NVM__WriteString(HTMLCONF_AP_SSID, config.ap_ssid);
     NVM__WriteU8Value(HTMLCONF_AP_SSID_HIDDEN, config.ap_ssid_hidden);
     NVM__WriteString(HTMLCONF_AP_PSWD, config.ap_pswd);
@@ -670,6 +915,7 @@ void WiFi__WriteCustomConfigInNVM(html_config_param_t config){
     NVM__WriteString(HTMLCONF_STA_PRI_DNS, config.sta_primary_dns);
     NVM__WriteString(HTMLCONF_STA_SCND_DNS, config.sta_secondary_dns);
 
+    NVM__EndTransaction();
 }
 
 /**
@@ -768,6 +1014,16 @@ esp_err_t WiFi__SetCustomConfig(html_config_param_t config){
 	strcpy((char*)wifi_config_STA.sta.password,config.sta_pswd);
 	//wifi_config_AP.sta.ssid_len = strlen(config.ap_ssid);
 
+	// the first connect goes directly to the last AP
+	wifi_last_ap_load(config.sta_ssid);
+	if (wifi_last_ap_valid)
+	{
+		wifi_config_STA.sta.bssid_set = true;
+		memcpy(wifi_config_STA.sta.bssid, wifi_last_ap.bssid, sizeof(wifi_config_STA.sta.bssid));
+		wifi_config_STA.sta.channel = wifi_last_ap.channel;
+		wifi_directed = 1;
+	}
+
 	PRINTF_DEBUG("\nSTA SSID = %s  and  Password = %s\n",wifi_config_STA.sta.ssid,wifi_config_STA.sta.password);
 
 	if(!config.sta_dhcp_mode)
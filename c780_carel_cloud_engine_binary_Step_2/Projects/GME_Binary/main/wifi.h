@@ -33,6 +33,19 @@
 //#define __DEBUG_WIFI_LEV_2
 #endif
 
+/* directed connects to the last AP before falling back to a full scan */
+#define WIFI_FAST_RETRY				2
+
+/* a station joined the AP, delay before the scan of the AP list (ms) */
+#define WIFI_AP_SCAN_DELAY_MS		3000
+
+typedef struct wifi_reconnect_stats_s{
+	C_UINT32 last_ms;					// last link down to MQTT up
+	C_UINT32 max_ms;
+	C_UINT16 directed;					// connects to the cached BSSID/channel
+	C_UINT16 fallback;					// directed connects failed, full scan
+}wifi_reconnect_stats_t;
+
 
 gme_sm_t WiFi__Config (config_sm_t sm);
 config_sm_t WiFi_GetConfigSM(void);
@@ -55,4 +68,7 @@ char* GetAvailableAPs(uint8_t index);
 esp_err_t test_sta(html_config_param_t config);
 void StartTimerForAPConnection(void);
 void IsTimerForAPConnectionExpired(void);
+void WiFi__SaveLastAP(void);
+void WiFi__MqttConnected(void);
+void WiFi__GetReconnectStats(wifi_reconnect_stats_t *stats);
 #endif /* MAIN_WIFI_H_ */
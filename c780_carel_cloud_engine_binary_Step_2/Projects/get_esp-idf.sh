@@ -36,4 +36,8 @@ patch components/freemodbus/modbus/include/mbconfig.h ~/esp/GME_Binary/patches/0
 patch components/freemodbus/modbus/include/mbproto.h ~/esp/GME_Binary/patches/0016_add_read_filetransf_6.patch
 patch components/esp_https_ota/src/esp_https_ota.c ~/esp/GME_Binary/patches/0017_fix_ota_2G_pt1.patch
 patch components/freemodbus/common/esp_modbus_master.c ~/esp/GME_Binary/patches/0019_fix_di_coil_read.patch
+# resume the TLS session and the MQTT session on reconnect
+patch -p0 < ~/esp/GME_Binary/patches/0022_tls_session_resumption.patch
+# raw request of the send_mb_adu tunnel
+patch -p0 < ~/esp/GME_Binary/patches/0023_raw_adu_request.patch
 
@@ -0,0 +1,311 @@
+/**
+ * @file   cbor_templates_test.c
+ * @author carel
+ * @date   18 Oct 2026
+ * @brief  host test of the pre-encoded templates of the outbound messages
+ *         (CBOR_Templates_CAREL.h):
+ *           - every template is byte by byte the key (and the "ver") that
+ *             tinycbor encodes one by one
+ *           - the values, alarms, status and response messages built as in
+ *             CBOR_CAREL.c are the same of the ones built key by key, also
+ *             when the buffer is too small: same error and same extra
+ *             bytes needed (the stream is dropped then, a key by key
+ *             encoding can leave the head of a string the template doesn't
+ *             write)
+ *           - benchmark of the values message with the templates against
+ *             the key by key encoding
+ *
+ *         usage: cbor_templates_test [benchmark iterations]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "CBOR_Templates_CAREL.h"
+
+#define BENCH_ITERATIONS	2000000
+#define STREAM_SIZE			512
+#define VALUES_NUM			8
+
+/* the key of a template, with "ver":CAREL_TYPES_VERSION before it if items is 3 */
+static CborError key(CborEncoder *enc, int use_tmpl, const C_BYTE *tmpl, size_t len, size_t items, const char *txt)
+{
+	CborError err = CborNoError;
+
+	if (use_tmpl)
+		return CBOR_AppendTemplate(enc, tmpl, len, items);
+
+	if (items == 3)
+	{
+		err |= cbor_encode_text_stringz(enc, "ver");
+		err |= cbor_encode_uint(enc, CAREL_TYPES_VERSION);
+	}
+	err |= cbor_encode_text_stringz(enc, txt);
+	return err;
+}
+
+#define KEY(enc, tmpl, items, txt)	key((enc), use_tmpl, (tmpl), sizeof(tmpl), (items), (txt))
+
+typedef CborError (*msg_t)(CborEncoder *encoder, int use_tmpl);
+
+/* ==== the messages, same fields of CBOR_CAREL.c ==== */
+
+static const char *aliases[VALUES_NUM] = { "1", "12", "123", "1234", "17", "250", "3000", "65535" };
+static const char *values[VALUES_NUM]  = { "0", "-1", "", "23.5", "65535", "1", "", "-32768" };
+
+/* CBOR_Values */
+static CborError msg_values(CborEncoder *encoder, int use_tmpl)
+{
+	CborEncoder mapEncoder, mapEncoder1;
+	CborError err;
+
+	err = cbor_encoder_create_map(encoder, &mapEncoder, CborIndefiniteLength);
+	err |= KEY(&mapEncoder, tmpl_ver_cnt, 3, "cnt");
+	err |= cbor_encode_uint(&mapEncoder, 1234);
+	err |= KEY(&mapEncoder, tmpl_key_btm, 1, "btm");
+	err |= cbor_encode_uint(&mapEncoder, 1792310400);
+	err |= KEY(&mapEncoder, tmpl_key_t, 1, "t");
+	err |= cbor_encode_uint(&mapEncoder, 1792312345);
+#ifdef SAMPLE_MS_TIMESTAMP
+	err |= KEY(&mapEncoder, tmpl_key_tms, 1, "tms");
+	err |= cbor_encode_uint(&mapEncoder, 999);
+#endif
+	err |= KEY(&mapEncoder, tmpl_key_vls, 1, "vls");
+	err |= cbor_encoder_create_map(&mapEncoder, &mapEncoder1, CborIndefiniteLength);
+	for (int i = 0; i < VALUES_NUM; i++)
+	{
+		err |= cbor_encode_text_stringz(&mapEncoder1, aliases[i]);
+		if (values[i][0] == 0)
+			err |= cbor_encode_null(&mapEncoder1);
+		else
+			err |= cbor_encode_text_stringz(&mapEncoder1, values[i]);
+	}
+	err |= cbor_encoder_close_container(&mapEncoder, &mapEncoder1);
+	err |= KEY(&mapEncoder, tmpl_key_agg, 1, "agg");
+	err |= cbor_encoder_create_map(&mapEncoder, &mapEncoder1, 0);
+	err |= cbor_encoder_close_container(&mapEncoder, &mapEncoder1);
+	err |= KEY(&mapEncoder, tmpl_key_frm, 1, "frm");
+	err |= cbor_encode_int(&mapEncoder, -1);
+	err |= KEY(&mapEncoder, tmpl_key_did, 1, "did");
+	err |= cbor_encode_int(&mapEncoder, 4242);
+	err |= cbor_encoder_close_container(encoder, &mapEncoder);
+	return err;
+}
+
+/* CBOR_SendAlarms */
+static CborError msg_alarms(CborEncoder *encoder, int use_tmpl)
+{
+	CborEncoder mapEncoder;
+	CborError err;
+
+	err = cbor_encoder_create_map(encoder, &mapEncoder, CborIndefiniteLength);
+	err |= KEY(&mapEncoder, tmpl_ver_aty, 3, "aty");
+	err |= cbor_encode_uint(&mapEncoder, 2);
+	err |= KEY(&mapEncoder, tmpl_key_ali, 1, "ali");
+	err |= cbor_encode_text_stringz(&mapEncoder, "1234");
+	err |= KEY(&mapEncoder, tmpl_key_aco, 1, "aco");
+	err |= cbor_encode_uint(&mapEncoder, 1);
+	err |= KEY(&mapEncoder, tmpl_key_st, 1, "st");
+	err |= cbor_encode_uint(&mapEncoder, 1792312345);
+	err |= KEY(&mapEncoder, tmpl_key_et, 1, "et");
+	err |= cbor_encode_uint(&mapEncoder, 0);
+#ifdef SAMPLE_MS_TIMESTAMP
+	err |= KEY(&mapEncoder, tmpl_key_sms, 1, "sms");
+	err |= cbor_encode_uint(&mapEncoder, 12);
+	err |= KEY(&mapEncoder, tmpl_key_ems, 1, "ems");
+	err |= cbor_encode_uint(&mapEncoder, 0);
+#endif
+	err |= KEY(&mapEncoder, tmpl_key_did, 1, "did");
+	err |= cbor_encode_int(&mapEncoder, 4242);
+	err |= cbor_encoder_close_container(encoder, &mapEncoder);
+	return err;
+}
+
+/* CBOR_SendStatus, without the telemetry */
+static CborError msg_status(CborEncoder *encoder, int use_tmpl)
+{
+	CborEncoder mapEncoder;
+	CborError err;
+
+	err = cbor_encoder_create_map(encoder, &mapEncoder, CborIndefiniteLength);
+	err |= KEY(&mapEncoder, tmpl_ver_t, 3, "t");
+	err |= cbor_encode_uint(&mapEncoder, 1792312345);
+	err |= KEY(&mapEncoder, tmpl_key_upt, 1, "upt");
+	err |= cbor_encode_uint(&mapEncoder, 86400);
+	err |= KEY(&mapEncoder, tmpl_key_fme, 1, "fme");
+	err |= cbor_encode_uint(&mapEncoder, 123456);
+	err |= KEY(&mapEncoder, tmpl_key_est, 1, "est");
+	err |= cbor_encode_uint(&mapEncoder, 1);
+	err |= KEY(&mapEncoder, tmpl_key_sgn, 1, "sgn");
+	err |= cbor_encode_int(&mapEncoder, -67);
+	err |= cbor_encoder_close_container(encoder, &mapEncoder);
+	return err;
+}
+
+/* CBOR_ResHeader and the closing of CBOR_ResSimple */
+static CborError msg_response(CborEncoder *encoder, int use_tmpl)
+{
+	CborEncoder mapEncoder;
+	CborError err;
+
+	err = cbor_encoder_create_map(encoder, &mapEncoder, CborIndefiniteLength);
+	err |= KEY(&mapEncoder, tmpl_ver_rto, 3, "rto");
+	err |= cbor_encode_text_stringz(&mapEncoder, "/res/0123456789AB");
+	err |= KEY(&mapEncoder, tmpl_key_cmd, 1, "cmd");
+	err |= cbor_encode_uint(&mapEncoder, 17);
+	err |= KEY(&mapEncoder, tmpl_key_res, 1, "res");
+	err |= cbor_encode_int(&mapEncoder, 0);
+	err |= cbor_encoder_close_container(encoder, &mapEncoder);
+	return err;
+}
+
+/* ==== the tests ==== */
+
+typedef struct{
+	const C_BYTE *tmpl;
+	size_t len;
+	size_t items;
+	const char *txt;
+}tmpl_t;
+
+#define TMPL(tmpl, items, txt)	{ (tmpl), sizeof(tmpl), (items), (txt) }
+
+static const tmpl_t tmpls[] = {
+	TMPL(tmpl_ver_cnt, 3, "cnt"), TMPL(tmpl_ver_aty, 3, "aty"),
+	TMPL(tmpl_ver_t, 3, "t"),     TMPL(tmpl_ver_rto, 3, "rto"),
+	TMPL(tmpl_key_ali, 1, "ali"), TMPL(tmpl_key_aco, 1, "aco"),
+	TMPL(tmpl_key_btm, 1, "btm"), TMPL(tmpl_key_cmd, 1, "cmd"),
+	TMPL(tmpl_key_did, 1, "did"), TMPL(tmpl_key_est, 1, "est"),
+	TMPL(tmpl_key_et, 1, "et"),   TMPL(tmpl_key_fme, 1, "fme"),
+	TMPL(tmpl_key_frm, 1, "frm"), TMPL(tmpl_key_res, 1, "res"),
+	TMPL(tmpl_key_sgn, 1, "sgn"), TMPL(tmpl_key_st, 1, "st"),
+	TMPL(tmpl_key_t, 1, "t"),     TMPL(tmpl_key_upt, 1, "upt"),
+	TMPL(tmpl_key_vls, 1, "vls"), TMPL(tmpl_key_agg, 1, "agg"),
+#ifdef SAMPLE_MS_TIMESTAMP
+	TMPL(tmpl_key_tms, 1, "tms"), TMPL(tmpl_key_sms, 1, "sms"),
+	TMPL(tmpl_key_ems, 1, "ems"),
+#endif
+#ifdef GW_STATUS_TELEMETRY
+	TMPL(tmpl_key_tlm, 1, "tlm"), TMPL(tmpl_key_hmn, 1, "hmn"),
+	TMPL(tmpl_key_hlb, 1, "hlb"), TMPL(tmpl_key_tsk, 1, "tsk"),
+	TMPL(tmpl_key_bfs, 1, "bfs"), TMPL(tmpl_key_mbl, 1, "mbl"),
+	TMPL(tmpl_key_rcn, 1, "rcn"), TMPL(tmpl_key_pla, 1, "pla"),
+#endif
+};
+#define TMPLS_NUM	(sizeof(tmpls) / sizeof(tmpls[0]))
+
+static int check_tmpl(const tmpl_t *t)
+{
+	C_BYTE exp[16], got[16];
+	CborEncoder enc;
+	size_t exp_len;
+
+	cbor_encoder_init(&enc, exp, sizeof(exp), 0);
+	key(&enc, 0, t->tmpl, t->len, t->items, t->txt);
+	exp_len = cbor_encoder_get_buffer_size(&enc, exp);
+
+	cbor_encoder_init(&enc, got, sizeof(got), 0);
+	CBOR_AppendTemplate(&enc, t->tmpl, t->len, t->items);
+
+	if ((exp_len != t->len) || memcmp(exp, got, exp_len))
+	{
+		printf("FAIL template %s%s: %u bytes, %u expected\n", (t->items == 3) ? "ver " : "", t->txt,
+			   (unsigned)t->len, (unsigned)exp_len);
+		return 1;
+	}
+	return 0;
+}
+
+/* the message with the templates and key by key in buffers of every size */
+static int check_msg(const char *name, msg_t msg)
+{
+	C_BYTE exp[STREAM_SIZE], got[STREAM_SIZE];
+	CborEncoder enc_exp, enc_got;
+	CborError err_exp, err_got;
+	size_t full = 0;
+	int err = 0;
+
+	for (size_t size = STREAM_SIZE; ; size--)
+	{
+		memset(exp, 0xA5, sizeof(exp));
+		memset(got, 0xA5, sizeof(got));
+		cbor_encoder_init(&enc_exp, exp, size, 0);
+		cbor_encoder_init(&enc_got, got, size, 0);
+		err_exp = msg(&enc_exp, 0);
+		err_got = msg(&enc_got, 1);
+
+		if (size == STREAM_SIZE)
+		{
+			full = cbor_encoder_get_buffer_size(&enc_exp, exp);
+			size = full + 1;
+		}
+
+		if ((err_exp != err_got) ||
+			(cbor_encoder_get_extra_bytes_needed(&enc_exp) != cbor_encoder_get_extra_bytes_needed(&enc_got)) ||
+			((err_exp == CborNoError) && memcmp(exp, got, sizeof(exp))))
+		{
+			printf("FAIL %s, %u bytes buffer: error %d/%d, %u/%u bytes needed\n", name, (unsigned)size, err_exp, err_got,
+				   (unsigned)cbor_encoder_get_extra_bytes_needed(&enc_exp),
+				   (unsigned)cbor_encoder_get_extra_bytes_needed(&enc_got));
+			err++;
+		}
+
+		if (size == 0)
+			break;
+	}
+
+	printf("%s %s: %u bytes, same stream and same overflow in buffers of 0..%u bytes\n", err ? "FAIL" : "ok  ",
+		   name, (unsigned)full, (unsigned)full);
+	return err;
+}
+
+static double now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static double bench(int use_tmpl, long iterations)
+{
+	static C_BYTE buf[STREAM_SIZE];
+	volatile size_t sink = 0;
+	CborEncoder enc;
+	double t0 = now_ns();
+
+	for (long i = 0; i < iterations; i++)
+	{
+		cbor_encoder_init(&enc, buf, sizeof(buf), 0);
+		msg_values(&enc, use_tmpl);
+		sink += cbor_encoder_get_buffer_size(&enc, buf);
+	}
+
+	return (now_ns() - t0) / iterations;
+}
+
+int main(int argc, char *argv[])
+{
+	long iterations = (argc > 1) ? atol(argv[1]) : BENCH_ITERATIONS;
+	double ns_key, ns_tmpl;
+	int err = 0;
+
+	for (size_t i = 0; i < TMPLS_NUM; i++)
+		err += check_tmpl(&tmpls[i]);
+	printf("%s %u templates same of the keys encoded by tinycbor\n", err ? "FAIL" : "ok  ", (unsigned)TMPLS_NUM);
+
+	err += check_msg("values", msg_values);
+	err += check_msg("alarms", msg_alarms);
+	err += check_msg("status", msg_status);
+	err += check_msg("response", msg_response);
+
+	ns_key = bench(0, iterations);
+	ns_tmpl = bench(1, iterations);
+	printf("bench values message (%d values): key by key %.1f ns, templates %.1f ns (x%.2f)\n",
+		   VALUES_NUM, ns_key, ns_tmpl, ns_key / ns_tmpl);
+
+	printf("%s\n", err ? "cbor_templates_test FAILED" : "cbor_templates_test OK");
+	return err ? 1 : 0;
+}
@@ -0,0 +1,304 @@
+/**
+ * @file   cmux_loopback_test.c
+ * @author carel
+ * @date   18 Oct 2026
+ * @brief  host loopback test of the CMUX framing of the modem component
+ *         (components/modem/src/esp_modem_cmux.c): a DTE and a simulated
+ *         DCE exchange frames through a byte stream cut in random pieces
+ *           - DLCI open (SABM/UA), refused DLCI (DM) and close (DISC/UA)
+ *           - frame/unframe round trip of UIH frames of every length,
+ *             with flags and escapes inside the information field
+ *           - FCS errors and garbage on the line are counted and dropped,
+ *             the decoder resyncs on the next frame
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "esp_modem_cmux.h"
+
+#define LINE_SIZE		8192
+
+typedef struct{
+	uint8_t dlci;
+	uint8_t control;
+	size_t len;
+	uint8_t info[CMUX_MAX_INFO_LEN];
+}frame_t;
+
+/* frames received by an end of the line */
+typedef struct{
+	cmux_decoder_t dec;
+	frame_t last;
+	int frames;
+}end_t;
+
+/* the simulated DCE accepts the channels below this one */
+#define DCE_DLCI_NUM	CMUX_DLCI_NUM
+
+typedef struct{
+	end_t end;
+	uint8_t open[DCE_DLCI_NUM];
+	uint8_t out[LINE_SIZE];		// answers to the DTE
+	size_t out_len;
+}dce_t;
+
+static unsigned int rnd_state = 0x2468ACE1;
+static int failures = 0;
+
+#define CHECK(cond, ...)	do { if (!(cond)) { printf("FAIL %s:%d: ", __func__, __LINE__); printf(__VA_ARGS__); printf("\n"); failures++; } } while (0)
+
+static unsigned int rnd(void)
+{
+	rnd_state ^= rnd_state << 13;
+	rnd_state ^= rnd_state >> 17;
+	rnd_state ^= rnd_state << 5;
+	return rnd_state;
+}
+
+static void on_frame(void *ctx, uint8_t dlci, uint8_t control, const uint8_t *info, size_t len)
+{
+	end_t *end = (end_t *)ctx;
+
+	end->last.dlci = dlci;
+	end->last.control = control;
+	end->last.len = len;
+	memcpy(end->last.info, info, len);
+	end->frames++;
+}
+
+/* feed the stream in pieces of random length, as read from the UART */
+static void feed(end_t *end, const uint8_t *data, size_t len, cmux_frame_cb_t cb, void *ctx)
+{
+	size_t pos = 0;
+
+	while (pos < len) {
+		size_t n = 1 + rnd() % 17;
+		if (n > len - pos) {
+			n = len - pos;
+		}
+		cmux_decode(&end->dec, data + pos, n, cb, ctx);
+		pos += n;
+	}
+}
+
+/* the DCE answers SABM and DISC as a modem does */
+static void dce_on_frame(void *ctx, uint8_t dlci, uint8_t control, const uint8_t *info, size_t len)
+{
+	dce_t *dce = (dce_t *)ctx;
+	uint8_t answer = 0;
+
+	on_frame(&dce->end, dlci, control, info, len);
+
+	switch (control) {
+	case CMUX_SABM:
+		answer = (dlci < DCE_DLCI_NUM) ? CMUX_UA : CMUX_DM;
+		if (dlci < DCE_DLCI_NUM) {
+			dce->open[dlci] = 1;
+		}
+		break;
+	case CMUX_DISC:
+		answer = (dlci < DCE_DLCI_NUM && dce->open[dlci]) ? CMUX_UA : CMUX_DM;
+		if (dlci < DCE_DLCI_NUM) {
+			dce->open[dlci] = 0;
+		}
+		break;
+	default:
+		return;
+	}
+	dce->out_len += cmux_encode(dlci, answer | CMUX_PF, NULL, 0, dce->out + dce->out_len);
+}
+
+/* DTE side: send a command frame to the DCE and decode its answer */
+static uint8_t dte_command(end_t *dte, dce_t *dce, uint8_t dlci, uint8_t control)
+{
+	uint8_t frame[CMUX_FRAME_OVERHEAD];
+	size_t len = cmux_encode(dlci, control | CMUX_PF, NULL, 0, frame);
+	int frames = dte->frames;
+
+	dce->out_len = 0;
+	feed(&dce->end, frame, len, dce_on_frame, dce);
+	feed(dte, dce->out, dce->out_len, on_frame, dte);
+
+	if ((dte->frames != frames + 1) || (dte->last.dlci != dlci)) {
+		return 0;
+	}
+	return dte->last.control;
+}
+
+static void test_open_close(void)
+{
+	end_t dte;
+	dce_t dce;
+
+	cmux_decoder_init(&dte.dec);
+	dte.frames = 0;
+	memset(&dce, 0, sizeof(dce));
+	cmux_decoder_init(&dce.end.dec);
+
+	for (uint8_t dlci = 0; dlci < CMUX_DLCI_NUM; dlci++) {
+		CHECK(dte_command(&dte, &dce, dlci, CMUX_SABM) == CMUX_UA, "DLCI %d not opened", dlci);
+		CHECK(dce.open[dlci], "DCE didn't see the SABM of DLCI %d", dlci);
+	}
+
+	// a channel the DCE doesn't have
+	CHECK(dte_command(&dte, &dce, 7, CMUX_SABM) == CMUX_DM, "DLCI 7 should be refused");
+
+	for (int dlci = CMUX_DLCI_NUM - 1; dlci >= 0; dlci--) {
+		CHECK(dte_command(&dte, &dce, dlci, CMUX_DISC) == CMUX_UA, "DLCI %d not closed", dlci);
+		CHECK(!dce.open[dlci], "DCE didn't see the DISC of DLCI %d", dlci);
+	}
+
+	// already closed
+	CHECK(dte_command(&dte, &dce, CMUX_DLCI_AT, CMUX_DISC) == CMUX_DM, "close of a closed DLCI should answer DM");
+
+	CHECK(dte.dec.errors == 0 && dce.end.dec.errors == 0, "errors %u %u", dte.dec.errors, dce.end.dec.errors);
+	printf("open/close: %d DLCI opened and closed\n", CMUX_DLCI_NUM);
+}
+
+static void test_round_trip(void)
+{
+	static uint8_t line[LINE_SIZE];
+	static frame_t sent[64];
+	end_t rx;
+	int total = 0;
+
+	cmux_decoder_init(&rx.dec);
+	rx.frames = 0;
+
+	// every length of the information field, bytes that look like flags included
+	for (size_t len = 0; len <= CMUX_MAX_INFO_LEN; len++) {
+		frame_t *f = &sent[0];
+		f->dlci = (uint8_t)(len % CMUX_DLCI_NUM);
+		f->control = CMUX_UIH;
+		f->len = len;
+		for (size_t i = 0; i < len; i++) {
+			f->info[i] = (rnd() % 4) ? (uint8_t)rnd() : CMUX_FLAG;
+		}
+
+		size_t n = cmux_encode(f->dlci, f->control, f->info, f->len, line);
+		CHECK(n == len + CMUX_FRAME_OVERHEAD, "frame of %d bytes for %d of info", (int)n, (int)len);
+
+		feed(&rx, line, n, on_frame, &rx);
+		CHECK(rx.frames == ++total, "frame with %d bytes of info not received", (int)len);
+		CHECK(rx.last.dlci == f->dlci && rx.last.control == f->control && rx.last.len == len &&
+		      memcmp(rx.last.info, f->info, len) == 0, "frame with %d bytes of info changed", (int)len);
+	}
+
+	// frames back to back in a single stream, P/F bit removed on decode
+	size_t pos = 0;
+	int num = 0;
+	while (num < 64 && pos + CMUX_MAX_INFO_LEN + CMUX_FRAME_OVERHEAD <= sizeof(line)) {
+		frame_t *f = &sent[num++];
+		f->dlci = (uint8_t)(rnd() % CMUX_DLCI_NUM);
+		f->control = CMUX_UIH;
+		f->len = rnd() % (CMUX_MAX_INFO_LEN + 1);
+		for (size_t i = 0; i < f->len; i++) {
+			f->info[i] = (uint8_t)rnd();
+		}
+		pos += cmux_encode(f->dlci, f->control | ((num % 2) ? CMUX_PF : 0), f->info, f->len, line + pos);
+	}
+
+	int first = rx.frames;
+	for (size_t i = 0; i < pos; i++) {
+		int before = rx.frames;
+		cmux_decode(&rx.dec, &line[i], 1, on_frame, &rx);
+		if (rx.frames != before) {
+			frame_t *f = &sent[rx.frames - first - 1];
+			CHECK(rx.last.dlci == f->dlci && rx.last.control == f->control && rx.last.len == f->len &&
+			      memcmp(rx.last.info, f->info, f->len) == 0, "frame %d of the stream changed", rx.frames - first);
+		}
+	}
+	CHECK(rx.frames - first == num, "%d frames of %d received", rx.frames - first, num);
+	CHECK(rx.dec.errors == 0, "%u errors", rx.dec.errors);
+
+	printf("round trip: %d frames\n", rx.frames);
+}
+
+static void test_errors(void)
+{
+	uint8_t line[CMUX_MAX_INFO_LEN + CMUX_FRAME_OVERHEAD];
+	uint8_t good[CMUX_MAX_INFO_LEN + CMUX_FRAME_OVERHEAD];
+	int frames;
+	uint8_t info[16];
+	end_t rx;
+	size_t n, g;
+
+	cmux_decoder_init(&rx.dec);
+	rx.frames = 0;
+
+	for (size_t i = 0; i < sizeof(info); i++) {
+		info[i] = (uint8_t)i;
+	}
+	g = cmux_encode(CMUX_DLCI_AT, CMUX_UIH, info, sizeof(info), good);
+
+	// a bit flipped in each byte of the header or in the FCS: the frame is
+	// dropped and counted. The basic option has no transparency, a wrong
+	// length swallows the frames that follow up to N1 bytes, then the
+	// decoder resyncs
+	size_t fcs_pos = g - 2;
+	size_t check[] = { 1, 2, 3, fcs_pos };
+	for (size_t k = 0; k < sizeof(check) / sizeof(check[0]); k++) {
+		for (int bit = 0; bit < 8; bit++) {
+			uint32_t errors = rx.dec.errors;
+			int frames = rx.frames;
+
+			memcpy(line, good, g);
+			line[check[k]] ^= (uint8_t)(1 << bit);
+			rx.last.len = 0;
+			feed(&rx, line, g, on_frame, &rx);
+			CHECK(rx.frames == frames, "corrupted byte %d bit %d accepted", (int)check[k], bit);
+
+			for (size_t sent = 0; sent <= CMUX_MAX_INFO_LEN + g; sent += g) {
+				feed(&rx, good, g, on_frame, &rx);
+			}
+			CHECK(rx.frames >= frames + 1, "no resync after byte %d bit %d", (int)check[k], bit);
+			CHECK(rx.last.len == sizeof(info) && memcmp(rx.last.info, info, sizeof(info)) == 0,
+			      "wrong frame after byte %d bit %d", (int)check[k], bit);
+			CHECK(rx.dec.errors > errors, "corrupted byte %d bit %d not counted", (int)check[k], bit);
+		}
+	}
+
+	// an FCS error on the line, without resetting the decoder
+	cmux_decoder_init(&rx.dec);
+	frames = rx.frames;
+	memcpy(line, good, g);
+	line[fcs_pos] ^= 0x55;
+	feed(&rx, line, g, on_frame, &rx);
+	feed(&rx, good, g, on_frame, &rx);
+	CHECK(rx.frames == frames + 1 && rx.dec.errors == 1, "FCS error: %d frames, %u errors", rx.frames - frames, rx.dec.errors);
+
+	// garbage before a frame and a length over N1
+	cmux_decoder_init(&rx.dec);
+	frames = rx.frames;
+	uint8_t garbage[] = { 0x00, 0x41, 0x54, 0x0D, 0x0A };
+	feed(&rx, garbage, sizeof(garbage), on_frame, &rx);
+	uint8_t too_long[] = { CMUX_FLAG, 0x0B, CMUX_UIH, (uint8_t)(((CMUX_MAX_INFO_LEN + 1) << 1) & 0xFE), 0x01 };
+	feed(&rx, too_long, sizeof(too_long), on_frame, &rx);
+	feed(&rx, good, g, on_frame, &rx);
+	CHECK(rx.frames == frames + 1, "no frame after garbage and a too long one");
+	CHECK(rx.dec.errors >= 1, "too long frame not counted");
+
+	// information field truncated: the closing flag is missing
+	cmux_decoder_init(&rx.dec);
+	frames = rx.frames;
+	n = cmux_encode(CMUX_DLCI_PPP, CMUX_UIH, info, sizeof(info), line);
+	feed(&rx, line, n - 5, on_frame, &rx);
+	feed(&rx, good, g, on_frame, &rx);
+	CHECK(rx.frames == frames, "truncated frame accepted");
+	feed(&rx, good, g, on_frame, &rx);
+	CHECK(rx.frames == frames + 1, "no resync after a truncated frame");
+
+	printf("errors: FCS and framing errors dropped\n");
+}
+
+int main(void)
+{
+	test_open_close();
+	test_round_trip();
+	test_errors();
+
+	printf("%s\n", failures ? "cmux_loopback_test FAILED" : "cmux_loopback_test OK");
+	return failures ? 1 : 0;
+}
@@ -0,0 +1,147 @@
+/**
+ * @file   crc16_test.c
+ * @author carel
+ * @date   18 Oct 2026
+ * @brief  host test of the slicing-by-4 modbus CRC16 (crc16_CAREL.c):
+ *           - the check value of CRC-16/MODBUS
+ *           - random blocks of every length up to 2 KB (the max size of
+ *             the model), at every alignment and split in random pieces
+ *             through CRC16_Update, are the same of the bitwise CRC and of
+ *             the old byte-wise table
+ *           - benchmark of the three kernels on a model of 2 KB and on a
+ *             modbus frame of 8 bytes
+ *
+ *         usage: crc16_test [benchmark iterations]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "crc16_CAREL.h"
+
+#define BENCH_ITERATIONS	20000
+#define MAX_LEN				2048
+
+static uint16_t byte_table[256];
+
+static uint32_t rnd_state = 0x12345678;
+
+static uint32_t rnd(void)
+{
+	rnd_state ^= rnd_state << 13;
+	rnd_state ^= rnd_state >> 17;
+	rnd_state ^= rnd_state << 5;
+	return rnd_state;
+}
+
+/* the definition, polynomial 0xA001 reflected */
+static uint16_t crc_bitwise(uint16_t crc, const uint8_t *p, uint32_t n)
+{
+	while (n--)
+	{
+		crc ^= *p++;
+		for (int i = 0; i < 8; i++)
+			crc = (crc & 1) ? ((crc >> 1) ^ 0xA001) : (crc >> 1);
+	}
+	return crc;
+}
+
+/* the old CRC16 of binary_model.c, one byte for each step */
+static uint16_t crc_bytewise(uint16_t crc, const uint8_t *p, uint32_t n)
+{
+	uint8_t nTemp;
+
+	while (n--)
+	{
+		nTemp = *p++ ^ crc;
+		crc >>= 8;
+		crc ^= byte_table[nTemp];
+	}
+	return crc;
+}
+
+static double now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+typedef uint16_t (*crc_t)(uint16_t crc, const uint8_t *p, uint32_t n);
+
+static double bench(crc_t crc, const uint8_t *p, uint32_t n, long iterations)
+{
+	volatile uint16_t sink = 0;
+	double t0 = now_ns();
+
+	for (long i = 0; i < iterations; i++)
+		sink ^= crc(CRC16_INIT, p, n);
+
+	return (now_ns() - t0) / iterations;
+}
+
+int main(int argc, char *argv[])
+{
+	long iterations = (argc > 1) ? atol(argv[1]) : BENCH_ITERATIONS;
+	static uint8_t buf[MAX_LEN + 4];
+	const uint8_t check[] = "123456789";
+	double ns_bit, ns_byte, ns_slice;
+	int err = 0, fails = 0;
+
+	for (int b = 0; b < 256; b++)
+	{
+		uint8_t v = (uint8_t)b;
+		byte_table[b] = crc_bitwise(0, &v, 1);
+	}
+	for (size_t i = 0; i < sizeof(buf); i++)
+		buf[i] = (uint8_t)rnd();
+
+	if (CRC16(check, 9) != 0x4B37)
+		err++;
+	printf("%s check value \"123456789\": %04X, 4B37 expected\n", err ? "FAIL" : "ok  ", CRC16(check, 9));
+
+	for (uint32_t len = 0; len <= MAX_LEN; len++)
+	{
+		for (uint32_t off = 0; off < 4; off++)
+		{
+			const uint8_t *p = buf + off;
+			uint16_t exp = crc_bitwise(CRC16_INIT, p, len);
+			uint16_t crc = CRC16_INIT;
+			uint32_t done = 0;
+
+			// in random pieces, as the streamed files
+			while (done < len)
+			{
+				uint32_t n = 1 + rnd() % (len - done);
+				crc = CRC16_Update(crc, p + done, n);
+				done += n;
+			}
+
+			if ((CRC16_Update(CRC16_INIT, p, len) != exp) || (crc != exp) ||
+				(crc_bytewise(CRC16_INIT, p, len) != exp) ||
+				((len <= 0xFFFF) && (CRC16(p, (uint16_t)len) != exp)))
+			{
+				if (fails++ < 10)
+					printf("FAIL %u bytes at offset %u\n", (unsigned)len, (unsigned)off);
+			}
+		}
+	}
+	printf("%s blocks of 0..%u bytes at 4 alignments, whole and in pieces\n", fails ? "FAIL" : "ok  ", MAX_LEN);
+	err += fails;
+
+	ns_bit = bench(crc_bitwise, buf, MAX_LEN, iterations);
+	ns_byte = bench(crc_bytewise, buf, MAX_LEN, iterations);
+	ns_slice = bench(CRC16_Update, buf, MAX_LEN, iterations);
+	printf("bench %u bytes: bitwise %.0f ns, byte-wise %.0f ns, slicing-by-4 %.0f ns (x%.2f of byte-wise)\n",
+		   MAX_LEN, ns_bit, ns_byte, ns_slice, ns_byte / ns_slice);
+
+	ns_byte = bench(crc_bytewise, buf, 8, iterations * 100);
+	ns_slice = bench(CRC16_Update, buf, 8, iterations * 100);
+	printf("bench 8 bytes: byte-wise %.1f ns, slicing-by-4 %.1f ns (x%.2f)\n", ns_byte, ns_slice, ns_byte / ns_slice);
+
+	printf("%s\n", err ? "crc16_test FAILED" : "crc16_test OK");
+	return err ? 1 : 0;
+}
@@ -0,0 +1,26 @@
+/**
+ * @file   MQTT_Interface_CAREL.h
+ * @brief  host stub: only the download request (CBOR_CAREL.h)
+ */
+#ifndef __MQTT_INTERFACE_CAREL_H
+#define __MQTT_INTERFACE_CAREL_H
+
+#include "data_types_CAREL.h"
+
+#pragma pack(1)
+typedef struct C_CBORDWLDEVSCFG{
+	C_USERNAME usr;
+	C_PASSWORD pwd;
+	C_URI uri;
+	C_UINT16 cid;
+	C_UINT16 crc;
+	C_UINT16 dev;
+	C_UINT16 did;
+	C_CHAR fil[FIL_SIZE];
+	C_CHAR sha[SHA_SIZE];
+}c_cborreqdwldevsconfig;
+#pragma pack()
+
+typedef c_cborreqdwldevsconfig c_cborrequpdatecacert;
+
+#endif
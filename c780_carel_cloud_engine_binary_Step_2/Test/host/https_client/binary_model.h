@@ -0,0 +1,29 @@
+/**
+ * @file   binary_model.h
+ * @brief  host stub: header and CRC of the model
+ */
+#ifndef _BINARY_MODEL_H
+#define _BINARY_MODEL_H
+
+#include <stdint.h>
+#include "gme_config.h"
+#include "crc16_CAREL.h"
+
+#define GME_MODEL			"GME_MBT\x0"
+#define HEADER_VERSION 		256
+#define GME_MODEL_MAX_SIZE	2048
+
+#pragma pack(1)
+typedef struct HeaderModel{
+	uint8_t    signature[8];
+	uint16_t   version;
+	uint8_t    guid[16];
+	uint32_t   modelVer;
+	uint8_t    Rs485Stop;
+	uint8_t    Rs485Parity;
+}H_HeaderModel;
+#pragma pack()
+
+void BinaryModel_SetCrcCache(uint16_t crc);
+
+#endif
@@ -0,0 +1,23 @@
+/**
+ * @file   gme_config.h
+ * @brief  host stub: the files of the downloads, in the test directory
+ */
+#ifndef MAIN_GME_CONFIG_H_
+#define MAIN_GME_CONFIG_H_
+
+#define CERT_1	0
+#define CERT_2	1
+#define CERT1_SPIFFS		"https_client/cert1.crt"
+#define CERT2_SPIFFS		"https_client/cert2.crt"
+
+#define MODEL_FILE  		"https_client/model.bin"
+
+#define LOGIN_HTML 			"https_client/login.htm"
+#define CHANGE_CRED_HTML	"https_client/chcred.htm"
+#define CONFIG_HTML 		"https_client/config.htm"
+#define STYLE_CSS 			"https_client/style.css"
+#define FAV_ICON 			"https_client/fav.ico"
+
+#define CERT_MAX_SIZE		1536
+
+#endif
@@ -0,0 +1,23 @@
+/**
+ * @file   https_client_CAREL.h
+ * @brief  host stub: the errors and the functions of a download
+ */
+#ifndef MAIN_HTTPS_CLIENT_C_
+#define MAIN_HTTPS_CLIENT_C_
+
+#include <stdint.h>
+#include "MQTT_Interface_CAREL.h"
+
+typedef enum https_conn_err_s{
+	CONN_OK = 0,
+	CONN_FAIL,
+	FILE_NOT_SAVED,
+	NO_HEAP_MEMORY,
+	WRONG_CRC,
+	WRONG_FILE,
+}https_conn_err_t;
+
+C_RES HttpsClient__DownloadFile(c_cborreqdwldevsconfig *download_devs_config, uint8_t cert_num, const char *filename);
+C_RES HttpsClient__UpdateCertificate(c_cborrequpdatecacert *update_ca_cert);
+
+#endif
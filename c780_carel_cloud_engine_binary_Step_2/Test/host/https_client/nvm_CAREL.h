@@ -0,0 +1,15 @@
+/**
+ * @file   nvm_CAREL.h
+ * @brief  host stub
+ */
+#ifndef MAIN_NVM_CAREL_H_
+#define MAIN_NVM_CAREL_H_
+
+#include "data_types_CAREL.h"
+
+#define MB_CERT_NVM "cert"
+
+C_RES NVM__ReadU8Value(const C_CHAR* var, C_BYTE* val);
+C_RES NVM__WriteU8Value(const C_CHAR* var, C_BYTE val);
+
+#endif
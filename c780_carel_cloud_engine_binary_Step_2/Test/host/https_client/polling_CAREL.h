@@ -0,0 +1,4 @@
+/**
+ * @file   polling_CAREL.h
+ * @brief  host stub: nothing of it is used by https_client_CAREL.c
+ */
@@ -0,0 +1,12 @@
+/**
+ * @file   sys_IS.h
+ * @brief  host stub
+ */
+#ifndef __SYS_IS_H
+#define __SYS_IS_H
+
+#include "data_types_CAREL.h"
+
+void Sys__Delay(C_UINT32 delay);
+
+#endif
@@ -0,0 +1,196 @@
+/**
+ * @file   https_client_test.c
+ * @author carel
+ * @date   18 Oct 2026
+ * @brief  host test of the resumed downloads of https_client_CAREL.c:
+ *           - dwl_check_range on the Content-Range of a 206: the first
+ *             byte, the length of the body, the "*" size, the end of the
+ *             file and the numbers that overflow 32 bit
+ *           - HttpsClient__DownloadFile with the stub server, broken once
+ *             and resumed with a Range request: the file is complete if
+ *             the Content-Range matches, a wrong one restarts it from the
+ *             beginning. The sha-256 of the request is checked on the
+ *             whole file
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* the copy in https_client/, the static functions are tested too */
+#include "https_client_CAREL.c"
+
+#define FILE_SIZE			1500
+
+static C_BYTE file[FILE_SIZE];
+
+/* the server: the file, from pos, and the Content-Range of a 206 */
+typedef struct{
+	size_t pos;
+	size_t break_at;		// the connection drops once here, 0 never
+	C_BYTE range;			// the request has a Range
+	int first_delta;		// added to the first byte of the Content-Range
+	C_CHAR content_range[48];
+	int sessions;
+}server_t;
+
+static server_t srv;
+
+/* ==== stubs of the platform ==== */
+
+void Sys__Delay(C_UINT32 delay) {}
+void BinaryModel_SetCrcCache(uint16_t crc) {}
+C_RES NVM__ReadU8Value(const C_CHAR* var, C_BYTE* val)		{ *val = CERT_1; return C_SUCCESS; }
+C_RES NVM__WriteU8Value(const C_CHAR* var, C_BYTE val)		{ return C_SUCCESS; }
+
+C_RES FS_ReplaceFile(const char* tmp_name, const char* filename)
+{
+	return (0 == rename(tmp_name, filename)) ? C_SUCCESS : C_FAIL;
+}
+
+http_client_handle_t http_client_init_IS(c_http_client_config_t *config, C_BYTE cert_num)
+{
+	srv.sessions++;
+	srv.range = 0;
+	srv.pos = 0;
+	return &srv;
+}
+
+C_INT32 http_client_set_header_IS(http_client_handle_t client, const C_CHAR *key, const C_CHAR *value)
+{
+	unsigned from;
+
+	if ((0 == strcmp(key, "Range")) && (1 == sscanf(value, "bytes=%u-", &from)))
+	{
+		srv.range = 1;
+		srv.pos = from;
+	}
+	return C_SUCCESS;
+}
+
+C_INT32 http_client_open_IS(http_client_handle_t client, C_INT32 write_len)
+{
+	if (srv.range)
+		snprintf(srv.content_range, sizeof(srv.content_range), "bytes %d-%u/%u",
+				 (int)srv.pos + srv.first_delta, (unsigned)(FILE_SIZE - 1), (unsigned)FILE_SIZE);
+	else
+		srv.content_range[0] = 0;
+	return C_SUCCESS;
+}
+
+C_INT32 http_client_fetch_headers_IS(http_client_handle_t client)			{ return (C_INT32)(FILE_SIZE - srv.pos); }
+C_INT32 http_client_get_status_IS(http_client_handle_t client)				{ return srv.range ? 206 : 200; }
+const C_CHAR* http_client_get_content_range_IS(http_client_handle_t client)	{ return srv.content_range; }
+C_INT32 http_client_close_IS(http_client_handle_t client)					{ return C_SUCCESS; }
+C_INT32 http_client_cleanup_IS(http_client_handle_t client)					{ return C_SUCCESS; }
+
+C_INT32 http_client_read_IS(http_client_handle_t client, C_CHAR *buffer, C_INT32 len)
+{
+	C_INT32 n = len;
+
+	if ((srv.break_at != 0) && (srv.pos >= srv.break_at))
+	{
+		srv.break_at = 0;
+		return C_FAIL;
+	}
+
+	if ((size_t)n > FILE_SIZE - srv.pos)
+		n = (C_INT32)(FILE_SIZE - srv.pos);
+	memcpy(buffer, file + srv.pos, n);
+	srv.pos += n;
+	return n;
+}
+
+/* ==== the tests ==== */
+
+static int range(const C_CHAR *cr, C_UINT32 from, C_INT32 content_length, C_RES expected)
+{
+	C_RES res = dwl_check_range(cr, from, content_length);
+
+	printf("%s Content-Range \"%s\" from %u, %d bytes: %s\n", (res != expected) ? "FAIL" : "ok  ",
+		   cr, (unsigned)from, (int)content_length, (res == C_SUCCESS) ? "accepted" : "refused");
+	return (res != expected);
+}
+
+static int download(const char *name, size_t break_at, int first_delta, const C_CHAR *sha, int sessions, C_RES expected)
+{
+	c_cborreqdwldevsconfig cfg = { 0 };
+	C_BYTE got[FILE_SIZE + 1];
+	FILE *fp;
+	size_t len = 0;
+	C_RES res;
+	int err = 0;
+
+	memset(&srv, 0, sizeof(srv));
+	srv.break_at = break_at;
+	srv.first_delta = first_delta;
+	strcpy((char*)cfg.uri, "https://server/file");
+	strcpy(cfg.sha, sha);
+	remove(LOGIN_HTML);
+
+	res = HttpsClient__DownloadFile(&cfg, CERT_1, LOGIN_HTML);
+
+	fp = fopen(LOGIN_HTML, "rb");
+	if (fp != NULL)
+	{
+		len = fread(got, 1, sizeof(got), fp);
+		fclose(fp);
+	}
+	if ((res != expected) || (srv.sessions != sessions))
+		err++;
+	if ((expected == CONN_OK) && ((len != FILE_SIZE) || memcmp(got, file, FILE_SIZE)))
+		err++;
+	if ((expected != CONN_OK) && (fp != NULL))
+		err++;
+
+	printf("%s %s: res %d, %d sessions, file %u bytes\n", err ? "FAIL" : "ok  ", name, res, srv.sessions, (unsigned)len);
+	remove(LOGIN_HTML);
+	return err;
+}
+
+int main(void)
+{
+	C_BYTE digest[SHA256_DIGEST_LEN];
+	C_CHAR sha[2 * SHA256_DIGEST_LEN + 1];
+	int err = 0;
+
+	for (size_t i = 0; i < FILE_SIZE; i++)
+		file[i] = (C_BYTE)(i * 7 + (i >> 8));
+
+	mbedtls_sha256_ret(file, FILE_SIZE, digest, 0);
+	for (int i = 0; i < SHA256_DIGEST_LEN; i++)
+		sprintf(&sha[2 * i], "%02x", digest[i]);
+
+	err += range("bytes 1000-1499/1500", 1000, 500, C_SUCCESS);
+	err += range("bytes 1000-1499/*", 1000, 500, C_SUCCESS);
+	err += range("bytes 0-0/1", 0, 1, C_SUCCESS);
+	err += range("bytes 4294967294-4294967294/4294967295", 4294967294u, 1, C_SUCCESS);
+	err += range("bytes 999-1499/1500", 1000, 500, C_FAIL);			// wrong first byte
+	err += range("bytes 1001-1499/1500", 1000, 500, C_FAIL);
+	err += range("bytes 1000-1498/1500", 1000, 500, C_FAIL);		// length mismatch
+	err += range("bytes 1000-1499/1500", 1000, 499, C_FAIL);
+	err += range("bytes 1000-999/1500", 1000, 0, C_FAIL);
+	err += range("bytes 1000-1499/1600", 1000, 500, C_FAIL);		// not the end of the file
+	err += range("bytes 1000-1499/1499", 1000, 500, C_FAIL);
+	err += range("bytes 1000-1499/*x", 1000, 500, C_FAIL);
+	err += range("bytes 1000-1499/1500 ", 1000, 500, C_FAIL);
+	err += range("bytes 1000-1499/", 1000, 500, C_FAIL);
+	err += range("bytes 1000-4294967296/*", 1000, 500, C_FAIL);		// overflow
+	err += range("bytes 4294967296-4294967296/*", 0, 1, C_FAIL);
+	err += range("bytes 1000-1499/4294967296", 1000, 500, C_FAIL);
+	err += range("bytes 99999999999999999999-1499/1500", 1000, 500, C_FAIL);
+	err += range("bytes -1499/1500", 1000, 500, C_FAIL);
+	err += range("bytes 1000-1499", 1000, 500, C_FAIL);
+	err += range("items 1000-1499/1500", 1000, 500, C_FAIL);
+	err += range("", 1000, 500, C_FAIL);
+
+	err += download("complete", 0, 0, "", 1, CONN_OK);
+	err += download("resumed", FILE_SIZE / 2, 0, sha, 2, CONN_OK);
+	// the partial body is refused, the next session starts again from the beginning
+	err += download("resumed, wrong first byte", FILE_SIZE / 2, 1, sha, 3, CONN_OK);
+	sha[5] = (sha[5] == '0') ? '1' : '0';
+	err += download("resumed, wrong sha-256", FILE_SIZE / 2, 0, sha, 2, WRONG_CRC);
+
+	printf("%s\n", err ? "https_client_test FAILED" : "https_client_test OK");
+	return err ? 1 : 0;
+}
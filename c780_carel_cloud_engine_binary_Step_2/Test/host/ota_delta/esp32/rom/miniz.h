@@ -0,0 +1,12 @@
+/**
+ * @file   miniz.h
+ * @brief  host stub: the tinfl of the ROM is the one of miniz.c
+ *         (flasher stub of esptool), built apart
+ */
+#ifndef _ROM_MINIZ_H_
+#define _ROM_MINIZ_H_
+
+#define MINIZ_HEADER_FILE_ONLY
+#include "miniz.c"
+
+#endif
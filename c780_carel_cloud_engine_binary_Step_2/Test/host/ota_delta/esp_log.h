@@ -0,0 +1,12 @@
+/**
+ * @file   esp_log.h
+ * @brief  host stub, the logs are dropped
+ */
+#ifndef __ESP_LOG_H__
+#define __ESP_LOG_H__
+
+#define ESP_LOGE(tag, ...)	((void)(tag))
+#define ESP_LOGW(tag, ...)	((void)(tag))
+#define ESP_LOGI(tag, ...)	((void)(tag))
+
+#endif
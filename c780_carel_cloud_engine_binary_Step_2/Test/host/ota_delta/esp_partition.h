@@ -0,0 +1,25 @@
+/**
+ * @file   esp_partition.h
+ * @brief  host stub: the partitions are buffers of ota_delta_test.c
+ */
+#ifndef __ESP_PARTITION_H__
+#define __ESP_PARTITION_H__
+
+#include <stdint.h>
+#include <stddef.h>
+
+typedef int esp_err_t;
+#define ESP_OK		0
+#define ESP_FAIL	-1
+
+typedef struct{
+	uint32_t address;
+	uint32_t size;
+	uint8_t *mem;
+	uint32_t len;		// bytes of the image, the sha-256 is computed on them
+}esp_partition_t;
+
+esp_err_t esp_partition_read(const esp_partition_t *partition, size_t src_offset, void *dst, size_t size);
+esp_err_t esp_partition_get_sha256(const esp_partition_t *partition, uint8_t *sha_256);
+
+#endif
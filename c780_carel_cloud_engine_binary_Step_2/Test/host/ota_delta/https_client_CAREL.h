@@ -0,0 +1,17 @@
+/**
+ * @file   https_client_CAREL.h
+ * @brief  host stub: only the errors of a download
+ */
+#ifndef MAIN_HTTPS_CLIENT_C_
+#define MAIN_HTTPS_CLIENT_C_
+
+typedef enum https_conn_err_s{
+	CONN_OK = 0,
+	CONN_FAIL,
+	FILE_NOT_SAVED,
+	NO_HEAP_MEMORY,
+	WRONG_CRC,
+	WRONG_FILE,
+}https_conn_err_t;
+
+#endif
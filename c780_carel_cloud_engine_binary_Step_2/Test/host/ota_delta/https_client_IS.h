@@ -0,0 +1,28 @@
+/**
+ * @file   https_client_IS.h
+ * @brief  host stub: the http client of ota_delta_test.c
+ */
+#ifndef __HTTP_CLIENT_IS
+#define __HTTP_CLIENT_IS
+
+#include "CAREL_GLOBAL_DEF.h"
+
+typedef struct {
+	const char *url;
+	const char *username;
+	const char *password;
+	int cert_num;
+} c_http_client_config_t;
+
+typedef void* http_client_handle_t;
+
+http_client_handle_t http_client_init_IS(c_http_client_config_t *config, C_BYTE cert_num);
+C_INT32 http_client_open_IS(http_client_handle_t client, C_INT32 write_len);
+C_INT32 http_client_fetch_headers_IS(http_client_handle_t client);
+C_INT32 http_client_read_IS(http_client_handle_t client, C_CHAR *buffer, C_INT32 len);
+C_INT32 http_client_set_header_IS(http_client_handle_t client, const C_CHAR *key, const C_CHAR *value);
+C_INT32 http_client_get_status_IS(http_client_handle_t client);
+C_INT32 http_client_close_IS(http_client_handle_t client);
+C_INT32 http_client_cleanup_IS(http_client_handle_t client);
+
+#endif
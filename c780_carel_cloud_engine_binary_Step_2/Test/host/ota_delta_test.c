@@ -0,0 +1,376 @@
+/**
+ * @file   ota_delta_test.c
+ * @author carel
+ * @date   18 Oct 2026
+ * @brief  host round trip of the delta update (ota_delta_IS.c):
+ *           - a new image is made from a random running one (changed
+ *             bytes, inserted code, a moved block), the patch is built
+ *             in the format of ota_delta_IS.h and deflated with miniz
+ *           - OTA__DeltaUpdate applies it on the partitions in RAM, the
+ *             server of the stub streams it in pieces of a few sizes and
+ *             breaks the connection once, the download is resumed with
+ *             a Range request
+ *           - the sha-256 of the rebuilt image must be the one of the new
+ *             image, and the expected one in hex (Sha256__MatchHex)
+ *           - a wrong expected sha, a patch for another image, a corrupted
+ *             patch and a server that can't resume are refused, and the
+ *             boot partition is not changed
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ota_delta_IS.h"
+#include "sha256_CAREL.h"
+#include "esp_ota_ops.h"
+#include "esp32/rom/miniz.h"
+#include "mbedtls/sha256.h"
+
+#define OLD_SIZE			(96 * 1024)
+#define PART_SIZE			(192 * 1024)
+
+#define INSERT_AT			60000
+#define INSERT_LEN			3000
+#define MOVED_FROM			80000
+
+static C_BYTE old_img[OLD_SIZE];
+static C_BYTE new_img[PART_SIZE];
+static C_UINT32 new_len;
+
+static C_BYTE run_mem[PART_SIZE];
+static C_BYTE upd_mem[PART_SIZE];
+static esp_partition_t run_part = { 0x10000, PART_SIZE, run_mem, 0 };
+static esp_partition_t upd_part = { 0x40000, PART_SIZE, upd_mem, 0 };
+static const esp_partition_t *boot_part;
+
+// miniz of the flasher stub has no malloc
+static tdefl_compressor deflator;
+static C_BYTE patch_z[PART_SIZE * 2];
+
+/* the server: the patch, streamed in pieces of chunk bytes */
+typedef struct{
+	C_BYTE *patch;
+	size_t len;
+	size_t pos;
+	C_INT32 chunk;
+	size_t break_at;		// the connection drops once here, 0 never
+	C_INT32 resume_status;	// answer to a Range request, 206 or 200
+	C_BYTE range;			// the request has a Range
+	int sessions;
+}server_t;
+
+static server_t srv;
+
+static C_UINT32 rnd_state = 0x2545F491;
+
+static C_UINT32 rnd(void)
+{
+	rnd_state ^= rnd_state << 13;
+	rnd_state ^= rnd_state >> 17;
+	rnd_state ^= rnd_state << 5;
+	return rnd_state;
+}
+
+static void sha256(const C_BYTE *p, size_t n, C_BYTE *digest)
+{
+	mbedtls_sha256_ret(p, n, digest, 0);
+}
+
+static void sha_hex(const C_BYTE *digest, C_CHAR *hex, C_BYTE upper)
+{
+	for (int i = 0; i < SHA256_DIGEST_LEN; i++)
+		sprintf(&hex[2 * i], upper ? "%02X" : "%02x", digest[i]);
+}
+
+/* ==== stubs of the platform ==== */
+
+esp_err_t esp_partition_read(const esp_partition_t *p, size_t off, void *dst, size_t n)
+{
+	if (off + n > p->size)
+		return ESP_FAIL;
+	memcpy(dst, p->mem + off, n);
+	return ESP_OK;
+}
+
+esp_err_t esp_partition_get_sha256(const esp_partition_t *p, uint8_t *digest)
+{
+	sha256(p->mem, p->len, digest);
+	return ESP_OK;
+}
+
+const esp_partition_t* esp_ota_get_running_partition(void)					{ return &run_part; }
+const esp_partition_t* esp_ota_get_next_update_partition(const esp_partition_t *p)	{ return &upd_part; }
+
+esp_err_t esp_ota_begin(const esp_partition_t *p, size_t size, esp_ota_handle_t *h)
+{
+	memset(upd_mem, 0xFF, sizeof(upd_mem));
+	upd_part.len = 0;
+	*h = 1;
+	return ESP_OK;
+}
+
+esp_err_t esp_ota_write(esp_ota_handle_t h, const void *data, size_t n)
+{
+	if (upd_part.len + n > upd_part.size)
+		return ESP_FAIL;
+	memcpy(upd_mem + upd_part.len, data, n);
+	upd_part.len += n;
+	return ESP_OK;
+}
+
+esp_err_t esp_ota_end(esp_ota_handle_t h)							{ return ESP_OK; }
+esp_err_t esp_ota_set_boot_partition(const esp_partition_t *p)		{ boot_part = p; return ESP_OK; }
+
+void Sys__Delay(C_UINT32 delay) {}
+
+http_client_handle_t http_client_init_IS(c_http_client_config_t *config, C_BYTE cert_num)
+{
+	srv.sessions++;
+	srv.range = 0;
+	return &srv;
+}
+
+C_INT32 http_client_set_header_IS(http_client_handle_t client, const C_CHAR *key, const C_CHAR *value)
+{
+	unsigned from;
+
+	if ((0 == strcmp(key, "Range")) && (1 == sscanf(value, "bytes=%u-", &from)))
+	{
+		srv.range = 1;
+		srv.pos = from;
+	}
+	return C_SUCCESS;
+}
+
+C_INT32 http_client_open_IS(http_client_handle_t client, C_INT32 write_len)
+{
+	// without Range, or if the server can't resume, it sends everything
+	if (!srv.range || (srv.resume_status == 200))
+		srv.pos = 0;
+	return C_SUCCESS;
+}
+
+C_INT32 http_client_fetch_headers_IS(http_client_handle_t client)	{ return (C_INT32)(srv.len - srv.pos); }
+C_INT32 http_client_get_status_IS(http_client_handle_t client)		{ return srv.range ? srv.resume_status : 200; }
+C_INT32 http_client_close_IS(http_client_handle_t client)			{ return C_SUCCESS; }
+C_INT32 http_client_cleanup_IS(http_client_handle_t client)			{ return C_SUCCESS; }
+
+C_INT32 http_client_read_IS(http_client_handle_t client, C_CHAR *buffer, C_INT32 len)
+{
+	C_INT32 n = (len < srv.chunk) ? len : srv.chunk;
+
+	if ((srv.break_at != 0) && (srv.pos >= srv.break_at))
+	{
+		srv.break_at = 0;
+		return C_FAIL;
+	}
+
+	if ((size_t)n > srv.len - srv.pos)
+		n = (C_INT32)(srv.len - srv.pos);
+	memcpy(buffer, srv.patch + srv.pos, n);
+	srv.pos += n;
+	return n;
+}
+
+/* ==== the patch ==== */
+
+static void put_u32(C_BYTE *p, C_UINT32 v)
+{
+	p[0] = (C_BYTE)v;
+	p[1] = (C_BYTE)(v >> 8);
+	p[2] = (C_BYTE)(v >> 16);
+	p[3] = (C_BYTE)(v >> 24);
+}
+
+/*
+ * a block of the patch: diff bytes from the running image at old_pos,
+ * extra bytes copied, then the running image moves of seek
+ */
+static C_UINT32 put_block(C_BYTE *p, C_UINT32 *old_pos, C_UINT32 *new_pos, C_UINT32 diff, C_UINT32 extra, C_INT32 seek)
+{
+	C_UINT32 n = 12, i;
+
+	put_u32(&p[0], diff);
+	put_u32(&p[4], extra);
+	put_u32(&p[8], (C_UINT32)seek);
+
+	for (i = 0; i < diff; i++)
+		p[n++] = (C_BYTE)(new_img[*new_pos + i] - old_img[*old_pos + i]);
+	*old_pos += diff;
+	*new_pos += diff;
+
+	memcpy(&p[n], &new_img[*new_pos], extra);
+	n += extra;
+	*new_pos += extra;
+
+	*old_pos += seek;
+	return n;
+}
+
+static mz_bool put_deflated(const void *buf, int len, void *user)
+{
+	size_t *zlen = user;
+
+	if (*zlen + len > sizeof(patch_z))
+		return MZ_FALSE;
+	memcpy(&patch_z[*zlen], buf, len);
+	*zlen += len;
+	return MZ_TRUE;
+}
+
+/*
+ * the new image: the running one up to INSERT_AT with some bytes changed,
+ * INSERT_LEN new bytes, then the running one from MOVED_FROM to the end
+ * and again its first 4K (moved back)
+ */
+static C_BYTE *make_patch(size_t *zlen)
+{
+	C_BYTE *raw = malloc(PART_SIZE * 2);
+	C_UINT32 n, old_pos = 0, new_pos = 0, i;
+
+	for (i = 0; i < OLD_SIZE; i++)
+		old_img[i] = (C_BYTE)rnd();
+
+	memcpy(new_img, old_img, INSERT_AT);
+	for (i = 0; i < INSERT_AT; i += 997)
+		new_img[i] += 3;
+	for (i = 0; i < INSERT_LEN; i++)
+		new_img[INSERT_AT + i] = (C_BYTE)rnd();
+	memcpy(&new_img[INSERT_AT + INSERT_LEN], &old_img[MOVED_FROM], OLD_SIZE - MOVED_FROM);
+	new_len = INSERT_AT + INSERT_LEN + (OLD_SIZE - MOVED_FROM);
+	memcpy(&new_img[new_len], old_img, 4096);
+	new_len += 4096;
+
+	memcpy(raw, OTA_DELTA_MAGIC, 4);
+	put_u32(&raw[4], new_len);
+	sha256(old_img, OLD_SIZE, &raw[8]);
+	sha256(new_img, new_len, &raw[8 + SHA256_DIGEST_LEN]);
+	n = 8 + 2 * SHA256_DIGEST_LEN;
+
+	n += put_block(&raw[n], &old_pos, &new_pos, INSERT_AT, INSERT_LEN, MOVED_FROM - INSERT_AT);
+	n += put_block(&raw[n], &old_pos, &new_pos, OLD_SIZE - MOVED_FROM, 0, -(C_INT32)OLD_SIZE);
+	n += put_block(&raw[n], &old_pos, &new_pos, 4096, 0, 0);
+
+	*zlen = 0;
+	if ((TDEFL_STATUS_OKAY != tdefl_init(&deflator, put_deflated, zlen, TDEFL_WRITE_ZLIB_HEADER | 128)) ||
+		(TDEFL_STATUS_DONE != tdefl_compress_buffer(&deflator, raw, n, TDEFL_FINISH)))
+		*zlen = 0;
+
+	printf("patch: image %u -> %u bytes, patch %u, deflated %u\n",
+		   (unsigned)OLD_SIZE, (unsigned)new_len, (unsigned)n, (unsigned)*zlen);
+	free(raw);
+	return patch_z;
+}
+
+/* ==== the tests ==== */
+
+static int run(const char *name, C_BYTE *patch, size_t len, C_INT32 chunk, size_t break_at,
+			   C_INT32 resume_status, const C_CHAR *sha, C_RES expected)
+{
+	C_BYTE digest[SHA256_DIGEST_LEN], new_sha[SHA256_DIGEST_LEN];
+	c_http_client_config_t config = { 0 };
+	C_RES res;
+	int err = 0;
+
+	memset(&srv, 0, sizeof(srv));
+	srv.patch = patch;
+	srv.len = len;
+	srv.chunk = chunk;
+	srv.break_at = break_at;
+	srv.resume_status = resume_status;
+	boot_part = NULL;
+
+	res = OTA__DeltaUpdate(&config, sha);
+
+	if (res != expected)
+		err++;
+
+	if (expected == C_SUCCESS)
+	{
+		sha256(new_img, new_len, new_sha);
+		esp_partition_get_sha256(&upd_part, digest);
+		if ((upd_part.len != new_len) || memcmp(digest, new_sha, sizeof(digest)) || (boot_part != &upd_part))
+			err++;
+	}
+	else if (boot_part != NULL)
+		err++;
+
+	printf("%s %s: res %d, %d sessions, image %u bytes\n", err ? "FAIL" : "ok  ", name, res, srv.sessions, (unsigned)upd_part.len);
+	return err;
+}
+
+static int check_match_hex(void)
+{
+	C_BYTE digest[SHA256_DIGEST_LEN];
+	C_CHAR hex[2 * SHA256_DIGEST_LEN + 1];
+	int err = 0;
+
+	sha256((const C_BYTE*)"abc", 3, digest);
+	sha_hex(digest, hex, 0);
+	err += (C_SUCCESS != Sha256__MatchHex(digest, hex));
+	err += (0 != strcmp(hex, "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad"));
+	sha_hex(digest, hex, 1);
+	err += (C_SUCCESS != Sha256__MatchHex(digest, hex));
+	hex[63] = 0;
+	err += (C_FAIL != Sha256__MatchHex(digest, hex));
+	err += (C_FAIL != Sha256__MatchHex(digest, ""));
+	sha_hex(digest, hex, 0);
+	hex[10] = 'g';
+	err += (C_FAIL != Sha256__MatchHex(digest, hex));
+
+	printf("%s Sha256__MatchHex\n", err ? "FAIL" : "ok  ");
+	return err;
+}
+
+int main(void)
+{
+	static const C_INT32 chunks[] = { 1, 7, 100, OTA_DELTA_CHUNK_SIZE };
+	C_BYTE digest[SHA256_DIGEST_LEN];
+	C_CHAR sha[2 * SHA256_DIGEST_LEN + 1], wrong[2 * SHA256_DIGEST_LEN + 1];
+	C_CHAR name[64];
+	C_BYTE *patch, *bad;
+	size_t len;
+	int err = 0;
+
+	err += check_match_hex();
+
+	patch = make_patch(&len);
+	if (len == 0)
+	{
+		printf("FAIL the patch can't be deflated\nota_delta_test FAILED\n");
+		return 1;
+	}
+	bad = malloc(len);
+	memcpy(run_mem, old_img, OLD_SIZE);
+	run_part.len = OLD_SIZE;
+
+	sha256(new_img, new_len, digest);
+	sha_hex(digest, sha, 1);
+	strcpy(wrong, sha);
+	wrong[0] = (wrong[0] == '0') ? '1' : '0';
+
+	for (size_t i = 0; i < sizeof(chunks) / sizeof(chunks[0]); i++)
+	{
+		snprintf(name, sizeof(name), "round trip, %d bytes reads", (int)chunks[i]);
+		err += run(name, patch, len, chunks[i], 0, 206, "", C_SUCCESS);
+		snprintf(name, sizeof(name), "resumed at %u, %d bytes reads", (unsigned)(len / 2), (int)chunks[i]);
+		err += run(name, patch, len, chunks[i], len / 2, 206, sha, C_SUCCESS);
+	}
+
+	err += run("wrong expected sha", patch, len, OTA_DELTA_CHUNK_SIZE, 0, 206, wrong, C_FAIL);
+	err += run("server can't resume", patch, len, OTA_DELTA_CHUNK_SIZE, len / 2, 200, "", C_FAIL);
+
+	memcpy(bad, patch, len);
+	bad[len / 3] ^= 0x55;
+	err += run("corrupted patch", bad, len, OTA_DELTA_CHUNK_SIZE, 0, 206, "", C_FAIL);
+
+	run_mem[1234] ^= 1;
+	err += run("patch of another image", patch, len, OTA_DELTA_CHUNK_SIZE, 0, 206, "", C_FAIL);
+	run_mem[1234] ^= 1;
+
+	free(bad);
+
+	printf("%s\n", err ? "ota_delta_test FAILED" : "ota_delta_test OK");
+	return err ? 1 : 0;
+}
@@ -0,0 +1,14 @@
+/**
+ * @file   MQTT_Interface_CAREL.h
+ * @brief  host stub: the alarms, the values and the flags sent by the polling
+ */
+#ifndef __MQTT_INTERFACE_CAREL_H
+#define __MQTT_INTERFACE_CAREL_H
+
+#include "CBOR_CAREL.h"
+
+void MQTT_Alarms(c_cboralarms alarms);
+void MQTT_FlushValues(void);
+C_BYTE MQTT_GetFlags(void);
+
+#endif
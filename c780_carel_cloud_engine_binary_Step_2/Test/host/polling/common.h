@@ -0,0 +1,22 @@
+/**
+ * @file   common.h
+ * @brief  host stub: the libc headers and the FreeRTOS/newlib functions the polling uses
+ */
+#ifndef COMMON_H_
+#define COMMON_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <math.h>
+
+/* newlib and FreeRTOS */
+char *itoa(int value, char *str, int base);
+unsigned int uxTaskGetStackHighWaterMark(void *task);
+
+#include "gme_config.h"
+#include "CAREL_GLOBAL_DEF.h"
+
+#endif
@@ -0,0 +1,13 @@
+/**
+ * @file   gme_config.h
+ * @brief  host stub: the options of the polling
+ */
+#ifndef MAIN_GME_CONFIG_H_
+#define MAIN_GME_CONFIG_H_
+
+#define POLL_ENGINE_PRINTF_DEFAULT	0
+#define PASS_MODE_TIMER				(60)
+#define MB_BAUDRATE					19200
+#define CONFIG_GME_POLL_TASK_PRIO	5
+
+#endif
@@ -0,0 +1,56 @@
+/**
+ * @file   mb_m.h
+ * @brief  host stub: the function codes and the errors of the freemodbus master
+ */
+#ifndef _MB_M_H
+#define _MB_M_H
+
+#define MB_FUNC_READ_COILS                    (  1 )
+#define MB_FUNC_READ_DISCRETE_INPUTS          (  2 )
+#define MB_FUNC_WRITE_SINGLE_COIL             (  5 )
+#define MB_FUNC_WRITE_MULTIPLE_COILS          ( 15 )
+#define MB_FUNC_READ_HOLDING_REGISTER         (  3 )
+#define MB_FUNC_READ_INPUT_REGISTER           (  4 )
+#define MB_FUNC_WRITE_REGISTER                (  6 )
+#define MB_FUNC_WRITE_MULTIPLE_REGISTERS      ( 16 )
+
+typedef enum
+{
+    MB_EX_NONE = 0x00,
+    MB_EX_ILLEGAL_FUNCTION = 0x01,
+    MB_EX_ILLEGAL_DATA_ADDRESS = 0x02,
+    MB_EX_ILLEGAL_DATA_VALUE = 0x03,
+    MB_EX_SLAVE_DEVICE_FAILURE = 0x04,
+    MB_EX_ACKNOWLEDGE = 0x05,
+    MB_EX_SLAVE_BUSY = 0x06,
+    MB_EX_MEMORY_PARITY_ERROR = 0x08,
+    MB_EX_GATEWAY_PATH_FAILED = 0x0A,
+    MB_EX_GATEWAY_TGT_FAILED = 0x0B
+} eMBException;
+
+typedef enum
+{
+    MB_ENOERR,
+    MB_ENOREG,
+    MB_EINVAL,
+    MB_EPORTERR,
+    MB_ENORES,
+    MB_EIO,
+    MB_EILLSTATE,
+    MB_ETIMEDOUT,
+} eMBErrorCode;
+
+typedef enum
+{
+    MB_MRE_NO_ERR,
+    MB_MRE_NO_REG,
+    MB_MRE_ILL_ARG,
+    MB_MRE_REV_DATA,
+    MB_MRE_TIMEDOUT,
+    MB_MRE_MASTER_BUSY,
+    MB_MRE_EXE_FUN
+} eMBMasterReqErrCode;
+
+void vMBMasterRunResRelease(void);
+
+#endif
@@ -0,0 +1,10 @@
+/**
+ * @file   mbcontroller.h
+ * @brief  host stub: only the type of the parameter descriptor
+ */
+#ifndef _MODBUS_CONTROLLER_COMMON
+#define _MODBUS_CONTROLLER_COMMON
+
+typedef struct mb_parameter_descriptor_s mb_parameter_descriptor_t;
+
+#endif
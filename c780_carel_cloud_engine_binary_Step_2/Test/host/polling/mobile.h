@@ -0,0 +1,12 @@
+/**
+ * @file   mobile.h
+ * @brief  host stub: only the command mode of the mobile app
+ */
+#ifndef MAIN_MOBILE_H_
+#define MAIN_MOBILE_H_
+
+#include <stdint.h>
+
+uint8_t Mobile_GetCommandMode(void);
+
+#endif
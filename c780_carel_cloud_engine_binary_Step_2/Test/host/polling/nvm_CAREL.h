@@ -0,0 +1,20 @@
+/**
+ * @file   nvm_CAREL.h
+ * @brief  host stub: the keys and the functions of the NVM the polling uses
+ */
+#ifndef MAIN_NVM_CAREL_H_
+#define MAIN_NVM_CAREL_H_
+
+#include "data_types_CAREL.h"
+
+#define MB_BAUDRATE_NVM	"mb_baud"
+#define AGG_WINDOW_NVM	"agg_win"
+#define AGG_POLICY_NVM	"agg_pol"
+#define PE_STATUS_NVM	"pe_status"
+
+C_RES NVM__ReadU8Value(const C_CHAR* var, C_BYTE* val);
+C_RES NVM__WriteU8Value(const C_CHAR* var, C_BYTE val);
+C_RES NVM__ReadU32Value(const C_CHAR* var, C_UINT32* val);
+C_RES NVM__WriteU32Value(const C_CHAR* var, C_UINT32 val);
+
+#endif
@@ -0,0 +1,12 @@
+/**
+ * @file   utilities_CAREL.h
+ * @brief  host stub: only the gateway configuration
+ */
+#ifndef MAIN_UTILITIES_H_
+#define MAIN_UTILITIES_H_
+
+#include "CBOR_CAREL.h"
+
+req_set_gw_config_t* Utilities__GetGWConfigData(void);
+
+#endif
@@ -0,0 +1,573 @@
+/**
+ * @file   polling_test.c
+ * @author carel
+ * @date   18 Oct 2026
+ * @brief  host test of the poll tables of polling_CAREL.c:
+ *           - the arena of PollEngine__CreateTables: its size, every array
+ *             inside it, aligned and apart from the others, the hot arrays
+ *             (values and errors) before the cold ones (model records and
+ *             alarms)
+ *           - benchmark of the compare pass of the high polling, a new read
+ *             of the same values: check_hr_ir_read_val, and the same
+ *             comparison on the arrays of the arena and on the old layout,
+ *             an array of hr_ir_low_high_poll_t records
+ *           - the alarm blocks: alarm_blocks_build on the span and gap
+ *             limits of the bits and of the registers, the read of the
+ *             blocks from the stub device with alarm_apply (the bits of
+ *             the alarms sharing a HR), the read one by one when the
+ *             device refuses a block with a hole out of its map
+ *
+ *         usage: polling_test [benchmark iterations]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/* the copy in polling/, the static functions are tested too */
+#include "polling_CAREL.c"
+
+#define BENCH_ITERATIONS	20000
+#define BENCH_RUNS			5
+#define MODEL_VARS			64		// of every table of the low and high polling
+#define MODEL_ALARMS		16
+
+static C_BYTE model_num[MAX_POLLING][MAX_REG];
+static r_coil_di model_coil_di[MAX_POLLING][MAX_REG][MODEL_VARS];
+static r_hr_ir model_hr_ir[MAX_POLLING][MAX_REG][MODEL_VARS];
+static r_coil_di_alarm model_coil_di_alarm[MAX_REG][MODEL_ALARMS];
+static r_hr_ir_alarm model_hr_ir_alarm[MAX_REG][MODEL_ALARMS];
+
+/* the device of app_block_read */
+#define DEV_SIZE			1024
+typedef struct{
+	uint8_t bits[2][DEV_SIZE];		// COIL, DI
+	uint16_t regs[2][DEV_SIZE];		// HR, IR
+	uint8_t hole[MAX_REG][DEV_SIZE];	// out of the map, the reads with it are refused
+	int offline;
+	int reqs;
+}device_t;
+
+static device_t dev;
+
+/* ==== stubs of the platform ==== */
+
+void BinaryModel__GetNum(uint8_t num[MAX_POLLING][MAX_REG])	{ memcpy(num, model_num, sizeof(model_num)); }
+
+uint8_t* BinaryModel__GetPtrSec(PollType_t polling_type, RegType_t reg_type)
+{
+	if (polling_type == ALARM_POLLING)
+		return (reg_type == COIL || reg_type == DI) ? (uint8_t*)model_coil_di_alarm[reg_type] : (uint8_t*)model_hr_ir_alarm[reg_type];
+	return (reg_type == COIL || reg_type == DI) ? (uint8_t*)model_coil_di[polling_type][reg_type] : (uint8_t*)model_hr_ir[polling_type][reg_type];
+}
+
+C_RES NVM__ReadU8Value(const C_CHAR* var, C_BYTE* val)		{ return C_FAIL; }
+C_RES NVM__WriteU8Value(const C_CHAR* var, C_BYTE val)		{ return C_SUCCESS; }
+C_RES NVM__ReadU32Value(const C_CHAR* var, C_UINT32* val)	{ return C_FAIL; }
+C_RES NVM__WriteU32Value(const C_CHAR* var, C_UINT32 val)	{ return C_SUCCESS; }
+
+unsigned int uxTaskGetStackHighWaterMark(void *task)	{ return 1000 + 1024 * sizeof(values_buffer_t); }
+char *itoa(int value, char *str, int base)				{ sprintf(str, "%d", value); return str; }
+
+C_TIME RTC_Get_UTC_Current_Time(void)					{ return 1792312345; }
+C_TIME RTC_Get_UTC_Current_Time_ms(C_UINT16 *ms)		{ *ms = 0; return 1792312345; }
+C_UINT64 RTC_Get_Mono_us(void)							{ return 0; }
+C_UINT32 RTC_Get_Uptime_ms(void)						{ return 0; }
+C_TIME RTC_Mono_To_Sample_Time(C_UINT64 mono_us, C_UINT16 *ms)	{ *ms = 0; return 1792312345; }
+C_TIME RTC_Rebase_Sample_Time(C_TIME t, C_UINT16 *ms)	{ return t; }
+
+C_UINT16 Modbus__GetAddress(void)						{ return 1; }
+int app_coil_read(const uint8_t addr, const int index, const int num)						{ return MB_MRE_TIMEDOUT; }
+int app_coil_discrete_input_read(const uint8_t addr, const int index, const int num)		{ return MB_MRE_TIMEDOUT; }
+int app_holding_register_read(const uint8_t addr, const int index, const int num)			{ return MB_MRE_TIMEDOUT; }
+int app_input_register_read(const uint8_t addr, const int index, const int num)				{ return MB_MRE_TIMEDOUT; }
+int app_coil_write(const uint8_t addr, const int index, short newData, int multi)			{ return MB_MRE_TIMEDOUT; }
+int app_hr_write(const uint8_t addr, const int index, C_CHAR num_of , C_UINT16 * newData, int multi)	{ return MB_MRE_TIMEDOUT; }
+int app_block_read(const uint8_t addr, const C_BYTE func, const int index, const int num, C_BYTE *data, C_UINT16 *data_len)
+{
+	const int t = (func == MB_FUNC_READ_COILS) ? COIL : (func == MB_FUNC_READ_DISCRETE_INPUTS) ? DI :
+				  (func == MB_FUNC_READ_HOLDING_REGISTER) ? HR : IR;
+	const int bytes = (t == COIL || t == DI) ? (num + 7) / 8 : 2 * num;
+
+	dev.reqs++;
+	if ((num <= 0) || (index + num > DEV_SIZE) || (*data_len < bytes + 2))
+		return MB_MRE_ILL_ARG;
+	if (dev.offline)
+		return MB_MRE_TIMEDOUT;
+	for (int i = index; i < index + num; i++)
+		if (dev.hole[t][i])
+			return MB_MRE_EXE_FUN;
+
+	memset(data, 0, bytes);
+	for (int i = 0; i < num; i++)
+	{
+		if (t == COIL || t == DI)
+			data[i >> 3] |= (dev.bits[t][index + i] & 1) << (i & 7);
+		else
+		{
+			data[2 * i] = (C_BYTE)(dev.regs[t - HR][index + i] >> 8);
+			data[2 * i + 1] = (C_BYTE)dev.regs[t - HR][index + i];
+		}
+	}
+	*data_len = bytes;
+	return MB_MRE_NO_ERR;
+}
+void vMBMasterRunResRelease(void) {}
+
+C_BYTE ModbusAux__PollNum(void)											{ return 0; }
+C_BOOL ModbusAux__PollChanged(C_BYTE i, C_UINT16 *ali, mb_aux_poll_val_t *val)	{ return C_FALSE; }
+
+void MQTT_Alarms(c_cboralarms alarms) {}
+void MQTT_FlushValues(void) {}
+C_BYTE MQTT_GetFlags(void)								{ return 0; }
+uint8_t Mobile_GetCommandMode(void)						{ return 0; }
+logfile_sm_t Dev_LogFile_GetSM(void)					{ return LOGFILE_IDLE; }
+C_BOOL get_relax(void)									{ return C_FALSE; }
+void set_relax(C_BOOL r) {}
+void mb_rw_call_execute(void) {}
+req_set_gw_config_t* Utilities__GetGWConfigData(void)	{ return NULL; }
+void SoftWDT_Reset(uint8_t which_one) {}
+void RetriveDataDebug(C_INT16 type, C_INT32 val) {}
+void Update_Led_Status(C_UINT16 set_status, C_BYTE status) {}
+void Sys__Delay(C_UINT32 delay) {}
+
+/* ==== the model ==== */
+
+/* the variables of the tables, every read type of the HR/IR */
+static void model_build(void)
+{
+	memset(model_num, 0, sizeof(model_num));
+
+	for (int p = LOW_POLLING; p <= HIGH_POLLING; p++)
+	{
+		for (int t = COIL; t < MAX_REG; t++)
+		{
+			model_num[p][t] = MODEL_VARS;
+			for (int i = 0; i < MODEL_VARS; i++)
+			{
+				r_coil_di *cd = &model_coil_di[p][t][i];
+				r_hr_ir *hi = &model_hr_ir[p][t][i];
+
+				cd->Alias = (uint16_t)(1000 * p + 100 * t + i + 1);
+				cd->Addr = (uint16_t)(2 * i);
+
+				memset(hi, 0, sizeof(*hi));
+				hi->Alias = cd->Alias;
+				hi->Addr = cd->Addr;
+				hi->linA = 1;
+				hi->Hyster = 0.5f;
+				switch (i % 5)
+				{
+					case 0: hi->dim = 32; hi->flag.bit.ieee = 1; break;						// A
+					case 1: hi->dim = 16; hi->flag.bit.fixedpoint = 1; hi->linA = 0.1f; break;	// B
+					case 2: hi->dim = 32; hi->flag.bit.signed_f = 1; break;					// C signed
+					case 3: hi->dim = 16; hi->len = 1; hi->bitposition = i % 16; break;		// D
+					default: hi->dim = 16; hi->flag.bit.signed_f = 1; break;				// F signed
+				}
+			}
+		}
+	}
+
+	for (int t = COIL; t < MAX_REG; t++)
+	{
+		model_num[ALARM_POLLING][t] = MODEL_ALARMS;
+		for (int i = 0; i < MODEL_ALARMS; i++)
+		{
+			model_coil_di_alarm[t][i].Alias = (uint16_t)(3000 + 100 * t + i);
+			model_coil_di_alarm[t][i].Addr = (uint16_t)(4 * i);
+			model_hr_ir_alarm[t][i].Alias = (uint16_t)(3000 + 100 * t + i);
+			model_hr_ir_alarm[t][i].Addr = (uint16_t)(4 * i);
+		}
+	}
+}
+
+/* ==== the arena ==== */
+
+typedef struct{
+	const void *ptr;
+	size_t size;
+	int hot;
+}area_t;
+
+static area_t areas[64];
+static int areas_n;
+
+static void area(const void *ptr, size_t n, size_t size, int hot)
+{
+	if (n != 0)
+		areas[areas_n++] = (area_t){ ptr, n * size, hot };
+}
+
+static int check_arena(void)
+{
+	hr_ir_poll_tables_t   *hr_ir[4]   = {&HRLowPollTab, &HRHighPollTab, &IRLowPollTab, &IRHighPollTab};
+	coil_di_poll_tables_t *coil_di[4] = {&COILLowPollTab, &COILHighPollTab, &DILowPollTab, &DIHighPollTab};
+	uint16_t n_alarm = 4 * MODEL_ALARMS;
+	const uint8_t *base = PollArena;
+	size_t size = poll_tables_layout(PollArena);	// the same pointers, NULL would clear them
+	size_t hot_end = 0, cold_start = size;
+	int err = 0;
+
+	areas_n = 0;
+	for (int i = 0; i < 4; i++)
+	{
+		area(hr_ir[i]->c_value, MODEL_VARS, sizeof(hr_ir_low_high_value_t), 1);
+		area(hr_ir[i]->p_value, MODEL_VARS, sizeof(hr_ir_low_high_value_t), 1);
+		area(hr_ir[i]->error, MODEL_VARS, 1, 1);
+		area(hr_ir[i]->p_error, MODEL_VARS, 1, 1);
+		area(hr_ir[i]->info, MODEL_VARS, sizeof(r_hr_ir), 0);
+		area(hr_ir[i]->read_type, MODEL_VARS, 1, 0);
+		area(coil_di[i]->c_value, MODEL_VARS, 1, 1);
+		area(coil_di[i]->p_value, MODEL_VARS, 1, 1);
+		area(coil_di[i]->error, MODEL_VARS, 1, 1);
+		area(coil_di[i]->p_error, MODEL_VARS, 1, 1);
+		area(coil_di[i]->info, MODEL_VARS, sizeof(r_coil_di), 0);
+	}
+	area(COILAlarmPollTab, MODEL_ALARMS, sizeof(coil_di_alarm_tables_t), 0);
+	area(DIAlarmPollTab, MODEL_ALARMS, sizeof(coil_di_alarm_tables_t), 0);
+	area(HRAlarmPollTab, MODEL_ALARMS, sizeof(hr_ir_alarm_tables_t), 0);
+	area(IRAlarmPollTab, MODEL_ALARMS, sizeof(hr_ir_alarm_tables_t), 0);
+	area(AlarmCur, ALARM_WORDS(n_alarm), sizeof(uint32_t), 0);
+	area(AlarmPrev, ALARM_WORDS(n_alarm), sizeof(uint32_t), 0);
+	area(AlarmOrder, n_alarm, sizeof(uint16_t), 0);
+	area(AlarmBlocks, n_alarm, sizeof(alarm_block_t), 0);
+
+	if ((base == NULL) || (PollStats.arena != size))
+		err++;
+
+	for (int i = 0; i < areas_n; i++)
+	{
+		size_t off = (const uint8_t*)areas[i].ptr - base;
+
+		if ((areas[i].ptr == NULL) || ((const uint8_t*)areas[i].ptr < base) || (off + areas[i].size > size) || (off & 3))
+			err++;
+		for (int j = 0; j < i; j++)
+		{
+			size_t off_j = (const uint8_t*)areas[j].ptr - base;
+			if ((off < off_j + areas[j].size) && (off_j < off + areas[i].size))
+				err++;
+		}
+		if (areas[i].hot && (off + areas[i].size > hot_end))
+			hot_end = off + areas[i].size;
+		if (!areas[i].hot && (off < cold_start))
+			cold_start = off;
+	}
+	if (hot_end > cold_start)
+		err++;
+
+	printf("%s arena: %u bytes, %d arrays inside it, apart and aligned, hot arrays in the first %u bytes\n",
+		   err ? "FAIL" : "ok  ", (unsigned)size, areas_n, (unsigned)hot_end);
+	return err;
+}
+
+/* ==== the benchmark ==== */
+
+static double now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+/* the comparison of the steady state, the same on both layouts */
+#define PASS_CHANGED(type, info, c, p) \
+	(((type) == TYPE_A) ? (fabs(conv_type_a(info, c) - conv_type_a(info, p)) > (info)->Hyster) : \
+	 ((type) == TYPE_B) ? (fabs(conv_type_b(info, c) - conv_type_b(info, p)) > (info)->Hyster) : \
+	 ((type) == TYPE_C_SIGNED) ? (abs(conv_type_c_signed(info, c) - conv_type_c_signed(info, p)) > (info)->Hyster) : \
+	 ((type) == TYPE_D) ? (conv_type_d(info, c) != conv_type_d(info, p)) : \
+	 (abs(conv_type_f_signed(info, c) - conv_type_f_signed(info, p)) > (info)->Hyster))
+
+/* the pass on the arena, the arrays of the table */
+static int arena_pass(hr_ir_poll_tables_t *tab, uint8_t n)
+{
+	int changed = 0;
+
+	for (uint8_t i = 0; i < n; i++)
+	{
+		if (tab->error[i] == 0)
+			changed += PASS_CHANGED(tab->read_type[i], &tab->info[i], tab->c_value[i], tab->p_value[i]);
+		tab->p_error[i] = tab->error[i];
+	}
+	return changed;
+}
+
+/* the pass on the old layout, the records of the registers one after the other */
+static int old_pass(hr_ir_low_high_poll_t *tab, uint8_t n)
+{
+	int changed = 0;
+
+	for (uint8_t i = 0; i < n; i++)
+	{
+		if (tab[i].error == 0)
+			changed += PASS_CHANGED(tab[i].read_type, &tab[i].info, tab[i].c_value, tab[i].p_value);
+		tab[i].p_error = tab[i].error;
+	}
+	return changed;
+}
+
+typedef enum{
+	BENCH_CHECK_HR_IR,		// check_hr_ir_read_val on the arena
+	BENCH_ARENA,			// arena_pass
+	BENCH_OLD,				// old_pass
+}bench_t;
+
+/* a new read of the same values and the pass, min of BENCH_RUNS runs */
+static double bench(bench_t kind, long iterations)
+{
+	hr_ir_poll_tables_t *soa[2] = {&HRHighPollTab, &IRHighPollTab};
+	hr_ir_low_high_poll_t *aos[2];
+	volatile int sink = 0;
+	double best = 1e30;
+
+	for (int t = 0; t < 2; t++)
+	{
+		aos[t] = malloc(MODEL_VARS * sizeof(hr_ir_low_high_poll_t));
+		for (int i = 0; i < MODEL_VARS; i++)
+			aos[t][i] = (hr_ir_low_high_poll_t){ soa[t]->info[i], soa[t]->c_value[i], soa[t]->p_value[i],
+												 soa[t]->read_type[i], 0, 0 };
+	}
+
+	for (int r = 0; r < BENCH_RUNS; r++)
+	{
+		double t0 = now_ns();
+
+		for (long k = 0; k < iterations; k++)
+		{
+			for (int t = 0; t < 2; t++)
+			{
+				if (kind == BENCH_OLD)
+				{
+					for (int i = 0; i < MODEL_VARS; i++)
+						aos[t][i].c_value = aos[t][i].p_value;
+					sink += old_pass(aos[t], MODEL_VARS);
+					continue;
+				}
+				memcpy(soa[t]->c_value, soa[t]->p_value, MODEL_VARS * sizeof(hr_ir_low_high_value_t));
+				if (kind == BENCH_ARENA)
+					sink += arena_pass(soa[t], MODEL_VARS);
+				else
+					check_hr_ir_read_val(soa[t], MODEL_VARS, 0);
+			}
+		}
+		t0 = (now_ns() - t0) / iterations;
+		if (t0 < best)
+			best = t0;
+	}
+
+	free(aos[0]);
+	free(aos[1]);
+	return best;
+}
+
+/* ==== the alarm blocks ==== */
+
+typedef struct{
+	uint16_t start;
+	uint16_t num;
+	uint16_t count;
+	uint8_t type;
+}exp_block_t;
+
+/* the alarms of the model, in a shuffled order to check the sort */
+static const uint16_t coil_addr[] = {385, 0, 257, 64, 129, 384, 193, 321};
+static const uint16_t di_addr[]   = {7, 7};
+static const uint16_t hr_addr[]   = {27, 10, 59, 18, 43, 10, 35, 58, 51, 10};
+static const uint8_t  hr_bit[]    = { 3,  0,  1,  2,  4, 15,  5,  6,  7,  7};
+
+/*
+ * COIL: the gap of 64 bits is in the block, 65 is not, the span of 256 bits
+ *       (129..384) is in, 385 is not
+ * DI:   two alarms of the same input
+ * HR:   the gap of 8 registers is in, 9 is not, the span of 32 registers
+ *       (27..58) is in, 59 is not. Three alarms share the register 10
+ */
+static const exp_block_t exp_blocks[] = {
+	{  0,  65, 2, COIL}, {129, 256, 5, COIL}, {385, 1, 1, COIL},
+	{  7,   1, 2, DI},
+	{ 10,   9, 4, HR},   { 27,  32, 5, HR},   { 59, 1, 1, HR},
+};
+
+static void alarm_model_load(void)
+{
+	#define N(a)	(sizeof(a) / sizeof((a)[0]))
+
+	memset(model_num, 0, sizeof(model_num));
+	model_num[ALARM_POLLING][COIL] = N(coil_addr);
+	model_num[ALARM_POLLING][DI] = N(di_addr);
+	model_num[ALARM_POLLING][HR] = N(hr_addr);
+	for (int i = 0; i < (int)N(coil_addr); i++)
+		model_coil_di_alarm[COIL][i] = (r_coil_di_alarm){ (uint16_t)(100 + i), coil_addr[i] };
+	for (int i = 0; i < (int)N(di_addr); i++)
+		model_coil_di_alarm[DI][i] = (r_coil_di_alarm){ (uint16_t)(200 + i), di_addr[i] };
+	for (int i = 0; i < (int)N(hr_addr); i++)
+		model_hr_ir_alarm[HR][i] = (r_hr_ir_alarm){ (uint16_t)(300 + i), hr_addr[i], hr_bit[i] };
+
+	PollEngine__CreateTables();
+}
+
+static int check_blocks(void)
+{
+	int err = 0;
+
+	if (alarm_block_n != sizeof(exp_blocks) / sizeof(exp_blocks[0]))
+		err++;
+
+	for (uint16_t b = 0; (b < alarm_block_n) && !err; b++)
+	{
+		alarm_block_t *blk = &AlarmBlocks[b];
+		uint16_t alias, addr, prev = 0;
+		uint8_t bit;
+
+		if ((blk->start != exp_blocks[b].start) || (blk->num != exp_blocks[b].num) ||
+			(blk->count != exp_blocks[b].count) || (blk->type != exp_blocks[b].type) || blk->split)
+			err++;
+		// the alarms of the block, sorted and inside it
+		for (uint16_t j = blk->first; j < blk->first + blk->count; j++)
+		{
+			alarm_ref(AlarmOrder[j], &alias, &addr, &bit);
+			if (((AlarmOrder[j] >> 8) != blk->type) || (addr < prev) || (addr < blk->start) || (addr >= blk->start + blk->num))
+				err++;
+			prev = addr;
+		}
+		if ((b > 0) && (blk->first != AlarmBlocks[b - 1].first + AlarmBlocks[b - 1].count))
+			err++;
+	}
+
+	printf("%s alarm blocks: %u blocks on the span and gap limits of bits and registers\n",
+		   err ? "FAIL" : "ok  ", (unsigned)alarm_block_n);
+	return err;
+}
+
+/* the value of the alarm in position j of AlarmOrder on the device */
+static uint8_t dev_alarm(uint16_t j)
+{
+	uint16_t alias, addr;
+	uint8_t bit;
+	int t = AlarmOrder[j] >> 8;
+
+	alarm_ref(AlarmOrder[j], &alias, &addr, &bit);
+	if (t == COIL || t == DI)
+		return dev.bits[t][addr] & 1;
+	return (dev.regs[t - HR][addr] >> bit) & 1;
+}
+
+/*
+ * read all the blocks and check every alarm: its value and error, and its
+ * bit of AlarmCur. The alarms with an error keep the bit of before
+ */
+static int read_alarms(const char *name, int reqs, int exp_res)
+{
+	uint32_t before[ALARM_WORDS(64)];
+	int err = 0, res = MB_MRE_NO_ERR;
+	uint16_t n = 0;
+
+	memcpy(before, AlarmCur, sizeof(uint32_t) * ALARM_WORDS(alarm_n.total));
+	dev.reqs = 0;
+	for (uint16_t b = 0; b < alarm_block_n; b++)
+	{
+		int r = alarm_block_read(&AlarmBlocks[b]);
+		if (r != MB_MRE_NO_ERR)
+			res = r;
+	}
+
+	for (uint16_t j = 0; j < alarm_n.total; j++)
+	{
+		uint16_t alias, addr;
+		uint8_t bit;
+		alarm_read_t *data = alarm_ref(AlarmOrder[j], &alias, &addr, &bit);
+		uint8_t cur = (AlarmCur[j >> 5] >> (j & 31)) & 1;
+		uint8_t exp = data->error ? ((before[j >> 5] >> (j & 31)) & 1) : dev_alarm(j);
+		int t = AlarmOrder[j] >> 8;
+
+		if ((cur != exp) || (!data->error && (data->value != exp)))
+			err++;
+		// only the alarms in a hole or offline have an error
+		if (!dev.offline && (data->error != (dev.hole[t][addr] ? MB_MRE_EXE_FUN : MB_MRE_NO_ERR)))
+			err++;
+		n += cur;
+	}
+	if ((dev.reqs != reqs) || (res != exp_res))
+		err++;
+
+	printf("%s alarms %s: %d requests, result %d, %u active\n", err ? "FAIL" : "ok  ", name, dev.reqs, res, (unsigned)n);
+	return err;
+}
+
+static int check_alarms(void)
+{
+	int err = 0, blocks;
+
+	memset(&dev, 0, sizeof(dev));
+	alarm_model_load();
+	err += check_blocks();
+	blocks = alarm_block_n;
+
+	for (int i = 0; i < DEV_SIZE; i++)
+	{
+		dev.bits[COIL][i] = (uint8_t)(i % 3 == 0);
+		dev.bits[DI][i] = 1;
+	}
+	dev.regs[0][10] = 0x8001;		// bits 0 and 15 of the register 10 on, 7 off
+	dev.regs[0][27] = 0x0008;
+	dev.regs[0][58] = 0x0040;
+	dev.regs[0][59] = 0x0002;
+	err += read_alarms("read by blocks", blocks, MB_MRE_NO_ERR);
+
+	dev.regs[0][10] = 0x0080;		// only the bit 7
+	dev.bits[COIL][0] = 0;
+	dev.bits[COIL][384] = 1;
+	err += read_alarms("changed", blocks, MB_MRE_NO_ERR);
+
+	// a hole of the device inside the second block of coils and of HR
+	dev.hole[COIL][200] = 1;
+	dev.hole[HR][30] = 1;
+	dev.bits[COIL][129] ^= 1;
+	dev.regs[0][43] = 0x0010;
+	err += read_alarms("split on a hole", blocks + 5 + 5, MB_MRE_NO_ERR);
+	if (!AlarmBlocks[1].split || !AlarmBlocks[5].split || AlarmBlocks[0].split)
+		err++;
+	// the blocks split stay split, no block request any more
+	err += read_alarms("split, next scan", blocks - 2 + 5 + 5, MB_MRE_NO_ERR);
+
+	// an alarm out of the map: only its error, the others of the split block are read
+	dev.hole[COIL][257] = 1;
+	dev.bits[COIL][321] ^= 1;
+	err += read_alarms("split, alarm out of the map", blocks - 2 + 5 + 5, MB_MRE_EXE_FUN);
+
+	// offline: 3 tries of every block, the split ones stop at the first alarm
+	dev.offline = 1;
+	err += read_alarms("offline", 3 * (blocks - 2) + 3 + 3, MB_MRE_TIMEDOUT);
+
+	return err;
+}
+
+int main(int argc, char *argv[])
+{
+	long iterations = (argc > 1) ? atol(argv[1]) : BENCH_ITERATIONS;
+	double ns_check, ns_arena, ns_old;
+	int err = 0;
+
+	model_build();
+	create_values_buffers();
+	PollEngine__CreateTables();
+	SetAllErrors(MB_MRE_NO_ERR);
+
+	err += check_arena();
+
+	ns_check = bench(BENCH_CHECK_HR_IR, iterations);
+	ns_arena = bench(BENCH_ARENA, iterations);
+	ns_old = bench(BENCH_OLD, iterations);
+	if (values_buffer_count != 0)
+		err++;
+	printf("%s no value sent by the compare pass of the same reads\n", values_buffer_count ? "FAIL" : "ok  ");
+	printf("bench compare pass of the high polling, %d HR + %d IR: check_hr_ir_read_val %.0f ns, "
+		   "arena %.0f ns, old records %.0f ns (x%.2f)\n",
+		   MODEL_VARS, MODEL_VARS, ns_check, ns_arena, ns_old, ns_old / ns_arena);
+
+	err += check_alarms();
+
+	printf("%s\n", err ? "polling_test FAILED" : "polling_test OK");
+	return err ? 1 : 0;
+}
@@ -0,0 +1,216 @@
+/**
+ * @file   req_keys_test.c
+ * @author carel
+ * @date   18 Oct 2026
+ * @brief  host test of the perfect hash of the request keys
+ *         (CBOR_ReqKeys_CAREL.h):
+ *           - every key of REQ_FIELDS has its own slot (a collision doesn't
+ *             even build, see ReqKey__SlotUsed)
+ *           - fuzz: random and mutated keys are found by the hash lookup
+ *             of CBOR_ReqWalk if and only if a linear search finds them
+ *           - benchmark of the lookup against the linear search
+ *
+ *         usage: req_keys_test [fuzz iterations]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "CBOR_ReqKeys_CAREL.h"
+
+#define FUZZ_ITERATIONS		2000000
+#define BENCH_ITERATIONS	20000000
+
+typedef struct{
+	C_UINT32 key;
+	C_BYTE used;
+}slot_t;
+
+#define KEY_SLOT(a,b,c, member, type, hdr)	[REQ_KEY_SLOT(REQ_KEY(a,b,c))] = { REQ_KEY(a,b,c), 1 },
+#define KEY_TEXT(a,b,c, member, type, hdr)	{ (a), (b), (c), 0 },
+
+/* same layout of req_fields of CBOR_CAREL.c */
+static const slot_t slots[REQ_KEY_SLOTS] = { REQ_FIELDS(KEY_SLOT) };
+static const char keys[][REQ_KEY_SIZE + 1] = { REQ_FIELDS(KEY_TEXT) };
+#define KEYS_NUM	(sizeof(keys) / sizeof(keys[0]))
+
+static C_UINT32 rnd_state = 0x12345678;
+
+static C_UINT32 rnd(void)
+{
+	rnd_state ^= rnd_state << 13;
+	rnd_state ^= rnd_state >> 17;
+	rnd_state ^= rnd_state << 5;
+	return rnd_state;
+}
+
+/* the lookup of CBOR_ReqWalk, -1 unknown key */
+static int hash_find(const char *tag, size_t len)
+{
+	C_UINT32 key = ReqKey__Pack(tag, len);
+	const slot_t *s;
+
+	if (key == 0)
+		return -1;
+
+	s = &slots[REQ_KEY_SLOT(key)];
+	if ((s->used == 0) || (s->key != key))
+		return -1;
+
+	return (int)REQ_KEY_SLOT(key);
+}
+
+/* reference, the keys compared one by one */
+static int linear_find(const char *tag, size_t len)
+{
+	for (size_t i = 0; i < KEYS_NUM; i++)
+	{
+		if ((strlen(keys[i]) == len) && (memcmp(keys[i], tag, len) == 0))
+			return (int)REQ_KEY_SLOT(ReqKey__Pack(keys[i], len));
+	}
+	return -1;
+}
+
+static int check_slots(void)
+{
+	int used = 0, err = 0;
+
+	for (C_UINT32 i = 0; i < REQ_KEY_SLOTS; i++)
+	{
+		if (slots[i].used != ReqKey__SlotUsed(i))
+		{
+			printf("FAIL slot %u: table and ReqKey__SlotUsed disagree\n", (unsigned)i);
+			err++;
+		}
+		used += slots[i].used;
+	}
+
+	// a key overwritten by another one in the same slot is lost
+	if (used != (int)KEYS_NUM)
+	{
+		printf("FAIL %d keys in %d slots, change REQ_KEY_HASH_MUL\n", (int)KEYS_NUM, used);
+		err++;
+	}
+
+	for (size_t i = 0; i < KEYS_NUM; i++)
+	{
+		if (hash_find(keys[i], strlen(keys[i])) < 0)
+		{
+			printf("FAIL key \"%s\" not found\n", keys[i]);
+			err++;
+		}
+	}
+
+	printf("slots: %d keys in %d slots of %d\n", (int)KEYS_NUM, used, REQ_KEY_SLOTS);
+	return err;
+}
+
+static void fuzz_tag(char *tag, size_t *len)
+{
+	const char *k = keys[rnd() % KEYS_NUM];
+	C_UINT32 r = rnd();
+
+	*len = rnd() % (REQ_KEY_SIZE + 3);
+
+	switch (r % 4)
+	{
+		case 0:		// any byte
+			for (size_t i = 0; i < *len; i++)
+				tag[i] = (char)rnd();
+			break;
+
+		case 1:		// lower case letters and NUL
+			for (size_t i = 0; i < *len; i++)
+				tag[i] = ((rnd() % 8) == 0) ? 0 : (char)('a' + rnd() % 26);
+			break;
+
+		default:	// a known key, truncated/extended and with a char changed
+			memset(tag, 0, REQ_KEY_SIZE + 2);
+			memcpy(tag, k, strlen(k));
+			if ((r % 4) == 2)
+				*len = strlen(k);
+			if (rnd() % 2)
+				tag[rnd() % (REQ_KEY_SIZE + 2)] ^= (char)(1 << (rnd() % 8));
+			break;
+	}
+}
+
+static int fuzz(unsigned long iterations)
+{
+	char tag[REQ_KEY_SIZE + 2];
+	size_t len;
+	unsigned long hits = 0;
+
+	for (unsigned long n = 0; n < iterations; n++)
+	{
+		fuzz_tag(tag, &len);
+
+		int h = hash_find(tag, len);
+		if (h != linear_find(tag, len))
+		{
+			printf("FAIL fuzz: len %u tag %02x %02x %02x %02x %02x, hash %d\n", (unsigned)len,
+			       (C_BYTE)tag[0], (C_BYTE)tag[1], (C_BYTE)tag[2], (C_BYTE)tag[3], (C_BYTE)tag[4], h);
+			return 1;
+		}
+		hits += (h >= 0);
+	}
+
+	printf("fuzz: %lu tags, %lu known keys\n", iterations, hits);
+	return 0;
+}
+
+static double elapsed_ns(const struct timespec *t0)
+{
+	struct timespec t1;
+	clock_gettime(CLOCK_MONOTONIC, &t1);
+	return (t1.tv_sec - t0->tv_sec) * 1e9 + (t1.tv_nsec - t0->tv_nsec);
+}
+
+static void bench(void)
+{
+	static char tags[1024][REQ_KEY_SIZE + 1];
+	static size_t lens[1024];
+	struct timespec t0;
+	volatile int sink = 0;
+	double hash_ns, linear_ns;
+
+	// keys as in the requests, some unknown
+	for (int i = 0; i < 1024; i++)
+	{
+		if (i % 8)
+			strcpy(tags[i], keys[rnd() % KEYS_NUM]);
+		else
+			strcpy(tags[i], "zzz");
+		lens[i] = strlen(tags[i]);
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+	for (long n = 0; n < BENCH_ITERATIONS; n++)
+		sink += hash_find(tags[n & 1023], lens[n & 1023]);
+	hash_ns = elapsed_ns(&t0) / BENCH_ITERATIONS;
+
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+	for (long n = 0; n < BENCH_ITERATIONS; n++)
+		sink += linear_find(tags[n & 1023], lens[n & 1023]);
+	linear_ns = elapsed_ns(&t0) / BENCH_ITERATIONS;
+
+	printf("bench: hash %.1f ns/key, linear %.1f ns/key (%d keys)\n", hash_ns, linear_ns, (int)KEYS_NUM);
+	(void)sink;
+}
+
+int main(int argc, char *argv[])
+{
+	unsigned long iterations = (argc > 1) ? strtoul(argv[1], NULL, 0) : FUZZ_ITERATIONS;
+	int err;
+
+	err = check_slots();
+	err += fuzz(iterations);
+
+	if (err == 0)
+		bench();
+
+	printf("%s\n", err ? "req_keys_test FAILED" : "req_keys_test OK");
+	return err ? 1 : 0;
+}
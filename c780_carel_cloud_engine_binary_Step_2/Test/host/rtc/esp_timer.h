@@ -0,0 +1,9 @@
+/**
+ * @file   esp_timer.h
+ * @brief  host stub: the monotonic clock, set by the test
+ */
+#pragma once
+
+#include <stdint.h>
+
+int64_t esp_timer_get_time(void);
@@ -0,0 +1,28 @@
+/**
+ * @file   sntp.h
+ * @brief  host stub: the SNTP client, the sync is notified by the test
+ */
+#ifndef __SNTP_H__
+#define __SNTP_H__
+
+#include <time.h>
+#include <sys/time.h>
+
+#define SNTP_OPMODE_POLL	0
+
+typedef enum {
+    SNTP_SYNC_STATUS_RESET,
+    SNTP_SYNC_STATUS_COMPLETED,
+    SNTP_SYNC_STATUS_IN_PROGRESS,
+} sntp_sync_status_t;
+
+typedef void (*sntp_sync_time_cb_t) (struct timeval *tv);
+
+void sntp_stop(void);
+void sntp_init(void);
+void sntp_setoperatingmode(unsigned char operating_mode);
+void sntp_setservername(unsigned char idx, const char *server);
+void sntp_set_time_sync_notification_cb(sntp_sync_time_cb_t callback);
+sntp_sync_status_t sntp_get_sync_status(void);
+
+#endif
@@ -0,0 +1,4 @@
+/**
+ * @file   err.h
+ * @brief  host stub, nothing is used
+ */
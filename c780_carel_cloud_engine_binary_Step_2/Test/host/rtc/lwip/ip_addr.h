@@ -0,0 +1,4 @@
+/**
+ * @file   ip_addr.h
+ * @brief  host stub, nothing is used
+ */
@@ -0,0 +1,12 @@
+/**
+ * @file   sys_IS.h
+ * @brief  host stub: only the delay
+ */
+#ifndef SYS_IS_H_
+#define SYS_IS_H_
+
+#include "data_types_CAREL.h"
+
+void Sys__Delay(C_UINT32 delay);
+
+#endif
@@ -0,0 +1,171 @@
+/**
+ * @file   rtc_test.c
+ * @author carel
+ * @date   18 Oct 2026
+ * @brief  host test of the sample stamps of RTC_IS.c:
+ *           - before the NTP sync the stamps are the seconds from boot and
+ *             RTC_Rebase_Sample_Time leaves them as they are
+ *           - the sync notified by SNTP takes the UTC offset of the
+ *             monotonic clock
+ *           - RTC_Rebase_Sample_Time of a stamp taken before the sync is
+ *             the stamp taken after it: the carry of the milliseconds into
+ *             the seconds, and random times and offsets. The offset is in
+ *             us and the stamp in ms, so the rebased stamp can be 1 ms
+ *             before, never when the offset is a whole ms
+ *           - the UTC stamps and a NULL ms are left as they are
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* the copy in rtc/, the static offset is set by the test too */
+#include "RTC_IS.c"
+
+#define RANDOM_STAMPS		100000
+#define UTC_2026			1792312345LL		// 18 Oct 2026
+
+static int64_t mono_now_us;
+static sntp_sync_time_cb_t sync_cb;
+
+static uint32_t rnd_state = 0x12345678;
+
+static uint32_t rnd(void)
+{
+	rnd_state ^= rnd_state << 13;
+	rnd_state ^= rnd_state >> 17;
+	rnd_state ^= rnd_state << 5;
+	return rnd_state;
+}
+
+/* ==== stubs of the platform ==== */
+
+int64_t esp_timer_get_time(void)	{ return mono_now_us; }
+void Sys__Delay(C_UINT32 delay) {}
+
+void sntp_stop(void) {}
+void sntp_init(void) {}
+void sntp_setoperatingmode(unsigned char operating_mode) {}
+void sntp_setservername(unsigned char idx, const char *server) {}
+void sntp_set_time_sync_notification_cb(sntp_sync_time_cb_t callback)	{ sync_cb = callback; }
+sntp_sync_status_t sntp_get_sync_status(void)	{ return SNTP_SYNC_STATUS_COMPLETED; }
+
+/* ==== the tests ==== */
+
+/* the stamp of mono_us before the sync, rebased with the offset */
+static int64_t rebased_ms(C_UINT64 mono_us, int64_t offset_us, C_UINT16 *ms)
+{
+	C_TIME t;
+
+	Synced = C_FALSE;
+	t = RTC_Mono_To_Sample_Time(mono_us, ms);
+	Synced = C_TRUE;
+	Utc_Offset_us = offset_us;
+	t = RTC_Rebase_Sample_Time(t, ms);
+	return (int64_t)t * 1000 + *ms;
+}
+
+/* the stamp of mono_us after the sync */
+static int64_t direct_ms(C_UINT64 mono_us, int64_t offset_us)
+{
+	C_UINT16 ms;
+	C_TIME t;
+
+	Synced = C_TRUE;
+	Utc_Offset_us = offset_us;
+	t = RTC_Mono_To_Sample_Time(mono_us, &ms);
+	return (int64_t)t * 1000 + ms;
+}
+
+static int rebase(const char *name, C_UINT64 mono_us, int64_t offset_us, C_TIME exp_t, C_UINT16 exp_ms)
+{
+	C_UINT16 ms;
+	int64_t t_ms = rebased_ms(mono_us, offset_us, &ms);
+	int err = (t_ms != (int64_t)exp_t * 1000 + exp_ms);
+
+	printf("%s %s: %lld.%03u\n", err ? "FAIL" : "ok  ", name, (long long)(t_ms / 1000), (unsigned)ms);
+	return err;
+}
+
+int main(void)
+{
+	C_URI server = "pool.ntp.org";
+	C_UINT16 ms;
+	C_TIME t;
+	int err = 0, fails = 0, late = 0;
+
+	// before the sync
+	RTC_Init(server, 123);
+	t = RTC_Mono_To_Sample_Time(5999600, &ms);
+	if ((t != 5) || (ms != 999) || (RTC_Rebase_Sample_Time(t, &ms) != 5) || (ms != 999) || RTC_IsSynced())
+		err++;
+	printf("%s before the sync: %u.%03u from boot, not rebased\n", err ? "FAIL" : "ok  ", (unsigned)t, (unsigned)ms);
+
+	// the sync of SNTP, the system clock of the host is the UTC
+	mono_now_us = 3600 * 1000000LL;
+	if (sync_cb != NULL)
+		sync_cb(NULL);
+	{
+		struct timeval now;
+		int64_t exp;
+
+		gettimeofday(&now, NULL);
+		exp = (int64_t)now.tv_sec * 1000000 + now.tv_usec - mono_now_us;
+		if (!RTC_IsSynced() || (llabs(Utc_Offset_us - exp) > 1000000))
+		{
+			printf("FAIL sync: offset %lld us, %lld expected\n", (long long)Utc_Offset_us, (long long)exp);
+			err++;
+		}
+		else
+			printf("ok   sync: offset of the monotonic clock taken\n");
+	}
+
+	// the carry of the ms
+	err += rebase("no carry", 5200000, UTC_2026 * 1000000 + 300000, UTC_2026 + 5, 500);
+	err += rebase("carry of the ms", 5999000, UTC_2026 * 1000000 + 1000, UTC_2026 + 6, 0);
+	err += rebase("carry of 998 ms", 5999000, UTC_2026 * 1000000 + 999000, UTC_2026 + 6, 998);
+	err += rebase("carry at the minute", 59999000, UTC_2026 * 1000000 + 1000, UTC_2026 + 60, 0);
+	// the 600 us lost by the ms of the stamp
+	err += rebase("sub-ms offset", 5999600, UTC_2026 * 1000000 + 500, UTC_2026 + 5, 999);
+
+	// random times up to 49 days and offsets, against the stamps taken after the sync
+	for (int i = 0; i < RANDOM_STAMPS; i++)
+	{
+		C_UINT64 mono_us = ((C_UINT64)rnd() << 10 | (rnd() & 1023)) % (49ULL * 86400 * 1000000);
+		int64_t offset_us = (UTC_2026 - 86400 * (rnd() % 3650)) * 1000000 + rnd() % 1000000;
+		int whole_ms = (i & 1);
+		int64_t got, exp;
+
+		if (whole_ms)
+			offset_us -= offset_us % 1000;
+		got = rebased_ms(mono_us, offset_us, &ms);
+		exp = direct_ms(mono_us, offset_us);
+		late += (got != exp);
+		if ((ms > 999) || (got > exp) || (got < exp - 1) || (whole_ms && (got != exp)))
+		{
+			if (fails++ < 10)
+				printf("FAIL mono %llu us, offset %lld us: %lld ms, %lld expected\n",
+					   (unsigned long long)mono_us, (long long)offset_us, (long long)got, (long long)exp);
+		}
+	}
+	printf("%s %d random stamps rebased, %d of them 1 ms before (sub-ms offsets only)\n",
+		   fails ? "FAIL" : "ok  ", RANDOM_STAMPS, late);
+	err += fails;
+
+	// UTC stamps, and NULL ms
+	Synced = C_TRUE;
+	Utc_Offset_us = UTC_2026 * 1000000 + 999000;
+	ms = 250;
+	if ((RTC_Rebase_Sample_Time(UTC_2026, &ms) != UTC_2026) || (ms != 250) ||
+		(RTC_Rebase_Sample_Time(RTC_UTC_VALID_MIN, &ms) != RTC_UTC_VALID_MIN) || (ms != 250) ||
+		(RTC_Rebase_Sample_Time(5, NULL) != UTC_2026 + 5))
+	{
+		printf("FAIL UTC stamps and NULL ms\n");
+		err++;
+	}
+	else
+		printf("ok   UTC stamps left as they are, NULL ms\n");
+
+	printf("%s\n", err ? "rtc_test FAILED" : "rtc_test OK");
+	return err ? 1 : 0;
+}